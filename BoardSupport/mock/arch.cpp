@@ -4,33 +4,93 @@
 #include <arch/aarch64/ints.hpp>
 #include <arch/aarch64/thread.hpp>
 
+#include <vmm/pte.hpp>
+#include <kern_runtime.hpp>
+
 #include <Proc/kern_cpu.hpp>
 #include <Proc/kern_thread.hpp>
 #include <System/Syscalls/Syscalls.hpp>
 
+#include <sched.h>
 #include <stdio.h>
+#include <time.h>
 
 void createprocess_tail()
 {
 
 }
 
-void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT32 RegOffset)
+void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT64 RegOffset)
 {
-	
+	PANTHEON_UNUSED(Old);
+	PANTHEON_UNUSED(New);
+	PANTHEON_UNUSED(RegOffset);
 }
 
+static thread_local UINT8 MockCoreNo = 0;
+
 UINT8 pantheon::CPU::GetProcessorNumber()
 {
-	return 0;
+	return MockCoreNo;
+}
+
+VOID pantheon::CPU::MockSetProcessorNumber(UINT8 CoreNo)
+{
+	MockCoreNo = CoreNo;
+}
+
+/* Every mock core always has its own area loaded, so there's nothing to set. */
+VOID *pantheon::CPU::GetPerCoreArea()
+{
+	return pantheon::CPU::GetCoreArea(MockCoreNo);
+}
+
+VOID pantheon::CPU::SetPerCoreArea(VOID *Area)
+{
+	PANTHEON_UNUSED(Area);
+}
+
+static UINT64 MockIntsOffAt[MAX_NUM_CPUS];
+static VOID (*MockHoldHook)(UINT64 Nanos) = nullptr;
+
+static UINT64 MockHostNanos()
+{
+	struct timespec Now = {};
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (static_cast<UINT64>(Now.tv_sec) * 1000000000ULL) + static_cast<UINT64>(Now.tv_nsec);
 }
 
 VOID pantheon::CPU::CLI()
 {
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	if (MockIntsOffAt[CoreNo] == 0)
+	{
+		MockIntsOffAt[CoreNo] = MockHostNanos();
+	}
 }
 
 VOID pantheon::CPU::STI()
 {
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	UINT64 OffAt = MockIntsOffAt[CoreNo];
+	MockIntsOffAt[CoreNo] = 0;
+	if (OffAt != 0 && MockHoldHook != nullptr)
+	{
+		MockHoldHook(MockHostNanos() - OffAt);
+	}
+}
+
+VOID pantheon::CPU::MockSetHoldHook(VOID (*Hook)(UINT64 Nanos))
+{
+	MockHoldHook = Hook;
+}
+
+/* Nothing ever really interrupts a mock core, so as far as PUSHI and
+ * POPI can tell, interrupts were always on before: the last POPI always
+ * turns them back on, which ends the hold. */
+BOOL pantheon::CPU::IF()
+{
+	return TRUE;
 }
 
 VOID pantheon::CPU::PAUSE()
@@ -38,6 +98,62 @@ VOID pantheon::CPU::PAUSE()
 
 }
 
+VOID pantheon::CPU::WFE()
+{
+	sched_yield();
+}
+
+VOID pantheon::CPU::SEV()
+{
+
+}
+
+VOID pantheon::CPU::WaitForChange(const UINT16 *Addr, UINT16 Value)
+{
+	if (__atomic_load_n(Addr, __ATOMIC_ACQUIRE) == Value)
+	{
+		sched_yield();
+	}
+}
+
+VOID pantheon::CPU::WaitForChange(const UINT32 *Addr, UINT32 Value)
+{
+	if (__atomic_load_n(Addr, __ATOMIC_ACQUIRE) == Value)
+	{
+		sched_yield();
+	}
+}
+
+VOID pantheon::CPU::WaitForChange(const UINT64 *Addr, UINT64 Value)
+{
+	if (__atomic_load_n(Addr, __ATOMIC_ACQUIRE) == Value)
+	{
+		sched_yield();
+	}
+}
+
+static UINT64 MockIPICount[MAX_NUM_CPUS];
+
+VOID pantheon::CPU::IPI(UINT8 CoreNo)
+{
+	MockIPICount[CoreNo]++;
+}
+
+UINT64 pantheon::CPU::MockIPIs(UINT8 CoreNo)
+{
+	return MockIPICount[CoreNo];
+}
+
+UINT64 pantheon::CPU::ReadCycleCounter()
+{
+	return MockHostNanos();
+}
+
+VOID pantheon::CPU::ZeroPage(VOID *Page)
+{
+	ClearBuffer(reinterpret_cast<CHAR*>(Page), pantheon::vmm::SmallestPageSize);
+}
+
 VOID pantheon::RearmSystemTimer()
 {
 
@@ -48,9 +164,36 @@ VOID pantheon::RearmSystemTimer(UINT64 Freq)
 
 }
 
+static UINT64 MockTicks = 0;
+static BOOL MockTimerOn[MAX_NUM_CPUS];
+static UINT64 MockTimerAt[MAX_NUM_CPUS];
+
 VOID pantheon::DisableSystemTimer()
 {
+	MockTimerOn[pantheon::CPU::GetProcessorNumber()] = FALSE;
+}
+
+VOID pantheon::ArmSystemTimer(UINT64 Ticks)
+{
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	MockTimerOn[CoreNo] = TRUE;
+	MockTimerAt[CoreNo] = MockTicks + Ticks;
+}
+
+UINT64 pantheon::MockTimerDeadline()
+{
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	return MockTimerOn[CoreNo] ? MockTimerAt[CoreNo] : ~0ULL;
+}
+
+UINT64 pantheon::GetSystemTicks()
+{
+	return MockTicks;
+}
 
+VOID pantheon::MockAdvanceTicks(UINT64 Ticks)
+{
+	MockTicks += Ticks;
 }
 
 extern "C" INT32 CallSMC(UINT64 X0, UINT64 X1, UINT64 X2, UINT64 X3)
@@ -99,27 +242,57 @@ VOID PerCoreBoardInit()
 	
 }
 
-VOID pantheon::CPU::PUSHI()
+VOID pantheon::CPU::HLT()
 {
-	pantheon::CPU::CoreInfo *CoreInfo = pantheon::CPU::GetCoreInfo();
-	CoreInfo->NOff++;
+	return;
 }
 
-VOID pantheon::CPU::POPI()
+static BOOL MockFPUOn[MAX_NUM_CPUS];
+static UINT64 MockFRegs[MAX_NUM_CPUS][2 * pantheon::CpuContext::NumFRegs];
+static UINT64 MockFPUSaveCount = 0;
+
+VOID pantheon::CPU::FPUEnable()
 {
-	pantheon::CPU::CoreInfo *CoreInfo = pantheon::CPU::GetCoreInfo();
-	CoreInfo->NOff--;
+	MockFPUOn[pantheon::CPU::GetProcessorNumber()] = TRUE;
 }
 
-VOID pantheon::CPU::HLT()
+VOID pantheon::CPU::FPUDisable()
 {
-	return;
+	MockFPUOn[pantheon::CPU::GetProcessorNumber()] = FALSE;
+}
+
+BOOL pantheon::CPU::FPUEnabled()
+{
+	return MockFPUOn[pantheon::CPU::GetProcessorNumber()];
+}
+
+VOID pantheon::CPU::FPUSave(pantheon::CpuContext *Context)
+{
+	UINT64 *Regs = MockFRegs[pantheon::CPU::GetProcessorNumber()];
+	for (UINT64 Index = 0; Index < 2 * pantheon::CpuContext::NumFRegs; ++Index)
+	{
+		Context->FRegs[Index] = Regs[Index];
+	}
+	MockFPUSaveCount++;
+}
+
+VOID pantheon::CPU::FPURestore(pantheon::CpuContext *Context)
+{
+	UINT64 *Regs = MockFRegs[pantheon::CPU::GetProcessorNumber()];
+	for (UINT64 Index = 0; Index < 2 * pantheon::CpuContext::NumFRegs; ++Index)
+	{
+		Regs[Index] = Context->FRegs[Index];
+	}
+}
+
+UINT64 *pantheon::CPU::MockFPURegs()
+{
+	return MockFRegs[pantheon::CPU::GetProcessorNumber()];
 }
 
-UINT64 pantheon::CPU::ICOUNT()
+UINT64 pantheon::CPU::MockFPUSaves()
 {
-	pantheon::CPU::CoreInfo *CoreInfo = pantheon::CPU::GetCoreInfo();
-	return CoreInfo->NOff;	
+	return MockFPUSaveCount;
 }
 
 VOID pantheon::CPU::LIDT(void *Loc)
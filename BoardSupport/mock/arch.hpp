@@ -10,7 +10,15 @@ namespace pantheon
 }
 
 extern "C" void createprocess_tail();
-extern "C" void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT32 RegOffset);
+extern "C" void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT64 RegOffset);
+
+namespace pantheon::ipc
+{
+	inline void SetThreadLocalRegion(UINT64 Value)
+	{
+		PANTHEON_UNUSED(Value);
+	}
+}
 
 namespace pantheon
 {
@@ -139,6 +147,12 @@ typedef struct TrapFrame
 		this->PSTATE = 1;
 	}
 
+	template<typename T>
+	T &GetRawArgument(UINT8 Index)
+	{
+		return (T&)this->Regs[Index];
+	}
+
 	UINT64 &GetIntArgument(UINT8 Index)
 	{
 		return this->Regs[Index];
@@ -150,14 +164,33 @@ VOID RearmSystemTimer();
 VOID RearmSystemTimer(UINT64 Freq);
 
 VOID DisableSystemTimer();
+VOID ArmSystemTimer(UINT64 Ticks);
+UINT64 GetSystemTicks();
+
+/* Lets a test pretend some amount of time passed. */
+VOID MockAdvanceTicks(UINT64 Ticks);
+
+/* When the current core's timer would go off, or ~0 if it's disabled. */
+UINT64 MockTimerDeadline();
 
 namespace CPU
 {
 
 UINT8 GetProcessorNumber();
 
+/* Lets a test pretend the calling host thread is some other core. */
+VOID MockSetProcessorNumber(UINT8 CoreNo);
+
+VOID *GetPerCoreArea();
+VOID SetPerCoreArea(VOID *Area);
+
 VOID CLI();
 VOID STI();
+BOOL IF();
+
+/* Called with how long, in host nanoseconds, a core kept interrupts
+ * off for: that is, how long it held some spinlock. */
+VOID MockSetHoldHook(VOID (*Hook)(UINT64 Nanos));
 
 VOID PUSHI();
 VOID POPI();
@@ -167,6 +200,36 @@ UINT64 ICOUNT();
 
 VOID PAUSE();
 
+/* There's no way to be woken up by another host thread, so WFE just lets
+ * some other one run instead. */
+VOID WFE();
+VOID SEV();
+
+VOID WaitForChange(const UINT16 *Addr, UINT16 Value);
+VOID WaitForChange(const UINT32 *Addr, UINT32 Value);
+VOID WaitForChange(const UINT64 *Addr, UINT64 Value);
+
+/* Nothing is really interrupted: IPIs are only counted, for tests. */
+VOID IPI(UINT8 CoreNo);
+UINT64 MockIPIs(UINT8 CoreNo);
+
+/* Counts host nanoseconds. */
+UINT64 ReadCycleCounter();
+
+VOID ZeroPage(VOID *Page);
+
+VOID FPUEnable();
+VOID FPUDisable();
+BOOL FPUEnabled();
+VOID FPUSave(pantheon::CpuContext *Context);
+VOID FPURestore(pantheon::CpuContext *Context);
+
+/* Lets a test look at, or pretend to use, the FP registers of the current core. */
+UINT64 *MockFPURegs();
+
+/* How many times the FP registers were saved, on any core. */
+UINT64 MockFPUSaves();
+
 }
 
 }
@@ -24,6 +24,10 @@ FORCE_INLINE VOID W_TTBR0_EL1(UINT64 Val)
 {
 }
 
+FORCE_INLINE VOID W_TTBR0_EL1_NOFLUSH(UINT64 Val)
+{
+}
+
 FORCE_INLINE VOID W_TTBR1_EL1(UINT64 Val)
 {
 }
@@ -225,6 +225,13 @@ public:
 	[[nodiscard]] constexpr FORCE_INLINE PageSharableType GetSharable() const { return static_cast<PageSharableType>(this->GetMaskedBits(8, 2)); };
 	[[nodiscard]] constexpr FORCE_INLINE PageAccessed GetAccessor() const { return static_cast<PageAccessed>(this->GetMaskedBits(10, 1)); };
 
+	/**
+	 * \~english @brief Checks if this entry only applies to the address space of one ASID
+	 * \~english @author Brian Schnepp
+	 * \~english @return TRUE if not global, FALSE otherwise.
+	 */
+	[[nodiscard]] constexpr FORCE_INLINE BOOL IsNonGlobal() const { return this->GetBits(11, 1) != 0; };
+
 	/**
 	 * \~english @brief Obtains the value of the Execute Never bit for the kernel at this level
 	 * \~english @author Brian Schnepp
@@ -304,6 +311,16 @@ public:
 	constexpr FORCE_INLINE VOID SetSharable(PageSharableType Value) { this->SetBitsRaw(8, 2, Value); }
 	constexpr FORCE_INLINE VOID SetAccessor(PageAccessed Value) { this->SetBitsRaw(10, 1, Value); };
 
+	/**
+	 * \~english @brief Sets this block as only applying to the current ASID
+	 * \~english @details Entries which aren't global are tagged with the
+	 * ASID in TTBR0 when they're cached in the TLB, so they don't need to be
+	 * flushed when switching address spaces.
+	 * \~english @param Value TRUE for not global, FALSE otherwise
+	 * \~english @author Brian Schnepp
+	 */
+	constexpr FORCE_INLINE VOID SetNonGlobal(BOOL Value) { this->SetBits(11, 1, Value != 0); };
+
 	/**
 	 * \~english @brief Sets this block as not being executable in kernel space
 	 * \~english @param Value TRUE for not-executable in kernel space, FALSE otherwise
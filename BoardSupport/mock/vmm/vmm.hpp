@@ -37,6 +37,20 @@ FORCE_INLINE PhysicalAddress VirtualToPhysicalAddress(PageTable *RootTable, Virt
 	return VirtAddr;
 }
 
+FORCE_INLINE VOID InvalidateLocalTLB()
+{
+}
+
+FORCE_INLINE VOID InvalidateASID(UINT64 ASID)
+{
+	PANTHEON_UNUSED(ASID);
+}
+
+constexpr FORCE_INLINE UINT64 MakeTTBR(PhysicalAddress Table, UINT64 ASID)
+{
+	return (ASID << 48) | (Table & 0xFFFFFFFFFFFE);
+}
+
 
 class PageAllocator
 {
@@ -80,6 +94,11 @@ public:
 		return TRUE;
 	}
 
+	VOID Release(pantheon::vmm::PageTable *TTBR)
+	{
+		PANTHEON_UNUSED(TTBR);
+	}
+
 	FORCE_INLINE BOOL MapLower(pantheon::vmm::PageTable *TTBR, pantheon::vmm::VirtualAddress VirtAddr, pantheon::vmm::PhysicalAddress PhysAddr, UINT64 Size, const pantheon::vmm::PageTableEntry &Permissions)
 	{
 		return TRUE;
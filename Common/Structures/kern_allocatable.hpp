@@ -17,9 +17,9 @@ public:
 
 	static void Init()
 	{
-		AllocSpinlock = pantheon::Spinlock("Allocatable Lock");
-		ClearBuffer((CHAR*)Items, sizeof(T) * Count);
-		Allocator = pantheon::mm::SlabCache<T>(Items, Count);
+		AllocSpinlock = pantheon::QueuedSpinlock("Allocatable Lock");
+		ClearBuffer((CHAR*)Items(), sizeof(T) * Count);
+		Allocator = pantheon::mm::SlabCache<T>(Items(), Count);
 	}
 
 	static T *Create()
@@ -40,11 +40,18 @@ public:
 
 
 private:
-	inline static pantheon::Spinlock AllocSpinlock;
+	inline static pantheon::QueuedSpinlock AllocSpinlock;
 
 	/* TODO: Use SlabAllocator instead! */
 
-	inline static T Items[Count];
+	/* Only the space for them: the slab hands these out, so nothing
+	 * should construct or destroy them along with the pool. */
+	static VOID *Items()
+	{
+		alignas(T) static UINT8 Space[sizeof(T) * Count];
+		return Space;
+	}
+
 	inline static pantheon::mm::SlabCache<T> Allocator;
 
 };
@@ -0,0 +1,148 @@
+#include <kern_datatypes.hpp>
+#include <Common/Sync/kern_atomic.hpp>
+
+#ifndef _KERN_IDALLOC_HPP_
+#define _KERN_IDALLOC_HPP_
+
+namespace pantheon
+{
+
+/**
+ * @brief Hands out small integer IDs, and takes them back when they're freed.
+ * @details The lowest free slot is always picked, so IDs stay dense. Each
+ * slot also counts how many times it was freed: that generation goes in the
+ * upper bits of the ID. An ID kept around after it was freed won't match
+ * whatever gets that slot next. Nothing here takes a lock.
+ * @tparam Count How many IDs can be live at once. Must be a power of two.
+ */
+template<UINT32 Count>
+class IDAllocator
+{
+public:
+	static_assert(Count != 0 && (Count & (Count - 1)) == 0);
+
+	static constexpr UINT32 Invalid = 0xFFFFFFFF;
+
+	/**
+	 * @brief Creates an allocator with every ID free
+	 * @param Reserved How many of the lowest IDs to never hand out
+	 */
+	explicit IDAllocator(UINT32 Reserved = 0)
+	{
+		for (pantheon::Atomic<UINT64> &Word : this->Words)
+		{
+			Word.Store(0);
+		}
+
+		for (pantheon::Atomic<UINT32> &Gen : this->Generations)
+		{
+			Gen.Store(0);
+		}
+
+		for (UINT32 Index = 0; Index < Reserved && Index < Count; ++Index)
+		{
+			UINT64 Word = this->Words[Index / 64].Load();
+			this->Words[Index / 64].Store(Word | (1ULL << (Index % 64)));
+		}
+	}
+
+	~IDAllocator() = default;
+
+	/**
+	 * @brief Takes the lowest free ID
+	 * @return The new ID, or Invalid if every ID is in use
+	 */
+	UINT32 Acquire()
+	{
+		for (UINT32 WordNo = 0; WordNo < Count / 64 + (Count % 64 != 0); ++WordNo)
+		{
+			UINT64 Word = this->Words[WordNo].Load();
+			while (~Word != 0)
+			{
+				UINT32 Bit = __builtin_ctzll(~Word);
+				UINT32 Slot = WordNo * 64 + Bit;
+				if (Slot >= Count)
+				{
+					break;
+				}
+
+				if (this->Words[WordNo].CompareExchange(Word, Word | (1ULL << Bit)))
+				{
+					return Compose(Slot, this->Generations[Slot].Load());
+				}
+			}
+		}
+		return Invalid;
+	}
+
+	/**
+	 * @brief Frees an ID, so it can be handed out again
+	 * @return TRUE if ID was live and is now freed, FALSE if it was stale
+	 */
+	BOOL Release(UINT32 ID)
+	{
+		if (this->Valid(ID) == FALSE)
+		{
+			return FALSE;
+		}
+
+		/* The new generation has to be there before anyone can take the slot. */
+		UINT32 Slot = IDAllocator::SlotOf(ID);
+		this->Generations[Slot].FetchAdd(1);
+
+		UINT64 Mask = 1ULL << (Slot % 64);
+		UINT64 Word = this->Words[Slot / 64].Load();
+		while (this->Words[Slot / 64].CompareExchange(Word, Word & ~Mask) == FALSE)
+		{
+		}
+		return TRUE;
+	}
+
+	/**
+	 * @brief Checks if an ID is still the one its slot was last given out as
+	 */
+	[[nodiscard]]
+	BOOL Valid(UINT32 ID) const
+	{
+		UINT32 Slot = IDAllocator::SlotOf(ID);
+		if ((this->Words[Slot / 64].Load() & (1ULL << (Slot % 64))) == 0)
+		{
+			return FALSE;
+		}
+		return ID == Compose(Slot, this->Generations[Slot].Load());
+	}
+
+	/**
+	 * @brief Gets which slot an ID uses: no two live IDs share one
+	 */
+	[[nodiscard]]
+	static constexpr UINT32 SlotOf(UINT32 ID)
+	{
+		return ID & (Count - 1);
+	}
+
+	/**
+	 * @brief Gets how many times the slot of an ID was freed before it was handed out
+	 */
+	[[nodiscard]]
+	static constexpr UINT32 GenerationOf(UINT32 ID)
+	{
+		return ID / Count;
+	}
+
+private:
+	[[nodiscard]]
+	static constexpr UINT32 Compose(UINT32 Slot, UINT32 Generation)
+	{
+		/* Skip the generation that would make this look like Invalid. */
+		UINT32 ID = (Generation * Count) | Slot;
+		return (ID == Invalid) ? Slot : ID;
+	}
+
+	pantheon::Atomic<UINT64> Words[Count / 64 + (Count % 64 != 0)];
+	pantheon::Atomic<UINT32> Generations[Count];
+};
+
+}
+
+#endif
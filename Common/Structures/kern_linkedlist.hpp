@@ -185,6 +185,40 @@ public:
 		return Item;
 	}
 
+	BOOL Remove(T *Item)
+	{
+		this->OperationSpinlock.Acquire();
+		LinkedListItem<T> *Prev = nullptr;
+		for (LinkedListItem<T> *Cur = this->Root; Cur != nullptr; Cur = Cur->GetNext())
+		{
+			if (Cur->GetValue() != Item)
+			{
+				Prev = Cur;
+				continue;
+			}
+
+			if (Prev == nullptr)
+			{
+				this->Root = Cur->GetNext();
+			}
+			else
+			{
+				Prev->SetNext(Cur->GetNext());
+			}
+
+			if (this->Tail == Cur)
+			{
+				this->Tail = Prev;
+			}
+			this->NumElem--;
+			LinkedListItem<T>::DestroyEntry(Cur);
+			this->OperationSpinlock.Release();
+			return TRUE;
+		}
+		this->OperationSpinlock.Release();
+		return FALSE;
+	}
+
 	[[nodiscard]] LinkedListIterator<T> begin() const
 	{
 		return LinkedListIterator<T>(this->Root);
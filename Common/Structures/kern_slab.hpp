@@ -134,11 +134,15 @@ public:
 			UINT64 BasePtr = Base + (Area * sizeof(T));
 			if (BasePtr == (UINT64)Ptr)
 			{
+				/* The link overwrites the start of the object, so
+				 * it has to be destroyed first. Don't go through
+				 * the vtable: objects from Allocate never had
+				 * theirs set up. */
+				Ptr->T::~T();
 				SlabNext<T> *Next = reinterpret_cast<SlabNext<T>*>(Ptr);
 				Next->Next = FreeList;
 				this->FreeList = Next;
 				this->Used--;
-				Ptr->~T();
 				return;
 			}
 		}
@@ -7,6 +7,23 @@
 namespace pantheon
 {
 
+/**
+ * @brief How an atomic operation is ordered against the memory accesses
+ * around it.
+ * @details These are exactly the orders the compiler builtins take. On
+ * a core with the ARMv8.1 atomics (LSE), a read-modify-write becomes a
+ * single LDADD, SWP or CAS with matching acquire and release bits;
+ * otherwise, it's a loop around an exclusive load and store.
+ */
+enum class MemoryOrder : INT32
+{
+	Relaxed = __ATOMIC_RELAXED,
+	Acquire = __ATOMIC_ACQUIRE,
+	Release = __ATOMIC_RELEASE,
+	AcqRel = __ATOMIC_ACQ_REL,
+	SeqCst = __ATOMIC_SEQ_CST,
+};
+
 template<typename T>
 class Atomic
 {
@@ -24,25 +41,60 @@ public:
 
 	~Atomic() = default;
 
+	/* Even tests race on these, so every operation is a real atomic. */
 	[[nodiscard]]
-	T Load() const
+	T Load(MemoryOrder Order = MemoryOrder::SeqCst) const
+	{
+		T RetVal;
+		__atomic_load(&(this->Content), &RetVal, static_cast<INT32>(Order));
+		return RetVal;
+	}
+
+	void Store(T Item, MemoryOrder Order = MemoryOrder::SeqCst)
+	{
+		__atomic_store(&(this->Content), &Item, static_cast<INT32>(Order));
+	}
+
+	/**
+	 * @brief Replaces the value, and gives back what it was before
+	 */
+	T Exchange(T Item, MemoryOrder Order = MemoryOrder::SeqCst)
 	{
 		T RetVal;
-		#ifndef ONLY_TESTS
-		__atomic_load(&(this->Content), &RetVal, __ATOMIC_SEQ_CST);
-		#else
-		RetVal = this->Content;
-		#endif
+		__atomic_exchange(&(this->Content), &Item, &RetVal, static_cast<INT32>(Order));
 		return RetVal;
 	}
 
-	void Store(T Item)
+	/**
+	 * @brief Adds to the value, and gives back what it was before
+	 * @details Only for integers and pointers.
+	 */
+	T FetchAdd(T Amount, MemoryOrder Order = MemoryOrder::SeqCst)
+	{
+		return __atomic_fetch_add(&(this->Content), Amount, static_cast<INT32>(Order));
+	}
+
+	/**
+	 * @brief Subtracts from the value, and gives back what it was before
+	 * @details Only for integers and pointers.
+	 */
+	T FetchSub(T Amount, MemoryOrder Order = MemoryOrder::SeqCst)
+	{
+		return __atomic_fetch_sub(&(this->Content), Amount, static_cast<INT32>(Order));
+	}
+
+	/**
+	 * @brief Replaces the value, but only if it's still what the caller expects
+	 * @param Expected What the value should be. If it isn't, this is set
+	 * to what the value actually was.
+	 * @param Desired The value to store
+	 * @param Order How this is ordered if the value is replaced. If it
+	 * isn't, nothing is stored, so any release half is dropped.
+	 * @return TRUE if the value was replaced, FALSE otherwise
+	 */
+	BOOL CompareExchange(T &Expected, T Desired, MemoryOrder Order = MemoryOrder::SeqCst)
 	{
-		#ifndef ONLY_TESTS
-		__atomic_store(&(this->Content), &Item, __ATOMIC_SEQ_CST);
-		#else
-		this->Content = Item;
-		#endif
+		return __atomic_compare_exchange(&(this->Content), &Expected, &Desired, false, static_cast<INT32>(Order), static_cast<INT32>(FailureOrder(Order)));
 	}
 
 	[[nodiscard]] 
@@ -68,6 +120,20 @@ public:
 	}
 
 private:
+	static constexpr MemoryOrder FailureOrder(MemoryOrder Order)
+	{
+		if (Order == MemoryOrder::Release)
+		{
+			return MemoryOrder::Relaxed;
+		}
+
+		if (Order == MemoryOrder::AcqRel)
+		{
+			return MemoryOrder::Acquire;
+		}
+		return Order;
+	}
+
 	T Content;
 
 };
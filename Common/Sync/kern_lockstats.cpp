@@ -0,0 +1,204 @@
+#include <arch.hpp>
+
+#include "kern_lockstats.hpp"
+#include "kern_datatypes.hpp"
+
+#include <kern_runtime.hpp>
+
+/**
+ * @file Common/Sync/kern_lockstats.cpp
+ * @brief A contention profiler for the spinlocks
+ * @details This is only built in when LOCK_STATS is enabled, since it
+ * reads the cycle counter twice for every lock taken. Nothing here takes
+ * a lock itself: every counter is only ever updated atomically.
+ */
+
+#if LOCK_STATS
+
+struct pantheon::lockstats::LockClass
+{
+	const char *Name;
+	UINT64 Acquires;
+	UINT64 Contended;
+	UINT64 SpinTotal;
+	UINT64 SpinMax;
+	UINT64 HoldTotal;
+	UINT64 HoldMax;
+};
+
+static pantheon::lockstats::LockClass Classes[pantheon::lockstats::MaxClasses];
+
+static UINT64 HashName(const char *Name)
+{
+	/* FNV-1a */
+	UINT64 Hash = 14695981039346656037ULL;
+	for (UINT64 Index = 0; Index < pantheon::LockStatsNameLength && Name[Index]; ++Index)
+	{
+		Hash ^= static_cast<UINT8>(Name[Index]);
+		Hash *= 1099511628211ULL;
+	}
+	return Hash;
+}
+
+static VOID RecordMax(UINT64 *Max, UINT64 Value)
+{
+	UINT64 Cur = __atomic_load_n(Max, __ATOMIC_RELAXED);
+	while (Value > Cur)
+	{
+		if (__atomic_compare_exchange_n(Max, &Cur, Value, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Gets the class of every lock with some name, creating it if need be
+ * @return The class, or nullptr if there are too many already
+ */
+pantheon::lockstats::LockClass *pantheon::lockstats::Find(const char *Name)
+{
+	if (Name == nullptr)
+	{
+		return nullptr;
+	}
+
+	UINT64 Start = HashName(Name);
+	for (UINT64 Probe = 0; Probe < MaxClasses; ++Probe)
+	{
+		LockClass *Class = &Classes[(Start + Probe) % MaxClasses];
+		const char *Cur = __atomic_load_n(&Class->Name, __ATOMIC_ACQUIRE);
+		if (Cur == nullptr)
+		{
+			if (__atomic_compare_exchange_n(&Class->Name, &Cur, Name, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			{
+				return Class;
+			}
+		}
+
+		if (StringCompare(Cur, Name, LockStatsNameLength))
+		{
+			return Class;
+		}
+	}
+	return nullptr;
+}
+
+VOID pantheon::lockstats::RecordAcquire(LockClass *Class, BOOL Contended, UINT64 Spin)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	__atomic_fetch_add(&Class->Acquires, 1, __ATOMIC_RELAXED);
+	if (Contended)
+	{
+		__atomic_fetch_add(&Class->Contended, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&Class->SpinTotal, Spin, __ATOMIC_RELAXED);
+		RecordMax(&Class->SpinMax, Spin);
+	}
+}
+
+VOID pantheon::lockstats::RecordRelease(LockClass *Class, UINT64 Hold)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	__atomic_fetch_add(&Class->HoldTotal, Hold, __ATOMIC_RELAXED);
+	RecordMax(&Class->HoldMax, Hold);
+}
+
+/**
+ * @brief Copies out what was measured for one class of lock
+ * @param Index Which class, counting only the ones which were ever used
+ * @param Out Where to copy it to
+ * @return TRUE if there is such a class, FALSE otherwise
+ */
+BOOL pantheon::lockstats::Get(UINT64 Index, LockStats *Out)
+{
+	for (LockClass &Class : Classes)
+	{
+		const char *Name = __atomic_load_n(&Class.Name, __ATOMIC_ACQUIRE);
+		if (Name == nullptr)
+		{
+			continue;
+		}
+
+		if (Index-- != 0)
+		{
+			continue;
+		}
+
+		ClearBuffer(Out->Name, LockStatsNameLength);
+		CopyString(Out->Name, Name, LockStatsNameLength - 1);
+		Out->Acquires = __atomic_load_n(&Class.Acquires, __ATOMIC_RELAXED);
+		Out->Contended = __atomic_load_n(&Class.Contended, __ATOMIC_RELAXED);
+		Out->SpinTotal = __atomic_load_n(&Class.SpinTotal, __ATOMIC_RELAXED);
+		Out->SpinMax = __atomic_load_n(&Class.SpinMax, __ATOMIC_RELAXED);
+		Out->HoldTotal = __atomic_load_n(&Class.HoldTotal, __ATOMIC_RELAXED);
+		Out->HoldMax = __atomic_load_n(&Class.HoldMax, __ATOMIC_RELAXED);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * @brief Forgets everything measured so far, but not the classes themselves
+ */
+VOID pantheon::lockstats::Reset()
+{
+	for (LockClass &Class : Classes)
+	{
+		__atomic_store_n(&Class.Acquires, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&Class.Contended, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&Class.SpinTotal, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&Class.SpinMax, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&Class.HoldTotal, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&Class.HoldMax, 0, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief Prints every class which was ever contended
+ * @details This is safe to call while panicking: it takes no locks.
+ */
+VOID pantheon::lockstats::Dump()
+{
+	SERIAL_LOG_UNSAFE("lock stats: name, acquires, contended, spin total/max, hold total/max\n");
+	LockStats Stats;
+	for (UINT64 Index = 0; pantheon::lockstats::Get(Index, &Stats); ++Index)
+	{
+		if (Stats.Contended == 0)
+		{
+			continue;
+		}
+
+		SERIAL_LOG_UNSAFE("  %s: %lu, %lu, %lu/%lu, %lu/%lu\n", Stats.Name,
+			Stats.Acquires, Stats.Contended, Stats.SpinTotal, Stats.SpinMax,
+			Stats.HoldTotal, Stats.HoldMax);
+	}
+}
+
+#else
+
+BOOL pantheon::lockstats::Get(UINT64 Index, LockStats *Out)
+{
+	PANTHEON_UNUSED(Index);
+	PANTHEON_UNUSED(Out);
+	return FALSE;
+}
+
+VOID pantheon::lockstats::Reset()
+{
+
+}
+
+VOID pantheon::lockstats::Dump()
+{
+
+}
+
+#endif
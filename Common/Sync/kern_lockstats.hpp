@@ -0,0 +1,62 @@
+#include <kern.h>
+#include <kern_datatypes.hpp>
+
+/**
+ * @file Common/Sync/kern_lockstats.hpp
+ * @brief Definitions for measuring how much time is lost to spinlocks
+ */
+
+#ifndef _KERN_LOCKSTATS_HPP_
+#define _KERN_LOCKSTATS_HPP_
+
+namespace pantheon
+{
+
+static constexpr UINT64 LockStatsNameLength = 32;
+
+/**
+ * @brief What was measured for every lock sharing one name.
+ * @details Times are in ticks of the cycle counter.
+ */
+typedef struct LockStats
+{
+	CHAR Name[LockStatsNameLength];
+
+	/* How many times any of these locks was acquired, and how many
+	 * times the acquirer had to wait for it. */
+	UINT64 Acquires;
+	UINT64 Contended;
+
+	/* How long was spent waiting to get one. */
+	UINT64 SpinTotal;
+	UINT64 SpinMax;
+
+	/* How long one was held for. */
+	UINT64 HoldTotal;
+	UINT64 HoldMax;
+}LockStats;
+
+namespace lockstats
+{
+
+/* Every lock with the same debug name counts towards the same class. */
+typedef struct LockClass LockClass;
+
+/* How many different names can be told apart: the rest aren't measured. */
+static constexpr UINT64 MaxClasses = 128;
+
+#if LOCK_STATS
+LockClass *Find(const char *Name);
+VOID RecordAcquire(LockClass *Class, BOOL Contended, UINT64 Spin);
+VOID RecordRelease(LockClass *Class, UINT64 Hold);
+#endif
+
+BOOL Get(UINT64 Index, LockStats *Out);
+VOID Reset();
+VOID Dump();
+
+}
+
+}
+
+#endif
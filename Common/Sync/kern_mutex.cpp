@@ -0,0 +1,442 @@
+#include <arch.hpp>
+
+#include "kern_mutex.hpp"
+#include "kern_datatypes.hpp"
+#include "Proc/kern_cpu.hpp"
+#include "Proc/kern_sched.hpp"
+#include "Proc/kern_thread.hpp"
+#include "Proc/kern_waitqueue.hpp"
+
+#include <kern_runtime.hpp>
+
+pantheon::Spinlock pantheon::Mutex::ChainLock("Mutex Chain");
+
+pantheon::Mutex::Mutex() : pantheon::Mutex::Mutex("mutex")
+{
+}
+
+pantheon::Mutex::Mutex(const char *Name)
+{
+	this->DebugName = Name;
+	this->State.Store(0);
+	this->Waiters = nullptr;
+	this->HeldNext = nullptr;
+}
+
+pantheon::Mutex::~Mutex()
+{
+
+}
+
+/**
+ * @brief Acquires this mutex, sleeping for as long as it takes if some
+ * other thread has it.
+ * @details If the owner is running right now, it's likely to be done
+ * soon, so this spins for a little while first. Otherwise, the caller
+ * is queued, lends its priority to the owner, and blocks until the owner
+ * hands the mutex over to it.
+ */
+VOID pantheon::Mutex::Acquire()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Self = pantheon::CPU::GetCurThread();
+	if (Self == nullptr || this->DebugName == nullptr)
+	{
+		StopError("bad mutex", this);
+	}
+
+	/* Sleeping here would leave some spinlock held, with interrupts off. */
+	if (pantheon::CPU::ICOUNT() != 0)
+	{
+		StopError("mutex acquired with spinlock held", this);
+	}
+
+	if (this->IsHolding())
+	{
+		StopError(this->DebugName, this);
+	}
+
+	for (UINT64 Spin = 0; Spin < SpinLimit; ++Spin)
+	{
+		if (this->TryAcquire())
+		{
+			return;
+		}
+
+		pantheon::Thread *Cur = this->Owner();
+		if (Cur != nullptr && Cur->OnCore() == FALSE)
+		{
+			break;
+		}
+		pantheon::CPU::PAUSE();
+	}
+	this->Wait(Self);
+}
+
+/**
+ * @brief Acquires this mutex, but only if nobody has it right now
+ * @return TRUE if the calling thread now holds this mutex, FALSE otherwise
+ */
+[[nodiscard]] BOOL pantheon::Mutex::TryAcquire()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Self = pantheon::CPU::GetCurThread();
+	if (Self == nullptr)
+	{
+		StopError("bad mutex", this);
+	}
+
+	UINT64 Expected = 0;
+	if (this->State.CompareExchange(Expected, reinterpret_cast<UINT64>(Self)) == FALSE)
+	{
+		return FALSE;
+	}
+	this->Take(Self);
+	return TRUE;
+}
+
+/**
+ * @brief Releases this mutex, handing it to the most important thread waiting for it
+ * @details Any priority the caller was lent through this mutex is taken
+ * back. If that means the new owner is more important than the caller,
+ * the caller gives up the rest of its timeslice.
+ */
+VOID pantheon::Mutex::Release()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsHolding() == FALSE)
+	{
+		StopError(this->DebugName, this);
+	}
+
+	pantheon::Thread *Self = pantheon::CPU::GetCurThread();
+	this->Untake(Self);
+
+	/* Nobody is waiting, so there's nobody to hand this to. */
+	UINT64 Expected = reinterpret_cast<UINT64>(Self);
+	if (this->State.CompareExchange(Expected, 0))
+	{
+		return;
+	}
+
+	ChainLock.Acquire();
+	MutexWaiter *Node = this->PopWaiter();
+	pantheon::Thread *Next = nullptr;
+	UINT64 Token = 0;
+	if (Node != nullptr)
+	{
+		Next = Node->Waiter;
+		Token = Node->Token;
+	}
+
+	UINT64 Tag = (this->Waiters != nullptr) ? HasWaiters : 0;
+	this->State.Store(reinterpret_cast<UINT64>(Next) | Tag);
+	if (Next != nullptr)
+	{
+		/* The new owner is asleep, so this is safe to do for it. */
+		this->Take(Next);
+		Next->SetBlockedOn(nullptr);
+		Inherit(Next, this->TopPriority());
+	}
+	BOOL Dropped = Disinherit(Self);
+	ChainLock.Release();
+
+	/* The node may be gone as soon as its thread is awake. */
+	if (Next != nullptr)
+	{
+		pantheon::WakeThread(Next, Token, 0);
+	}
+
+	if (Dropped)
+	{
+		pantheon::CPU::GetCurSched()->Reschedule();
+	}
+}
+
+/**
+ * @brief Checks if any thread holds this mutex.
+ */
+[[nodiscard]] BOOL pantheon::Mutex::IsLocked() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Owner() != nullptr;
+}
+
+/**
+ * @brief Checks if the current thread holds this mutex.
+ */
+[[nodiscard]] BOOL pantheon::Mutex::IsHolding() const
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Self = pantheon::CPU::GetCurThread();
+	return Self != nullptr && this->Owner() == Self;
+}
+
+/**
+ * @brief Gets the thread which holds this mutex
+ * @return The owner, or nullptr if this isn't held
+ */
+[[nodiscard]] pantheon::Thread *pantheon::Mutex::Owner() const
+{
+	OBJECT_SELF_ASSERT();
+	return reinterpret_cast<pantheon::Thread*>(this->State.Load() & ~HasWaiters);
+}
+
+[[nodiscard]] const char *pantheon::Mutex::GetDebugName() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DebugName;
+}
+
+/**
+ * @brief Sleeps until the owner hands this mutex over.
+ * @details The calling thread is queued by priority, and lends it to the
+ * owner for as long as it waits.
+ */
+VOID pantheon::Mutex::Wait(pantheon::Thread *Self)
+{
+	MutexWaiter Node;
+	Node.Waiter = Self;
+	Node.Next = nullptr;
+
+	Self->Lock();
+	Node.Token = Self->BeginWait();
+	Node.Priority = static_cast<UINT8>(Self->MyPriority());
+	Self->Unlock();
+
+	ChainLock.Acquire();
+	UINT64 Cur = this->State.Load();
+	for (;;)
+	{
+		/* Released since the last try. */
+		if (Cur == 0 && this->State.CompareExchange(Cur, reinterpret_cast<UINT64>(Self)))
+		{
+			this->Take(Self);
+			ChainLock.Release();
+			return;
+		}
+
+		/* Make sure the owner comes this way to release it. */
+		if (Cur != 0 && this->State.CompareExchange(Cur, Cur | HasWaiters))
+		{
+			break;
+		}
+	}
+
+	this->PushWaiter(&Node);
+	Self->SetBlockedOn(this);
+	Inherit(this->Owner(), Node.Priority);
+	ChainLock.Release();
+
+	for (;;)
+	{
+		Self->Lock();
+		BOOL Blocked = Self->Block(FALSE);
+		Self->Unlock();
+		if (Blocked)
+		{
+			pantheon::CPU::GetCurSched()->Reschedule();
+		}
+
+		ChainLock.Acquire();
+		if (this->Owner() == Self)
+		{
+			ChainLock.Release();
+			return;
+		}
+
+		/* Woken up by something else: stay queued, and wait again. */
+		Self->Lock();
+		Node.Token = Self->BeginWait();
+		Self->Unlock();
+		ChainLock.Release();
+	}
+}
+
+/**
+ * @brief Records that some thread now owns this mutex.
+ * @details Only ever done by the thread itself, or for it by whoever
+ * hands it this mutex while it's asleep.
+ */
+VOID pantheon::Mutex::Take(pantheon::Thread *Self)
+{
+	this->HeldNext = Self->HeldMutexes();
+	Self->SetHeldMutexes(this);
+}
+
+/**
+ * @brief Forgets that some thread owns this mutex, so that it no longer
+ * gets any priority through it.
+ */
+VOID pantheon::Mutex::Untake(pantheon::Thread *Self)
+{
+	Mutex *Prev = nullptr;
+	for (Mutex *Cur = Self->HeldMutexes(); Cur != nullptr; Cur = Cur->HeldNext)
+	{
+		if (Cur != this)
+		{
+			Prev = Cur;
+			continue;
+		}
+
+		if (Prev)
+		{
+			Prev->HeldNext = Cur->HeldNext;
+		}
+		else
+		{
+			Self->SetHeldMutexes(Cur->HeldNext);
+		}
+		break;
+	}
+	this->HeldNext = nullptr;
+}
+
+/**
+ * @brief Queues a waiter behind every waiter at least as important as it.
+ * @details The chain lock must be held.
+ */
+VOID pantheon::Mutex::PushWaiter(MutexWaiter *Node)
+{
+	MutexWaiter *Prev = nullptr;
+	MutexWaiter *Cur = this->Waiters;
+	while (Cur != nullptr && Cur->Priority >= Node->Priority)
+	{
+		Prev = Cur;
+		Cur = Cur->Next;
+	}
+
+	Node->Next = Cur;
+	if (Prev)
+	{
+		Prev->Next = Node;
+	}
+	else
+	{
+		this->Waiters = Node;
+	}
+}
+
+/**
+ * @brief Takes the most important waiter out of the queue.
+ * @details The chain lock must be held.
+ * @return That waiter, or nullptr if nobody is waiting
+ */
+pantheon::MutexWaiter *pantheon::Mutex::PopWaiter()
+{
+	MutexWaiter *Node = this->Waiters;
+	if (Node != nullptr)
+	{
+		this->Waiters = Node->Next;
+		Node->Next = nullptr;
+	}
+	return Node;
+}
+
+/**
+ * @brief Moves a waiter which was just lent a higher priority further up
+ * the queue.
+ * @details The chain lock must be held.
+ */
+VOID pantheon::Mutex::Requeue(pantheon::Thread *Waiter, UINT8 Priority)
+{
+	MutexWaiter *Prev = nullptr;
+	for (MutexWaiter *Cur = this->Waiters; Cur != nullptr; Cur = Cur->Next)
+	{
+		if (Cur->Waiter != Waiter)
+		{
+			Prev = Cur;
+			continue;
+		}
+
+		if (Cur->Priority >= Priority)
+		{
+			return;
+		}
+
+		if (Prev)
+		{
+			Prev->Next = Cur->Next;
+		}
+		else
+		{
+			this->Waiters = Cur->Next;
+		}
+		Cur->Priority = Priority;
+		this->PushWaiter(Cur);
+		return;
+	}
+}
+
+/**
+ * @brief Gets the priority of the most important waiter.
+ * @details The chain lock must be held.
+ */
+[[nodiscard]] UINT8 pantheon::Mutex::TopPriority() const
+{
+	if (this->Waiters == nullptr)
+	{
+		return pantheon::Thread::PRIORITY_VERYLOW;
+	}
+	return this->Waiters->Priority;
+}
+
+/**
+ * @brief Lends some priority to an owner, and to whoever it's waiting on in turn.
+ * @details An owner already waiting to run is moved up to its new
+ * priority right away. The chain lock must be held.
+ * @param Owner The thread holding up some more important thread
+ * @param Priority The priority of that more important thread
+ */
+VOID pantheon::Mutex::Inherit(pantheon::Thread *Owner, UINT8 Priority)
+{
+	pantheon::Thread::Priority Pri = static_cast<pantheon::Thread::Priority>(Priority);
+	for (UINT64 Depth = 0; Owner != nullptr && Depth < MaxInheritDepth; ++Depth)
+	{
+		Mutex *Next = nullptr;
+		{
+			pantheon::ScopedLock _L(Owner);
+			if (Owner->MyPriority() >= Pri)
+			{
+				return;
+			}
+
+			Owner->InheritPriority(Pri);
+			if (Owner->MyState() == pantheon::Thread::STATE_WAITING)
+			{
+				pantheon::Scheduler::Promote(Owner);
+			}
+			Next = Owner->BlockedOn();
+		}
+
+		if (Next == nullptr)
+		{
+			return;
+		}
+		Next->Requeue(Owner, Priority);
+		Owner = Next->Owner();
+	}
+}
+
+/**
+ * @brief Takes back whatever priority some thread was lent by mutexes it
+ * no longer holds.
+ * @details The chain lock must be held.
+ * @return TRUE if the thread's priority went down, FALSE otherwise
+ */
+BOOL pantheon::Mutex::Disinherit(pantheon::Thread *Self)
+{
+	UINT8 Top = pantheon::Thread::PRIORITY_VERYLOW;
+	for (Mutex *Cur = Self->HeldMutexes(); Cur != nullptr; Cur = Cur->HeldNext)
+	{
+		if (Cur->TopPriority() > Top)
+		{
+			Top = Cur->TopPriority();
+		}
+	}
+
+	pantheon::ScopedLock _L(Self);
+	pantheon::Thread::Priority Was = Self->MyPriority();
+	Self->InheritPriority(static_cast<pantheon::Thread::Priority>(Top));
+	return Self->MyPriority() < Was;
+}
@@ -0,0 +1,112 @@
+#include <kern_datatypes.hpp>
+
+#include <Sync/kern_atomic.hpp>
+#include <Sync/kern_spinlock.hpp>
+
+/**
+ * @file Common/Sync/kern_mutex.hpp
+ * @brief Definitions for locks which put their waiters to sleep
+ */
+
+#ifndef _KERN_MUTEX_HPP_
+#define _KERN_MUTEX_HPP_
+
+namespace pantheon
+{
+
+class Thread;
+
+/**
+ * @brief One thread waiting to acquire a mutex.
+ * @details These live on the stack of the waiting thread.
+ */
+typedef struct MutexWaiter
+{
+	pantheon::Thread *Waiter;
+	UINT64 Token;
+	UINT8 Priority;
+	struct MutexWaiter *Next;
+}MutexWaiter;
+
+/**
+ * @brief A lock which can be held for a long time.
+ * @details Unlike a Spinlock, interrupts stay enabled while this is held,
+ * and a thread which can't get it goes to sleep instead of spinning
+ * forever. Whoever holds it runs at the priority of the most important
+ * thread waiting for it, so that a low priority holder can't keep a high
+ * priority thread waiting behind everything in between.
+ *
+ * This can only be used by a thread, and never with any Spinlock held.
+ */
+class Mutex
+{
+public:
+	Mutex();
+	Mutex(const char *Name);
+	~Mutex();
+
+	VOID Acquire();
+	VOID Release();
+	[[nodiscard]] BOOL TryAcquire();
+
+	[[nodiscard]] BOOL IsLocked() const;
+	[[nodiscard]] BOOL IsHolding() const;
+	[[nodiscard]] pantheon::Thread *Owner() const;
+
+	[[nodiscard]] const char *GetDebugName() const;
+
+	/* How long to wait for an owner which is running, before sleeping. */
+	static constexpr UINT64 SpinLimit = 1000;
+
+	/* How many owners in a row can be lent some priority at once. */
+	static constexpr UINT64 MaxInheritDepth = 8;
+
+private:
+	VOID Wait(pantheon::Thread *Self);
+	VOID Take(pantheon::Thread *Self);
+	VOID Untake(pantheon::Thread *Self);
+
+	VOID PushWaiter(MutexWaiter *Node);
+	MutexWaiter *PopWaiter();
+	VOID Requeue(pantheon::Thread *Waiter, UINT8 Priority);
+	[[nodiscard]] UINT8 TopPriority() const;
+
+	static VOID Inherit(pantheon::Thread *Owner, UINT8 Priority);
+	static BOOL Disinherit(pantheon::Thread *Self);
+
+	const char *DebugName;
+
+	/* The owning thread, tagged with HasWaiters while anyone is queued. */
+	pantheon::Atomic<UINT64> State;
+	static constexpr UINT64 HasWaiters = 1;
+
+	/* Highest priority first, and oldest first among equals. */
+	MutexWaiter *Waiters;
+
+	/* The mutex acquired before this one, by the same owner. */
+	Mutex *HeldNext;
+
+	/* Covers every waiter list, and who is waiting on what. */
+	static pantheon::Spinlock ChainLock;
+};
+
+class ScopedMutex
+{
+public:
+	ScopedMutex(Mutex *Mtx) : Lock(Mtx)
+	{
+		Lock->Acquire();
+	}
+
+	~ScopedMutex()
+	{
+		Lock->Release();
+	}
+
+private:
+	Mutex *Lock;
+};
+
+}
+
+#endif
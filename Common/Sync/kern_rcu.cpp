@@ -0,0 +1,182 @@
+#include <arch.hpp>
+
+#include "kern_rcu.hpp"
+#include "kern_datatypes.hpp"
+#include "Proc/kern_cpu.hpp"
+
+#include <kern_runtime.hpp>
+
+/**
+ * @file Common/Sync/kern_rcu.cpp
+ * @brief Quiescent-state based reclamation
+ * @details There is one global epoch. Each core records the epoch it saw
+ * at its last quiescent point, and whichever core notices that every
+ * online core has seen the current epoch moves it ahead. Something
+ * deferred during epoch E can't be reached by any core which has since
+ * seen E + 1, since that core went through a quiescent point after the
+ * free was deferred.
+ */
+
+typedef struct CoreState
+{
+	/* How deeply nested in read sections this core is. */
+	UINT64 Nesting;
+
+	/* The epoch this core saw at its last quiescent point. */
+	UINT64 Seen;
+
+	/* Everything this core deferred, newest first. */
+	pantheon::rcu::Head *Waiting;
+	UINT64 Count;
+}CoreState;
+
+static pantheon::CPU::PerCore<CoreState> States;
+static UINT64 GlobalEpoch = 1;
+static UINT64 OnlineCores = 0;
+
+/**
+ * @brief Starts tracking some core, which must not be inside any read section
+ * @details Until this is done, no core waits on it.
+ */
+VOID pantheon::rcu::Online(UINT8 CoreNo)
+{
+	CoreState &State = States.On(CoreNo);
+	State.Nesting = 0;
+	__atomic_store_n(&State.Seen, __atomic_load_n(&GlobalEpoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+	__atomic_fetch_or(&OnlineCores, 1ULL << CoreNo, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Enters a read section on the current core
+ * @details Interrupts stay off until the matching ReadUnlock, so this
+ * core can't reschedule in the meantime.
+ */
+VOID pantheon::rcu::ReadLock()
+{
+	pantheon::CPU::PUSHI();
+	States.Local().Nesting++;
+}
+
+VOID pantheon::rcu::ReadUnlock()
+{
+	CoreState &State = States.Local();
+	if (State.Nesting == 0)
+	{
+		StopError("read section not held");
+	}
+	State.Nesting--;
+	pantheon::CPU::POPI();
+}
+
+[[nodiscard]] BOOL pantheon::rcu::InReadSection()
+{
+	return States.Local().Nesting != 0;
+}
+
+/**
+ * @brief Calls some function once no core can still be looking at what it frees
+ * @param Node Space for keeping track of this, inside whatever is to be freed
+ * @param Func The function which frees it
+ * @param Arg What to pass to Func
+ */
+VOID pantheon::rcu::Defer(Head *Node, VOID (*Func)(VOID *Arg), VOID *Arg)
+{
+	Node->Func = Func;
+	Node->Arg = Arg;
+
+	pantheon::CPU::PUSHI();
+	CoreState &State = States.Local();
+	Node->Epoch = __atomic_load_n(&GlobalEpoch, __ATOMIC_SEQ_CST);
+	Node->Next = State.Waiting;
+	State.Waiting = Node;
+	State.Count++;
+	pantheon::CPU::POPI();
+}
+
+static UINT64 OldestSeen()
+{
+	UINT64 Online = __atomic_load_n(&OnlineCores, __ATOMIC_SEQ_CST);
+	UINT64 Oldest = __atomic_load_n(&GlobalEpoch, __ATOMIC_SEQ_CST);
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		if ((Online & (1ULL << Index)) == 0)
+		{
+			continue;
+		}
+
+		UINT64 Seen = __atomic_load_n(&States.On(Index).Seen, __ATOMIC_SEQ_CST);
+		if (Seen < Oldest)
+		{
+			Oldest = Seen;
+		}
+	}
+	return Oldest;
+}
+
+/**
+ * @brief Reports that the current core isn't inside any read section,
+ * and frees whatever it deferred that nobody can see anymore.
+ */
+VOID pantheon::rcu::Quiescent()
+{
+	pantheon::CPU::PUSHI();
+	CoreState &State = States.Local();
+	if (State.Nesting != 0)
+	{
+		StopError("quiescent inside read section");
+	}
+
+	UINT64 Epoch = __atomic_load_n(&GlobalEpoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&State.Seen, Epoch, __ATOMIC_SEQ_CST);
+
+	UINT64 Oldest = OldestSeen();
+	if (Oldest == Epoch)
+	{
+		/* Everyone has caught up, so start the next grace period. */
+		__atomic_compare_exchange_n(&GlobalEpoch, &Epoch, Epoch + 1, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	}
+
+	/* The list is newest first, so everything past the first expired entry is too. */
+	Head *Prev = nullptr;
+	Head *Done = State.Waiting;
+	while (Done != nullptr && Done->Epoch >= Oldest)
+	{
+		Prev = Done;
+		Done = Done->Next;
+	}
+
+	if (Prev)
+	{
+		Prev->Next = nullptr;
+	}
+	else
+	{
+		State.Waiting = nullptr;
+	}
+
+	for (Head *Cur = Done; Cur != nullptr; Cur = Cur->Next)
+	{
+		State.Count--;
+	}
+	pantheon::CPU::POPI();
+
+	while (Done != nullptr)
+	{
+		Head *Next = Done->Next;
+		Done->Func(Done->Arg);
+		Done = Next;
+	}
+}
+
+[[nodiscard]] UINT64 pantheon::rcu::CurrentEpoch()
+{
+	return __atomic_load_n(&GlobalEpoch, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Gets how many frees the current core is still waiting to do
+ */
+[[nodiscard]] UINT64 pantheon::rcu::Pending()
+{
+	return States.Local().Count;
+}
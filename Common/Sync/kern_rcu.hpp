@@ -0,0 +1,64 @@
+#include <kern_datatypes.hpp>
+
+/**
+ * @file Common/Sync/kern_rcu.hpp
+ * @brief Definitions for freeing objects only once no lookup can still see them
+ */
+
+#ifndef _KERN_RCU_HPP_
+#define _KERN_RCU_HPP_
+
+namespace pantheon::rcu
+{
+
+/**
+ * @brief Something waiting to be freed.
+ * @details This lives inside whatever is to be freed, so deferring a free
+ * never needs to allocate anything.
+ */
+typedef struct Head
+{
+	struct Head *Next;
+	VOID (*Func)(VOID *Arg);
+	VOID *Arg;
+	UINT64 Epoch;
+}Head;
+
+/*
+ * Lookups which don't take any lock do so inside a read section, which
+ * only touches the current core. Anything such a lookup could have found
+ * is freed with Defer once it's been unpublished, and is only really
+ * freed after every core has passed through a quiescent point: somewhere
+ * it can't be inside a read section, like rescheduling.
+ *
+ * Read sections can nest, but can't sleep or reschedule.
+ */
+VOID Online(UINT8 CoreNo);
+
+VOID ReadLock();
+VOID ReadUnlock();
+[[nodiscard]] BOOL InReadSection();
+
+VOID Defer(Head *Node, VOID (*Func)(VOID *Arg), VOID *Arg);
+VOID Quiescent();
+
+[[nodiscard]] UINT64 CurrentEpoch();
+[[nodiscard]] UINT64 Pending();
+
+class ScopedReadSection
+{
+public:
+	ScopedReadSection()
+	{
+		pantheon::rcu::ReadLock();
+	}
+
+	~ScopedReadSection()
+	{
+		pantheon::rcu::ReadUnlock();
+	}
+};
+
+}
+
+#endif
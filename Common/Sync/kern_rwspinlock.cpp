@@ -0,0 +1,163 @@
+#include <arch.hpp>
+
+#include "kern_rwspinlock.hpp"
+#include "kern_datatypes.hpp"
+#include "Proc/kern_cpu.hpp"
+
+#include <kern_runtime.hpp>
+
+pantheon::RWSpinlock::RWSpinlock() : pantheon::RWSpinlock::RWSpinlock("rwlock")
+{
+}
+
+pantheon::RWSpinlock::RWSpinlock(const char *Name)
+{
+	this->DebugName = Name;
+	this->CoreNo = -1;
+	this->State = 0;
+}
+
+pantheon::RWSpinlock::~RWSpinlock()
+{
+
+}
+
+[[nodiscard]] BOOL pantheon::RWSpinlock::IsWriting() const
+{
+	return (this->IsWriteLocked() && this->CoreNo == pantheon::CPU::GetProcessorNumber());
+}
+
+/**
+ * \~english @brief Acquires this lock alongside any other readers
+ * \~english @details Waits for as long as a writer holds this, or is
+ * waiting for it.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::RWSpinlock::AcquireRead()
+{
+	if (this->DebugName == nullptr)
+	{
+		StopError("bad rwlock", this);
+	}
+
+	pantheon::CPU::PUSHI();
+	if (this->IsWriting())
+	{
+		StopError(this->DebugName, this);
+	}
+
+	for (;;)
+	{
+		UINT64 Cur = __atomic_load_n(&this->State, __ATOMIC_RELAXED);
+		if (Cur & (Writer | WriterWaiting))
+		{
+			pantheon::CPU::WaitForChange(&this->State, Cur);
+			continue;
+		}
+
+		if (__atomic_compare_exchange_n(&this->State, &Cur, Cur + OneReader, TRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+}
+
+void pantheon::RWSpinlock::ReleaseRead()
+{
+	if (this->Readers() == 0)
+	{
+		StopError(this->DebugName, this);
+	}
+
+	__atomic_sub_fetch(&this->State, OneReader, __ATOMIC_RELEASE);
+	pantheon::CPU::POPI();
+}
+
+/**
+ * \~english @brief Acquires this lock, with nobody else holding it
+ * \~english @details Readers which already hold this are let finish, but
+ * no new ones can get in until the writer is done.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::RWSpinlock::AcquireWrite()
+{
+	if (this->DebugName == nullptr)
+	{
+		StopError("bad rwlock", this);
+	}
+
+	pantheon::CPU::PUSHI();
+	if (this->IsWriting())
+	{
+		StopError(this->DebugName, this);
+	}
+
+	for (;;)
+	{
+		UINT64 Cur = __atomic_load_n(&this->State, __ATOMIC_RELAXED);
+		if ((Cur & ~WriterWaiting) == 0)
+		{
+			if (__atomic_compare_exchange_n(&this->State, &Cur, Writer, TRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+			continue;
+		}
+
+		if ((Cur & WriterWaiting) == 0)
+		{
+			Cur = __atomic_or_fetch(&this->State, WriterWaiting, __ATOMIC_RELAXED);
+		}
+		pantheon::CPU::WaitForChange(&this->State, Cur);
+	}
+	this->CoreNo = pantheon::CPU::GetProcessorNumber();
+}
+
+void pantheon::RWSpinlock::ReleaseWrite()
+{
+	if (!this->IsWriting())
+	{
+		StopError(this->DebugName, this);
+	}
+	this->CoreNo = -1;
+
+	/* Any other writer which showed up in the meantime is still waiting. */
+	__atomic_fetch_and(&this->State, ~Writer, __ATOMIC_RELEASE);
+	pantheon::CPU::POPI();
+}
+
+/**
+ * \~english @brief Checks if anyone, reader or writer, holds this lock.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+BOOL pantheon::RWSpinlock::IsLocked() const
+{
+	return (__atomic_load_n(&this->State, __ATOMIC_RELAXED) & ~WriterWaiting) != 0;
+}
+
+[[nodiscard]]
+BOOL pantheon::RWSpinlock::IsWriteLocked() const
+{
+	return (__atomic_load_n(&this->State, __ATOMIC_RELAXED) & Writer) != 0;
+}
+
+/**
+ * \~english @brief Gets how many readers hold this lock right now.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::RWSpinlock::Readers() const
+{
+	return __atomic_load_n(&this->State, __ATOMIC_RELAXED) / OneReader;
+}
+
+void pantheon::RWSpinlock::SetDebugName(const char *Name)
+{
+	this->DebugName = Name;
+}
+
+const char *pantheon::RWSpinlock::GetDebugName()
+{
+	return this->DebugName;
+}
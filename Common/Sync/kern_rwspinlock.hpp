@@ -0,0 +1,84 @@
+#include <kern_datatypes.hpp>
+
+#ifndef _KERN_RWSPINLOCK_HPP_
+#define _KERN_RWSPINLOCK_HPP_
+
+namespace pantheon
+{
+
+/**
+ * \~english @brief A spinlock which any number of readers can hold at
+ * once, or a single writer can hold alone.
+ * \~english @details Like Spinlock, interrupts stay off while this is
+ * held. A waiting writer keeps any new readers out, so a steady stream of
+ * readers can't starve it. Neither side can be acquired recursively.
+ */
+class RWSpinlock
+{
+public:
+	RWSpinlock();
+	RWSpinlock(const char *Name);
+	~RWSpinlock();
+
+	void AcquireRead();
+	void ReleaseRead();
+
+	void AcquireWrite();
+	void ReleaseWrite();
+
+	[[nodiscard]] BOOL IsLocked() const;
+	[[nodiscard]] BOOL IsWriteLocked() const;
+	[[nodiscard]] UINT64 Readers() const;
+
+	void SetDebugName(const char *Name);
+	const char *GetDebugName();
+
+private:
+	[[nodiscard]] BOOL IsWriting() const;
+	const char *DebugName;
+	UINT16 CoreNo;
+
+	/* The number of readers, above a bit for each of the flags. */
+	UINT64 State;
+	static constexpr UINT64 Writer = 1;
+	static constexpr UINT64 WriterWaiting = 2;
+	static constexpr UINT64 OneReader = 4;
+};
+
+class ScopedReadLock
+{
+public:
+	ScopedReadLock(RWSpinlock *Lk) : Lock(Lk)
+	{
+		Lock->AcquireRead();
+	}
+
+	~ScopedReadLock()
+	{
+		Lock->ReleaseRead();
+	}
+
+private:
+	RWSpinlock *Lock;
+};
+
+class ScopedWriteLock
+{
+public:
+	ScopedWriteLock(RWSpinlock *Lk) : Lock(Lk)
+	{
+		Lock->AcquireWrite();
+	}
+
+	~ScopedWriteLock()
+	{
+		Lock->ReleaseWrite();
+	}
+
+private:
+	RWSpinlock *Lock;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include <arch.hpp>
+
+#include "kern_seqlock.hpp"
+#include "kern_datatypes.hpp"
+
+#include <kern_runtime.hpp>
+
+pantheon::SeqLock::SeqLock() : pantheon::SeqLock::SeqLock("seqlock")
+{
+}
+
+pantheon::SeqLock::SeqLock(const char *Name) : WriteLock(Name)
+{
+	this->Sequence = 0;
+}
+
+pantheon::SeqLock::~SeqLock()
+{
+
+}
+
+/**
+ * \~english @brief Starts a read, waiting out any writer already in progress.
+ * \~english @return The sequence number to hand to ReadRetry afterwards
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::SeqLock::ReadBegin() const
+{
+	for (;;)
+	{
+		UINT64 Seq = __atomic_load_n(&this->Sequence, __ATOMIC_ACQUIRE);
+		if ((Seq & 1) == 0)
+		{
+			return Seq;
+		}
+		pantheon::CPU::PAUSE();
+	}
+}
+
+/**
+ * \~english @brief Checks if whatever was read since ReadBegin may be torn.
+ * \~english @param Seq What ReadBegin returned
+ * \~english @return TRUE if a writer got in, and the read has to be done
+ * over, FALSE if what was read is consistent.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+BOOL pantheon::SeqLock::ReadRetry(UINT64 Seq) const
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&this->Sequence, __ATOMIC_RELAXED) != Seq;
+}
+
+void pantheon::SeqLock::AcquireWrite()
+{
+	this->WriteLock.Acquire();
+	__atomic_store_n(&this->Sequence, this->Sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void pantheon::SeqLock::ReleaseWrite()
+{
+	__atomic_store_n(&this->Sequence, this->Sequence + 1, __ATOMIC_RELEASE);
+	this->WriteLock.Release();
+}
+
+[[nodiscard]]
+BOOL pantheon::SeqLock::IsLocked() const
+{
+	return this->WriteLock.IsLocked();
+}
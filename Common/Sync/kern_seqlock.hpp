@@ -0,0 +1,52 @@
+#include <kern_datatypes.hpp>
+#include <Sync/kern_spinlock.hpp>
+
+#ifndef _KERN_SEQLOCK_HPP_
+#define _KERN_SEQLOCK_HPP_
+
+namespace pantheon
+{
+
+/**
+ * \~english @brief A lock for data which is read very often, and only
+ * rarely written.
+ * \~english @details Readers never write anything shared, so they never
+ * slow each other down, or the writer. Instead, a reader notices if a
+ * writer got in while it was reading, and tries again. Whatever readers
+ * look at has to be safe to read while it's being changed, so this is
+ * best for small things made of Atomics.
+ *
+ * A reader does something like:
+ *
+ *     UINT64 Seq;
+ *     do
+ *     {
+ *         Seq = Lock.ReadBegin();
+ *         ... copy out whatever is needed ...
+ *     } while (Lock.ReadRetry(Seq));
+ */
+class SeqLock
+{
+public:
+	SeqLock();
+	SeqLock(const char *Name);
+	~SeqLock();
+
+	[[nodiscard]] UINT64 ReadBegin() const;
+	[[nodiscard]] BOOL ReadRetry(UINT64 Seq) const;
+
+	void AcquireWrite();
+	void ReleaseWrite();
+
+	[[nodiscard]] BOOL IsLocked() const;
+
+private:
+	pantheon::Spinlock WriteLock;
+
+	/* Odd while a writer is in the middle of a change. */
+	UINT64 Sequence;
+};
+
+}
+
+#endif
@@ -6,6 +6,35 @@
 
 #include <kern_runtime.hpp>
 
+#if LOCK_STATS
+/**
+ * \~english @brief Records that a lock was just acquired, and when.
+ * \~english @details This must be called with the lock held.
+ * \~english @author Brian Schnepp
+ */
+template<typename LockType>
+static VOID NoteAcquire(LockType *Lock, pantheon::lockstats::LockClass **Class, UINT64 *HeldSince, UINT64 Start, BOOL Contended)
+{
+	if (*Class == nullptr)
+	{
+		*Class = pantheon::lockstats::Find(Lock->GetDebugName());
+	}
+	UINT64 Now = pantheon::CPU::ReadCycleCounter();
+	pantheon::lockstats::RecordAcquire(*Class, Contended, Now - Start);
+	*HeldSince = Now;
+}
+
+/**
+ * \~english @brief Records how long a lock was held for.
+ * \~english @details This must be called before the lock is released.
+ * \~english @author Brian Schnepp
+ */
+static VOID NoteRelease(pantheon::lockstats::LockClass *Class, UINT64 HeldSince)
+{
+	pantheon::lockstats::RecordRelease(Class, pantheon::CPU::ReadCycleCounter() - HeldSince);
+}
+#endif
+
 pantheon::Spinlock::Spinlock() : pantheon::Spinlock::Spinlock("lock")
 {
 }
@@ -14,7 +43,12 @@ pantheon::Spinlock::Spinlock(const char *Name)
 {
 	this->DebugName = Name;
 	this->CoreNo = -1;
-	this->Locked = FALSE;
+	this->NextTicket = 0;
+	this->Serving = 0;
+#if LOCK_STATS
+	this->Class = nullptr;
+	this->HeldSince = 0;
+#endif
 }
 
 pantheon::Spinlock::~Spinlock()
@@ -24,7 +58,7 @@ pantheon::Spinlock::~Spinlock()
 
 [[nodiscard]] BOOL pantheon::Spinlock::IsHolding() const
 {
-	return (this->Locked && this->CoreNo == pantheon::CPU::GetProcessorNumber());
+	return (this->IsLocked() && this->CoreNo == pantheon::CPU::GetProcessorNumber());
 }
 
 void pantheon::Spinlock::Acquire()
@@ -40,19 +74,24 @@ void pantheon::Spinlock::Acquire()
 		StopError(this->DebugName, this);
 	}
 
-	for (;;)
+#if LOCK_STATS
+	UINT64 Start = pantheon::CPU::ReadCycleCounter();
+	BOOL Contended = FALSE;
+#endif
+	UINT16 Ticket = __atomic_fetch_add(&this->NextTicket, 1, __ATOMIC_RELAXED);
+	UINT16 Cur = 0;
+	while ((Cur = __atomic_load_n(&this->Serving, __ATOMIC_ACQUIRE)) != Ticket)
 	{
-		if (__sync_lock_test_and_set(&this->Locked, TRUE) == FALSE)
-		{
-			break;
-		}
-		while (__atomic_load_n(&this->Locked, __ATOMIC_RELAXED))
-		{
-			pantheon::CPU::PAUSE();
-		}
+#if LOCK_STATS
+		Contended = TRUE;
+#endif
+		/* Releasing this writes Serving, which is what wakes us up. */
+		pantheon::CPU::WaitForChange(&this->Serving, Cur);
 	}
 	this->CoreNo = pantheon::CPU::GetProcessorNumber();
-	__sync_synchronize();
+#if LOCK_STATS
+	NoteAcquire(this, &this->Class, &this->HeldSince, Start, Contended);
+#endif
 }
 
 void pantheon::Spinlock::Release()
@@ -61,9 +100,14 @@ void pantheon::Spinlock::Release()
 	{
 		pantheon::StopError(this->DebugName, this);
 	}
+#if LOCK_STATS
+	NoteRelease(this->Class, this->HeldSince);
+#endif
 	this->CoreNo = -1;
-	__sync_synchronize();
-	__sync_lock_release(&this->Locked);
+
+	/* Only the holder ever writes this, so there's no need for an RMW. */
+	UINT16 Next = static_cast<UINT16>(this->Serving + 1);
+	__atomic_store_n(&this->Serving, Next, __ATOMIC_RELEASE);
 	pantheon::CPU::POPI();
 	
 }
@@ -77,7 +121,8 @@ void pantheon::Spinlock::Release()
 [[nodiscard]]
 BOOL pantheon::Spinlock::IsLocked() const
 {
-	return this->Locked == TRUE;
+	UINT16 Next = __atomic_load_n(&this->NextTicket, __ATOMIC_RELAXED);
+	return __atomic_load_n(&this->Serving, __ATOMIC_RELAXED) != Next;
 }
 
 /**
@@ -89,5 +134,176 @@ BOOL pantheon::Spinlock::IsLocked() const
 [[nodiscard]] 
 UINT8 pantheon::Spinlock::Holder() const
 {
-	return (this->Locked ? this->CoreNo : 0);
-}
\ No newline at end of file
+	return (this->IsLocked() ? this->CoreNo : 0);
+}
+
+void pantheon::Spinlock::SetDebugName(const char *Name)
+{
+	this->DebugName = Name;
+#if LOCK_STATS
+	this->Class = nullptr;
+#endif
+}
+
+const char *pantheon::Spinlock::GetDebugName()
+{
+	return this->DebugName;
+}
+
+/* Each core only ever uses its own nodes, with interrupts off. */
+static pantheon::QueuedSpinlockNode QueueNodes[MAX_NUM_CPUS][pantheon::QueuedSpinlock::MaxNesting];
+static UINT8 QueueNodesUsed[MAX_NUM_CPUS];
+
+static pantheon::QueuedSpinlockNode *GetQueueNode(UINT8 CoreNo)
+{
+	for (UINT8 Index = 0; Index < pantheon::QueuedSpinlock::MaxNesting; ++Index)
+	{
+		if ((QueueNodesUsed[CoreNo] & (1 << Index)) == 0)
+		{
+			QueueNodesUsed[CoreNo] |= (1 << Index);
+			return &QueueNodes[CoreNo][Index];
+		}
+	}
+	pantheon::StopError("too many queued spinlocks held");
+}
+
+static VOID PutQueueNode(UINT8 CoreNo, pantheon::QueuedSpinlockNode *Node)
+{
+	UINT64 Index = static_cast<UINT64>(Node - QueueNodes[CoreNo]);
+	QueueNodesUsed[CoreNo] &= ~(1 << Index);
+}
+
+pantheon::QueuedSpinlock::QueuedSpinlock() : pantheon::QueuedSpinlock::QueuedSpinlock("lock")
+{
+}
+
+pantheon::QueuedSpinlock::QueuedSpinlock(const char *Name)
+{
+	this->DebugName = Name;
+	this->CoreNo = -1;
+	this->Tail = nullptr;
+	this->Owner = nullptr;
+#if LOCK_STATS
+	this->Class = nullptr;
+	this->HeldSince = 0;
+#endif
+}
+
+pantheon::QueuedSpinlock::~QueuedSpinlock()
+{
+
+}
+
+[[nodiscard]] BOOL pantheon::QueuedSpinlock::IsHolding() const
+{
+	return (this->IsLocked() && this->CoreNo == pantheon::CPU::GetProcessorNumber());
+}
+
+/**
+ * \~english @brief Gets in line for this lock, and waits until the core
+ * ahead hands it over.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::QueuedSpinlock::Acquire()
+{
+	if (this->DebugName == nullptr)
+	{
+		StopError("bad spinlock", this);
+	}
+
+	pantheon::CPU::PUSHI();
+	if (this->IsHolding())
+	{
+		StopError(this->DebugName, this);
+	}
+
+#if LOCK_STATS
+	UINT64 Start = pantheon::CPU::ReadCycleCounter();
+#endif
+	UINT8 Core = pantheon::CPU::GetProcessorNumber();
+	QueuedSpinlockNode *Node = GetQueueNode(Core);
+	Node->Next = nullptr;
+	Node->Locked = TRUE;
+
+	QueuedSpinlockNode *Prev = __atomic_exchange_n(&this->Tail, Node, __ATOMIC_ACQ_REL);
+	if (Prev != nullptr)
+	{
+		__atomic_store_n(&Prev->Next, Node, __ATOMIC_RELEASE);
+		while (__atomic_load_n(&Node->Locked, __ATOMIC_ACQUIRE))
+		{
+			pantheon::CPU::WaitForChange(&Node->Locked, TRUE);
+		}
+	}
+	this->Owner = Node;
+	this->CoreNo = Core;
+#if LOCK_STATS
+	NoteAcquire(this, &this->Class, &this->HeldSince, Start, Prev != nullptr);
+#endif
+}
+
+/**
+ * \~english @brief Hands this lock to the next core in line, if there is one.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::QueuedSpinlock::Release()
+{
+	if (!this->IsHolding())
+	{
+		pantheon::StopError(this->DebugName, this);
+	}
+
+#if LOCK_STATS
+	NoteRelease(this->Class, this->HeldSince);
+#endif
+	UINT8 Core = this->CoreNo;
+	QueuedSpinlockNode *Node = this->Owner;
+	this->Owner = nullptr;
+	this->CoreNo = -1;
+
+	QueuedSpinlockNode *Next = __atomic_load_n(&Node->Next, __ATOMIC_ACQUIRE);
+	if (Next == nullptr)
+	{
+		QueuedSpinlockNode *Expected = Node;
+		if (__atomic_compare_exchange_n(&this->Tail, &Expected, nullptr, FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+			PutQueueNode(Core, Node);
+			pantheon::CPU::POPI();
+			return;
+		}
+
+		/* Someone just got in line, but hasn't told us yet. */
+		while ((Next = __atomic_load_n(&Node->Next, __ATOMIC_ACQUIRE)) == nullptr)
+		{
+			pantheon::CPU::PAUSE();
+		}
+	}
+
+	__atomic_store_n(&Next->Locked, FALSE, __ATOMIC_RELEASE);
+	PutQueueNode(Core, Node);
+	pantheon::CPU::POPI();
+}
+
+[[nodiscard]]
+BOOL pantheon::QueuedSpinlock::IsLocked() const
+{
+	return __atomic_load_n(&this->Tail, __ATOMIC_RELAXED) != nullptr;
+}
+
+[[nodiscard]]
+UINT8 pantheon::QueuedSpinlock::Holder() const
+{
+	return (this->IsLocked() ? this->CoreNo : 0);
+}
+
+void pantheon::QueuedSpinlock::SetDebugName(const char *Name)
+{
+	this->DebugName = Name;
+#if LOCK_STATS
+	this->Class = nullptr;
+#endif
+}
+
+const char *pantheon::QueuedSpinlock::GetDebugName()
+{
+	return this->DebugName;
+}
@@ -1,11 +1,19 @@
 #include <kern_datatypes.hpp>
 
-#ifndef _KERN_MUTEX_HPP_
-#define _KERN_MUTEX_HPP_
+#include <Sync/kern_lockstats.hpp>
+
+#ifndef _KERN_SPINLOCK_HPP_
+#define _KERN_SPINLOCK_HPP_
 
 namespace pantheon
 {
 
+/**
+ * \~english @brief A lock which keeps interrupts off while it's held.
+ * \~english @details Cores get this lock in the order they asked for it,
+ * so no core can be starved by luckier ones. Waiting cores only ever read
+ * the lock, and sleep until the holder signals it's done.
+ */
 class Spinlock
 {
 public:
@@ -26,9 +34,68 @@ private:
 	[[nodiscard]] BOOL IsHolding() const;
 	const char *DebugName;
 	UINT16 CoreNo;
-	BOOL Locked; 
+
+	/* The ticket the next core to ask gets, and the one which holds this. */
+	UINT16 NextTicket;
+	UINT16 Serving;
+
+#if LOCK_STATS
+	/* Looked up the first time this is taken, by DebugName. */
+	lockstats::LockClass *Class;
+	UINT64 HeldSince;
+#endif
+};
+
+/**
+ * \~english @brief One core waiting for, or holding, a QueuedSpinlock.
+ */
+typedef struct alignas(64) QueuedSpinlockNode
+{
+	struct QueuedSpinlockNode *Next;
+	BOOL Locked;
+}QueuedSpinlockNode;
+
+/**
+ * \~english @brief A fair spinlock, where every waiting core spins on a
+ * cache line of its own.
+ * \~english @details This has the same interface as Spinlock, but is
+ * better for locks many cores fight over at once: the holder hands this
+ * directly to the next core in line, and only that core has to notice.
+ */
+class QueuedSpinlock
+{
+public:
+	QueuedSpinlock();
+	QueuedSpinlock(const char *Name);
+	~QueuedSpinlock();
+
+	void Acquire();
+	void Release();
+
+	[[nodiscard]] UINT8 Holder() const;
+	[[nodiscard]] BOOL IsLocked() const;
+
+	void SetDebugName(const char *Name);
+	const char *GetDebugName();
+
+	/* How many of these one core can be waiting on or holding at once. */
+	static constexpr UINT8 MaxNesting = 8;
+
+private:
+	[[nodiscard]] BOOL IsHolding() const;
+	const char *DebugName;
+	UINT16 CoreNo;
+
+	/* The last core in line, and the node of the one holding this. */
+	QueuedSpinlockNode *Tail;
+	QueuedSpinlockNode *Owner;
+
+#if LOCK_STATS
+	lockstats::LockClass *Class;
+	UINT64 HeldSince;
+#endif
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -43,7 +43,7 @@ template<typename T>
 class ArrayList
 {
 public:
-	ArrayList() : ArrayList(0){};
+	ArrayList() : ArrayList(10){};
 
 	ArrayList(UINT64 InitCount) : ArrayList(InitCount, BasicMalloc, BasicFree){};
 
@@ -225,9 +225,8 @@ public:
 		}
 		
 		/* If it couldn't fit, expand the storage */
-		this->SpaceCount *= 2;
-		this->SpaceCount++;
-		auto MaybeMem = this->Malloc(sizeof(T) * this->SpaceCount);
+		UINT64 OldSpace = this->SpaceCount;
+		auto MaybeMem = this->Malloc(sizeof(T) * ((OldSpace * 2) + 1));
 		if (MaybeMem.GetOkay())
 		{
 			T* NewContent = (T*)MaybeMem.GetValue();
@@ -236,11 +235,15 @@ public:
 				T &Current = this->Content[Index];
 				NewContent[Index] = Current;
 			}
-			#if POISON_MEMORY
-				SetBufferBytes((UINT8*)this->Content, 0xDF, this->SpaceCount * sizeof(T));
-			#endif			
-			this->Free(this->Content);
+			if (this->Content)
+			{
+				#if POISON_MEMORY
+					SetBufferBytes((UINT8*)this->Content, 0xDF, OldSpace * sizeof(T));
+				#endif
+				this->Free(this->Content);
+			}
 			this->Content = NewContent;
+			this->SpaceCount = (OldSpace * 2) + 1;
 			this->Add(NewItem);
 		}
 	}
@@ -1,5 +1,5 @@
-#include <stdatomic.h>
 #include <kern_datatypes.hpp>
+#include <Common/Sync/kern_rcu.hpp>
 #include <Common/Sync/kern_atomic.hpp>
 
 #include <Common/Structures/kern_allocatable.hpp>
@@ -13,29 +13,37 @@ namespace pantheon
 template<typename T, UINT64 Count = 512>
 class Object : public Allocatable<T, Count>
 {
-	struct RefCount
-	{
-		atomic_ullong Counter = 0;
-	};
-
 public:
 	UINT64 Open()
 	{
-		return atomic_fetch_add(&this->RefCounter.Counter, 1) + 1;
+		return this->RefCounter.FetchAdd(1) + 1;
 	}
 
 	UINT64 Close()
 	{
-		UINT64 NewVal = atomic_fetch_add(&this->RefCounter.Counter, -1) - 1;
-		if (NewVal <= 0)
+		UINT64 NewVal = this->RefCounter.FetchSub(1, pantheon::MemoryOrder::AcqRel) - 1;
+		if (NewVal == 0)
 		{
-			Allocatable<T, Count>::Destroy((T*)this);
+			this->DeferDestroy();
 		}
 		return NewVal;
 	}
 
+protected:
+	VOID DeferDestroy()
+	{
+		/* Some lookup which never took a reference might still see it. */
+		pantheon::rcu::Defer(&this->Reclaim, Object::Free, this);
+	}
+
 private:
-	RefCount RefCounter;
+	static VOID Free(VOID *Arg)
+	{
+		Allocatable<T, Count>::Destroy(static_cast<T*>(static_cast<Object*>(Arg)));
+	}
+
+	pantheon::Atomic<UINT64> RefCounter;
+	pantheon::rcu::Head Reclaim;
 };
 
 }
@@ -21,6 +21,8 @@ enum class Result : INT32
 
 	KERN_CONN_CLOSED = 3 | CLASS_KERN,
 	KERN_PORT_CLOSED = 4 | CLASS_KERN,	
+	KERN_TIMED_OUT = 5 | CLASS_KERN,
+	KERN_TRY_AGAIN = 6 | CLASS_KERN,
 };
 
 }
@@ -4,6 +4,7 @@
 #include <kern_datatypes.hpp>
 
 #include <Sync/kern_spinlock.hpp>
+#include <Sync/kern_lockstats.hpp>
 #include <System/Proc/kern_cpu.hpp>
 #include <System/Memory/kern_alloc.hpp>
 
@@ -61,7 +62,10 @@ void pantheon::StopError(const char *Reason, void *Source)
 	{
 		SERIAL_LOG_UNSAFE("panic: %s [core %lx]\n", "unknown reason", pantheon::CPU::GetProcessorNumber());
 	}
-	
+
+	/* Whatever led up to this might have been some lock being fought over. */
+	pantheon::lockstats::Dump();
+
 	/* TODO: stop other cores */
 	pantheon::SetKernelStatus(pantheon::KERNEL_STATUS_PANIC);
 	PanicMutex.Release();
@@ -78,6 +82,7 @@ void pantheon::StopErrorFmt(const char *Fmt, ...)
 	va_start(Args, Fmt);
 	vprintf(Fmt, Args);
 	va_end(Args);
+	pantheon::lockstats::Dump();
 
 	/* TODO: stop other cores */
 	pantheon::SetKernelStatus(pantheon::KERNEL_STATUS_PANIC);
@@ -229,19 +229,19 @@ static inline void SetBufferBytes(UINT8 *Location, UINT8 Value, UINT32 Amount)
 			| ((UINT64)Value << 8*3) | ((UINT64)Value << 8*2) 
 			| ((UINT64)Value << 8) | (UINT64)Value;
 
-		for (Index = 0; Index < Amount; Index += 64)
+		for (Index = 0; Index + 64 <= Amount; Index += 64)
 		{
 			AsUINT64[(Index + 0) / 8] = NValue;
-			AsUINT64[(Index + 1) / 8] = NValue;
-			AsUINT64[(Index + 2) / 8] = NValue;
-			AsUINT64[(Index + 3) / 8] = NValue;
-			AsUINT64[(Index + 4) / 8] = NValue;
-			AsUINT64[(Index + 5) / 8] = NValue;
-			AsUINT64[(Index + 6) / 8] = NValue;
-			AsUINT64[(Index + 7) / 8] = NValue;		
+			AsUINT64[(Index + 8) / 8] = NValue;
+			AsUINT64[(Index + 16) / 8] = NValue;
+			AsUINT64[(Index + 24) / 8] = NValue;
+			AsUINT64[(Index + 32) / 8] = NValue;
+			AsUINT64[(Index + 40) / 8] = NValue;
+			AsUINT64[(Index + 48) / 8] = NValue;
+			AsUINT64[(Index + 56) / 8] = NValue;		
 		}
 
-		for (; Index < Amount; Index += 8)
+		for (; Index + 8 <= Amount; Index += 8)
 		{
 			AsUINT64[Index / 8] = NValue;
 		}
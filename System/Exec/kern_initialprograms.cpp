@@ -81,7 +81,11 @@ static void RunElf(ELFFileHeader64 Header, const char *ElfLocation, UINT32 Proc,
 			UEntry.SetAccessor(pantheon::vmm::PAGE_MISC_ACCESSED);
 			UEntry.SetMAIREntry(pantheon::vmm::MAIREntry_1);
 
-			pantheon::GlobalScheduler::MapPages(Proc, &TargetVAddr, &NewPage, UEntry, 1);
+			/* The process frees this page when it's done. */
+			if (pantheon::GlobalScheduler::MapPages(Proc, &TargetVAddr, &NewPage, UEntry, 1) == FALSE)
+			{
+				pantheon::StopError("unable to map program image");
+			}
 		}
 	}
 }
@@ -59,14 +59,16 @@ pantheon::Handle::Handle(pantheon::ipc::ServerConnection *Connection)
 {
 	this->Type = pantheon::HANDLE_TYPE_SERVER_CONNECTION;
 	this->Content.Connection = Connection;
-	Connection->Open();
+
+	/* Both ends live inside the connection, so that's what's counted. */
+	Connection->GetOwner()->Open();
 }
 
 pantheon::Handle::Handle(pantheon::ipc::ClientConnection *ClientConnection)
 {
 	this->Type = pantheon::HANDLE_TYPE_CLIENT_CONNECTION;
 	this->Content.ClientConnection = ClientConnection;
-	ClientConnection->Open();
+	ClientConnection->GetOwner()->Open();
 }
 
 pantheon::HandleContent &pantheon::Handle::GetContent()
@@ -132,11 +134,8 @@ void pantheon::Handle::Close()
 			pantheon::ipc::ServerConnection *SrvConn = this->Content.Connection;
 			pantheon::ipc::Connection *Conn = SrvConn->GetOwner();
 			Conn->CloseServerHandler();
-			if (Conn->IsClientClosed() && Conn->IsServerClosed())
-			{
-				Conn->Close();
-			}
 			SrvConn->Close();
+			Conn->Close();
 			break;
 		}
 
@@ -145,11 +144,7 @@ void pantheon::Handle::Close()
 			pantheon::ipc::ClientConnection *CliConn = this->Content.ClientConnection;
 			pantheon::ipc::Connection *Conn = CliConn->GetOwner();
 			Conn->CloseClientHandler();
-			if (Conn->IsClientClosed() && Conn->IsServerClosed())
-			{
-				Conn->Close();
-			}
-			CliConn->Close();
+			Conn->Close();
 			break;
 		}
 
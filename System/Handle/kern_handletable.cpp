@@ -56,4 +56,15 @@ VOID pantheon::HandleTable::Clear()
 	{
 		Hand = pantheon::Handle();
 	}
+}
+
+VOID pantheon::HandleTable::CloseAll()
+{
+	for (pantheon::Handle &Hand : this->ProcHandleTable)
+	{
+		if (Hand.IsValid())
+		{
+			Hand.Close();
+		}
+	}
 }
\ No newline at end of file
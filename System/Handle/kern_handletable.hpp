@@ -18,6 +18,7 @@ public:
 	BOOL Release(INT32 Index);
 
 	VOID Clear();
+	VOID CloseAll();
 
 private:
 	static constexpr INT32 HandleTableSize = 64;
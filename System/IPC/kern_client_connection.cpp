@@ -6,6 +6,8 @@
 #include <System/IPC/kern_client_port.hpp>
 #include <System/IPC/kern_client_connection.hpp>
 
+#include <System/Proc/kern_cpu.hpp>
+
 
 void pantheon::ipc::ClientConnection::Initialize(pantheon::ipc::Connection *Owner)
 {
@@ -13,11 +15,13 @@ void pantheon::ipc::ClientConnection::Initialize(pantheon::ipc::Connection *Owne
 	this->Owner = Owner;
 }
 
-void pantheon::ipc::ClientConnection::Send(const UINT32 *Content)
+/**
+ * @brief Sends the request in the thread local region of the current thread, and waits for the reply
+ */
+pantheon::Result pantheon::ipc::ClientConnection::Send()
 {
 	OBJECT_SELF_ASSERT();
-	PANTHEON_UNUSED(Content);
-	/* NYI */
+	return this->Owner->GetServerConnection()->RequestHandler(pantheon::CPU::GetCurThread());
 }
 
 void pantheon::ipc::ClientConnection::Recieve(UINT32 *Content, UINT64 Size)
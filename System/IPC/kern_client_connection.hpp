@@ -1,4 +1,5 @@
 #include <kern_object.hpp>
+#include <kern_result.hpp>
 #include <kern_datatypes.hpp>
 
 #include <Common/Sync/kern_atomic.hpp>
@@ -21,7 +22,7 @@ public:
 
 	[[nodiscard]] Connection *GetOwner() const { return this->Owner; }
 
-	void Send(const UINT32 *Content);
+	pantheon::Result Send();
 	void Recieve(UINT32 *Content, UINT64 Size);
 
 	void ServerClosedHandler();
@@ -24,7 +24,7 @@ void pantheon::ipc::Connection::CloseClientHandler()
 	if (CurrentState != pantheon::ipc::Connection::State::CLOSED_SERVER)
 	{
 		this->CurState = pantheon::ipc::Connection::State::CLOSED_CLIENT;
-		/* TODO: Fire client closed event for client */
+		this->SrvConn.ClientClosedHandler();
 	}
 	else
 	{
@@ -2,6 +2,7 @@
 
 #include <Common/kern_container.hpp>
 #include <Common/Structures/kern_slab.hpp>
+#include <Common/Sync/kern_spinlock.hpp>
 #include <System/IPC/kern_event.hpp>
 
 /* TODO: Make allocator more robust */
@@ -14,25 +15,65 @@ pantheon::mm::SlabCache<pantheon::ipc::NamedEvent> NamedEventAllocator;
 pantheon::mm::SlabCache<pantheon::ipc::WritableEvent> WritableEventAllocator;
 pantheon::mm::SlabCache<pantheon::ipc::ReadableEvent> ReadableEventAllocator;
 
-struct NamedEventContainer
+/* Looked up without any lock. Changing it takes the lock, which also
+ * covers the allocators. */
+static pantheon::Atomic<pantheon::ipc::NamedEvent*> ValidEvents[NumEvents];
+static pantheon::Spinlock ValidEventsLock("Named Events");
+
+static pantheon::ipc::NamedEvent *FindEvent(const pantheon::String &Name)
 {
-	pantheon::ipc::NamedEvent* Ptr;
-	BOOL Valid;
-};
+	for (pantheon::Atomic<pantheon::ipc::NamedEvent*> &Slot : ValidEvents)
+	{
+		pantheon::ipc::NamedEvent *Evt = Slot.Load();
+		if (Evt != nullptr && Evt->Name == Name)
+		{
+			return Evt;
+		}
+	}
+	return nullptr;
+}
 
-static ArrayList<NamedEventContainer> ValidEvents;
+static void FreeNamedEvent(VOID *Arg)
+{
+	pantheon::ipc::NamedEvent *Evt = static_cast<pantheon::ipc::NamedEvent*>(Arg);
+
+	/* In order for this to be valid, all contents must also be
+	 * valid. Therefore, the sub-contents must be deallocated first.
+	 */
+	ValidEventsLock.Acquire();
+	ReadableEventAllocator.Deallocate(Evt->Readable);
+	WritableEventAllocator.Deallocate(Evt->Writable);
+	NamedEventAllocator.Deallocate(Evt);
+	ValidEventsLock.Release();
+}
 
 void pantheon::ipc::InitEventSystem()
 {
-	ValidEvents = ArrayList<NamedEventContainer>(NumEvents);
+	for (pantheon::Atomic<pantheon::ipc::NamedEvent*> &Slot : ValidEvents)
+	{
+		Slot.Store(nullptr);
+	}
 	NamedEventAllocator = pantheon::mm::SlabCache<pantheon::ipc::NamedEvent>(AreaBuffer);
 	WritableEventAllocator = pantheon::mm::SlabCache<pantheon::ipc::WritableEvent>(WritableBuffer);
 	ReadableEventAllocator = pantheon::mm::SlabCache<pantheon::ipc::ReadableEvent>(ReadableBuffer);
 }
 
+/**
+ * @brief Creates a new event, which any process can find by its name
+ * @details If some other event with the same name was created in the
+ * meantime, that one is returned instead.
+ */
 pantheon::ipc::NamedEvent *pantheon::ipc::CreateNamedEvent(const pantheon::String &Name, pantheon::Process *Creator)
 {
-	pantheon::ipc::NamedEvent *Evt = NamedEventAllocator.Allocate();
+	ValidEventsLock.Acquire();
+	pantheon::ipc::NamedEvent *Evt = FindEvent(Name);
+	if (Evt)
+	{
+		ValidEventsLock.Release();
+		return Evt;
+	}
+
+	Evt = NamedEventAllocator.Allocate();
 	if (Evt)
 	{
 		Evt->Creator = Creator;
@@ -44,7 +85,17 @@ pantheon::ipc::NamedEvent *pantheon::ipc::CreateNamedEvent(const pantheon::Strin
 		Evt->Writable->Parent = Evt;
 		Evt->Readable->Parent = Evt;
 
-		if (Creator == nullptr || Evt->Readable == nullptr || Evt->Writable == nullptr)
+		pantheon::Atomic<pantheon::ipc::NamedEvent*> *Free = nullptr;
+		for (pantheon::Atomic<pantheon::ipc::NamedEvent*> &Slot : ValidEvents)
+		{
+			if (Slot.Load() == nullptr)
+			{
+				Free = &Slot;
+				break;
+			}
+		}
+
+		if (Creator == nullptr || Evt->Readable == nullptr || Evt->Writable == nullptr || Free == nullptr)
 		{
 			if (Evt->Readable)
 			{
@@ -56,52 +107,50 @@ pantheon::ipc::NamedEvent *pantheon::ipc::CreateNamedEvent(const pantheon::Strin
 				WritableEventAllocator.Deallocate(Evt->Writable);
 			}
 			NamedEventAllocator.Deallocate(Evt);
+			ValidEventsLock.Release();
 			return nullptr;
 		}
 
-		ValidEvents.Add({Evt, TRUE});
+		/* Only visible to lookups once it's all set up. */
+		Free->Store(Evt);
 	}
+	ValidEventsLock.Release();
 	return Evt;
 
 }
 
+/**
+ * @brief Finds an event by its name, without taking any lock
+ * @details The caller has to be in a read section for as long as it uses
+ * the event it gets back.
+ */
 pantheon::ipc::NamedEvent *pantheon::ipc::LookupEvent(const pantheon::String &Name)
 {
-	for (auto &EvtItem : ValidEvents)
+	if (pantheon::rcu::InReadSection() == FALSE)
 	{
-		pantheon::ipc::NamedEvent *Evt = EvtItem.Ptr;
-		if (Evt->Name == Name)
-		{
-			return Evt;
-		}
+		StopError("LookupEvent outside read section");
 	}
-	return nullptr;
+	return FindEvent(Name);
 }
 
+/**
+ * @brief Removes an event, so that it can't be found anymore
+ * @details It's only actually freed once no lookup could still be using it.
+ */
 void pantheon::ipc::DestroyNamedEvent(pantheon::ipc::NamedEvent *Evt)
 {
 	if (Evt)
 	{
-		UINT64 SIndex = -1;
-		for (UINT64 Index = 0; Index < ValidEvents.Size(); Index++)
+		ValidEventsLock.Acquire();
+		for (pantheon::Atomic<pantheon::ipc::NamedEvent*> &Slot : ValidEvents)
 		{
-			if (ValidEvents[Index].Ptr == Evt)
+			if (Slot.Load() == Evt)
 			{
-				SIndex = Index;
+				Slot.Store(nullptr);
 				break;
 			}
 		}
-
-		if (SIndex >= 0)
-		{
-			ValidEvents.Delete(SIndex);
-		}
-
-		/* In order for this to be valid, all contents must also be
-		 * valid. Therefore, the sub-contents must be deallocated first.
-		 */
-		ReadableEventAllocator.Deallocate(Evt->Readable);
-		WritableEventAllocator.Deallocate(Evt->Writable);
-		NamedEventAllocator.Deallocate(Evt);
+		ValidEventsLock.Release();
+		pantheon::rcu::Defer(&Evt->Reclaim, FreeNamedEvent, Evt);
 	}
-}
\ No newline at end of file
+}
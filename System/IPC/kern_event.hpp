@@ -1,6 +1,8 @@
 #include <kern_string.hpp>
 #include <kern_datatypes.hpp>
 #include <Common/kern_object.hpp>
+#include <Common/Sync/kern_rcu.hpp>
+#include <System/Proc/kern_waitqueue.hpp>
 
 #ifndef _KERN_EVENT_HPP_
 #define _KERN_EVENT_HPP_
@@ -28,11 +30,17 @@ struct Event
 	ReadableEvent *Readable;
 	pantheon::Process *Creator;
 	volatile EventStatus Status;
+
+	/* Threads waiting for this to be signaled */
+	pantheon::WaitQueue Waiters;
 };
 
 struct NamedEvent : public Event
 {
 	pantheon::String Name;
+
+	/* Lookups don't take a lock, so freeing this has to wait for them. */
+	pantheon::rcu::Head Reclaim;
 };
 
 typedef struct WritableEvent : public pantheon::Object<WritableEvent, 64>
@@ -8,6 +8,9 @@
 
 #include <System/Proc/kern_sched.hpp>
 
+#include <Common/Sync/kern_rcu.hpp>
+#include <Common/Sync/kern_spinlock.hpp>
+
 /**
  * @file System/IPC/kern_port.cpp
  * @brief Description and definition of a pantheon port.
@@ -23,54 +26,77 @@ pantheon::ipc::Port::~Port()
 
 }
 
-typedef union PortAlias
-{
-	pantheon::ipc::Port *Ptr;
-	pantheon::vmm::VirtualAddress VAddr;
-}PortAlias;
+/* There can't be more named ports than there are ports. */
+static constexpr UINT64 MaxNamedPorts = 128;
+
+/* Looked up on every connection, without any lock. Only changing it needs one. */
+static pantheon::Atomic<pantheon::ipc::Port*> NamedPorts[MaxNamedPorts];
+static pantheon::Spinlock NamedPortsLock("Named Ports");
 
-static ArrayList<PortAlias> NamedPortsList;
 void pantheon::ipc::Port::Setup()
 {
-	NamedPortsList = ArrayList<PortAlias>(1024);
+	for (pantheon::Atomic<pantheon::ipc::Port*> &Slot : NamedPorts)
+	{
+		Slot.Store(nullptr);
+	}
 }
 
 static void Register(pantheon::ipc::Port *Current)
 {
-	/* Make sure this exists precisely once in the list? */
-	NamedPortsList.Add({Current});
+	NamedPortsLock.Acquire();
+	for (pantheon::Atomic<pantheon::ipc::Port*> &Slot : NamedPorts)
+	{
+		if (Slot.Load() == Current)
+		{
+			break;
+		}
+
+		if (Slot.Load() == nullptr)
+		{
+			Slot.Store(Current);
+			break;
+		}
+	}
+	NamedPortsLock.Release();
 }
 
 static void Unregister(pantheon::ipc::Port *Current)
 {
-	INT64 DelIndex = -1;
-	for (UINT64 Index = 0; Index < NamedPortsList.Size(); ++Index)
+	NamedPortsLock.Acquire();
+	for (pantheon::Atomic<pantheon::ipc::Port*> &Slot : NamedPorts)
 	{
-		if (NamedPortsList[Index].Ptr == Current)
+		if (Slot.Load() == Current)
 		{
-			DelIndex = (INT64)Index;
+			Slot.Store(nullptr);
 			break;
 		}
 	}
-
-	if (DelIndex >= 0)
-	{
-		NamedPortsList.Delete(DelIndex);
-	}
+	NamedPortsLock.Release();
 }
 
+/**
+ * @brief Finds an open port by its name, without taking any lock
+ * @details The caller has to be in a read section for as long as it uses
+ * the port it gets back.
+ */
 pantheon::ipc::Port *pantheon::ipc::Port::GetRegistered(const PortName &Name)
 {
+	if (pantheon::rcu::InReadSection() == FALSE)
+	{
+		StopError("GetRegistered outside read section");
+	}
+
 	if (Name.AsNumber == 0)
 	{
 		return nullptr;
 	}
 
-	for (const PortAlias &Item : NamedPortsList)
+	for (pantheon::Atomic<pantheon::ipc::Port*> &Slot : NamedPorts)
 	{
-		if (Item.Ptr->GetName().AsNumber == Name.AsNumber)
+		pantheon::ipc::Port *Item = Slot.Load();
+		if (Item != nullptr && Item->GetName().AsNumber == Name.AsNumber)
 		{
-			return Item.Ptr;
+			return Item;
 		}
 	}
 
@@ -149,8 +175,9 @@ pantheon::ipc::ClientConnection *pantheon::ipc::Port::CreateConnection()
 
 	NewConn->Initialize(this->Client, this->Server);
 
+	/* The server port keeps it alive until it's accepted. */
 	pantheon::ipc::ServerConnection *Conn = NewConn->GetServerConnection();
-	Conn->Open();
+	NewConn->Open();
 	pantheon::Result Res = this->Enqueue(Conn);
 	if (Res != pantheon::Result::SYS_OK)
 	{
@@ -6,30 +6,228 @@
 #include <System/IPC/kern_server_port.hpp>
 #include <System/IPC/kern_server_connection.hpp>
 
+#include <System/Proc/kern_cpu.hpp>
 #include <System/Proc/kern_sched.hpp>
+#include <System/Proc/kern_thread.hpp>
 
-void pantheon::ipc::ServerConnection::ReplyAndRecv(const UINT32 *Content)
+/* The most payload words a message can hold. */
+static constexpr UINT64 MaxMessageWords = sizeof(pantheon::Thread::ThreadLocalPayload) / sizeof(UINT32);
+
+/**
+ * @brief Copies the message in the thread local region of one thread to another
+ * @param From The thread which wrote the message
+ * @param To The thread to deliver the message to
+ * @param Request If this is a request, the server is also told which process sent it
+ */
+static VOID CopyMessage(pantheon::Thread *From, pantheon::Thread *To, BOOL Request)
+{
+	pantheon::Thread::ThreadLocalRegion *Src = From->GetThreadLocalArea();
+	pantheon::Thread::ThreadLocalRegion *Dst = To->GetThreadLocalArea();
+	if (Src == nullptr || Dst == nullptr)
+	{
+		return;
+	}
+
+	UINT64 Size = Src->Header.GetSize();
+	if (Size > MaxMessageWords)
+	{
+		Size = MaxMessageWords;
+	}
+
+	Dst->Header = Src->Header;
+	CopyMemory(Dst->Payload.Data, Src->Payload.Data, Size * sizeof(UINT32));
+
+	pantheon::Process *Proc = From->MyProc();
+	if (Request && Proc != nullptr)
+	{
+		Dst->Header.ClientPID = Proc->ProcessID();
+	}
+}
+
+/**
+ * @brief Blocks the current thread until its current wait is over
+ * @return Why the thread was woken up
+ */
+static INT64 WaitUntilWoken(pantheon::Thread *Waiter)
+{
+	for (;;)
+	{
+		{
+			pantheon::ScopedLock _T(Waiter);
+			if (Waiter->Block() == FALSE)
+			{
+				return Waiter->WakeReason();
+			}
+		}
+		pantheon::CPU::GetCurSched()->Reschedule();
+	}
+}
+
+/**
+ * @brief Replies to the request being handled, then waits for the next one
+ * @details The reply is whatever is in the thread local region of the server
+ * thread, and the next request is put there too. If nothing else needs to be
+ * handled yet, the server switches straight back to the client it replied
+ * to, giving it the rest of its time slice.
+ * @param SrvThread The current thread
+ * @return SYS_OK once a new request was received, KERN_CONN_CLOSED if either
+ * side of the connection closed, SYS_FAIL if some other thread is already
+ * waiting for requests on this connection.
+ */
+pantheon::Result pantheon::ipc::ServerConnection::ReplyAndRecv(pantheon::Thread *SrvThread)
 {
 	OBJECT_SELF_ASSERT();
-	PANTHEON_UNUSED(Content);
-	/* NYI */
+
+	pantheon::Thread *Replied = nullptr;
+	UINT64 RepliedToken = 0;
+	pantheon::Result Result = pantheon::Result::SYS_OK;
+
+	BOOL Waiting = FALSE;
+	pantheon::WaitNode Node;
+	{
+		pantheon::ScopedGlobalSchedulerLock SchedLock;
+		if (this->Client)
+		{
+			CopyMessage(SrvThread, this->Client->Waiter, FALSE);
+			Replied = this->Client->Waiter;
+			RepliedToken = this->Client->Token;
+			this->Client = nullptr;
+		}
+
+		pantheon::WaitNode *Next = nullptr;
+		if (this->Owner->IsClientClosed() || this->Owner->IsServerClosed())
+		{
+			Result = pantheon::Result::KERN_CONN_CLOSED;
+		}
+		else if ((Next = this->Requests.PopFront()) != nullptr)
+		{
+			/* Somebody's already waiting: no need to block at all. */
+			CopyMessage(Next->Waiter, SrvThread, TRUE);
+			this->Client = Next;
+		}
+		else if (this->Receiver != nullptr)
+		{
+			Result = pantheon::Result::SYS_FAIL;
+		}
+		else
+		{
+			pantheon::ScopedLock _T(SrvThread);
+			pantheon::InitWaitNode(&Node, SrvThread, SrvThread->BeginWait(), 0);
+			SrvThread->Block();
+			this->Receiver = &Node;
+			Waiting = TRUE;
+		}
+
+		if (Waiting == FALSE && Replied)
+		{
+			pantheon::WakeThread(Replied, RepliedToken, 0);
+		}
+	}
+
+	if (Waiting == FALSE)
+	{
+		return Result;
+	}
+
+	pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
+	if (Replied)
+	{
+		Sched->HandOff(Replied, RepliedToken, 0);
+	}
+	else
+	{
+		Sched->Reschedule();
+	}
+
+	INT64 Reason = WaitUntilWoken(SrvThread);
+	{
+		pantheon::ScopedGlobalSchedulerLock SchedLock;
+		if (this->Receiver == &Node)
+		{
+			this->Receiver = nullptr;
+		}
+	}
+
+	if (Reason == pantheon::Thread::WakeClosed)
+	{
+		return pantheon::Result::KERN_CONN_CLOSED;
+	}
+	return pantheon::Result::SYS_OK;
 }
 
+/**
+ * @brief Sends a request, and waits for the reply
+ * @details The request is whatever is in the thread local region of the
+ * client thread, and the reply is put there too. If a server thread is
+ * already waiting for requests, the client switches straight to it, giving
+ * it the rest of its time slice. Otherwise, the request waits in line for
+ * a server thread to pick it up.
+ * @param RqThread The current thread
+ * @return SYS_OK once a reply was received, or KERN_CONN_CLOSED if the
+ * connection closed before that.
+ */
 pantheon::Result pantheon::ipc::ServerConnection::RequestHandler(pantheon::Thread *RqThread)
 {
 	OBJECT_SELF_ASSERT();
-	pantheon::ScopedGlobalSchedulerLock SchedLock;
 
-	/* Were we already closed? */
-	if (this->Owner->IsServerClosed())
+	pantheon::WaitNode Node;
+	pantheon::Thread *Server = nullptr;
+	UINT64 ServerToken = 0;
 	{
-		return pantheon::Result::KERN_CONN_CLOSED;
+		pantheon::ScopedGlobalSchedulerLock SchedLock;
+
+		/* Were we already closed? */
+		if (this->Owner->IsServerClosed())
+		{
+			return pantheon::Result::KERN_CONN_CLOSED;
+		}
+
+		{
+			pantheon::ScopedLock _T(RqThread);
+			pantheon::InitWaitNode(&Node, RqThread, RqThread->BeginWait(), 0);
+			RqThread->Block();
+		}
+
+		if (this->Receiver)
+		{
+			CopyMessage(RqThread, this->Receiver->Waiter, TRUE);
+			Server = this->Receiver->Waiter;
+			ServerToken = this->Receiver->Token;
+			this->Receiver = nullptr;
+			this->Client = &Node;
+		}
+		else
+		{
+			this->Requests.Insert(&Node);
+			this->Waiters.WakeAll();
+		}
+	}
+
+	pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
+	if (Server)
+	{
+		Sched->HandOff(Server, ServerToken, 0);
+	}
+	else
+	{
+		Sched->Reschedule();
 	}
 
-	/* TODO: Sleep the client thread */
+	INT64 Reason = WaitUntilWoken(RqThread);
+	{
+		/* Not always woken by the server: don't leave it a dangling node to reply to. */
+		pantheon::ScopedGlobalSchedulerLock SchedLock;
+		this->Requests.Remove(&Node);
+		if (this->Client == &Node)
+		{
+			this->Client = nullptr;
+		}
+	}
 
-	this->WaitingThreads.PushBack(RqThread);
-	/* NYI */
+	if (Reason == pantheon::Thread::WakeClosed)
+	{
+		return pantheon::Result::KERN_CONN_CLOSED;
+	}
 	return pantheon::Result::SYS_OK;
 }
 
@@ -50,5 +248,21 @@ void pantheon::ipc::ServerConnection::Cleanup()
 {
 	/* Mark all threads attempting to push a packet through that the connection is closed. */
 	pantheon::ScopedGlobalSchedulerLock SchedLock;
-	/* NYI */	
-}
\ No newline at end of file
+	pantheon::WaitNode *Node = nullptr;
+	while ((Node = this->Requests.PopFront()) != nullptr)
+	{
+		pantheon::WakeThread(Node->Waiter, Node->Token, pantheon::Thread::WakeClosed);
+	}
+
+	if (this->Client)
+	{
+		pantheon::WakeThread(this->Client->Waiter, this->Client->Token, pantheon::Thread::WakeClosed);
+		this->Client = nullptr;
+	}
+
+	if (this->Receiver)
+	{
+		pantheon::WakeThread(this->Receiver->Waiter, this->Receiver->Token, pantheon::Thread::WakeClosed);
+		this->Receiver = nullptr;
+	}
+}
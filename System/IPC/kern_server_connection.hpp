@@ -4,7 +4,7 @@
 #include <Common/Sync/kern_atomic.hpp>
 #include <Common/Structures/kern_allocatable.hpp>
 
-#include <Common/Structures/kern_linkedlist.hpp>
+#include <System/Proc/kern_waitqueue.hpp>
 
 #ifndef _KERN_SERVER_CONNECTION_HPP_
 #define _KERN_SERVER_CONNECTION_HPP_
@@ -17,20 +17,32 @@ class Connection;
 class ServerConnection : public pantheon::Object<ServerConnection>
 {
 public:
-	explicit ServerConnection() = default;
+	explicit ServerConnection() : Owner(nullptr), Receiver(nullptr), Client(nullptr) {}
 
 	void Initialize(Connection *Owner) { this->Owner = Owner; }
 	[[nodiscard]] Connection *GetOwner() const { return this->Owner; }
 
-	void ReplyAndRecv(const UINT32 *Content);
+	pantheon::Result ReplyAndRecv(pantheon::Thread *SrvThread);
 	pantheon::Result RequestHandler(pantheon::Thread *RqThread);
 	void ClientClosedHandler();
 
 	void Close();
 
+	[[nodiscard]] BOOL HasPending() const { return this->Requests.IsEmpty() == FALSE; }
+	pantheon::WaitQueue *GetWaiters() { return &this->Waiters; }
+
 private:
 	Connection *Owner;
-	pantheon::LinkedList<pantheon::Thread> WaitingThreads;
+	pantheon::WaitQueue Waiters;
+
+	/* Clients whose requests haven't been picked up yet. */
+	pantheon::WaitQueue Requests;
+
+	/* The server thread waiting for the next request, if any. */
+	pantheon::WaitNode *Receiver;
+
+	/* The client whose request is being handled, waiting for a reply. */
+	pantheon::WaitNode *Client;
 
 private:
 	void Cleanup();
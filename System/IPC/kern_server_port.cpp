@@ -28,6 +28,7 @@ void pantheon::ipc::ServerPort::Cleanup()
 		if (CurCon)
 		{
 			CurCon->Close();
+			CurCon->GetOwner()->Close();
 		}
 		else
 		{
@@ -40,6 +41,7 @@ void pantheon::ipc::ServerPort::Enqueue(pantheon::ipc::ServerConnection *Conn)
 {
 	OBJECT_SELF_ASSERT();
 	this->ConnectionList.PushBack(Conn);
+	this->Waiters.WakeAll();
 }
 
 pantheon::ipc::ServerConnection *pantheon::ipc::ServerPort::Dequeue()
@@ -7,6 +7,8 @@
 #include <Common/Structures/kern_linkedlist.hpp>
 #include <Common/Structures/kern_allocatable.hpp>
 
+#include <System/Proc/kern_waitqueue.hpp>
+
 #ifndef _KERN_SERVER_PORT_HPP_
 #define _KERN_SERVER_PORT_HPP_
 
@@ -27,11 +29,15 @@ public:
 	void Enqueue(ServerConnection *Conn);
 	ServerConnection *Dequeue();
 
+	[[nodiscard]] BOOL HasPending() const { return this->ConnectionList.Size() != 0; }
+	pantheon::WaitQueue *GetWaiters() { return &this->Waiters; }
+
 	void Cleanup();
 	
 private:
 	pantheon::ipc::Port *Owner;
 	pantheon::LinkedList<ServerConnection> ConnectionList;
+	pantheon::WaitQueue Waiters;
 };
 
 }
@@ -1,15 +1,18 @@
 #include <vmm/vmm.hpp>
 #include <vmm/pte.hpp>
 #include <Boot/Boot.hpp>
+#include <Proc/kern_cpu.hpp>
 #include <Sync/kern_spinlock.hpp>
 #include <System/Memory/kern_alloc.hpp>
 
-static pantheon::Spinlock AllocLock;
+#include <System/Memory/kern_buddy.hpp>
+#include <System/Memory/kern_magazine.hpp>
 
-struct BitmapRegion
+/* Each area of memory is handed out separately, under its own lock. */
+struct MemoryRegion
 {
-	UINT64 BaseAddress;
-	pantheon::RawBitmap Map;
+	pantheon::Spinlock Lock;
+	pantheon::mm::BuddyAllocator Buddy;
 };
 
 extern "C" CHAR *PRE_KERN_AREA;
@@ -29,163 +32,336 @@ extern "C" CHAR *BSS_AREA;
 extern "C" CHAR *BSS_PHY_AREA;
 extern "C" CHAR *BSS_END;
 
-/* Assume we average 2GB per reegion, up to NUM_BOOT_MEMORY_AREAS times*/
+/* Assume we average 2GB per region, up to NUM_BOOT_MEMORY_AREAS times */
+static constexpr UINT64 AreaPages = (2ULL * 1024ULL * 1024ULL * 1024ULL) / pantheon::vmm::SmallestPageSize;
+static constexpr UINT64 AreaBitmapBytes = pantheon::mm::BuddyAllocator::BitmapBytes(AreaPages + (1ULL << pantheon::mm::BuddyAllocator::MaxOrder));
+
 static UINT64 NumMemArea = 0;
-static UINT8 Area[(NUM_BOOT_MEMORY_AREAS * (2ULL * 1024ULL * 1024ULL * 1024ULL)) / (pantheon::vmm::SmallestPageSize * 8)];
-static BitmapRegion Regions[NUM_BOOT_MEMORY_AREAS];
+static UINT8 Area[NUM_BOOT_MEMORY_AREAS * AreaBitmapBytes];
+static MemoryRegion Regions[NUM_BOOT_MEMORY_AREAS];
+
+/* Single pages are mostly handed out, and taken back, without any lock. */
+static pantheon::CPU::PerCore<pantheon::mm::PageMagazine> Magazines;
 
-bool IsUsed(UINT64 Addr)
+static MemoryRegion *RegionOf(UINT64 Addr)
 {
 	for (UINT64 InitArea = 0; InitArea < NumMemArea; ++InitArea)
 	{
-		UINT64 MinAddr = Regions[InitArea].BaseAddress;
-		UINT64 MaxAddr = MinAddr + Regions[InitArea].Map.GetSizeBytes() * pantheon::vmm::SmallestPageSize * 8;
-
-		if (Addr < MinAddr || Addr > MaxAddr)
+		if (Regions[InitArea].Buddy.Contains(Addr))
 		{
-			continue;
+			return &Regions[InitArea];
 		}
-
-		UINT64 Offset = (Addr - MinAddr) / (pantheon::vmm::SmallestPageSize);
-		return Regions[InitArea].Map.Get(Offset);
 	}
-	return 0;
+	return nullptr;
 }
 
-void AllocatePage(UINT64 Addr)
+void pantheon::PageAllocator::InitPageAllocator(InitialBootInfo *BootInfo)
 {
-	UINT64 NumMemAreas = NumMemArea;
-	for (UINT64 InitArea = 0; InitArea < NumMemAreas; ++InitArea)
+	UINT64 Offset = 0;
+	for (UINT64 Index = 0; Index < BootInfo->NumMemoryAreas; Index++)
 	{
-		UINT64 MinAddr = Regions[InitArea].BaseAddress;
-		UINT64 MaxAddr = MinAddr + Regions[InitArea].Map.GetSizeBytes() * pantheon::vmm::SmallestPageSize * 8;
+		/* The boot code counts areas by the size of a bitmap of their pages. */
+		UINT64 NumPages = (BootInfo->InitMemoryAreas[Index].Size - 1) * 8;
+		Regions[Index].Lock = pantheon::Spinlock("page_alloc");
+		Regions[Index].Buddy.Init(BootInfo->InitMemoryAreas[Index].BaseAddress, NumPages, Area + Offset, AreaBitmapBytes);
+		NumMemArea++;
+		Offset += AreaBitmapBytes;
+	}
 
-		if (Addr < MinAddr || Addr > MaxAddr)
-		{
-			continue;
-		}
+#if 0
+	pantheon::vmm::PhysicalAddress TextBegin = (pantheon::vmm::PhysicalAddress)&TEXT_PHY_AREA;
+	pantheon::vmm::PhysicalAddress TextEnd = TextBegin + ((pantheon::vmm::PhysicalAddress)&TEXT_END - (pantheon::vmm::PhysicalAddress)&TEXT_AREA);
+
+	for (pantheon::vmm::PhysicalAddress Addr = TextBegin; Addr <= TextEnd; Addr += pantheon::vmm::SmallestPageSize)
+	{
+		AllocatePage(Addr);
+	}
+
+	pantheon::vmm::PhysicalAddress RodataBegin = (pantheon::vmm::PhysicalAddress)&RODATA_PHY_AREA;
+	pantheon::vmm::PhysicalAddress RodataEnd = RodataBegin + ((pantheon::vmm::PhysicalAddress)&RODATA_END - (pantheon::vmm::PhysicalAddress)&RODATA_AREA);
+
+	for (pantheon::vmm::PhysicalAddress Addr = RodataBegin; Addr <= RodataEnd; Addr += pantheon::vmm::SmallestPageSize)
+	{
+		AllocatePage(Addr);
+	}
+
+	pantheon::vmm::PhysicalAddress DataBegin = (pantheon::vmm::PhysicalAddress)&DATA_PHY_AREA;
+	pantheon::vmm::PhysicalAddress DataEnd = DataBegin + ((pantheon::vmm::PhysicalAddress)&DATA_END - (pantheon::vmm::PhysicalAddress)&DATA_AREA);
 
-		UINT64 Offset = (Addr - MinAddr) / (pantheon::vmm::SmallestPageSize);
-		Regions[InitArea].Map.Set(Offset, TRUE);
+	for (pantheon::vmm::PhysicalAddress Addr = DataBegin; Addr <= DataEnd; Addr += pantheon::vmm::SmallestPageSize)
+	{
+		AllocatePage(Addr);
 	}
+#endif
 }
 
-void FreePage(UINT64 Addr)
+#ifdef ONLY_TESTS
+#include <stdlib.h>
+#endif
+
+/**
+ * @brief Fills up a magazine from the shared allocator, taking each
+ * area's lock at most once.
+ * @details Interrupts must be off, so that nothing else on this core
+ * touches the magazine in between.
+ */
+static VOID Refill(pantheon::mm::PageMagazine &Mag)
 {
-	UINT64 NumMemAreas = NumMemArea;
-	for (UINT64 InitArea = 0; InitArea < NumMemAreas; ++InitArea)
+	for (UINT64 InitArea = 0; InitArea < NumMemArea && Mag.Count() < pantheon::mm::PageMagazine::Batch; ++InitArea)
 	{
-		UINT64 MinAddr = Regions[InitArea].BaseAddress;
-		UINT64 MaxAddr = MinAddr + Regions[InitArea].Map.GetSizeBytes() * pantheon::vmm::SmallestPageSize * 8;
-
-		if (Addr < MinAddr || Addr > MaxAddr)
+		Regions[InitArea].Lock.Acquire();
+		while (Mag.Count() < pantheon::mm::PageMagazine::Batch)
 		{
-			continue;
+			UINT64 Page = Regions[InitArea].Buddy.Alloc(0);
+			if (Page == 0)
+			{
+				break;
+			}
+			Mag.Push(Page, FALSE);
 		}
-
-		UINT64 Offset = (Addr - MinAddr) / (pantheon::vmm::SmallestPageSize);
-		Regions[InitArea].Map.Set(Offset, FALSE);
+		Regions[InitArea].Lock.Release();
 	}
 }
 
-UINT64 FindPage()
+/**
+ * @brief Gives single pages back to the shared allocator, taking each
+ * area's lock at most once.
+ * @details Every page must be in some area: Free and FreeMany check that
+ * before any page gets here.
+ */
+static VOID ReturnPages(const UINT64 *Pages, UINT64 Count)
 {
-	UINT64 NumMemAreas = NumMemArea;
-	for (UINT64 InitArea = 0; InitArea < NumMemAreas; ++InitArea)
+	for (UINT64 InitArea = 0; InitArea < NumMemArea; ++InitArea)
 	{
-		for (UINT64 Bit = 0; Bit < Regions[InitArea].Map.GetSizeBits(); ++Bit)
+		Regions[InitArea].Lock.Acquire();
+		for (UINT64 Index = 0; Index < Count; ++Index)
 		{
-			if (Regions[InitArea].Map.Get(Bit) == 0)
+			if (Regions[InitArea].Buddy.Contains(Pages[Index]))
 			{
-				return Regions[InitArea].BaseAddress + (pantheon::vmm::SmallestPageSize * Bit);
+				Regions[InitArea].Buddy.Free(Pages[Index], 0);
 			}
 		}
+		Regions[InitArea].Lock.Release();
 	}
-	return 0;
 }
 
-
-void pantheon::PageAllocator::InitPageAllocator(InitialBootInfo *BootInfo)
+/**
+ * @brief Keeps a free page in a magazine, making room first if it's full.
+ * @details Interrupts must be off, so that nothing else on this core
+ * touches the magazine in between.
+ */
+static VOID Keep(pantheon::mm::PageMagazine &Mag, UINT64 Page, BOOL Clean)
 {
-	AllocLock = pantheon::Spinlock("page_alloc");
-	UINT64 Offset = 0;
-	for (UINT64 Index = 0; Index < BootInfo->NumMemoryAreas; Index++)
+	if (Mag.Full())
 	{
-		Regions[Index].BaseAddress = BootInfo->InitMemoryAreas[Index].BaseAddress;
-		Regions[Index].Map = pantheon::RawBitmap(Area + Offset, BootInfo->InitMemoryAreas->Size);
-		NumMemArea++;
-		Offset += BootInfo->InitMemoryAreas->Size;
+		UINT64 Pages[pantheon::mm::PageMagazine::Batch];
+		UINT64 Count = Mag.Take(Pages, pantheon::mm::PageMagazine::Batch);
+		ReturnPages(Pages, Count);
 	}
+	Mag.Push(Page, Clean);
+}
 
-#if 0
-	pantheon::vmm::PhysicalAddress TextBegin = (pantheon::vmm::PhysicalAddress)&TEXT_PHY_AREA;
-	pantheon::vmm::PhysicalAddress TextEnd = TextBegin + ((pantheon::vmm::PhysicalAddress)&TEXT_END - (pantheon::vmm::PhysicalAddress)&TEXT_AREA);
+/**
+ * @brief Allocates a single page, cleared to zero
+ * @details The page comes from this core's magazine if it has any, and
+ * only goes to the shared allocator when it has run dry. Pages the idle
+ * loop already cleared go first, so usually there's nothing left to clear.
+ * @return The physical address of the page, or 0 if there's no free memory left
+ */
+UINT64 pantheon::PageAllocator::Alloc()
+{
+/* This allows tests to pass in userspace for things like process creation. */
+#ifdef ONLY_TESTS
+	return pantheon::PageAllocator::AllocContiguous(0);
+#endif
 
-	for (pantheon::vmm::PhysicalAddress Addr = TextBegin; Addr <= TextEnd; Addr += pantheon::vmm::SmallestPageSize)
+	BOOL Clean = FALSE;
+	pantheon::CPU::PUSHI();
+	pantheon::mm::PageMagazine &Mag = Magazines.Local();
+	UINT64 Page = Mag.Pop(Clean);
+	if (Page == 0)
 	{
-		AllocatePage(Addr);
+		Refill(Mag);
+		Page = Mag.Pop(Clean);
 	}
+	pantheon::CPU::POPI();
 
-	pantheon::vmm::PhysicalAddress RodataBegin = (pantheon::vmm::PhysicalAddress)&RODATA_PHY_AREA;
-	pantheon::vmm::PhysicalAddress RodataEnd = RodataBegin + ((pantheon::vmm::PhysicalAddress)&RODATA_END - (pantheon::vmm::PhysicalAddress)&RODATA_AREA);
-
-	for (pantheon::vmm::PhysicalAddress Addr = RodataBegin; Addr <= RodataEnd; Addr += pantheon::vmm::SmallestPageSize)
+	if (Page != 0x00 && Clean == FALSE)
 	{
-		AllocatePage(Addr);
+		pantheon::CPU::ZeroPage((VOID*)pantheon::vmm::PhysicalToVirtualAddress(Page));
 	}
+	return Page;
+}
 
-	pantheon::vmm::PhysicalAddress DataBegin = (pantheon::vmm::PhysicalAddress)&DATA_PHY_AREA;
-	pantheon::vmm::PhysicalAddress DataEnd = DataBegin + ((pantheon::vmm::PhysicalAddress)&DATA_END - (pantheon::vmm::PhysicalAddress)&DATA_AREA);
+/**
+ * @brief Frees a single page from Alloc
+ * @details The page is kept in this core's magazine for the next Alloc
+ * here. Only once that's full do some of its pages go back to the shared
+ * allocator.
+ * @param Page The physical address of the page
+ * @param Clean If the caller knows the page is all zeroes, so that it
+ * doesn't have to be cleared again
+ */
+void pantheon::PageAllocator::Free(UINT64 Page, BOOL Clean)
+{
+/* This allows tests to pass in userspace for things like process creation. */
+#ifdef ONLY_TESTS
+	pantheon::PageAllocator::FreeContiguous(Page, 0);
+	return;
+#endif
 
-	for (pantheon::vmm::PhysicalAddress Addr = DataBegin; Addr <= DataEnd; Addr += pantheon::vmm::SmallestPageSize)
+	if (RegionOf(Page) == nullptr)
 	{
-		AllocatePage(Addr);
+		pantheon::StopError("freed page not in any region", (VOID*)Page);
 	}
-#endif
+
+	pantheon::CPU::PUSHI();
+	Keep(Magazines.Local(), Page, Clean);
+	pantheon::CPU::POPI();
 }
 
+/**
+ * @brief Clears a few free pages ahead of time, so that Alloc doesn't
+ * have to.
+ * @details This is for the idle loop. Dirty pages in this core's
+ * magazine are cleared first, and if there aren't any, more are taken
+ * from the shared allocator, until Batch clean pages are ready. Only
+ * ScrubPerPass pages are done per call, with interrupts on while each one
+ * is cleared, so that the idle loop still notices new work quickly.
+ * @return TRUE if any page was cleared, so there may be more to do.
+ */
+BOOL pantheon::PageAllocator::Scrub()
+{
 #ifdef ONLY_TESTS
-#include <stdlib.h>
+	return FALSE;
 #endif
 
-UINT64 pantheon::PageAllocator::Alloc()
+	for (UINT64 Pass = 0; Pass < ScrubPerPass; ++Pass)
+	{
+		UINT64 Page = 0;
+		pantheon::CPU::PUSHI();
+		pantheon::mm::PageMagazine &Mag = Magazines.Local();
+		if (Mag.CleanCount() < pantheon::mm::PageMagazine::Batch)
+		{
+			Page = Mag.PopDirty();
+			if (Page == 0)
+			{
+				Refill(Mag);
+				Page = Mag.PopDirty();
+			}
+		}
+		pantheon::CPU::POPI();
+
+		if (Page == 0)
+		{
+			return Pass != 0;
+		}
+
+		/* Nobody else can see this page while it's out of the magazine. */
+		pantheon::CPU::ZeroPage((VOID*)pantheon::vmm::PhysicalToVirtualAddress(Page));
+
+		pantheon::CPU::PUSHI();
+		Keep(Magazines.Local(), Page, TRUE);
+		pantheon::CPU::POPI();
+	}
+	return TRUE;
+}
+
+/**
+ * @brief Allocates physically contiguous pages, cleared to zero
+ * @details The block is aligned to its own size, so a block of MaxOrder
+ * can be mapped with a single 2 MiB block descriptor.
+ * @param Order The block is 2^Order pages long
+ * @return The physical address of the first page, or 0 if no area has a
+ * free block that big
+ */
+UINT64 pantheon::PageAllocator::AllocContiguous(UINT8 Order)
 {
+	UINT64 Size = pantheon::vmm::SmallestPageSize << Order;
+
 /* This allows tests to pass in userspace for things like process creation. */
 #ifdef ONLY_TESTS
-	return (UINT64)malloc(pantheon::vmm::SmallestPageSize);
+	VOID *Block = aligned_alloc(Size, Size);
+	ClearBuffer((CHAR*)Block, Size);
+	return (UINT64)Block;
 #endif
 
-	AllocLock.Acquire();
-	UINT64 Addr = FindPage();
-	AllocatePage(Addr);
-	AllocLock.Release();
+	UINT64 Addr = 0;
+	for (UINT64 InitArea = 0; InitArea < NumMemArea && Addr == 0; ++InitArea)
+	{
+		Regions[InitArea].Lock.Acquire();
+		Addr = Regions[InitArea].Buddy.Alloc(Order);
+		Regions[InitArea].Lock.Release();
+	}
 
-	if (Addr != 0x00)
+	for (UINT64 Offset = 0; Addr != 0x00 && Offset < Size; Offset += pantheon::vmm::SmallestPageSize)
 	{
-		ClearBuffer((CHAR*)pantheon::vmm::PhysicalToVirtualAddress(Addr), pantheon::vmm::SmallestPageSize);
+		pantheon::CPU::ZeroPage((VOID*)pantheon::vmm::PhysicalToVirtualAddress(Addr + Offset));
 	}
 
 	return Addr;
 }
 
-void pantheon::PageAllocator::Free(UINT64 Page)
+/**
+ * @brief Frees pages from AllocContiguous
+ * @param Base The physical address of the first page
+ * @param Order The order they were allocated with
+ */
+void pantheon::PageAllocator::FreeContiguous(UINT64 Base, UINT8 Order)
 {
 /* This allows tests to pass in userspace for things like process creation. */
 #ifdef ONLY_TESTS
-	free((void*)Page);
+	free((void*)Base);
+	return;
+#endif
+
+	MemoryRegion *Region = RegionOf(Base);
+	if (Region == nullptr)
+	{
+		pantheon::StopError("freed page not in any region", (VOID*)Base);
+	}
+
+	Region->Lock.Acquire();
+	Region->Buddy.Free(Base, Order);
+	Region->Lock.Release();
+}
+
+/**
+ * @brief Frees several pages at once, only taking each area's lock once
+ * @param Pages The physical addresses of the pages to free
+ * @param Count How many pages there are
+ */
+void pantheon::PageAllocator::FreeMany(const UINT64 *Pages, UINT64 Count)
+{
+#ifdef ONLY_TESTS
+	for (UINT64 Index = 0; Index < Count; ++Index)
+	{
+		free((void*)Pages[Index]);
+	}
 	return;
 #endif
 
-	AllocLock.Acquire();
-	FreePage(Page);
-	AllocLock.Release();
+	/* Same as Free: a page from no region is a bug, and must not go unnoticed. */
+	for (UINT64 Index = 0; Index < Count; ++Index)
+	{
+		if (RegionOf(Pages[Index]) == nullptr)
+		{
+			pantheon::StopError("freed page not in any region", (VOID*)Pages[Index]);
+		}
+	}
+	ReturnPages(Pages, Count);
 }
 
 bool pantheon::PageAllocator::Used(UINT64 Page)
 {
-	bool Status = false;
-	AllocLock.Acquire();
-	Status = !IsUsed(Page);
-	AllocLock.Release();
+	MemoryRegion *Region = RegionOf(Page);
+	if (Region == nullptr)
+	{
+		return true;
+	}
+
+	Region->Lock.Acquire();
+	bool Status = Region->Buddy.IsFree(Page);
+	Region->Lock.Release();
 	return Status;
-}
\ No newline at end of file
+}
@@ -8,8 +8,15 @@ namespace pantheon::PageAllocator
 {
 	void InitPageAllocator(InitialBootInfo *BootInfo);
 	UINT64 Alloc();
-	void Free(UINT64 Page);
+	void Free(UINT64 Page, BOOL Clean = FALSE);
+	UINT64 AllocContiguous(UINT8 Order);
+	void FreeContiguous(UINT64 Base, UINT8 Order);
+	void FreeMany(const UINT64 *Pages, UINT64 Count);
 	bool Used(UINT64 Addr);
+	BOOL Scrub();
+
+	/* How many pages the idle loop clears at a time. */
+	static constexpr UINT64 ScrubPerPass = 4;
 }
 
 #endif
\ No newline at end of file
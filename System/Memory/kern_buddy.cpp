@@ -0,0 +1,253 @@
+#include <vmm/vmm.hpp>
+#include <vmm/pte.hpp>
+#include <kern_runtime.hpp>
+
+#include "kern_buddy.hpp"
+
+/* Lives at the start of every free block. */
+typedef struct BuddyBlock
+{
+	UINT64 Next;
+	UINT64 Prev;
+}BuddyBlock;
+
+static BuddyBlock *BlockAt(UINT64 Addr)
+{
+	return reinterpret_cast<BuddyBlock*>(pantheon::vmm::PhysicalToVirtualAddress(Addr));
+}
+
+pantheon::mm::BuddyAllocator::BuddyAllocator()
+{
+	this->Base = 0;
+	this->Start = 0;
+	this->End = 0;
+	this->NumFree = 0;
+	for (UINT8 Order = 0; Order < NumOrders; ++Order)
+	{
+		this->Heads[Order] = 0;
+		this->BitOffset[Order] = 0;
+	}
+}
+
+pantheon::mm::BuddyAllocator::~BuddyAllocator()
+{
+
+}
+
+/**
+ * @brief Sets up this allocator, with every page in its area free
+ * @details If the bitmap is too small to describe the whole area, only
+ * as much of it as can be described is used. It must describe at least
+ * one page.
+ * @param Start The physical address of the first page
+ * @param NumPages How many pages there are
+ * @param Bitmap Where to keep track of free blocks, at least
+ * BitmapBytes bytes for the area
+ * @param BitmapSize How many bytes the bitmap has
+ */
+VOID pantheon::mm::BuddyAllocator::Init(UINT64 Start, UINT64 NumPages, UINT8 *Bitmap, UINT64 BitmapSize)
+{
+	OBJECT_SELF_ASSERT();
+	this->Start = Align<UINT64>(Start, pantheon::vmm::SmallestPageSize);
+	this->Base = this->Start & ~(MaxBlockSize - 1);
+
+	UINT64 Lead = (this->Start - this->Base) / pantheon::vmm::SmallestPageSize;
+	UINT64 Span = Lead + NumPages;
+	if (BitmapBytes(Span) > BitmapSize)
+	{
+		/* Every order together takes at most two bits a page, plus one
+		 * for each order's partial last block. */
+		UINT64 Bits = BitmapSize * 8;
+		if (Bits < NumOrders + (2 * (Lead + 1)))
+		{
+			StopError("buddy bitmap too small", Bitmap);
+		}
+		Span = (Bits - NumOrders) / 2;
+	}
+	this->End = this->Base + (Span * pantheon::vmm::SmallestPageSize);
+
+	UINT64 Offset = 0;
+	for (UINT8 Order = 0; Order < NumOrders; ++Order)
+	{
+		this->Heads[Order] = 0;
+		this->BitOffset[Order] = Offset;
+		Offset += (Span + (1ULL << Order) - 1) >> Order;
+	}
+	this->Map = pantheon::RawBitmap(Bitmap, (Offset + 7) / 8);
+
+	/* Carve the area into the biggest blocks which fit. */
+	this->NumFree = 0;
+	UINT64 Addr = this->Start;
+	while (Addr < this->End)
+	{
+		UINT8 Order = MaxOrder;
+		while (Order > 0 && this->Fits(Addr, Order) == FALSE)
+		{
+			Order--;
+		}
+		this->Push(Addr, Order);
+		this->NumFree += (1ULL << Order);
+		Addr += (pantheon::vmm::SmallestPageSize << Order);
+	}
+}
+
+/**
+ * @brief Allocates 2^Order contiguous pages, aligned to their size
+ * @details If there's no free block that size, a bigger one is split in
+ * half until there is. The pages are not cleared.
+ * @return The physical address of the first page, or 0 if there's no
+ * room left
+ */
+[[nodiscard]] UINT64 pantheon::mm::BuddyAllocator::Alloc(UINT8 Order)
+{
+	OBJECT_SELF_ASSERT();
+	if (Order > MaxOrder)
+	{
+		return 0;
+	}
+
+	UINT8 Cur = Order;
+	while (Cur <= MaxOrder && this->Heads[Cur] == 0)
+	{
+		Cur++;
+	}
+
+	if (Cur > MaxOrder)
+	{
+		return 0;
+	}
+
+	UINT64 Addr = this->Heads[Cur];
+	this->Unlink(Addr, Cur);
+	while (Cur > Order)
+	{
+		Cur--;
+		this->Push(Addr + (pantheon::vmm::SmallestPageSize << Cur), Cur);
+	}
+	this->NumFree -= (1ULL << Order);
+	return Addr;
+}
+
+/**
+ * @brief Gives back a block from Alloc, merging it with its buddy for as
+ * long as that's free too
+ * @param Addr The address Alloc returned
+ * @param Order The order it was allocated with
+ */
+VOID pantheon::mm::BuddyAllocator::Free(UINT64 Addr, UINT8 Order)
+{
+	OBJECT_SELF_ASSERT();
+	if (Order > MaxOrder || this->Fits(Addr, Order) == FALSE)
+	{
+		StopError("bad buddy block freed", reinterpret_cast<VOID*>(Addr));
+	}
+
+	if (this->IsFree(Addr))
+	{
+		StopError("buddy block freed twice", reinterpret_cast<VOID*>(Addr));
+	}
+
+	this->NumFree += (1ULL << Order);
+	while (Order < MaxOrder)
+	{
+		UINT64 Buddy = this->Base + ((Addr - this->Base) ^ (pantheon::vmm::SmallestPageSize << Order));
+		if (this->Fits(Buddy, Order) == FALSE || this->Map.Get(this->BitOf(Buddy, Order)) == FALSE)
+		{
+			break;
+		}
+
+		this->Unlink(Buddy, Order);
+		Addr = (Addr < Buddy) ? Addr : Buddy;
+		Order++;
+	}
+	this->Push(Addr, Order);
+}
+
+/**
+ * @brief Checks if some page is in the area this allocator hands out
+ */
+[[nodiscard]] BOOL pantheon::mm::BuddyAllocator::Contains(UINT64 Addr) const
+{
+	OBJECT_SELF_ASSERT();
+	return Addr >= this->Start && Addr < this->End;
+}
+
+/**
+ * @brief Checks if some page is part of a free block
+ */
+[[nodiscard]] BOOL pantheon::mm::BuddyAllocator::IsFree(UINT64 Addr)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->Contains(Addr) == FALSE)
+	{
+		return FALSE;
+	}
+
+	for (UINT8 Order = 0; Order < NumOrders; ++Order)
+	{
+		UINT64 Block = this->Base + ((Addr - this->Base) & ~((pantheon::vmm::SmallestPageSize << Order) - 1));
+		if (this->Fits(Block, Order) && this->Map.Get(this->BitOf(Block, Order)))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+[[nodiscard]] UINT64 pantheon::mm::BuddyAllocator::FreePages() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->NumFree;
+}
+
+/**
+ * @brief Checks if a block of some order could start at some address:
+ * that is, if it's aligned, and entirely inside this area.
+ */
+[[nodiscard]] BOOL pantheon::mm::BuddyAllocator::Fits(UINT64 Addr, UINT8 Order) const
+{
+	UINT64 Size = pantheon::vmm::SmallestPageSize << Order;
+	if (Addr < this->Start || Addr >= this->End || ((Addr - this->Base) & (Size - 1)) != 0)
+	{
+		return FALSE;
+	}
+	return (this->End - Addr) >= Size;
+}
+
+[[nodiscard]] UINT64 pantheon::mm::BuddyAllocator::BitOf(UINT64 Addr, UINT8 Order) const
+{
+	UINT64 Page = (Addr - this->Base) / pantheon::vmm::SmallestPageSize;
+	return this->BitOffset[Order] + (Page >> Order);
+}
+
+VOID pantheon::mm::BuddyAllocator::Push(UINT64 Addr, UINT8 Order)
+{
+	BuddyBlock *Block = BlockAt(Addr);
+	Block->Prev = 0;
+	Block->Next = this->Heads[Order];
+	if (this->Heads[Order] != 0)
+	{
+		BlockAt(this->Heads[Order])->Prev = Addr;
+	}
+	this->Heads[Order] = Addr;
+	this->Map.Set(this->BitOf(Addr, Order), TRUE);
+}
+
+VOID pantheon::mm::BuddyAllocator::Unlink(UINT64 Addr, UINT8 Order)
+{
+	BuddyBlock *Block = BlockAt(Addr);
+	if (Block->Prev != 0)
+	{
+		BlockAt(Block->Prev)->Next = Block->Next;
+	}
+	else
+	{
+		this->Heads[Order] = Block->Next;
+	}
+
+	if (Block->Next != 0)
+	{
+		BlockAt(Block->Next)->Prev = Block->Prev;
+	}
+	this->Map.Set(this->BitOf(Addr, Order), FALSE);
+}
@@ -0,0 +1,84 @@
+#include <kern.h>
+#include <kern_datatypes.hpp>
+
+#include <vmm/pte.hpp>
+#include <Structures/kern_rawbitmap.hpp>
+
+/**
+ * @file System/Memory/kern_buddy.hpp
+ * @brief Definitions for allocating physically contiguous pages
+ */
+
+#ifndef _KERN_BUDDY_HPP_
+#define _KERN_BUDDY_HPP_
+
+namespace pantheon::mm
+{
+
+/**
+ * @brief Hands out blocks of 2^Order contiguous pages from one area of
+ * physical memory, each aligned to its own size.
+ * @details Free blocks sit on one list per order, linked through the
+ * blocks themselves. A bitmap per order says which blocks are on those
+ * lists, so freeing a block can tell right away whether its buddy is free
+ * too, and merge them. Both allocating and freeing take at most one step
+ * per order. This isn't locked: whoever owns it has to do that.
+ */
+class BuddyAllocator
+{
+public:
+	/* The biggest block is 2 MiB: enough for one L2 block mapping. */
+	static constexpr UINT8 MaxOrder = 9;
+	static constexpr UINT8 NumOrders = MaxOrder + 1;
+	static constexpr UINT64 MaxBlockSize = pantheon::vmm::SmallestPageSize << MaxOrder;
+
+	BuddyAllocator();
+	~BuddyAllocator();
+
+	VOID Init(UINT64 Start, UINT64 NumPages, UINT8 *Bitmap, UINT64 BitmapSize);
+
+	[[nodiscard]] UINT64 Alloc(UINT8 Order);
+	VOID Free(UINT64 Addr, UINT8 Order);
+
+	[[nodiscard]] BOOL Contains(UINT64 Addr) const;
+	[[nodiscard]] BOOL IsFree(UINT64 Addr);
+	[[nodiscard]] UINT64 FreePages() const;
+
+	/**
+	 * @brief How big the bitmap has to be for an area of some size
+	 * @param NumPages How many pages the area spans, counting from the
+	 * last MaxBlockSize boundary at or before its start
+	 */
+	static constexpr UINT64 BitmapBytes(UINT64 NumPages)
+	{
+		UINT64 Bits = 0;
+		for (UINT8 Order = 0; Order < NumOrders; ++Order)
+		{
+			Bits += (NumPages + (1ULL << Order) - 1) >> Order;
+		}
+		return (Bits + 7) / 8;
+	}
+
+private:
+	[[nodiscard]] BOOL Fits(UINT64 Addr, UINT8 Order) const;
+	[[nodiscard]] UINT64 BitOf(UINT64 Addr, UINT8 Order) const;
+
+	VOID Push(UINT64 Addr, UINT8 Order);
+	VOID Unlink(UINT64 Addr, UINT8 Order);
+
+	/* Blocks are aligned relative to this, which is aligned to MaxBlockSize. */
+	UINT64 Base;
+
+	/* The part of the area which really exists. */
+	UINT64 Start;
+	UINT64 End;
+
+	UINT64 NumFree;
+	UINT64 Heads[NumOrders];
+	UINT64 BitOffset[NumOrders];
+	pantheon::RawBitmap Map;
+};
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include <kern.h>
+#include <kern_datatypes.hpp>
+
+/**
+ * @file System/Memory/kern_magazine.hpp
+ * @brief Definitions for caching free pages close to where they're used
+ */
+
+#ifndef _KERN_MAGAZINE_HPP_
+#define _KERN_MAGAZINE_HPP_
+
+namespace pantheon::mm
+{
+
+/**
+ * @brief A small stack of free pages, kept by one core for itself.
+ * @details Most pages freed on a core are allocated again on that same
+ * core soon after, so they don't have to go back through the shared
+ * allocator in between. When this runs dry or fills up, it's refilled or
+ * drained by Batch pages at a time, so that the shared lock is taken
+ * once per Batch pages instead of once per page.
+ *
+ * Pages known to be all zeroes are kept apart from the rest, so that
+ * they can be handed out without clearing them again. An idle core
+ * clears dirty pages ahead of time, and moves them over.
+ *
+ * This isn't locked: only its own core may touch it, with interrupts off.
+ */
+class PageMagazine
+{
+public:
+	static constexpr UINT64 Capacity = 64;
+	static constexpr UINT64 Batch = Capacity / 2;
+
+	PageMagazine() : NumClean(0), NumDirty(0)
+	{
+	}
+
+	/**
+	 * @brief Takes a page, preferring one which is already cleared.
+	 * @details Among either kind, the page freed most recently is the
+	 * most likely to still be in the cache, so that one goes first.
+	 * @param Clean Set to whether the page is already all zeroes
+	 * @return The physical address of that page, or 0 if this is empty
+	 */
+	[[nodiscard]] UINT64 Pop(BOOL &Clean)
+	{
+		Clean = (this->NumClean != 0);
+		if (Clean)
+		{
+			return this->CleanPages[--this->NumClean];
+		}
+		return this->PopDirty();
+	}
+
+	/**
+	 * @brief Takes a page which still has to be cleared
+	 * @return The physical address of that page, or 0 if there's none
+	 */
+	[[nodiscard]] UINT64 PopDirty()
+	{
+		if (this->NumDirty == 0)
+		{
+			return 0;
+		}
+		return this->DirtyPages[--this->NumDirty];
+	}
+
+	/**
+	 * @brief Keeps a free page
+	 * @param Clean If the page is known to be all zeroes
+	 * @return FALSE if this is already full, and the page wasn't kept
+	 */
+	BOOL Push(UINT64 Page, BOOL Clean)
+	{
+		if (this->Full())
+		{
+			return FALSE;
+		}
+
+		if (Clean)
+		{
+			this->CleanPages[this->NumClean++] = Page;
+		}
+		else
+		{
+			this->DirtyPages[this->NumDirty++] = Page;
+		}
+		return TRUE;
+	}
+
+	/**
+	 * @brief Gives up the oldest pages, to hand back to the shared allocator.
+	 * @details Dirty pages go first, since clean ones are worth more here.
+	 * @param Out Where to put the pages taken out
+	 * @param Count How many pages to take out, at most
+	 * @return How many pages were really taken out
+	 */
+	UINT64 Take(UINT64 *Out, UINT64 Count)
+	{
+		UINT64 Taken = TakeOldest(this->DirtyPages, this->NumDirty, Out, Count);
+		Taken += TakeOldest(this->CleanPages, this->NumClean, Out + Taken, Count - Taken);
+		return Taken;
+	}
+
+	[[nodiscard]] UINT64 Count() const
+	{
+		return this->NumClean + this->NumDirty;
+	}
+
+	[[nodiscard]] UINT64 CleanCount() const
+	{
+		return this->NumClean;
+	}
+
+	[[nodiscard]] BOOL Full() const
+	{
+		return this->Count() == Capacity;
+	}
+
+private:
+	static UINT64 TakeOldest(UINT64 *Pages, UINT64 &NumPages, UINT64 *Out, UINT64 Count)
+	{
+		if (Count > NumPages)
+		{
+			Count = NumPages;
+		}
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			Out[Index] = Pages[Index];
+		}
+
+		for (UINT64 Index = Count; Index < NumPages; ++Index)
+		{
+			Pages[Index - Count] = Pages[Index];
+		}
+		NumPages -= Count;
+		return Count;
+	}
+
+	UINT64 NumClean;
+	UINT64 NumDirty;
+	UINT64 CleanPages[Capacity];
+	UINT64 DirtyPages[Capacity];
+};
+
+}
+
+#endif
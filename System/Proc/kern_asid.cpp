@@ -0,0 +1,211 @@
+#include <kern_datatypes.hpp>
+
+#include "kern_asid.hpp"
+
+pantheon::ASIDAllocator::ASIDAllocator() : pantheon::Lockable("ASID Allocator")
+{
+	this->CurGeneration.Store(1);
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		this->Active.On(Index).Store(0);
+		this->Reserved[Index] = 0;
+
+		/* Whatever was in the TLB before the first process isn't tagged. */
+		this->FlushPending.On(Index).Store(TRUE);
+	}
+
+	for (UINT64 &Word : this->Used)
+	{
+		Word = 0;
+	}
+	this->SetUsed(0);
+	this->NextASID = 1;
+}
+
+pantheon::ASIDAllocator::~ASIDAllocator() = default;
+
+/**
+ * @brief Gets the ASID a process should run with on some core
+ * @details This must be called by the core which is about to load the
+ * address space, every time it does so.
+ * @param Context The context of the process, updated if it needs a new ASID
+ * @param CoreNo The current core
+ * @param Flush Set to TRUE if this core must flush its whole TLB before
+ * running with the returned ASID
+ * @return The ASID to run the process with
+ */
+UINT64 pantheon::ASIDAllocator::Activate(pantheon::Atomic<UINT64> &Context, UINT8 CoreNo, BOOL &Flush)
+{
+	OBJECT_SELF_ASSERT();
+	Flush = FALSE;
+
+	UINT64 Cur = Context.Load();
+	BOOL Current = (Cur & Mask) != 0 && (Cur >> Bits) == this->CurGeneration.Load();
+	if (Current && this->FlushPending.On(CoreNo).Load() == FALSE)
+	{
+		/* A rollover either sees this and keeps the ASID, or we see the rollover. */
+		this->Active.On(CoreNo).Store(Cur);
+		if ((Cur >> Bits) == this->CurGeneration.Load())
+		{
+			return Cur & Mask;
+		}
+	}
+
+	pantheon::ScopedLock _L(this);
+	Cur = Context.Load();
+	if ((Cur & Mask) == 0 || (Cur >> Bits) != this->CurGeneration.Load())
+	{
+		Cur = this->NewContext(Cur);
+		Context.Store(Cur);
+	}
+
+	if (this->FlushPending.On(CoreNo).Load())
+	{
+		this->FlushPending.On(CoreNo).Store(FALSE);
+		Flush = TRUE;
+	}
+	this->Active.On(CoreNo).Store(Cur);
+	return Cur & Mask;
+}
+
+/**
+ * @brief Gets the current generation of ASIDs
+ */
+[[nodiscard]]
+UINT64 pantheon::ASIDAllocator::Generation() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->CurGeneration.Load();
+}
+
+/**
+ * @brief Checks if some core still has an address space loaded
+ * @details A core keeps whatever it last loaded until it switches to some
+ * other process, even while it only runs kernel threads.
+ * @param Context The context of the process
+ */
+[[nodiscard]]
+BOOL pantheon::ASIDAllocator::Loaded(UINT64 Context) const
+{
+	OBJECT_SELF_ASSERT();
+	if ((Context & Mask) == 0)
+	{
+		return FALSE;
+	}
+
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		if (this->Active.On(Index).Load() == Context)
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * @brief Gives a context from some older generation one for this generation. Must be locked.
+ * @details The old ASID is kept if nobody else took it in the meantime.
+ */
+UINT64 pantheon::ASIDAllocator::NewContext(UINT64 Old)
+{
+	OBJECT_SELF_ASSERT();
+	UINT64 Gen = this->CurGeneration.Load();
+	UINT64 ASID = Old & Mask;
+	if (ASID != 0)
+	{
+		UINT64 New = (Gen << Bits) | ASID;
+		if (this->UpdateReserved(Old, New))
+		{
+			return New;
+		}
+
+		if (this->IsUsed(ASID) == FALSE)
+		{
+			this->SetUsed(ASID);
+			return New;
+		}
+	}
+
+	for (UINT64 Pass = 0; Pass < 2; ++Pass)
+	{
+		for (UINT64 Tries = 0; Tries < Count; ++Tries)
+		{
+			ASID = this->NextASID;
+			this->NextASID = (this->NextASID + 1) & Mask;
+			if (this->IsUsed(ASID) == FALSE)
+			{
+				this->SetUsed(ASID);
+				return (this->CurGeneration.Load() << Bits) | ASID;
+			}
+		}
+		this->Rollover();
+	}
+
+	StopError("Out of ASIDs even after a rollover");
+	return 0;
+}
+
+/**
+ * @brief Starts a new generation of ASIDs. Must be locked.
+ * @details Only the ASID each core currently has loaded carries over.
+ */
+VOID pantheon::ASIDAllocator::Rollover()
+{
+	OBJECT_SELF_ASSERT();
+	for (UINT64 &Word : this->Used)
+	{
+		Word = 0;
+	}
+	this->SetUsed(0);
+	this->NextASID = 1;
+
+	/* This has to be visible before looking at what each core has loaded. */
+	this->CurGeneration.FetchAdd(1);
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		UINT64 Loaded = this->Active.On(Index).Load();
+		if (Loaded != 0)
+		{
+			this->Reserved[Index] = Loaded;
+		}
+
+		if (this->Reserved[Index] != 0)
+		{
+			this->SetUsed(this->Reserved[Index] & Mask);
+		}
+		this->FlushPending.On(Index).Store(TRUE);
+	}
+}
+
+/**
+ * @brief Moves a context some core kept over a rollover into this generation. Must be locked.
+ * @return TRUE if some core had kept Old
+ */
+BOOL pantheon::ASIDAllocator::UpdateReserved(UINT64 Old, UINT64 New)
+{
+	OBJECT_SELF_ASSERT();
+	BOOL Found = FALSE;
+	for (UINT64 &Entry : this->Reserved)
+	{
+		if (Entry == Old)
+		{
+			Entry = New;
+			Found = TRUE;
+		}
+	}
+	return Found;
+}
+
+[[nodiscard]]
+BOOL pantheon::ASIDAllocator::IsUsed(UINT64 ASID) const
+{
+	OBJECT_SELF_ASSERT();
+	return (this->Used[ASID / 64] & (1ULL << (ASID % 64))) != 0;
+}
+
+VOID pantheon::ASIDAllocator::SetUsed(UINT64 ASID)
+{
+	OBJECT_SELF_ASSERT();
+	this->Used[ASID / 64] |= (1ULL << (ASID % 64));
+}
@@ -0,0 +1,67 @@
+#include <kern_datatypes.hpp>
+
+#include <Sync/kern_atomic.hpp>
+#include <Proc/kern_cpu.hpp>
+#include <Common/Sync/kern_lockable.hpp>
+
+/**
+ * @file System/Proc/kern_asid.hpp
+ * @brief Definitions for handing out address space IDs to processes
+ */
+
+#ifndef _KERN_ASID_HPP_
+#define _KERN_ASID_HPP_
+
+namespace pantheon
+{
+
+/**
+ * @brief Hands out the address space IDs the TLB tags entries with.
+ * @details A process holds onto a context: the ASID it was given, and the
+ * generation it was given in. Once every ASID was handed out, a new
+ * generation starts, and processes get a new ASID the next time they're
+ * switched to. Whatever each core had loaded at that point is kept, so
+ * running processes don't need to be stopped. Every core has to flush its
+ * TLB once before it uses an ASID from the new generation.
+ *
+ * Switching to a process which already has an ASID from the current
+ * generation never takes the lock.
+ */
+class ASIDAllocator : public pantheon::Lockable
+{
+public:
+	ASIDAllocator();
+	~ASIDAllocator() override;
+
+	UINT64 Activate(pantheon::Atomic<UINT64> &Context, UINT8 CoreNo, BOOL &Flush);
+	[[nodiscard]] UINT64 Generation() const;
+	[[nodiscard]] BOOL Loaded(UINT64 Context) const;
+
+	/* Only 8 bits are guaranteed to be there. ASID 0 is never handed out. */
+	static constexpr UINT64 Bits = 8;
+	static constexpr UINT64 Count = 1ULL << Bits;
+	static constexpr UINT64 Mask = Count - 1;
+
+private:
+	UINT64 NewContext(UINT64 Old);
+	VOID Rollover();
+	BOOL UpdateReserved(UINT64 Old, UINT64 New);
+
+	[[nodiscard]] BOOL IsUsed(UINT64 ASID) const;
+	VOID SetUsed(UINT64 ASID);
+
+	pantheon::Atomic<UINT64> CurGeneration;
+
+	/* The context each core last loaded, and what was kept at the last rollover.
+	 * Every switch writes these, so each core's are kept apart. */
+	pantheon::CPU::PerCore<pantheon::Atomic<UINT64>> Active;
+	UINT64 Reserved[MAX_NUM_CPUS];
+	pantheon::CPU::PerCore<pantheon::Atomic<BOOL>> FlushPending;
+
+	UINT64 Used[Count / 64];
+	UINT64 NextASID;
+};
+
+}
+
+#endif
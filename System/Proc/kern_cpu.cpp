@@ -6,6 +6,7 @@
 #include <vmm/vmm.hpp>
 #include <Boot/Boot.hpp>
 #include <kern_datatypes.hpp>
+#include <Sync/kern_rcu.hpp>
 
 #include <Proc/kern_proc.hpp>
 #include <Proc/kern_sched.hpp>
@@ -16,9 +17,25 @@
 /* Avoid having too high a number of cores to look through. */
 static pantheon::CPU::CoreInfo PerCoreInfo[MAX_NUM_CPUS];
 
-pantheon::CPU::CoreInfo *pantheon::CPU::GetCoreInfo()
+/**
+ * \~english @brief Points the current core at its own per-core area.
+ * \~english @details Must be done before anything else on that core,
+ * since even locks need it.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::CPU::InitCoreArea(UINT8 CoreNo)
+{
+	PerCoreInfo[CoreNo].CoreNo = CoreNo;
+	pantheon::CPU::SetPerCoreArea(&PerCoreInfo[CoreNo]);
+}
+
+/**
+ * \~english @brief Gets the per-core area of some given core.
+ * \~english @author Brian Schnepp
+ */
+pantheon::CPU::CoreInfo *pantheon::CPU::GetCoreArea(UINT8 CoreNo)
 {
-	return &(PerCoreInfo[pantheon::CPU::GetProcessorNumber()]);
+	return &(PerCoreInfo[CoreNo]);
 }
 
 /**
@@ -31,30 +48,39 @@ pantheon::CPU::CoreInfo *pantheon::CPU::GetCoreInfo()
  */
 void pantheon::CPU::InitCoreInfo(UINT8 CoreNo)
 {
-	static pantheon::Scheduler Scheds[MAX_NUM_CPUS];
+	static pantheon::CPU::PerCore<pantheon::Scheduler> Scheds;
 	ClearBuffer((CHAR*)&PerCoreInfo[CoreNo], sizeof(pantheon::CPU::CoreInfo));
-	PerCoreInfo[CoreNo].CurSched = &Scheds[CoreNo];
-	(*PerCoreInfo[CoreNo].CurSched) = pantheon::Scheduler();
+	PerCoreInfo[CoreNo].CoreNo = CoreNo;
+	PerCoreInfo[CoreNo].TickMark = pantheon::GetSystemTicks();
+
+	/* Other cores may steal from this scheduler as soon as it's visible. */
+	Scheds.On(CoreNo) = pantheon::Scheduler(CoreNo);
+	PerCoreInfo[CoreNo].CurThread = Scheds.On(CoreNo).MyThread();
+	pantheon::Sync::DSBISH();
+	PerCoreInfo[CoreNo].CurSched = &Scheds.On(CoreNo);
+	pantheon::rcu::Online(CoreNo);
+
+	/* Nothing's loaded yet: the first thread to use FP/SIMD traps. */
+	pantheon::CPU::FPUDisable();
 }
 
-pantheon::Thread *pantheon::CPU::GetCurThread()
+/**
+ * \~english @brief Records which thread some core just switched to.
+ * \~english @details Only ever done by the scheduler of that core, so
+ * that GetCurThread doesn't have to go through it.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::SetCurThread(UINT8 CoreNo, pantheon::Thread *Thread)
 {
-	pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
-	if (Sched == nullptr)
+	if (CoreNo < MAX_NUM_CPUS)
 	{
-		return nullptr;
+		PerCoreInfo[CoreNo].CurThread = Thread;
 	}
-	return Sched->MyThread();
 }
 
 pantheon::Process *pantheon::CPU::GetCurProcess()
 {
-	pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
-	if (Sched == nullptr)
-	{
-		return nullptr;
-	}
-	pantheon::Thread *CurThread = Sched->MyThread();
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
 	if (CurThread)
 	{
 		return CurThread->MyProc();
@@ -62,9 +88,19 @@ pantheon::Process *pantheon::CPU::GetCurProcess()
 	return nullptr;
 }
 
-pantheon::Scheduler *pantheon::CPU::GetCurSched()
+/**
+ * \~english @brief Gets the scheduler belonging to some given core.
+ * \~english @return The scheduler of that core, or nullptr if the core
+ * has not yet been initialized.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Scheduler *pantheon::CPU::GetSched(UINT8 CoreNo)
 {
-	return pantheon::CPU::GetCoreInfo()->CurSched;
+	if (CoreNo >= MAX_NUM_CPUS)
+	{
+		return nullptr;
+	}
+	return PerCoreInfo[CoreNo].CurSched;
 }
 
 pantheon::TrapFrame *pantheon::CPU::GetCurFrame()
@@ -114,4 +150,156 @@ UINT64 pantheon::CPU::ICOUNT()
 {
 	pantheon::CPU::CoreInfo *CoreInfo = pantheon::CPU::GetCoreInfo();
 	return CoreInfo->NOff;
-}
\ No newline at end of file
+}
+
+/**
+ * \~english @brief Charges every tick since the last one was accounted for
+ * as skipped, since no interrupt was taken for any of them.
+ * \~english @author Brian Schnepp
+ */
+static VOID SkipTicks(pantheon::CPU::CoreInfo *Info)
+{
+	UINT64 Now = pantheon::GetSystemTicks();
+	Info->TicksSkipped += Now - Info->TickMark;
+	Info->TickMark = Now;
+}
+
+/**
+ * \~english @brief Programs this core's timer to fire once, after some
+ * number of ticks.
+ * \~english @details There's no periodic tick: a busy core only takes an
+ * interrupt when the running thread's time slice is over. Interrupts
+ * must be disabled.
+ * \~english @param Ticks The number of ticks to wait, at least 1
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::ArmTick(UINT64 Ticks)
+{
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	SkipTicks(Info);
+	Info->TickStopped = FALSE;
+	pantheon::ArmSystemTimer(Ticks ? Ticks : 1);
+}
+
+/**
+ * \~english @brief Stops this core's timer entirely.
+ * \~english @details Used when this core has nothing to do but idle.
+ * The timer stays off until the next call to ArmTick. Interrupts
+ * must be disabled.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::StopTick()
+{
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	if (Info->TickStopped)
+	{
+		return;
+	}
+	SkipTicks(Info);
+	Info->TickStopped = TRUE;
+	pantheon::DisableSystemTimer();
+}
+
+/**
+ * \~english @brief Records that this core took a timer interrupt.
+ * \~english @details The timer must be armed or stopped again before
+ * interrupts are reenabled: it's one-shot, and won't rearm itself.
+ * \~english @return The number of ticks which passed since the timer was
+ * last armed, at least 1.
+ * \~english @author Brian Schnepp
+ */
+UINT64 pantheon::CPU::TimerTick()
+{
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	UINT64 Now = pantheon::GetSystemTicks();
+	UINT64 Elapsed = Now - Info->TickMark;
+	Info->TickMark = Now;
+
+	Info->TicksTaken++;
+	if (Elapsed <= 1)
+	{
+		return 1;
+	}
+
+	/* Only one of these actually turned into an interrupt. */
+	Info->TicksSkipped += Elapsed - 1;
+	return Elapsed;
+}
+
+/**
+ * \~english @brief Gets the number of timer interrupts some core has taken.
+ * \~english @author Brian Schnepp
+ */
+UINT64 pantheon::CPU::TicksTaken(UINT8 CoreNo)
+{
+	if (CoreNo >= MAX_NUM_CPUS)
+	{
+		return 0;
+	}
+	return PerCoreInfo[CoreNo].TicksTaken;
+}
+
+/**
+ * \~english @brief Gets the number of ticks some core would have taken
+ * an interrupt for with a periodic timer, but didn't.
+ * \~english @author Brian Schnepp
+ */
+UINT64 pantheon::CPU::TicksSkipped(UINT8 CoreNo)
+{
+	if (CoreNo >= MAX_NUM_CPUS)
+	{
+		return 0;
+	}
+	return PerCoreInfo[CoreNo].TicksSkipped;
+}
+
+/**
+ * \~english @brief Hands the FP/SIMD registers over from one thread to
+ * another, as this core switches between them.
+ * \~english @details The registers are switched lazily. They're only
+ * saved if the old thread used them since it was switched to, so threads
+ * which never touch them never pay for it. The new thread only gets them
+ * if they still hold its state from the last time it ran here: otherwise,
+ * its first use traps, and they're loaded then. Both threads must be locked.
+ * \~english @param Old The thread being switched away from
+ * \~english @param New The thread being switched to
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::SwitchFPU(pantheon::Thread *Old, pantheon::Thread *New)
+{
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	if (Info->FPUOwner == Old && pantheon::CPU::FPUEnabled())
+	{
+		pantheon::CPU::FPUSave(Old->GetRegisters());
+	}
+
+	/* If the thread loaded its state on some other core since, what's here is stale. */
+	if (Info->FPUOwner == New && New->LastFPUCore() == CoreNo)
+	{
+		pantheon::CPU::FPUEnable();
+	}
+	else
+	{
+		pantheon::CPU::FPUDisable();
+	}
+}
+
+/**
+ * \~english @brief Gives the current thread the FP/SIMD registers, after
+ * it tried to use them.
+ * \~english @details Whoever had them before already saved their state
+ * when they were switched away from. Interrupts must be disabled.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::FPUTrap()
+{
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+
+	pantheon::ScopedLock _T(CurThread);
+	pantheon::CPU::FPUEnable();
+	pantheon::CPU::FPURestore(CurThread->GetRegisters());
+	CurThread->SetFPUCore(pantheon::CPU::GetProcessorNumber());
+	Info->FPUOwner = CurThread;
+}
@@ -1,11 +1,13 @@
 #include <arch.hpp>
 #include <kern_datatypes.hpp>
+#include <kern_runtime.hpp>
 
 #ifndef _KERN_CPU_HPP_
 #define _KERN_CPU_HPP_
 
 #define MAX_NUM_CPUS (8)
 #define DEFAULT_STACK_SIZE (128ULL * 1024ULL)
+#define CACHE_LINE_SIZE (64)
 
 namespace pantheon
 {
@@ -30,25 +32,72 @@ namespace CPU
  * 
  * Naturally, the contents of this struct may change over time, but those
  * items will always be present.
+ *
+ * Every core can always reach its own through a system register, without
+ * having to know which core it is first. Each is on cache lines of its
+ * own, so cores never contend over them.
  * 
  * \~english @author Brian Schnepp
  */
-typedef struct CoreInfo
+typedef struct alignas(CACHE_LINE_SIZE) CoreInfo
 {
+	/* Read on nearly every lock and syscall: keep these together. */
+	pantheon::Thread *CurThread;
 	pantheon::Scheduler *CurSched;
-	pantheon::TrapFrame *CurFrame;
 	UINT64 NOff;
 	BOOL IntStatus;
+	UINT8 CoreNo;
+
+	pantheon::TrapFrame *CurFrame;
+
+	UINT64 TicksTaken;
+	UINT64 TicksSkipped;
+	UINT64 TickMark;
+	BOOL TickStopped;
+
+	/* The thread whose FP/SIMD state was last loaded on this core. */
+	pantheon::Thread *FPUOwner;
+
+	/* The user address space loaded on this core, tagged with its ASID. */
+	UINT64 UserTTBR0;
 }CoreInfo;
 
+void InitCoreArea(UINT8 CoreNo);
 void InitCoreInfo(UINT8 CoreNo);
-CoreInfo *GetCoreInfo();
+CoreInfo *GetCoreArea(UINT8 CoreNo);
+
+/**
+ * \~english @brief Gets the per-core data of the current core.
+ * \~english @details This is a single system register read.
+ * \~english @author Brian Schnepp
+ */
+FORCE_INLINE CoreInfo *GetCoreInfo()
+{
+	return reinterpret_cast<CoreInfo*>(pantheon::CPU::GetPerCoreArea());
+}
 
 UINT8 GetProcessorNumber();
 
-pantheon::Thread *GetCurThread();
+/**
+ * \~english @brief Gets the thread running on the current core.
+ * \~english @return The thread, or nullptr if this core has no
+ * scheduler yet.
+ * \~english @author Brian Schnepp
+ */
+FORCE_INLINE pantheon::Thread *GetCurThread()
+{
+	return pantheon::CPU::GetCoreInfo()->CurThread;
+}
+
+FORCE_INLINE pantheon::Scheduler *GetCurSched()
+{
+	return pantheon::CPU::GetCoreInfo()->CurSched;
+}
+
+VOID SetCurThread(UINT8 CoreNo, pantheon::Thread *Thread);
+
 pantheon::Process *GetCurProcess();
-pantheon::Scheduler *GetCurSched();
+pantheon::Scheduler *GetSched(UINT8 CoreNo);
 pantheon::TrapFrame *GetCurFrame();
 
 VOID PUSHI();
@@ -57,6 +106,55 @@ UINT64 ICOUNT();
 
 void *GetStackArea(UINT64 Core);
 
+VOID ArmTick(UINT64 Ticks);
+VOID StopTick();
+UINT64 TimerTick();
+
+UINT64 TicksTaken(UINT8 CoreNo);
+UINT64 TicksSkipped(UINT8 CoreNo);
+
+VOID SwitchFPU(pantheon::Thread *Old, pantheon::Thread *New);
+VOID FPUTrap();
+
+/**
+ * \~english @brief A variable with a separate copy for every core.
+ * \~english @details Every copy is on cache lines of its own, so cores
+ * which only ever touch their own copy never slow each other down.
+ * \~english @author Brian Schnepp
+ */
+template<typename T>
+class PerCore
+{
+public:
+	/**
+	 * \~english @brief Gets the copy belonging to the current core.
+	 */
+	FORCE_INLINE T &Local()
+	{
+		return this->Slots[pantheon::CPU::GetCoreInfo()->CoreNo].Item;
+	}
+
+	/**
+	 * \~english @brief Gets the copy belonging to some given core.
+	 */
+	FORCE_INLINE T &On(UINT8 CoreNo)
+	{
+		return this->Slots[CoreNo].Item;
+	}
+
+	FORCE_INLINE const T &On(UINT8 CoreNo) const
+	{
+		return this->Slots[CoreNo].Item;
+	}
+
+private:
+	struct alignas(CACHE_LINE_SIZE) Slot
+	{
+		T Item;
+	};
+	Slot Slots[MAX_NUM_CPUS];
+};
+
 }
 
 }
@@ -0,0 +1,209 @@
+#include <kern_datatypes.hpp>
+
+#include <Sync/kern_spinlock.hpp>
+
+#include "kern_cpu.hpp"
+#include "kern_sched.hpp"
+#include "kern_futex.hpp"
+#include "kern_thread.hpp"
+#include "kern_waitqueue.hpp"
+
+/**
+ * @file System/Proc/kern_futex.cpp
+ * @brief Sleeping on, and waking up, a word of userspace memory
+ * @details The kernel doesn't know anything about the locks userspace
+ * builds out of these: all it does is put a thread to sleep if some word
+ * still has the value it expects, and wake up threads sleeping on some
+ * word. A futex is named by the physical address of its word, so that
+ * processes sharing memory can share one too.
+ */
+
+typedef struct FutexBucket
+{
+	FutexBucket() : Lock("futex")
+	{
+		this->Head = nullptr;
+		this->Tail = nullptr;
+	}
+
+	pantheon::Spinlock Lock;
+	pantheon::FutexWaiter *Head;
+	pantheon::FutexWaiter *Tail;
+}FutexBucket;
+
+static FutexBucket Buckets[pantheon::FutexBuckets];
+
+static FutexBucket *BucketOf(UINT64 Key)
+{
+	/* Words are 4-byte aligned, so the low bits say nothing. */
+	UINT64 Hash = (Key >> 2) * 0x9E3779B97F4A7C15ULL;
+	return &Buckets[Hash >> 58];
+}
+
+static_assert(pantheon::FutexBuckets == (1ULL << (64 - 58)));
+
+/* The bucket must be locked for these. */
+static VOID InsertWaiter(FutexBucket *Bucket, pantheon::FutexWaiter *Waiter)
+{
+	Waiter->Next = nullptr;
+	Waiter->Prev = Bucket->Tail;
+	if (Bucket->Tail)
+	{
+		Bucket->Tail->Next = Waiter;
+	}
+	else
+	{
+		Bucket->Head = Waiter;
+	}
+	Bucket->Tail = Waiter;
+	Waiter->Node.Queued = TRUE;
+}
+
+static VOID RemoveWaiter(FutexBucket *Bucket, pantheon::FutexWaiter *Waiter)
+{
+	if (Waiter->Node.Queued == FALSE)
+	{
+		return;
+	}
+
+	if (Waiter->Prev)
+	{
+		Waiter->Prev->Next = Waiter->Next;
+	}
+	else
+	{
+		Bucket->Head = Waiter->Next;
+	}
+
+	if (Waiter->Next)
+	{
+		Waiter->Next->Prev = Waiter->Prev;
+	}
+	else
+	{
+		Bucket->Tail = Waiter->Prev;
+	}
+	Waiter->Next = nullptr;
+	Waiter->Prev = nullptr;
+	Waiter->Node.Queued = FALSE;
+}
+
+/**
+ * @brief Sleeps until woken up on some futex, if it still has the value
+ * the caller expects.
+ * @details The value is checked with the futex's queue locked, so a
+ * waker which changes it first and then wakes the futex can't be missed.
+ * Like any wait, this can return without the futex being woken, so the
+ * caller should check its word again either way.
+ * @param Word Where the value of the futex can be read by the kernel
+ * @param Key The physical address of the futex
+ * @param Expected The value the futex has to have to sleep on it
+ * @param Timeout The most ticks to wait for, 0 to only check the value,
+ * or a negative number to wait forever
+ * @return SYS_OK once woken up, KERN_TRY_AGAIN if the value wasn't the
+ * expected one, or KERN_TIMED_OUT if the timeout ran out first.
+ */
+pantheon::Result pantheon::FutexWait(const UINT32 *Word, UINT64 Key, UINT32 Expected, INT64 Timeout)
+{
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	FutexBucket *Bucket = BucketOf(Key);
+
+	UINT64 Token = 0;
+	{
+		pantheon::ScopedLock _T(CurThread);
+		Token = CurThread->BeginWait();
+	}
+
+	FutexWaiter Waiter;
+	pantheon::InitWaitNode(&Waiter.Node, CurThread, Token, 0);
+	Waiter.Key = Key;
+
+	Bucket->Lock.Acquire();
+	if (__atomic_load_n(Word, __ATOMIC_SEQ_CST) != Expected)
+	{
+		Bucket->Lock.Release();
+		return pantheon::Result::KERN_TRY_AGAIN;
+	}
+
+	if (Timeout == 0)
+	{
+		Bucket->Lock.Release();
+		return pantheon::Result::KERN_TIMED_OUT;
+	}
+	InsertWaiter(Bucket, &Waiter);
+	Bucket->Lock.Release();
+
+	pantheon::WaitNode Timer;
+	pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
+	if (Timeout > 0)
+	{
+		pantheon::InitWaitNode(&Timer, CurThread, Token, pantheon::Thread::WakeTimeout);
+		Timer.WakeAt = pantheon::GetSystemTicks() + static_cast<UINT64>(Timeout);
+		Sched->AddSleeper(&Timer);
+	}
+
+	INT64 Reason = pantheon::Thread::WakeNone;
+	while (Reason == pantheon::Thread::WakeNone)
+	{
+		BOOL Blocked = FALSE;
+		{
+			pantheon::ScopedLock _T(CurThread);
+			Blocked = CurThread->Block();
+		}
+
+		if (Blocked)
+		{
+			pantheon::CPU::GetCurSched()->Reschedule();
+		}
+
+		pantheon::ScopedLock _T(CurThread);
+		Reason = CurThread->WakeReason();
+	}
+
+	if (Timeout > 0)
+	{
+		Sched->RemoveSleeper(&Timer);
+	}
+
+	/* A waker takes the node out first, but a timeout doesn't. */
+	Bucket->Lock.Acquire();
+	RemoveWaiter(Bucket, &Waiter);
+	Bucket->Lock.Release();
+
+	if (Reason == pantheon::Thread::WakeTimeout)
+	{
+		return pantheon::Result::KERN_TIMED_OUT;
+	}
+	return pantheon::Result::SYS_OK;
+}
+
+/**
+ * @brief Wakes up threads sleeping on some futex, oldest first
+ * @param Key The physical address of the futex
+ * @param Count The most threads to wake up
+ * @return How many threads were woken up
+ */
+UINT64 pantheon::FutexWake(UINT64 Key, UINT64 Count)
+{
+	FutexBucket *Bucket = BucketOf(Key);
+	UINT64 Woken = 0;
+
+	Bucket->Lock.Acquire();
+	FutexWaiter *Cur = Bucket->Head;
+	while (Cur != nullptr && Woken < Count)
+	{
+		FutexWaiter *Next = Cur->Next;
+		if (Cur->Key == Key)
+		{
+			/* The waiter can't go away until the bucket is unlocked. */
+			RemoveWaiter(Bucket, Cur);
+			if (pantheon::WakeThread(Cur->Node.Waiter, Cur->Node.Token, Cur->Node.Index))
+			{
+				Woken++;
+			}
+		}
+		Cur = Next;
+	}
+	Bucket->Lock.Release();
+	return Woken;
+}
@@ -0,0 +1,37 @@
+#include <kern_result.hpp>
+#include <kern_datatypes.hpp>
+
+#include <Proc/kern_waitqueue.hpp>
+
+/**
+ * @file System/Proc/kern_futex.hpp
+ * @brief Definitions for letting userspace sleep on a word of its own memory
+ */
+
+#ifndef _KERN_FUTEX_HPP_
+#define _KERN_FUTEX_HPP_
+
+namespace pantheon
+{
+
+/**
+ * @brief One thread sleeping on some futex.
+ * @details These live on the stack of the waiting thread.
+ */
+typedef struct FutexWaiter
+{
+	pantheon::WaitNode Node;
+	UINT64 Key;
+	struct FutexWaiter *Next;
+	struct FutexWaiter *Prev;
+}FutexWaiter;
+
+/* How many queues waiters are spread across. */
+static constexpr UINT64 FutexBuckets = 64;
+
+pantheon::Result FutexWait(const UINT32 *Word, UINT64 Key, UINT32 Expected, INT64 Timeout);
+UINT64 FutexWake(UINT64 Key, UINT64 Count);
+
+}
+
+#endif
@@ -3,9 +3,12 @@
 #include <kern_datatypes.hpp>
 #include <Sync/kern_spinlock.hpp>
 
+#include <System/Proc/kern_asid.hpp>
+#include <System/Proc/kern_cpu.hpp>
 #include <System/Proc/kern_proc.hpp>
 #include <System/Proc/kern_sched.hpp>
 #include <System/Proc/kern_thread.hpp>
+#include <System/Proc/kern_waitqueue.hpp>
 #include <System/Memory/kern_alloc.hpp>
 
 #include <Common/Sync/kern_lockable.hpp>
@@ -16,6 +19,7 @@ static constexpr UINT64 InitNumPageTables = 1024;
 alignas(4096) static pantheon::vmm::PageTable Tables[InitNumPageTables];
 static pantheon::vmm::PageAllocator PageTableAllocator;
 static pantheon::Spinlock PageTableLock;
+static pantheon::ASIDAllocator ASIDs;
 
 /**
  * @file System/Proc/kern_proc.cpp
@@ -31,18 +35,34 @@ void pantheon::InitProcessTables()
 	Process::Init();
 	PageTableAllocator = pantheon::vmm::PageAllocator(Tables, InitNumPageTables);
 	PageTableLock = pantheon::Spinlock("Map Pages Lock");
+	ASIDs = pantheon::ASIDAllocator();
 }
 
 /**
  * @brief Creates a minimal, empty process, which by default is equivalent to the idle process
  * @author Brian Schnepp
  */
-pantheon::Process::Process() : pantheon::Lockable("Process")
+pantheon::Process::Process() : pantheon::Lockable("Process"), MemoryLock("Address Space")
 {
 	this->CurState = pantheon::Process::STATE_INIT;
 	this->CurPriority = pantheon::Process::PRIORITY_VERYLOW;
 	this->ProcessString = "idle";
 	this->PID = 0;
+	this->TTBR0 = 0;
+	this->MemoryMap = nullptr;
+	this->ASIDContext.Store(0);
+	this->Threads = nullptr;
+	this->NumThreads.Store(0);
+	this->NumLiveThreads.Store(0);
+	this->NumLocalRegions = 0;
+	this->LocalPageList = 0;
+	for (pantheon::vmm::PhysicalAddress &Page : this->UserStack)
+	{
+		Page = 0;
+	}
+	this->ImagePageList = 0;
+	this->ImageListCount = 0;
+	this->ZombieNext = nullptr;
 }
 
 pantheon::Process::~Process() = default;
@@ -65,8 +85,17 @@ void pantheon::Process::Initialize(const pantheon::ProcessCreateInfo &CreateInfo
 	this->ProcessString = CreateInfo.Name;
 	this->PID = pantheon::AcquireProcessID();
 	this->TTBR0 = pantheon::PageAllocator::Alloc();
+	this->ASIDContext.Store(0);
 	this->EntryPoint = CreateInfo.EntryPoint;
 	this->HandTable.Clear();
+	this->Threads = nullptr;
+	this->NumThreads.Store(0);
+	this->NumLiveThreads.Store(0);
+	this->NumLocalRegions = 0;
+	this->LocalPageList = 0;
+	this->ImagePageList = 0;
+	this->ImageListCount = 0;
+	this->ZombieNext = nullptr;
 
 	pantheon::vmm::VirtualAddress NewTableVAddr = pantheon::vmm::PhysicalToVirtualAddress(this->TTBR0);
 	pantheon::vmm::PageTable *PgTable = reinterpret_cast<pantheon::vmm::PageTable*>(NewTableVAddr);
@@ -97,11 +126,11 @@ void pantheon::Process::Initialize(const pantheon::ProcessCreateInfo &CreateInfo
 	Entry.SetMAIREntry(pantheon::vmm::MAIREntry_1);
 
 	pantheon::vmm::VirtualAddress VAddrs[Process::StackPages];
-	pantheon::vmm::PhysicalAddress PAddrs[Process::StackPages];
 
+	/* The stack pages are kept track of, so they can be freed with the process. */
 	for (UINT8 Index = 0; Index < Process::StackPages; Index++)
 	{
-		PAddrs[Index] = pantheon::PageAllocator::Alloc();
+		this->UserStack[Index] = pantheon::PageAllocator::Alloc();
 		VAddrs[Index] = StackAddr - pantheon::vmm::SmallestPageSize * Index;
 	}
 
@@ -110,7 +139,7 @@ void pantheon::Process::Initialize(const pantheon::ProcessCreateInfo &CreateInfo
 	/* Create the stack */
 	for (UINT64 Index = 0; Index < Process::StackPages; ++Index)
 	{
-		this->MapAddress(VAddrs[Index], PAddrs[Index], UStackEntry);
+		this->MapAddress(VAddrs[Index], this->UserStack[Index], UStackEntry);
 	}
 
 	/* Map in initial objects */
@@ -139,6 +168,20 @@ pantheon::Process &pantheon::Process::operator=(const pantheon::Process &Other)
 	this->ProcessString = Other.ProcessString;
 	this->MemoryMap = Other.MemoryMap;
 	this->TTBR0 = Other.TTBR0;
+	this->MemoryLock = pantheon::Mutex("Address Space");
+	this->ASIDContext.Store(Other.ASIDContext.Load());
+	this->Threads = Other.Threads;
+	this->NumThreads.Store(Other.NumThreads.Load());
+	this->NumLiveThreads.Store(Other.NumLiveThreads.Load());
+	this->NumLocalRegions = Other.NumLocalRegions;
+	this->LocalPageList = Other.LocalPageList;
+	for (UINT64 Index = 0; Index < Process::StackPages; ++Index)
+	{
+		this->UserStack[Index] = Other.UserStack[Index];
+	}
+	this->ImagePageList = Other.ImagePageList;
+	this->ImageListCount = Other.ImageListCount;
+	this->ZombieNext = Other.ZombieNext;
 	return *this;
 }
 
@@ -156,6 +199,20 @@ pantheon::Process &pantheon::Process::operator=(pantheon::Process &&Other) noexc
 	this->ProcessString = Other.ProcessString;
 	this->MemoryMap = Other.MemoryMap;
 	this->TTBR0 = Other.TTBR0;	
+	this->MemoryLock = pantheon::Mutex("Address Space");
+	this->ASIDContext.Store(Other.ASIDContext.Load());
+	this->Threads = Other.Threads;
+	this->NumThreads.Store(Other.NumThreads.Load());
+	this->NumLiveThreads.Store(Other.NumLiveThreads.Load());
+	this->NumLocalRegions = Other.NumLocalRegions;
+	this->LocalPageList = Other.LocalPageList;
+	for (UINT64 Index = 0; Index < Process::StackPages; ++Index)
+	{
+		this->UserStack[Index] = Other.UserStack[Index];
+	}
+	this->ImagePageList = Other.ImagePageList;
+	this->ImageListCount = Other.ImageListCount;
+	this->ZombieNext = Other.ZombieNext;
 	ClearBuffer((CHAR*)&Other, sizeof(Process));
 	return *this;
 }
@@ -174,11 +231,105 @@ void pantheon::Process::MapAddress(const pantheon::vmm::VirtualAddress &VAddress
 		StopError("Process not locked when mapping addresses\n");
 	}
 
+	/* Nothing in the lower half is shared: tag it with this process' ASID. */
+	pantheon::vmm::PageTableEntry Attributes(PageAttributes);
+	Attributes.SetNonGlobal(TRUE);
+
 	PageTableLock.Acquire();
-	PageTableAllocator.Map(this->MemoryMap, VAddress, PAddress, pantheon::vmm::SmallestPageSize, PageAttributes);
+	PageTableAllocator.Map(this->MemoryMap, VAddress, PAddress, pantheon::vmm::SmallestPageSize, Attributes);
 	PageTableLock.Release();
 }
 
+/**
+ * @brief Gives a new thread a thread local region. Process must be locked before use.
+ * @details Each thread gets its own slot, just below the user stack. Slots
+ * left behind by threads which were destroyed are handed out again, with the
+ * same page still mapped in, so a process which keeps making threads doesn't
+ * keep taking more memory. The page is cleared either way.
+ * @param PAddress Set to the physical address of the page of the region
+ * @return Where the region is in this process, or 0 if there's no room left
+ */
+pantheon::vmm::VirtualAddress pantheon::Process::AcquireThreadLocalRegion(pantheon::vmm::PhysicalAddress &PAddress)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked when mapping thread local region\n");
+	}
+
+	if (this->LocalPageList == 0)
+	{
+		this->LocalPageList = pantheon::PageAllocator::Alloc();
+		if (this->LocalPageList == 0)
+		{
+			return 0;
+		}
+		ClearBuffer((CHAR*)pantheon::vmm::PhysicalToVirtualAddress(this->LocalPageList), pantheon::vmm::SmallestPageSize);
+	}
+
+	pantheon::vmm::PhysicalAddress *LocalPages = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(this->LocalPageList));
+	UINT64 Slot = 0;
+	for (Slot = 0; Slot < this->NumLocalRegions; ++Slot)
+	{
+		if ((LocalPages[Slot] & Process::LocalRegionInUse) == 0)
+		{
+			break;
+		}
+	}
+
+	if (Slot == this->NumLocalRegions)
+	{
+		if (this->NumLocalRegions >= pantheon::Process::MaxThreadLocalRegions)
+		{
+			return 0;
+		}
+
+		pantheon::vmm::PhysicalAddress NewPage = pantheon::PageAllocator::Alloc();
+		if (NewPage == 0)
+		{
+			return 0;
+		}
+
+		pantheon::vmm::VirtualAddress VAddr = pantheon::Process::ThreadLocalAddr + pantheon::vmm::SmallestPageSize * Slot;
+		this->MapAddress(VAddr, NewPage, pantheon::vmm::StackPermissions());
+		LocalPages[Slot] = NewPage;
+		this->NumLocalRegions++;
+	}
+
+	LocalPages[Slot] |= Process::LocalRegionInUse;
+	PAddress = LocalPages[Slot] & ~Process::LocalRegionInUse;
+	ClearBuffer((CHAR*)pantheon::vmm::PhysicalToVirtualAddress(PAddress), pantheon::vmm::SmallestPageSize);
+	return pantheon::Process::ThreadLocalAddr + pantheon::vmm::SmallestPageSize * Slot;
+}
+
+/**
+ * @brief Lets some later thread have the thread local region of a destroyed thread. Process must be locked before use.
+ * @details The page stays mapped in until the whole process is freed.
+ * @param VAddress Where the region is in this process. Anything outside of the thread local regions is ignored.
+ */
+void pantheon::Process::ReleaseThreadLocalRegion(pantheon::vmm::VirtualAddress VAddress)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked when releasing thread local region\n");
+	}
+
+	if (VAddress < pantheon::Process::ThreadLocalAddr || this->LocalPageList == 0)
+	{
+		return;
+	}
+
+	UINT64 Slot = (VAddress - pantheon::Process::ThreadLocalAddr) / pantheon::vmm::SmallestPageSize;
+	if (Slot >= this->NumLocalRegions)
+	{
+		return;
+	}
+
+	pantheon::vmm::PhysicalAddress *LocalPages = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(this->LocalPageList));
+	LocalPages[Slot] &= ~Process::LocalRegionInUse;
+}
+
 /**
  * @brief Obtains the process state for this process
  * @return The state of this process
@@ -238,6 +389,180 @@ pantheon::Handle *pantheon::Process::GetHandle(INT32 HandleID)
 	return this->HandTable.Get(HandleID);
 }
 
+/**
+ * @brief Adds a newly created thread to this process. Process must be locked before use.
+ * @param Thr The thread to attach, which must not already belong to any process's list
+ */
+void pantheon::Process::AttachThread(pantheon::Thread *Thr)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with AttachThread");
+	}
+
+	Thr->SetPrevInProcess(nullptr);
+	Thr->SetNextInProcess(this->Threads);
+	if (this->Threads)
+	{
+		this->Threads->SetPrevInProcess(Thr);
+	}
+	this->Threads = Thr;
+
+	this->NumThreads.FetchAdd(1);
+	this->NumLiveThreads.FetchAdd(1);
+
+	/* Too late to be told by KillThreads. */
+	if (this->CurState == pantheon::Process::STATE_ZOMBIE)
+	{
+		pantheon::ScopedLock _T(Thr);
+		Thr->RequestExit();
+	}
+}
+
+/**
+ * @brief Removes a thread from this process, once it is to be destroyed. Process must be locked before use.
+ * @param Thr The thread to detach, which must belong to this process
+ */
+void pantheon::Process::DetachThread(pantheon::Thread *Thr)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with DetachThread");
+	}
+
+	pantheon::Thread *Prev = Thr->PrevInProcess();
+	pantheon::Thread *Next = Thr->NextInProcess();
+	if (Prev)
+	{
+		Prev->SetNextInProcess(Next);
+	}
+	else
+	{
+		this->Threads = Next;
+	}
+
+	if (Next)
+	{
+		Next->SetPrevInProcess(Prev);
+	}
+	Thr->SetPrevInProcess(nullptr);
+	Thr->SetNextInProcess(nullptr);
+
+	/* A thread which never exited is still counted as live. */
+	pantheon::Thread::State ThrState = Thr->MyState();
+	if (ThrState != pantheon::Thread::STATE_TERMINATED && ThrState != pantheon::Thread::STATE_DEAD)
+	{
+		this->NumLiveThreads.FetchSub(1);
+	}
+	this->NumThreads.FetchSub(1);
+}
+
+/**
+ * @brief Records that one of this process's threads has exited. Process must be locked before use.
+ * @return The number of threads in this process which are still live
+ */
+UINT64 pantheon::Process::ThreadExited()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with ThreadExited");
+	}
+
+	UINT64 Live = this->NumLiveThreads.FetchSub(1, pantheon::MemoryOrder::AcqRel);
+	if (Live == 0)
+	{
+		StopError("Process had more threads exit than were created");
+	}
+	return Live - 1;
+}
+
+/**
+ * @brief Tells every other thread of this process to exit. Process must be locked before use.
+ * @details A thread which is waiting stops waiting, and one running on some
+ * other core is interrupted, so each of them ends itself soon after. They're
+ * freed as usual once they have, along with the process after the last one.
+ * @param Caller The thread exiting the process, which ends itself
+ */
+void pantheon::Process::KillThreads(pantheon::Thread *Caller)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with KillThreads");
+	}
+
+	UINT8 CoreNo = pantheon::CPU::GetProcessorNumber();
+	for (pantheon::Thread *Thr = this->Threads; Thr != nullptr; Thr = Thr->NextInProcess())
+	{
+		if (Thr == Caller)
+		{
+			continue;
+		}
+
+		pantheon::ScopedLock _T(Thr);
+		if (Thr->RequestExit())
+		{
+			pantheon::ResumeThread(Thr);
+		}
+
+		/* Otherwise it only notices at its next tick. */
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Thr->LastCore());
+		if (Thr->LastCore() != CoreNo && Sched != nullptr && Sched->MyThread() == Thr)
+		{
+			pantheon::CPU::IPI(Thr->LastCore());
+		}
+	}
+}
+
+/**
+ * @brief Obtains the number of threads in this process which have not exited
+ */
+[[nodiscard]]
+UINT64 pantheon::Process::CountThreads() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->NumLiveThreads.Load();
+}
+
+/**
+ * @brief Obtains the number of threads in this process, including those which exited but were not yet destroyed
+ */
+[[nodiscard]]
+UINT64 pantheon::Process::CountAttachedThreads() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->NumThreads.Load();
+}
+
+/**
+ * @brief Checks if this process can still run anything
+ * @return TRUE if the process was not yet started, or is running with at least one live thread
+ */
+[[nodiscard]]
+BOOL pantheon::Process::IsAlive() const
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Process::State St = this->MyState();
+	if (St == pantheon::Process::STATE_INIT)
+	{
+		return TRUE;
+	}
+	return St == pantheon::Process::STATE_RUNNING && this->NumLiveThreads.Load() != 0;
+}
+
+/**
+ * @brief Obtains the most recently created thread of this process. Process must be locked while walking the list.
+ */
+[[nodiscard]]
+pantheon::Thread *pantheon::Process::FirstThread() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Threads;
+}
+
 /**
  * @brief Obtains the physical address of the page table for this process.
  * @return The physical address of the page table for this process.
@@ -260,7 +585,190 @@ pantheon::vmm::PageTable *pantheon::Process::GetPageTable() const
 	return this->MemoryMap;
 }
 
+/**
+ * @brief Checks if some core could still be using the page tables of this process
+ */
+[[nodiscard]]
+BOOL pantheon::Process::AddressSpaceLoaded() const
+{
+	OBJECT_SELF_ASSERT();
+	return ASIDs.Loaded(this->ASIDContext.Load());
+}
+
+/**
+ * @brief Gets the lock for long changes to the address space of this process
+ * @details This is acquired before the process lock, never while it's held.
+ */
+pantheon::Mutex *pantheon::Process::AddressSpaceLock()
+{
+	OBJECT_SELF_ASSERT();
+	return &this->MemoryLock;
+}
+
+/**
+ * @brief Hands some page mapped into this process over to it, to be freed along with it. Process must be locked before use.
+ * @details This is meant for the pages a program is loaded into, which
+ * nothing else keeps track of.
+ * @param Page The physical address of the page
+ * @return FALSE if there was no memory left to keep track of the page
+ */
+BOOL pantheon::Process::KeepImagePage(pantheon::vmm::PhysicalAddress Page)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with KeepImagePage");
+	}
+
+	if (this->ImagePageList == 0 || this->ImageListCount == Process::ImagePagesPerList)
+	{
+		pantheon::vmm::PhysicalAddress NewList = pantheon::PageAllocator::Alloc();
+		if (NewList == 0)
+		{
+			return FALSE;
+		}
+
+		pantheon::vmm::PhysicalAddress *Entries = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(NewList));
+		Entries[0] = this->ImagePageList;
+		this->ImagePageList = NewList;
+		this->ImageListCount = 1;
+	}
+
+	pantheon::vmm::PhysicalAddress *Entries = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(this->ImagePageList));
+	Entries[this->ImageListCount++] = Page;
+	return TRUE;
+}
+
+/**
+ * @brief Frees everything this process owns, once it has no threads left. Process must be locked before use.
+ * @details Every handle is closed, and the page tables, the user stack, the
+ * thread local regions, and the program image are given back. The process object itself isn't
+ * freed. No core may still have the address space loaded.
+ */
+void pantheon::Process::Teardown()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Process not locked with Teardown");
+	}
+
+	this->HandTable.CloseAll();
+	this->CurState = pantheon::Process::STATE_TERMINATED;
+	if (this->MemoryMap == nullptr)
+	{
+		return;
+	}
+
+	/* Nothing runs with this ASID anymore, but the TLB could still have entries from it. */
+	UINT64 ASID = this->ASIDContext.Load() & pantheon::ASIDAllocator::Mask;
+	if (ASID != 0)
+	{
+		pantheon::vmm::InvalidateASID(ASID);
+	}
+
+	PageTableLock.Acquire();
+	PageTableAllocator.Release(this->MemoryMap);
+	PageTableLock.Release();
+
+	/* Every slot has a page, whether a thread has it or not. */
+	if (this->LocalPageList != 0)
+	{
+		pantheon::vmm::PhysicalAddress *LocalPages = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(this->LocalPageList));
+		for (UINT64 Slot = 0; Slot < this->NumLocalRegions; ++Slot)
+		{
+			LocalPages[Slot] &= ~Process::LocalRegionInUse;
+		}
+		pantheon::PageAllocator::FreeMany(LocalPages, this->NumLocalRegions);
+	}
+
+	/* Only the newest page of the list can be partly full. */
+	UINT64 Count = this->ImageListCount;
+	for (pantheon::vmm::PhysicalAddress List = this->ImagePageList; List != 0; Count = Process::ImagePagesPerList)
+	{
+		pantheon::vmm::PhysicalAddress *Entries = reinterpret_cast<pantheon::vmm::PhysicalAddress*>(pantheon::vmm::PhysicalToVirtualAddress(List));
+		pantheon::vmm::PhysicalAddress Prev = Entries[0];
+		pantheon::PageAllocator::FreeMany(Entries + 1, Count - 1);
+		pantheon::PageAllocator::Free(List);
+		List = Prev;
+	}
+
+	pantheon::vmm::PhysicalAddress Pages[Process::StackPages + 2];
+	UINT64 NumPages = 0;
+	for (pantheon::vmm::PhysicalAddress &Page : this->UserStack)
+	{
+		Pages[NumPages++] = Page;
+		Page = 0;
+	}
+	Pages[NumPages++] = this->TTBR0;
+	if (this->LocalPageList != 0)
+	{
+		Pages[NumPages++] = this->LocalPageList;
+	}
+	pantheon::PageAllocator::FreeMany(Pages, NumPages);
+
+	this->MemoryMap = nullptr;
+	this->TTBR0 = 0;
+	this->ASIDContext.Store(0);
+	this->LocalPageList = 0;
+	this->NumLocalRegions = 0;
+	this->ImagePageList = 0;
+	this->ImageListCount = 0;
+}
+
+[[nodiscard]]
+pantheon::Process *pantheon::Process::NextZombie() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->ZombieNext;
+}
+
+void pantheon::Process::SetNextZombie(pantheon::Process *Proc)
+{
+	OBJECT_SELF_ASSERT();
+	this->ZombieNext = Proc;
+}
+
+/**
+ * @brief Switches page tables from the current process to a new process
+ * @details Every process has its own ASID, so the TLB doesn't need to be
+ * flushed. Processes without page tables of their own, like the one the
+ * idle threads belong to, keep running on whatever was loaded last. If the
+ * same process is switched back to afterwards, nothing has to be reloaded.
+ * @param Next The process about to run on this core
+ */
+void pantheon::Process::Switch(pantheon::Process *Next)
+{
+	if (Next == nullptr || Next->MemoryMap == nullptr)
+	{
+		return;
+	}
+
+	BOOL Flush = FALSE;
+	UINT64 ASID = ASIDs.Activate(Next->ASIDContext, pantheon::CPU::GetProcessorNumber(), Flush);
+	UINT64 NewTTBR0 = pantheon::vmm::MakeTTBR(Next->TTBR0, ASID);
+
+	pantheon::CPU::CoreInfo *Info = pantheon::CPU::GetCoreInfo();
+	if (Info->UserTTBR0 != NewTTBR0)
+	{
+		Info->UserTTBR0 = NewTTBR0;
+		pantheon::CPUReg::W_TTBR0_EL1_NOFLUSH(NewTTBR0);
+	}
+
+	/* Some other process had this ASID before the last rollover. */
+	if (Flush)
+	{
+		pantheon::vmm::InvalidateLocalTLB();
+	}
+}
+
+/**
+ * @brief Frees this process, once no core can have it from a lookup anymore
+ * @details This must already be out of the process table. Its PID can be
+ * given out again right away: that one can't match a stale PID.
+ */
 void pantheon::Process::DestroyObject()
 {
-	pantheon::Process::Destroy(this);
+	pantheon::ReleaseProcessID(this->PID);
+	this->DeferDestroy();
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <kern_datatypes.hpp>
 #include <kern_container.hpp>
 
+#include <Sync/kern_mutex.hpp>
 #include <Sync/kern_atomic.hpp>
 #include <Sync/kern_spinlock.hpp>
 
@@ -86,16 +87,42 @@ public:
 	void DestroyObject();
 	void SetState(ProcessState State);
 	void MapAddress(const pantheon::vmm::VirtualAddress &VAddresses, const pantheon::vmm::PhysicalAddress &PAddresses, const pantheon::vmm::PageTableEntry &PageAttributes);
+	pantheon::vmm::VirtualAddress AcquireThreadLocalRegion(pantheon::vmm::PhysicalAddress &PAddress);
+	void ReleaseThreadLocalRegion(pantheon::vmm::VirtualAddress VAddress);
+	BOOL KeepImagePage(pantheon::vmm::PhysicalAddress Page);
 
 	INT32 EncodeHandle(const pantheon::Handle &NewHand);
 	pantheon::Handle *GetHandle(INT32 HandleID);
 
+	void AttachThread(pantheon::Thread *Thr);
+	void DetachThread(pantheon::Thread *Thr);
+	UINT64 ThreadExited();
+	void KillThreads(pantheon::Thread *Caller);
+
+	[[nodiscard]] UINT64 CountThreads() const;
+	[[nodiscard]] UINT64 CountAttachedThreads() const;
+	[[nodiscard]] BOOL IsAlive() const;
+	[[nodiscard]] pantheon::Thread *FirstThread() const;
+
 	[[nodiscard]] pantheon::vmm::PhysicalAddress GetTTBR0() const;
 	[[nodiscard]] pantheon::vmm::PageTable *GetPageTable() const;
+	[[nodiscard]] BOOL AddressSpaceLoaded() const;
+	[[nodiscard]] pantheon::Mutex *AddressSpaceLock();
+
+	void Teardown();
+
+	[[nodiscard]] Process *NextZombie() const;
+	void SetNextZombie(Process *Proc);
+
+	static void Switch(Process *Next);
 
 	static const constexpr UINT64 StackPages = 16;
 	static const constexpr pantheon::vmm::VirtualAddress StackAddr = 0xFFFFFFFFF000;
 
+	/* Every region's page is kept track of in a single page. */
+	static const constexpr UINT64 MaxThreadLocalRegions = pantheon::vmm::SmallestPageSize / sizeof(pantheon::vmm::PhysicalAddress);
+	static const constexpr pantheon::vmm::VirtualAddress ThreadLocalAddr = 0xFFFFFF000000;
+
 	/**
 	 * @brief Obtains the process ID for this process
 	 * @return The process ID belonging to this process
@@ -124,23 +151,6 @@ public:
 		return this->EntryPoint; 
 	}
 
-	/**
-	 * @brief Switches page tables from the current process to a new process
-	 */
-	static void Switch(Process *Next)
-	{
-		if (Next == nullptr)
-		{
-			return;
-		}
-		
-		pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
-		if (CurProc && CurProc != Next)
-		{
-			pantheon::CPUReg::W_TTBR0_EL1(Next->GetTTBR0());
-		}
-	}
-
 private:
 	ID PID;
 	String ProcessString;
@@ -154,7 +164,35 @@ private:
 	pantheon::vmm::PhysicalAddress TTBR0;
 	pantheon::vmm::PageTable *MemoryMap;
 
+	/* Held across long changes to the address space, like loading a
+	 * program, so that the process lock only needs to be held per page. */
+	pantheon::Mutex MemoryLock;
+
+	/* The ASID this process was given, and which generation it's from. */
+	pantheon::Atomic<UINT64> ASIDContext;
+
 	pantheon::HandleTable HandTable;
+
+	pantheon::Thread *Threads;
+	pantheon::Atomic<UINT64> NumThreads;
+	pantheon::Atomic<UINT64> NumLiveThreads;
+
+	UINT64 NumLocalRegions;
+
+	/* The page of each thread local region, tagged with LocalRegionInUse while some thread has it. */
+	pantheon::vmm::PhysicalAddress LocalPageList;
+	static const constexpr pantheon::vmm::PhysicalAddress LocalRegionInUse = 1;
+
+	pantheon::vmm::PhysicalAddress UserStack[StackPages];
+
+	/* The pages the program was loaded into. Each page of this list starts
+	 * with the address of the one before it, if there is one. */
+	pantheon::vmm::PhysicalAddress ImagePageList;
+	UINT64 ImageListCount;
+	static const constexpr UINT64 ImagePagesPerList = pantheon::vmm::SmallestPageSize / sizeof(pantheon::vmm::PhysicalAddress);
+
+	/* Waiting to be freed, once no core has this address space loaded anymore. */
+	Process *ZombieNext;
 };
 
 void InitProcessTables();
@@ -0,0 +1,144 @@
+#include <kern_datatypes.hpp>
+#include <Sync/kern_rcu.hpp>
+
+#include "kern_proc.hpp"
+#include "kern_proctable.hpp"
+
+pantheon::ProcessTable::ProcessTable() : Seq("Process Table")
+{
+	for (UINT64 Index = 0; Index < ProcessTable::NumSlots; ++Index)
+	{
+		this->Keys[Index].Store(ProcessTable::EmptySlot);
+		this->Values[Index].Store(nullptr);
+	}
+	this->Used = 0;
+}
+
+pantheon::ProcessTable::~ProcessTable() = default;
+
+/**
+ * @brief Makes a process visible to lookups by its PID
+ * @param Proc The process to insert, which must have its PID already set
+ * @return TRUE if the process was inserted, FALSE if that PID is already present
+ */
+BOOL pantheon::ProcessTable::Insert(pantheon::Process *Proc)
+{
+	OBJECT_SELF_ASSERT();
+	if (Proc == nullptr)
+	{
+		return FALSE;
+	}
+
+	this->Seq.AcquireWrite();
+	BOOL Inserted = this->InsertLocked(Proc);
+	this->Seq.ReleaseWrite();
+	return Inserted;
+}
+
+BOOL pantheon::ProcessTable::InsertLocked(pantheon::Process *Proc)
+{
+	UINT32 PID = Proc->ProcessID();
+	UINT64 Index = ProcessTable::SlotOf(PID);
+	UINT32 Key = this->Keys[Index].Load();
+	if (Key == PID)
+	{
+		return FALSE;
+	}
+
+	if (Key != ProcessTable::EmptySlot)
+	{
+		StopError("Process table slot already taken");
+	}
+
+	this->Values[Index].Store(Proc);
+	this->Keys[Index].Store(PID);
+	this->Used++;
+	return TRUE;
+}
+
+/**
+ * @brief Removes a process from the table
+ * @param PID The ID of the process to remove
+ * @return TRUE if the process was removed, FALSE if it was not present
+ */
+BOOL pantheon::ProcessTable::Remove(UINT32 PID)
+{
+	OBJECT_SELF_ASSERT();
+	this->Seq.AcquireWrite();
+	BOOL Removed = this->RemoveLocked(PID);
+	this->Seq.ReleaseWrite();
+	return Removed;
+}
+
+BOOL pantheon::ProcessTable::RemoveLocked(UINT32 PID)
+{
+	UINT64 Index = ProcessTable::SlotOf(PID);
+	if (this->Keys[Index].Load() != PID)
+	{
+		return FALSE;
+	}
+
+	this->Keys[Index].Store(ProcessTable::EmptySlot);
+	this->Values[Index].Store(nullptr);
+	this->Used--;
+	return TRUE;
+}
+
+/**
+ * @brief Finds a process from its PID, without taking any locks
+ * @details A slot can be emptied and reused for some other process between
+ * reading its key and its value, so this looks again if that happened.
+ * The caller has to be inside a read section for as long as it uses the
+ * process it found: a removed process is freed once nobody can see it.
+ * @param PID The ID of the process to find
+ * @return The process with that ID, or nullptr if there is none.
+ */
+[[nodiscard]]
+pantheon::Process *pantheon::ProcessTable::Lookup(UINT32 PID) const
+{
+	OBJECT_SELF_ASSERT();
+	if (pantheon::rcu::InReadSection() == FALSE)
+	{
+		StopError("Process lookup outside of read section");
+	}
+
+	UINT64 Start = 0;
+	pantheon::Process *Proc = nullptr;
+	do
+	{
+		Start = this->Seq.ReadBegin();
+		Proc = this->Find(PID);
+	} while (this->Seq.ReadRetry(Start));
+	return Proc;
+}
+
+[[nodiscard]]
+pantheon::Process *pantheon::ProcessTable::Find(UINT32 PID) const
+{
+	UINT64 Index = ProcessTable::SlotOf(PID);
+	if (this->Keys[Index].Load() != PID)
+	{
+		return nullptr;
+	}
+	return this->Values[Index].Load();
+}
+
+/**
+ * @brief Gets the number of processes currently in the table
+ */
+[[nodiscard]]
+UINT64 pantheon::ProcessTable::Count() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Used;
+}
+
+/**
+ * @brief Checks if a process is being inserted or removed right now
+ */
+[[nodiscard]]
+BOOL pantheon::ProcessTable::IsLocked() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Seq.IsLocked();
+}
@@ -0,0 +1,68 @@
+#include <kern_datatypes.hpp>
+
+#include <Sync/kern_atomic.hpp>
+#include <Sync/kern_seqlock.hpp>
+
+/**
+ * @file System/Proc/kern_proctable.hpp
+ * @brief Definitions for the table used to find a process from its PID
+ */
+
+#ifndef _KERN_PROCTABLE_HPP_
+#define _KERN_PROCTABLE_HPP_
+
+namespace pantheon
+{
+
+class Process;
+
+/**
+ * @brief A table of processes, indexed by the slot bits of their PID.
+ * @details The low bits of a PID are its slot in the PID allocator, so
+ * every live process has a slot here to itself, and a stale PID never
+ * matches whatever took its slot afterwards. Lookups never take a lock:
+ * they only try again if the table changed under them. Inserting or
+ * removing a process is serialized by the table's seqlock.
+ *
+ * A process found here is only freed once every core has left the read
+ * section it was found in, so Lookup has to be called inside one.
+ */
+class ProcessTable
+{
+public:
+	ProcessTable();
+	~ProcessTable();
+
+	BOOL Insert(pantheon::Process *Proc);
+	BOOL Remove(UINT32 PID);
+	[[nodiscard]] pantheon::Process *Lookup(UINT32 PID) const;
+	[[nodiscard]] UINT64 Count() const;
+
+	[[nodiscard]] BOOL IsLocked() const;
+
+	/* One per slot of the PID allocator: PID 0 is the idle process,
+	 * which leaves room for 255 more. */
+	static constexpr UINT64 NumSlots = 256;
+
+private:
+	static constexpr UINT32 EmptySlot = 0xFFFFFFFF;
+
+	static constexpr UINT64 SlotOf(UINT32 PID)
+	{
+		return PID & (ProcessTable::NumSlots - 1);
+	}
+
+	BOOL InsertLocked(pantheon::Process *Proc);
+	BOOL RemoveLocked(UINT32 PID);
+	[[nodiscard]] pantheon::Process *Find(UINT32 PID) const;
+
+	pantheon::SeqLock Seq;
+
+	pantheon::Atomic<UINT32> Keys[NumSlots];
+	pantheon::Atomic<pantheon::Process*> Values[NumSlots];
+	UINT64 Used;
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <vmm/pte.hpp>
 #include <vmm/vmm.hpp>
 #include <kern_datatypes.hpp>
+#include <Sync/kern_rcu.hpp>
 #include <Sync/kern_spinlock.hpp>
 
 #include <System/Proc/kern_cpu.hpp>
@@ -15,6 +16,7 @@
 #include <System/Proc/kern_thread.hpp>
 #include <System/Memory/kern_alloc.hpp>
 
+#include <Common/Structures/kern_idalloc.hpp>
 #include <Common/Structures/kern_linkedlist.hpp>
 
 #ifndef ONLY_TESTING
@@ -29,101 +31,1353 @@ static UINT64 USER_END = 0;
  * @file Common/Proc/kern_sched.cpp
  * \~english @brief Definitions for basic kernel scheduling data structures and
  * algorithms. The pantheon kernel implements a basic round-robin style scheduling
- * algorithm based on tick counts and a list of threads.
+ * algorithm based on tick counts and a list of threads for each core and
+ * priority level.
  * \~english @author Brian Schnepp
  */
 
+pantheon::Scheduler::Scheduler() : pantheon::Scheduler::Scheduler(0)
+{
+}
+
+/**
+ * \~english @brief Initalizes an instance of a per-core scheduler.
+ * \~english @param CoreNo The core this scheduler runs threads on
+ * \~english @author Brian Schnepp
+ */
+pantheon::Scheduler::Scheduler(UINT8 CoreNo) : pantheon::Lockable("Scheduler")
+{
+	this->CoreNo = CoreNo;
+	this->IdleThread = pantheon::GlobalScheduler::CreateProcessorIdleThread();
+	this->CurThread = this->IdleThread;
+	this->SwitchedFrom = nullptr;
+	for (UINT8 Level = 0; Level < pantheon::Thread::PRIORITY_MAX; ++Level)
+	{
+		this->ReadyHead[Level] = nullptr;
+		this->ReadyTail[Level] = nullptr;
+	}
+	this->ReadyMask = 0;
+	this->LastQueued = nullptr;
+	this->Picks = 0;
+	this->ReadyCount.Store(0);
+	this->Sleepers.Store(nullptr);
+	this->DeadThreads.Store(nullptr);
+	this->Zombies.Store(nullptr);
+	this->DeadlineHead = nullptr;
+	this->ThrottledHead = nullptr;
+	this->ReservedLoad = 0;
+
+	UINT64 Now = pantheon::GetSystemTicks();
+	this->BusyTicks = 0;
+	this->BusySince = Now;
+	this->WindowStart = Now;
+	this->NextBalance = Now + pantheon::Scheduler::BalanceInterval;
+	this->LoadAvg.Store(0);
+	this->Utilized.Store(0);
+}
+
+pantheon::Scheduler::~Scheduler()
+{
+
+}
+
+extern "C" void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT64 RegOffset);
+
+/**
+ * \~english @brief Changes the current thread of this core.
+ * \~english @details Forcefully changes the current thread by iterating to
+ * the next thread in the list of threads belonging to this core. The active
+ * count for the current thread is set to zero, and the new thread is run until
+ * either the core is forcefully rescheduled, or the timer indicates the current
+ * thread should quit. If this core has no work of its own, work is stolen
+ * from the run queue of some other core.
+ * 
+ * \~english @author Brian Schnepp
+ */
+void pantheon::Scheduler::Reschedule()
+{
+	OBJECT_SELF_ASSERT();
+	/* Interrupts must be enabled before we can do anything. */
+	if (pantheon::CPU::ICOUNT())
+	{
+		return;
+	}
+
+	/* Interrupts are on, so this core can't be in any read section. */
+	pantheon::rcu::Quiescent();
+
+	/* Anyone whose timeout ran out should be considered too. */
+	this->WakeSleepers();
+
+	pantheon::Thread *Old = this->CurThread;
+	pantheon::Thread *New = this->Dequeue();
+
+	/* If there's nothing here, see if some other core has work to spare. */
+	if (New == nullptr)
+	{
+		New = pantheon::Scheduler::StealFromOthers(this->CoreNo);
+	}
+
+	/* If there is no next, just do the idle thread. */
+	if (New == nullptr)
+	{
+		New = this->IdleThread;
+	}
+
+	/* Some other core could still be saving its registers. */
+	while (New != Old && New->OnCore())
+	{
+		pantheon::CPU::PAUSE();
+	}
+
+	/* Don't bother trying to switching threads if we don't have to. */
+	New->Lock();
+	if (New == Old)
+	{
+		/* This thread was woken up while it was trying to block. */
+		if (New->MyState() == pantheon::Thread::STATE_WAITING)
+		{
+			New->SetState(pantheon::Thread::STATE_RUNNING);
+		}
+
+		/* An idle core has no need for a tick, unless someone's sleeping. */
+		if (New == this->IdleThread)
+		{
+			this->ProgramTimer(New);
+		}
+		New->Unlock();
+		return;
+	}
+
+	Old->Lock();
+	/* If it's not currently waiting, definitely don't. */
+	if (New->MyState() != pantheon::Thread::STATE_WAITING)
+	{
+		New->Unlock();
+		Old->Unlock();
+		return;
+	}
+
+	pantheon::ScopedLocalSchedulerLock _L;
+
+	/* Threads which exited shouldn't come back to life. */
+	BOOL Requeue = (Old->MyState() == pantheon::Thread::STATE_RUNNING);
+	if (Requeue)
+	{
+		Old->SetState(pantheon::Thread::STATE_WAITING);
+	}
+	Old->RefreshTicks();
+	this->AccountSwitch(Old, pantheon::GetSystemTicks());
+
+	pantheon::Process *NewProc = New->MyProc();
+	pantheon::Process::Switch(NewProc);
+	this->CurThread = New;
+	pantheon::CPU::SetCurThread(this->CoreNo, New);
+	this->CurThread->SetState(pantheon::Thread::STATE_RUNNING);
+	this->CurThread->SetLastCore(this->CoreNo);
+	this->CurThread->SetOnCore(TRUE);
+	this->SwitchedFrom = Old;
+
+	pantheon::CpuContext *OldContext = Old->GetRegisters();
+	pantheon::CpuContext *NewContext = New->GetRegisters();
+
+	/* Update the Thread Local Area register */
+	pantheon::ipc::SetThreadLocalRegion(New->GetThreadLocalAreaRegister());
+	pantheon::CPU::SwitchFPU(Old, New);
+
+	/* The idle thread is only ever run by the core which owns it. */
+	if (Requeue && Old != this->IdleThread)
+	{
+		this->Enqueue(Old);
+	}
+
+	this->ProgramTimer(New);
+
+	Old->Unlock();
+	New->Unlock();
+
+	this->PerformCpuSwitch(OldContext, NewContext);
+}
+
+/**
+ * \~english @brief Switches directly to a thread the current one was
+ * waiting on.
+ * \~english @details This is meant for synchronous IPC: the current thread
+ * must have just blocked on something only Next can finish, like a reply.
+ * Next doesn't go through any run queue, and no other thread is considered.
+ * Whatever is left of the current time slice is given to Next, so a request
+ * and its reply both run on the time of whoever made the request. If Next
+ * can't be run here right away, it's only woken up, and this core
+ * reschedules as usual.
+ * \~english @param Next The thread to run next
+ * \~english @param Token The token of the wait Next is blocked in
+ * \~english @param Reason Why Next is being woken up
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::HandOff(pantheon::Thread *Next, UINT64 Token, INT64 Reason)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Old = this->CurThread;
+
+	/* Interrupts must be enabled before we can switch to anything. */
+	if (pantheon::CPU::ICOUNT())
+	{
+		pantheon::WakeThread(Next, Token, Reason);
+		return;
+	}
+
+	Next->Lock();
+	if (Next->Wake(Token, Reason) == FALSE)
+	{
+		Next->Unlock();
+		this->Reschedule();
+		return;
+	}
+
+	/* Next may not have blocked yet, or may still be getting switched away from.
+	 * Deadline threads always go through their own run queue, so they
+	 * start a new period and stay on the core they're reserved on. */
+	BOOL Movable = Next->CanRunOn(this->CoreNo) && Next->IsDeadline() == FALSE;
+	if (Next->OnCore() || Movable == FALSE || Next->MyState() != pantheon::Thread::STATE_BLOCKED)
+	{
+		pantheon::ResumeThread(Next);
+		Next->Unlock();
+		this->Reschedule();
+		return;
+	}
+
+	Old->Lock();
+	pantheon::ScopedLocalSchedulerLock _L;
+
+	/* Someone could have woken up the old thread already. */
+	BOOL Requeue = (Old->MyState() == pantheon::Thread::STATE_RUNNING);
+	if (Requeue)
+	{
+		Old->SetState(pantheon::Thread::STATE_WAITING);
+	}
+	if (Old->IsDeadline() == FALSE)
+	{
+		Next->SetTicks(Old->TicksLeft());
+	}
+	Old->RefreshTicks();
+	this->AccountSwitch(Old, pantheon::GetSystemTicks());
+
+	pantheon::Process::Switch(Next->MyProc());
+	this->CurThread = Next;
+	pantheon::CPU::SetCurThread(this->CoreNo, Next);
+	this->CurThread->SetState(pantheon::Thread::STATE_RUNNING);
+	this->CurThread->SetLastCore(this->CoreNo);
+	this->CurThread->SetOnCore(TRUE);
+	this->SwitchedFrom = Old;
+
+	pantheon::CpuContext *OldContext = Old->GetRegisters();
+	pantheon::CpuContext *NewContext = Next->GetRegisters();
+
+	pantheon::ipc::SetThreadLocalRegion(Next->GetThreadLocalAreaRegister());
+	pantheon::CPU::SwitchFPU(Old, Next);
+
+	if (Requeue && Old != this->IdleThread)
+	{
+		this->Enqueue(Old);
+	}
+
+	this->ProgramTimer(Next);
+
+	Old->Unlock();
+	Next->Unlock();
+
+	this->PerformCpuSwitch(OldContext, NewContext);
+}
+
+/**
+ * \~english @brief Saves the registers of the old thread, and loads those
+ * of the new one.
+ * \~english @details Neither thread should be locked anymore. This returns
+ * once the old thread gets switched back to, possibly on some other core.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::PerformCpuSwitch(pantheon::CpuContext *Old, pantheon::CpuContext *New)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Sync::DSBISH();
+	pantheon::Sync::ISB();
+	cpu_switch(Old, New, CpuIRegOffset);
+	pantheon::CPU::GetCurSched()->FinishSwitch();
+}
+
+/**
+ * \~english @brief Lets other cores run the thread this core just
+ * switched away from.
+ * \~english @details This has to be called by whatever runs first after
+ * a switch, on the core which did the switch: the registers of the old
+ * thread are only saved by then. If the old thread exited, nothing is
+ * using its stack anymore either, so it's left for Reap to free.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::FinishSwitch()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Old = this->SwitchedFrom;
+	this->SwitchedFrom = nullptr;
+	if (Old != nullptr && Old != this->CurThread)
+	{
+		pantheon::Sync::DSBISH();
+		Old->SetOnCore(FALSE);
+
+		pantheon::Thread::State OldState = Old->MyState();
+		if (OldState == pantheon::Thread::STATE_TERMINATED || OldState == pantheon::Thread::STATE_DEAD)
+		{
+			pantheon::Thread *Head = this->DeadThreads.Load();
+			do
+			{
+				Old->SetNext(Head);
+			} while (this->DeadThreads.CompareExchange(Head, Old) == FALSE);
+		}
+	}
+}
+
+/**
+ * \~english @brief Frees the threads which exited on this core, along with
+ * any process they were the last threads of.
+ * \~english @details Everything which piled up since the last call is
+ * taken at once, and freed here instead of while switching threads. A
+ * process can't be freed while some core still has its address space
+ * loaded: it's kept around until some later call. This must be called
+ * without any locks held.
+ * \~english @return TRUE if any thread or process was freed.
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::Scheduler::Reap()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Thread *Dead = this->DeadThreads.Load();
+	while (Dead != nullptr && this->DeadThreads.CompareExchange(Dead, nullptr) == FALSE)
+	{
+	}
+
+	pantheon::Process *Zombie = this->Zombies.Load();
+	while (Zombie != nullptr && this->Zombies.CompareExchange(Zombie, nullptr) == FALSE)
+	{
+	}
+
+	BOOL Freed = (Dead != nullptr);
+	while (Dead != nullptr)
+	{
+		pantheon::Thread *Next = Dead->Next();
+		pantheon::Process *Proc = pantheon::GlobalScheduler::ReapThread(Dead);
+		if (Proc != nullptr)
+		{
+			Proc->SetNextZombie(Zombie);
+			Zombie = Proc;
+		}
+		Dead = Next;
+	}
+
+	while (Zombie != nullptr)
+	{
+		pantheon::Process *Next = Zombie->NextZombie();
+		if (pantheon::GlobalScheduler::ReapProcess(Zombie) == FALSE)
+		{
+			this->PushZombie(Zombie);
+		}
+		else
+		{
+			Freed = TRUE;
+		}
+		Zombie = Next;
+	}
+	return Freed;
+}
+
+/**
+ * \~english @brief Keeps a process for some later call to Reap.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::PushZombie(pantheon::Process *Proc)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Process *Head = this->Zombies.Load();
+	do
+	{
+		Proc->SetNextZombie(Head);
+	} while (this->Zombies.CompareExchange(Head, Proc) == FALSE);
+}
+
+/**
+ * \~english @brief Keeps track of how long this core is busy for.
+ * \~english @details Time spent running the idle thread doesn't count.
+ * Only the core which owns this scheduler may call this.
+ * \~english @param Old The thread being switched away from
+ * \~english @param Now The tick the switch happens at
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::AccountSwitch(pantheon::Thread *Old, UINT64 Now)
+{
+	OBJECT_SELF_ASSERT();
+	if (Old != this->IdleThread)
+	{
+		this->BusyTicks += Now - this->BusySince;
+	}
+	this->BusySince = Now;
+	Old->SetLastRan(Now);
+}
+
+/**
+ * \~english @brief Sets up the timer for a thread about to run on this core.
+ * \~english @details The timer is programmed to fire exactly when the
+ * thread's time slice runs out, or when the next sleeping thread on this
+ * core has to be woken up, whichever is sooner. The idle thread runs
+ * untimed: anything queued onto this core is noticed by the idle loop
+ * instead. The thread must be locked.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::ProgramTimer(pantheon::Thread *Next)
+{
+	OBJECT_SELF_ASSERT();
+	UINT64 Ticks = 0;
+	if (Next != this->IdleThread)
+	{
+		Ticks = Next->TicksLeft() ? Next->TicksLeft() : 1;
+	}
+
+	UINT64 WakeAt = this->NextWakeup();
+	if (WakeAt != 0)
+	{
+		UINT64 Now = pantheon::GetSystemTicks();
+		UINT64 Until = (WakeAt > Now) ? (WakeAt - Now) : 1;
+		if (Ticks == 0 || Until < Ticks)
+		{
+			Ticks = Until;
+		}
+	}
+
+	if (Ticks == 0)
+	{
+		pantheon::CPU::StopTick();
+		return;
+	}
+	pantheon::CPU::ArmTick(Ticks);
+}
+
+/**
+ * \~english @brief Gets when the soonest sleeping thread on this core
+ * has to be woken up, or the soonest throttled thread gets a new budget.
+ * \~english @return The tick to wake up at, or 0 if there's no such thread.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::Scheduler::NextWakeup()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	UINT64 WakeAt = 0;
+	pantheon::WaitNode *Head = this->Sleepers.Load();
+	if (Head != nullptr)
+	{
+		WakeAt = Head->WakeAt;
+	}
+
+	if (this->ThrottledHead != nullptr)
+	{
+		UINT64 Release = this->ThrottledHead->NextRelease();
+		if (WakeAt == 0 || Release < WakeAt)
+		{
+			WakeAt = Release;
+		}
+	}
+	return WakeAt;
+}
+
+/**
+ * \~english @brief Makes a waiting thread time out at some point.
+ * \~english @details The thread is woken up with WakeTimeout once the
+ * system tick count reaches the node's WakeAt, if nothing else woke it up
+ * first. The node must be removed with RemoveSleeper before the wait
+ * ends, even if it did time out.
+ * \~english @param Node A node for the waiting thread, with WakeAt set
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::AddSleeper(pantheon::WaitNode *Node)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	pantheon::WaitNode *Prev = nullptr;
+	pantheon::WaitNode *Cur = this->Sleepers.Load();
+	while (Cur != nullptr && Cur->WakeAt <= Node->WakeAt)
+	{
+		Prev = Cur;
+		Cur = Cur->Next;
+	}
+
+	Node->Prev = Prev;
+	Node->Next = Cur;
+	if (Cur)
+	{
+		Cur->Prev = Node;
+	}
+
+	if (Prev)
+	{
+		Prev->Next = Node;
+	}
+	else
+	{
+		this->Sleepers.Store(Node);
+	}
+	Node->Queued = TRUE;
+}
+
+/**
+ * \~english @brief Cancels the timeout of some waiting thread.
+ * \~english @details Nothing happens if the timeout already went off.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::RemoveSleeper(pantheon::WaitNode *Node)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+	if (Node->Queued == FALSE)
+	{
+		return;
+	}
+
+	if (Node->Prev)
+	{
+		Node->Prev->Next = Node->Next;
+	}
+	else
+	{
+		this->Sleepers.Store(Node->Next);
+	}
+
+	if (Node->Next)
+	{
+		Node->Next->Prev = Node->Prev;
+	}
+	Node->Next = nullptr;
+	Node->Prev = nullptr;
+	Node->Queued = FALSE;
+}
+
+/**
+ * \~english @brief Wakes up every sleeping thread whose timeout ran out.
+ * \~english @details The threads can't be woken with this scheduler
+ * locked, since they have to be locked first. Their nodes may also be
+ * gone as soon as the lock is dropped, so everything needed is copied
+ * out first, a few at a time.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::WakeSleepers()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->Sleepers.Load() == nullptr)
+	{
+		return;
+	}
+
+	UINT64 Now = pantheon::GetSystemTicks();
+	for (;;)
+	{
+		pantheon::Thread *Waiters[MaxWakeBatch];
+		UINT64 Tokens[MaxWakeBatch];
+		UINT64 Count = 0;
+
+		this->Lock();
+		while (Count < MaxWakeBatch)
+		{
+			pantheon::WaitNode *Head = this->Sleepers.Load();
+			if (Head == nullptr || Head->WakeAt > Now)
+			{
+				break;
+			}
+
+			this->Sleepers.Store(Head->Next);
+			if (Head->Next)
+			{
+				Head->Next->Prev = nullptr;
+			}
+			Head->Next = nullptr;
+			Head->Queued = FALSE;
+
+			Waiters[Count] = Head->Waiter;
+			Tokens[Count] = Head->Token;
+			Count++;
+		}
+		this->Unlock();
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			pantheon::WakeThread(Waiters[Index], Tokens[Index], pantheon::Thread::WakeTimeout);
+		}
+
+		if (Count < MaxWakeBatch)
+		{
+			break;
+		}
+	}
+}
+
+/**
+ * \~english @brief Inserts a thread at the end of the queue for some priority.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::PushLevel(UINT8 Level, pantheon::Thread *Next)
+{
+	Next->SetNext(nullptr);
+	if (this->ReadyTail[Level])
+	{
+		this->ReadyTail[Level]->SetNext(Next);
+		this->ReadyTail[Level] = Next;
+	}
+	else
+	{
+		/* Only possible if the queue really is empty. */
+		this->ReadyHead[Level] = Next;
+		this->ReadyTail[Level] = Next;
+	}
+	this->ReadyMask |= (1U << Level);
+}
+
+/**
+ * \~english @brief Removes the thread at the front of the queue for some priority.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread *pantheon::Scheduler::PopLevel(UINT8 Level)
+{
+	pantheon::Thread *Head = this->ReadyHead[Level];
+	if (Head == nullptr)
+	{
+		return nullptr;
+	}
+
+	this->ReadyHead[Level] = Head->Next();
+	if (this->ReadyHead[Level] == nullptr)
+	{
+		this->ReadyTail[Level] = nullptr;
+		this->ReadyMask &= ~(1U << Level);
+	}
+	Head->SetNext(nullptr);
+	return Head;
+}
+
+/**
+ * \~english @brief Removes a thread from anywhere in the queue for some priority.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @param Level The priority the thread is queued at
+ * \~english @param Prev The thread queued right before it, or nullptr
+ * \~english @param Cur The thread to remove
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::UnlinkLevel(UINT8 Level, pantheon::Thread *Prev, pantheon::Thread *Cur)
+{
+	if (Prev == nullptr)
+	{
+		this->PopLevel(Level);
+		return;
+	}
+
+	Prev->SetNext(Cur->Next());
+	if (this->ReadyTail[Level] == Cur)
+	{
+		this->ReadyTail[Level] = Prev;
+	}
+	Cur->SetNext(nullptr);
+}
+
+/**
+ * \~english @brief Gets the highest priority with anything queued at it.
+ * \~english @details The scheduler must be locked to do this, and there
+ * must be at least one thread queued.
+ * \~english @author Brian Schnepp
+ */
+UINT8 pantheon::Scheduler::HighestLevel() const
+{
+	return static_cast<UINT8>(31 - __builtin_clz(this->ReadyMask));
+}
+
+/**
+ * \~english @brief Inserts a thread at the end of this core's run queue.
+ * \~english @details The thread is queued according to its priority, or
+ * by its deadline on the core it's reserved on if it has one. A thread
+ * which isn't allowed to run on this core is queued onto the least busy
+ * core it is allowed on instead. The thread must be locked, so that its
+ * priority doesn't change underneath us.
+ * \~english @param Next The thread to queue for execution on this core
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::Enqueue(pantheon::Thread *Next)
+{
+	OBJECT_SELF_ASSERT();
+
+	/* If this thread is null for whatever reason, don't bother. */
+	if (Next == nullptr)
+	{
+		return;
+	}
+
+	if (Next->IsDeadline())
+	{
+		this->EnqueueDeadline(Next);
+		return;
+	}
+
+	if (Next->CanRunOn(this->CoreNo) == FALSE)
+	{
+		pantheon::Scheduler *Allowed = pantheon::Scheduler::PickScheduler(Next->AffinityMask());
+		if (Allowed != nullptr)
+		{
+			Allowed->Enqueue(Next);
+			return;
+		}
+	}
+
+	UINT8 Level = static_cast<UINT8>(Next->MyPriority());
+	{
+		pantheon::ScopedLock _L(this);
+		this->PushLevel(Level, Next);
+		this->LastQueued = Next;
+		this->ReadyCount.FetchAdd(1, pantheon::MemoryOrder::Relaxed);
+	}
+	this->WakeIdleCore();
+}
+
+/**
+ * \~english @brief Makes sure some core gets to a thread just queued here.
+ * \~english @details Idle cores sleep until they're interrupted. If this
+ * core is idle, it's interrupted to run the thread. If it's busy, and has
+ * enough queued that some of it can be stolen, some idle core is
+ * interrupted to steal it. Otherwise, nobody needs to be woken up.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::WakeIdleCore()
+{
+	OBJECT_SELF_ASSERT();
+	UINT8 Self = pantheon::CPU::GetProcessorNumber();
+	if (this->CurThread == this->IdleThread)
+	{
+		/* The current core gets to it on its own. */
+		if (this->CoreNo != Self)
+		{
+			pantheon::CPU::IPI(this->CoreNo);
+		}
+		return;
+	}
+
+	if (this->ReadyCount.Load() < 2)
+	{
+		return;
+	}
+
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::Scheduler *Other = pantheon::CPU::GetSched(Index);
+		if (Index != Self && Other != nullptr && Other != this && Other->CurThread == Other->IdleThread)
+		{
+			pantheon::CPU::IPI(Index);
+			return;
+		}
+	}
+}
+
+/**
+ * \~english @brief Moves a queued thread up to the level of its current priority.
+ * \~english @details Needed when a thread already waiting to run inherits
+ * a higher priority through a mutex: otherwise it would wait behind
+ * everything at its old priority, which is exactly what inheriting is
+ * supposed to prevent. Does nothing if the thread isn't queued anywhere.
+ * The thread must be locked.
+ * \~english @param T The thread whose priority was just raised
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::Promote(pantheon::Thread *T)
+{
+	if (T->IsLocked() == FALSE)
+	{
+		StopError("Promote without lock");
+	}
+
+	/* Deadline threads aren't ordered by priority anyway. */
+	if (T->IsDeadline())
+	{
+		return;
+	}
+
+	UINT8 Target = static_cast<UINT8>(T->MyPriority());
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Index);
+		if (Sched == nullptr)
+		{
+			continue;
+		}
+
+		pantheon::ScopedLock _L(Sched);
+		for (UINT8 Level = 0; Level < Target; ++Level)
+		{
+			pantheon::Thread *Prev = nullptr;
+			for (pantheon::Thread *Cur = Sched->ReadyHead[Level]; Cur != nullptr; Cur = Cur->Next())
+			{
+				if (Cur == T)
+				{
+					Sched->UnlinkLevel(Level, Prev, Cur);
+					Sched->PushLevel(Target, Cur);
+					return;
+				}
+				Prev = Cur;
+			}
+		}
+	}
+}
+
+/**
+ * \~english @brief Queues a deadline thread on the core it's reserved on.
+ * \~english @details A thread out of budget waits for its next period
+ * before it can run again. A thread coming back after its deadline
+ * already passed starts a new period right away. Otherwise, the thread
+ * picks up where it left off in its current period. The thread must be
+ * locked.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::EnqueueDeadline(pantheon::Thread *Next)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::Scheduler *Home = Next->DeadlineHome();
+	if (Home != nullptr && Home != this)
+	{
+		Home->EnqueueDeadline(Next);
+		return;
+	}
+
+	pantheon::ScopedLock _L(this);
+	UINT64 Now = pantheon::GetSystemTicks();
+	if (Next->TicksLeft() == 0 && Now < Next->NextRelease())
+	{
+		this->PushThrottled(Next);
+		return;
+	}
+
+	if (Next->TicksLeft() == 0 || Now >= Next->AbsoluteDeadline())
+	{
+		Next->StartPeriod(Now);
+	}
+	this->PushDeadline(Next);
+	this->WakeIdleCore();
+}
+
+/**
+ * \~english @brief Inserts a deadline thread into the run queue, after
+ * every thread due no later than it.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::PushDeadline(pantheon::Thread *Next)
+{
+	pantheon::Thread *Prev = nullptr;
+	pantheon::Thread *Cur = this->DeadlineHead;
+	while (Cur != nullptr && Cur->AbsoluteDeadline() <= Next->AbsoluteDeadline())
+	{
+		Prev = Cur;
+		Cur = Cur->Next();
+	}
+
+	Next->SetNext(Cur);
+	if (Prev)
+	{
+		Prev->SetNext(Next);
+	}
+	else
+	{
+		this->DeadlineHead = Next;
+	}
+	this->ReadyCount.FetchAdd(1, pantheon::MemoryOrder::Relaxed);
+}
+
+/**
+ * \~english @brief Puts away a deadline thread until its next period.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::PushThrottled(pantheon::Thread *Next)
+{
+	pantheon::Thread *Prev = nullptr;
+	pantheon::Thread *Cur = this->ThrottledHead;
+	while (Cur != nullptr && Cur->NextRelease() <= Next->NextRelease())
+	{
+		Prev = Cur;
+		Cur = Cur->Next();
+	}
+
+	Next->SetNext(Cur);
+	if (Prev)
+	{
+		Prev->SetNext(Next);
+	}
+	else
+	{
+		this->ThrottledHead = Next;
+	}
+}
+
+/**
+ * \~english @brief Gives every throttled thread whose next period started
+ * a new budget, and makes it runnable again.
+ * \~english @details The scheduler must be locked to do this.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::ReleaseThrottledLocked(UINT64 Now)
+{
+	while (this->ThrottledHead != nullptr && this->ThrottledHead->NextRelease() <= Now)
+	{
+		pantheon::Thread *Head = this->ThrottledHead;
+		this->ThrottledHead = Head->Next();
+		Head->StartPeriod(Head->NextRelease());
+		this->PushDeadline(Head);
+	}
+}
+
+VOID pantheon::Scheduler::ReleaseThrottled()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+	this->ReleaseThrottledLocked(pantheon::GetSystemTicks());
+}
+
+/**
+ * \~english @brief Checks if some deadline thread should take over this
+ * core from whatever is running now.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+BOOL pantheon::Scheduler::ShouldPreempt()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+	if (this->DeadlineHead == nullptr)
+	{
+		return FALSE;
+	}
+
+	pantheon::Thread *Cur = this->CurThread;
+	if (Cur == nullptr || Cur->IsDeadline() == FALSE)
+	{
+		return TRUE;
+	}
+	return this->DeadlineHead->AbsoluteDeadline() < Cur->AbsoluteDeadline();
+}
+
+/**
+ * \~english @brief Gets how much of a core some deadline thread needs.
+ * \~english @return The worst case share of this core, in parts of LoadUnit
+ */
+static UINT64 DeadlineDensity(UINT64 Runtime, UINT64 Deadline)
+{
+	return (Runtime * pantheon::Scheduler::LoadUnit + Deadline - 1) / Deadline;
+}
+
+/**
+ * \~english @brief Reserves time on this core for a thread to be
+ * scheduled by deadline.
+ * \~english @details The reservation is only made if every deadline
+ * thread on this core can still always meet its deadline, with some room
+ * left over for everything else. Deadline threads run ahead of all other
+ * threads, earliest deadline first, and are stopped for the rest of a
+ * period once they use up their runtime. The thread must be locked, and
+ * must not be queued anywhere.
+ * \~english @param T The thread to reserve time for
+ * \~english @param Runtime The ticks of work needed every period
+ * \~english @param Period How often the work comes in
+ * \~english @param Deadline How long after the start of a period the
+ * work has to be done, at most the period
+ * \~english @return TRUE if the reservation was made
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::Scheduler::AdmitDeadline(pantheon::Thread *T, UINT64 Runtime, UINT64 Period, UINT64 Deadline)
+{
+	OBJECT_SELF_ASSERT();
+	if (Runtime == 0 || Runtime > Deadline || Deadline > Period)
+	{
+		return FALSE;
+	}
+
+	UINT64 Load = DeadlineDensity(Runtime, Deadline);
+	pantheon::ScopedLock _L(this);
+	if (this->ReservedLoad + Load > pantheon::Scheduler::MaxDeadlineLoad)
+	{
+		return FALSE;
+	}
+
+	this->ReservedLoad += Load;
+	T->SetDeadlineParams(Runtime, Period, Deadline, this);
+	T->StartPeriod(pantheon::GetSystemTicks());
+	return TRUE;
+}
+
+/**
+ * \~english @brief Gives back the time reserved for a deadline thread.
+ * \~english @details The thread goes back to being scheduled by priority.
+ * The thread must be locked, and must not be queued anywhere.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::ReleaseDeadline(pantheon::Thread *T)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+	if (T->DeadlineHome() != this)
+	{
+		return;
+	}
+
+	this->ReservedLoad -= DeadlineDensity(T->DeadlineRuntime(), T->RelativeDeadline());
+	T->SetDeadlineParams(0, 0, 0, nullptr);
+}
+
+/**
+ * \~english @brief Gets how much of this core is reserved for deadline threads.
+ * \~english @return The reserved share of this core, in parts of LoadUnit
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::Scheduler::DeadlineLoad() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->ReservedLoad;
+}
+
+/**
+ * \~english @brief Removes the highest priority thread from this core's run queue.
+ * \~english @details Every AgingInterval picks, the oldest thread waiting at
+ * each priority below the one picked is moved up a level. A thread which
+ * keeps getting passed over will eventually reach the highest priority and
+ * be run, no matter what else is queued. Threads fall back to their own
+ * priority the next time they're queued.
+ * \~english @return The next thread to run, or nullptr if there is none.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread *pantheon::Scheduler::Dequeue()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	/* Deadline threads always go ahead of everything else. */
+	this->ReleaseThrottledLocked(pantheon::GetSystemTicks());
+	if (this->DeadlineHead)
+	{
+		pantheon::Thread *Head = this->DeadlineHead;
+		this->DeadlineHead = Head->Next();
+		Head->SetNext(nullptr);
+		this->ReadyCount.FetchSub(1, pantheon::MemoryOrder::Relaxed);
+		return Head;
+	}
+
+	if (this->ReadyMask == 0)
+	{
+		return nullptr;
+	}
+
+	UINT8 Level = this->HighestLevel();
+	pantheon::Thread *Head = this->PopLevel(Level);
+	this->ReadyCount.FetchSub(1, pantheon::MemoryOrder::Relaxed);
+	if (Head == this->LastQueued)
+	{
+		this->LastQueued = nullptr;
+	}
+
+	if (++this->Picks % pantheon::Scheduler::AgingInterval == 0)
+	{
+		/* From the top down, so nothing moves up more than one level at once. */
+		for (UINT8 Upper = Level; Upper > 0; --Upper)
+		{
+			pantheon::Thread *Aged = this->PopLevel(Upper - 1);
+			if (Aged)
+			{
+				this->PushLevel(Upper, Aged);
+			}
+		}
+	}
+	return Head;
+}
+
+/**
+ * \~english @brief Takes a thread away from this core on behalf of an idle one.
+ * \~english @details A thread is only taken if this core would still have
+ * something else queued afterwards. The idle core would otherwise do
+ * nothing at all, so threads whose cache is still warm here are taken too.
+ * \~english @param CoreNo The core which is looking for work
+ * \~english @return A thread to run elsewhere, or nullptr if there is none.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread *pantheon::Scheduler::Steal(UINT8 CoreNo)
+{
+	OBJECT_SELF_ASSERT();
+
+	/* Don't even bother with the lock if there's nothing to take. */
+	if (this->ReadyCount.Load() < 2)
+	{
+		return nullptr;
+	}
+
+	pantheon::ScopedLock _L(this);
+	return this->Detach(CoreNo, TRUE);
+}
+
+/**
+ * \~english @brief Takes a thread away from this core to even out the load.
+ * \~english @details Threads which ran here recently are left alone: they
+ * would most likely run faster here, once their turn comes, than on a
+ * core where they have to start over with a cold cache.
+ * \~english @param CoreNo The core the thread is moved to
+ * \~english @return A thread to queue elsewhere, or nullptr if there is none.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread *pantheon::Scheduler::Migrate(UINT8 CoreNo)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->ReadyCount.Load() == 0)
+	{
+		return nullptr;
+	}
+
+	pantheon::ScopedLock _L(this);
+	return this->Detach(CoreNo, FALSE);
+}
+
+/**
+ * \~english @brief Removes the oldest, highest priority thread which could
+ * run on some other core from this core's run queue.
+ * \~english @details The most recently queued thread may be the one this
+ * core is in the middle of switching away from, so it is never a candidate.
+ * Neither is any thread some core is still switching away from. Deadline
+ * threads always stay where they are. The scheduler must be locked to do this.
+ * \~english @param CoreNo The core the thread would run on
+ * \~english @param TakeHot If threads which only just ran here may be taken
+ * \~english @return The thread removed, or nullptr if there was none.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread *pantheon::Scheduler::Detach(UINT8 CoreNo, BOOL TakeHot)
+{
+	OBJECT_SELF_ASSERT();
+	UINT64 Now = pantheon::GetSystemTicks();
+	for (INT8 Level = static_cast<INT8>(pantheon::Thread::PRIORITY_MAX - 1); Level >= 0; --Level)
+	{
+		pantheon::Thread *Prev = nullptr;
+		for (pantheon::Thread *Cur = this->ReadyHead[Level]; Cur != nullptr; Prev = Cur, Cur = Cur->Next())
+		{
+			if (Cur == this->LastQueued || Cur->OnCore() || Cur->CanRunOn(CoreNo) == FALSE)
+			{
+				continue;
+			}
+
+			BOOL Hot = Cur->LastCore() == this->CoreNo && Cur->LastRan() != 0
+				&& Now - Cur->LastRan() < pantheon::Scheduler::CacheHotTicks;
+			if (Hot && TakeHot == FALSE)
+			{
+				continue;
+			}
+
+			this->UnlinkLevel(static_cast<UINT8>(Level), Prev, Cur);
+			this->ReadyCount.FetchSub(1, pantheon::MemoryOrder::Relaxed);
+			return Cur;
+		}
+	}
+	return nullptr;
+}
+
 /**
- * \~english @brief Initalizes an instance of a per-core scheduler.
+ * \~english @brief Attempts to take work from the busiest other core.
+ * \~english @details Only one run queue is ever locked at a time, so two
+ * idle cores trying to steal from each other can never deadlock.
+ * \~english @param CoreNo The core which is looking for work
+ * \~english @return A thread to run, or nullptr if no core had any to spare.
  * \~english @author Brian Schnepp
  */
-pantheon::Scheduler::Scheduler()
+pantheon::Thread *pantheon::Scheduler::StealFromOthers(UINT8 CoreNo)
 {
-	this->IdleThread = pantheon::GlobalScheduler::CreateProcessorIdleThread();
-	this->CurThread = this->IdleThread;	
-}
+	pantheon::Scheduler *Victim = nullptr;
+	UINT64 Longest = 0;
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Index);
+		if (Index == CoreNo || Sched == nullptr)
+		{
+			continue;
+		}
 
-pantheon::Scheduler::~Scheduler()
-{
+		UINT64 Count = Sched->CountReady();
+		if (Count > Longest)
+		{
+			Longest = Count;
+			Victim = Sched;
+		}
+	}
 
+	if (Victim == nullptr)
+	{
+		return nullptr;
+	}
+	return Victim->Steal(CoreNo);
 }
 
-extern "C" void cpu_switch(pantheon::CpuContext *Old, pantheon::CpuContext *New, UINT64 RegOffset);
-
 /**
- * \~english @brief Changes the current thread of this core.
- * \~english @details Forcefully changes the current thread by iterating to
- * the next thread in the list of threads belonging to this core. The active
- * count for the current thread is set to zero, and the new thread is run until
- * either the core is forcefully rescheduled, or the timer indicates the current
- * thread should quit.
- * 
+ * \~english @brief Evens out the load between this core and the busiest one.
+ * \~english @details This only does anything every BalanceInterval ticks.
+ * The load of this core is sampled first, and if some other core has more
+ * than a thread's worth of load more, one thread which isn't cache-warm
+ * there is moved here. Only the core which owns this scheduler may call this.
  * \~english @author Brian Schnepp
  */
-void pantheon::Scheduler::Reschedule()
+VOID pantheon::Scheduler::Balance()
 {
 	OBJECT_SELF_ASSERT();
-	/* Interrupts must be enabled before we can do anything. */
-	if (pantheon::CPU::ICOUNT())
+	UINT64 Now = pantheon::GetSystemTicks();
+	if (Now < this->NextBalance)
 	{
 		return;
 	}
+	this->NextBalance = Now + pantheon::Scheduler::BalanceInterval;
+	this->SampleLoad(Now);
 
-	GlobalScheduler::Lock();
-	pantheon::Thread *Old = this->CurThread;
-	pantheon::Thread *New = GlobalScheduler::PopFromReadyList();
-
-	/* If there is no next, just do the idle thread. */
-	if (New == nullptr)
+	pantheon::Scheduler *Busiest = nullptr;
+	UINT64 Heaviest = this->Load() + pantheon::Scheduler::LoadUnit;
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
 	{
-		New = this->IdleThread;
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Index);
+		if (Sched == nullptr || Sched == this || Sched->CountReady() == 0)
+		{
+			continue;
+		}
+
+		if (Sched->Load() > Heaviest)
+		{
+			Heaviest = Sched->Load();
+			Busiest = Sched;
+		}
 	}
 
-	/* Don't bother trying to switching threads if we don't have to. */
-	New->Lock();
-	if (New == Old)
+	if (Busiest == nullptr)
 	{
-		New->Unlock();
-		pantheon::GlobalScheduler::Unlock();
 		return;
 	}
 
-	Old->Lock();
-	/* If it's not currently waiting, definitely don't. */
-	if (New->MyState() != pantheon::Thread::STATE_WAITING)
+	pantheon::Thread *Moved = Busiest->Migrate(this->CoreNo);
+	if (Moved != nullptr)
 	{
-		New->Unlock();
-		Old->Unlock();
-		pantheon::GlobalScheduler::Unlock();
-		return;
+		pantheon::ScopedLock _T(Moved);
+		this->Enqueue(Moved);
 	}
+}
 
-	pantheon::ScopedLocalSchedulerLock _L;
-	Old->SetState(pantheon::Thread::STATE_WAITING);
-	Old->RefreshTicks();
+/**
+ * \~english @brief Updates the load and utilization of this core.
+ * \~english @details The load is a decaying average of how many threads
+ * want this core, counting the one running. The utilization is how much of
+ * the time since the last sample was spent running something other than
+ * the idle thread. Only the core which owns this scheduler may call this.
+ * \~english @param Now The current tick
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Scheduler::SampleLoad(UINT64 Now)
+{
+	OBJECT_SELF_ASSERT();
+	UINT64 Busy = this->BusyTicks;
+	UINT64 Running = 0;
+	if (this->CurThread != this->IdleThread)
+	{
+		Busy += Now - this->BusySince;
+		Running = 1;
+	}
 
+	UINT64 Window = Now - this->WindowStart;
+	if (Window != 0)
+	{
+		UINT64 Share = (Busy * pantheon::Scheduler::LoadUnit) / Window;
+		this->Utilized.Store(Share < pantheon::Scheduler::LoadUnit ? Share : pantheon::Scheduler::LoadUnit);
+	}
+	this->BusyTicks = 0;
+	this->BusySince = Now;
+	this->WindowStart = Now;
 
-	pantheon::Process *NewProc = New->MyProc();
-	pantheon::Process::Switch(NewProc);
-	this->CurThread = New;
-	this->CurThread->SetState(pantheon::Thread::STATE_RUNNING);
+	/* Half the old average, half what's there now. */
+	UINT64 Sample = (this->ReadyCount.Load() + Running) * pantheon::Scheduler::LoadUnit;
+	this->LoadAvg.Store((this->LoadAvg.Load() + Sample) / 2);
+}
 
-	pantheon::CpuContext *OldContext = Old->GetRegisters();
-	pantheon::CpuContext *NewContext = New->GetRegisters();
+/**
+ * \~english @brief Gets the number of the core this scheduler runs threads on.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT8 pantheon::Scheduler::CoreNumber() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->CoreNo;
+}
 
-	/* Update the Thread Local Area register */
-	pantheon::ipc::SetThreadLocalRegion(New->GetThreadLocalAreaRegister());
+/**
+ * \~english @brief Gets how many threads want this core, on average.
+ * \~english @details This is only updated when this core balances.
+ * \~english @return The load of this core, in parts of LoadUnit
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::Scheduler::Load() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->LoadAvg.Load();
+}
 
-	/* TODO: Make this better */
-	pantheon::GlobalScheduler::AppendIntoReadyList(Old);
-	pantheon::GlobalScheduler::Unlock();
+/**
+ * \~english @brief Gets how busy this core was between its last two balances.
+ * \~english @return The busy share of this core, in parts of LoadUnit
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::Scheduler::Utilization() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Utilized.Load();
+}
 
-	Old->Unlock();
-	New->Unlock();
+/**
+ * \~english @brief Gets the number of threads waiting to run on this core.
+ * \~english @details This is only a hint: it is read without the lock held.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]]
+UINT64 pantheon::Scheduler::CountReady() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->ReadyCount.Load();
+}
 
-	pantheon::Sync::DSBISH();
-	pantheon::Sync::ISB();
-	cpu_switch(OldContext, NewContext, CpuIRegOffset);
+/**
+ * \~english @brief Picks which core a newly created thread should start on.
+ * \~english @details The core with the shortest run queue is preferred,
+ * with ties going to the lowest numbered core.
+ * \~english @param Mask The cores the thread is allowed to run on
+ * \~english @return The core to use, or nullptr if none are allowed.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Scheduler *pantheon::Scheduler::PickScheduler(UINT64 Mask)
+{
+	pantheon::Scheduler *Best = nullptr;
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Index);
+		if (Sched == nullptr || (Mask & (1ULL << Index)) == 0)
+		{
+			continue;
+		}
+
+		if (Best == nullptr || Sched->CountReady() < Best->CountReady())
+		{
+			Best = Sched;
+		}
+	}
+	return Best;
 }
 
 pantheon::Process *pantheon::Scheduler::MyProc()
@@ -177,11 +1431,9 @@ UINT32 pantheon::GlobalScheduler::CreateProcess(const pantheon::String &ProcStr,
 		Result = NewProc->ProcessID();
 	}
 
-	GlobalScheduler::ProcessList.PushFront(NewProc);
-
-	if (NewProc != GlobalScheduler::ProcessList.Front())
+	if (GlobalScheduler::Processes.Insert(NewProc) == FALSE)
 	{
-		StopError("NewProc was not front.");
+		StopError("NewProc was already in process table.");
 	}
 
 	return Result;
@@ -191,24 +1443,29 @@ pantheon::Thread *pantheon::GlobalScheduler::CreateUserThreadCommon(pantheon::Pr
 {
 	pantheon::Thread *T = pantheon::Thread::Create();
 	T->Initialize(Proc, StartAddr, ThreadData, Priority, TRUE);
-	GlobalScheduler::ThreadList.PushFront(T);
-	GlobalScheduler::AppendIntoReadyList(T);
-	return GlobalScheduler::ThreadList.Front();
-}
-
-pantheon::Thread *pantheon::GlobalScheduler::CreateUserThread(UINT32 PID, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority)
-{
-	pantheon::ScopedGlobalSchedulerLock _L;
 
-	pantheon::Process *SelProc = nullptr;
-	for (pantheon::Process &Proc : GlobalScheduler::ProcessList)
+	/* Every user thread gets a page to pass messages in. */
 	{
-		if (Proc.ProcessID() == PID)
+		pantheon::ScopedLock _L(Proc);
+		Proc->AttachThread(T);
+		pantheon::vmm::PhysicalAddress LocalPage = 0;
+		pantheon::vmm::VirtualAddress LocalRegion = Proc->AcquireThreadLocalRegion(LocalPage);
+		if (LocalRegion != 0)
 		{
-			SelProc = &Proc;
-			break;
+			pantheon::vmm::VirtualAddress LocalArea = pantheon::vmm::PhysicalToVirtualAddress(LocalPage);
+			pantheon::ScopedLock _T(T);
+			T->SetLocalRegion(LocalRegion, reinterpret_cast<pantheon::Thread::ThreadLocalRegion*>(LocalArea));
 		}
 	}
+	GlobalScheduler::QueueThread(T);
+	return T;
+}
+
+pantheon::Thread *pantheon::GlobalScheduler::CreateUserThread(UINT32 PID, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority)
+{
+	pantheon::rcu::ScopedReadSection _R;
+	pantheon::Process *SelProc = GlobalScheduler::Processes.Lookup(PID);
+	pantheon::ScopedGlobalSchedulerLock _L;
 
 	pantheon::Thread *Result = nullptr;
 	if (SelProc)
@@ -235,9 +1492,12 @@ pantheon::Thread *pantheon::GlobalScheduler::CreateThread(pantheon::Process *Pro
 
 	pantheon::Thread *T = pantheon::Thread::Create();
 	T->Initialize(Proc, StartAddr, ThreadData, Priority, FALSE);
-	GlobalScheduler::ThreadList.PushFront(T);
-	GlobalScheduler::AppendIntoReadyList(T);
-	return GlobalScheduler::ThreadList.Front();
+	{
+		pantheon::ScopedLock _L(Proc);
+		Proc->AttachThread(T);
+	}
+	GlobalScheduler::QueueThread(T);
+	return T;
 }
 
 void pantheon::GlobalScheduler::Lock()
@@ -251,27 +1511,19 @@ void pantheon::GlobalScheduler::Unlock()
 }
 
 pantheon::Atomic<BOOL> pantheon::GlobalScheduler::Okay;
-pantheon::Spinlock pantheon::GlobalScheduler::AccessSpinlock;
+pantheon::QueuedSpinlock pantheon::GlobalScheduler::AccessSpinlock;
 
-pantheon::LinkedList<pantheon::Process> pantheon::GlobalScheduler::ProcessList;
-pantheon::LinkedList<pantheon::Thread> pantheon::GlobalScheduler::ThreadList;
-
-pantheon::Thread *pantheon::GlobalScheduler::ReadyHead;
-pantheon::Thread *pantheon::GlobalScheduler::ReadyTail;
+pantheon::ProcessTable pantheon::GlobalScheduler::Processes;
 
 static pantheon::Process IdleProc;
 VOID pantheon::GlobalScheduler::Init()
 {
 	IdleProc = pantheon::Process();
 
-	GlobalScheduler::ReadyHead = nullptr;
-	GlobalScheduler::ReadyTail = nullptr;
-
-	GlobalScheduler::ThreadList = LinkedList<Thread>();
-	GlobalScheduler::ProcessList = LinkedList<Process>();
+	GlobalScheduler::Processes = ProcessTable();
 
-	GlobalScheduler::AccessSpinlock = Spinlock("access_spinlock");
-	GlobalScheduler::ProcessList.PushFront(&IdleProc);
+	GlobalScheduler::AccessSpinlock = QueuedSpinlock("access_spinlock");
+	GlobalScheduler::Processes.Insert(&IdleProc);
 	GlobalScheduler::Okay.Store(TRUE);
 }
 
@@ -279,78 +1531,189 @@ pantheon::Thread *pantheon::GlobalScheduler::CreateProcessorIdleThread()
 {
 	while (!GlobalScheduler::Okay.Load()){}
 
-	for (pantheon::Process &Proc : GlobalScheduler::ProcessList)
+	pantheon::Process *Proc = nullptr;
 	{
-		if (Proc.ProcessID() == 0)
-		{
-			/* Note the idle thread needs to have no meaningful data: it gets smashed on startup.  */
-			pantheon::Thread *CurThread = Thread::Create();
-			CurThread->Initialize(&Proc, nullptr, nullptr, pantheon::Thread::PRIORITY_VERYLOW, FALSE);
-			return CurThread;
-		}
+		/* The idle process is never freed, so it's fine to keep it after this. */
+		pantheon::rcu::ScopedReadSection _R;
+		Proc = GlobalScheduler::Processes.Lookup(0);
+	}
+
+	if (Proc)
+	{
+		/* Note the idle thread needs to have no meaningful data: it gets smashed on startup.  */
+		pantheon::Thread *CurThread = Thread::Create();
+		CurThread->Initialize(Proc, nullptr, nullptr, pantheon::Thread::PRIORITY_VERYLOW, FALSE);
+		return CurThread;
 	}
-	GlobalScheduler::AccessSpinlock.Release();
 	return nullptr;
 }
 
-UINT64 pantheon::GlobalScheduler::CountThreads(UINT64 PID)
+/**
+ * \~english @brief Gets the number of threads of a process which haven't exited.
+ * \~english @details This doesn't take any locks: the count is kept up to
+ * date by the process as threads are created and exit.
+ * \~english @param PID The ID of the process to query
+ * \~english @return The number of live threads, or 0 if there is no such process.
+ * \~english @author Brian Schnepp
+ */
+UINT64 pantheon::GlobalScheduler::CountThreads(UINT32 PID)
+{
+	pantheon::rcu::ScopedReadSection _R;
+	pantheon::Process *Proc = GlobalScheduler::Processes.Lookup(PID);
+	if (Proc == nullptr)
+	{
+		return 0;
+	}
+	return Proc->CountThreads();
+}
+
+/**
+ * \~english @brief Checks if a process exists and can still run anything.
+ * \~english @param PID The ID of the process to query
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::GlobalScheduler::ProcessAlive(UINT32 PID)
+{
+	pantheon::rcu::ScopedReadSection _R;
+	pantheon::Process *Proc = GlobalScheduler::Processes.Lookup(PID);
+	if (Proc == nullptr)
+	{
+		return FALSE;
+	}
+	return Proc->IsAlive();
+}
+
+/**
+ * \~english @brief Frees a thread which exited, once no core is using it.
+ * \~english @details The thread local region of the thread is kept by its
+ * process, for the next thread it makes.
+ * \~english @return The process of the thread if it has no threads left,
+ * and should be freed too, or nullptr otherwise.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Process *pantheon::GlobalScheduler::ReapThread(pantheon::Thread *T)
+{
+	pantheon::Process *Proc = T->MyProc();
+	BOOL LastThread = FALSE;
+	{
+		pantheon::ScopedLock _L(Proc);
+		Proc->DetachThread(T);
+		Proc->ReleaseThreadLocalRegion(T->GetThreadLocalAreaRegister());
+		LastThread = Proc->CountAttachedThreads() == 0 && Proc->MyState() == pantheon::Process::STATE_ZOMBIE;
+	}
+	T->DestroyObject();
+	return LastThread ? Proc : nullptr;
+}
+
+/**
+ * \~english @brief Frees a process with no threads left.
+ * \~english @return TRUE if the process was freed, FALSE if some core
+ * still has its address space loaded.
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::GlobalScheduler::ReapProcess(pantheon::Process *Proc)
 {
-	UINT64 Count = 0;
-	pantheon::GlobalScheduler::Lock();
-	for (const pantheon::Thread &T : GlobalScheduler::ThreadList)
 	{
-		if (T.MyProc()->ProcessID() == PID)
+		pantheon::ScopedLock _L(Proc);
+		if (Proc->AddressSpaceLoaded())
 		{
-			Count++;
+			return FALSE;
 		}
 	}
-	pantheon::GlobalScheduler::Unlock();
-	return Count;
+
+	GlobalScheduler::Processes.Remove(Proc->ProcessID());
+	{
+		pantheon::ScopedLock _L(Proc);
+		Proc->Teardown();
+	}
+	Proc->DestroyObject();
+	return TRUE;
 }
 
+/* PID 0 is the idle process. A PID's slot is also where it goes in the process table. */
+static pantheon::IDAllocator<pantheon::ProcessTable::NumSlots> ProcessIDs(1);
+static pantheon::IDAllocator<1024> ThreadIDs;
+
+/**
+ * \~english @brief Takes a process ID nobody else has.
+ * \~english @details Freed IDs are reused, but with a different generation
+ * in the upper bits, so a stale PID never finds the new process.
+ * \~english @author Brian Schnepp
+ */
 UINT32 pantheon::AcquireProcessID()
 {
-	/* TODO: When we run out of IDs, go back and ensure we don't
-	 * reuse an ID already in use!
-	 * 
-	 * 0 should be reserved for the generic idle process.
-	 */
-	UINT32 RetVal = 0;
-	static UINT32 ProcessID = 1;
-	RetVal = ProcessID++;
-	return RetVal;
+	UINT32 PID = ProcessIDs.Acquire();
+	if (PID == ProcessIDs.Invalid)
+	{
+		StopError("Out of process IDs");
+	}
+	return PID;
+}
+
+/**
+ * \~english @brief Gives back the ID of a process which no longer exists.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::ReleaseProcessID(UINT32 PID)
+{
+	if (ProcessIDs.Release(PID) == FALSE)
+	{
+		StopErrorFmt("Released stale process ID 0x%x\n", PID);
+	}
 }
 
+/**
+ * \~english @brief Takes a thread ID nobody else has.
+ * \~english @see AcquireProcessID
+ * \~english @author Brian Schnepp
+ */
 UINT64 pantheon::AcquireThreadID()
 {
-	/* TODO: When we run out of IDs, go back and ensure we don't
-	 * reuse an ID already in use!
-	 */
-	UINT32 RetVal = 0;
-	static UINT64 ThreadID = 0;
-	/* A copy has to be made since we haven't unlocked the spinlock yet. */
-	RetVal = ThreadID++;
-	return RetVal;
+	UINT32 TID = ThreadIDs.Acquire();
+	if (TID == ThreadIDs.Invalid)
+	{
+		StopError("Out of thread IDs");
+	}
+	return TID;
+}
+
+/**
+ * \~english @brief Gives back the ID of a thread which no longer exists.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::ReleaseThreadID(UINT64 TID)
+{
+	if (ThreadIDs.Release(static_cast<UINT32>(TID)) == FALSE)
+	{
+		StopErrorFmt("Released stale thread ID 0x%lx\n", TID);
+	}
 }
 
 void pantheon::AttemptReschedule()
 {
 	pantheon::Scheduler *CurSched = pantheon::CPU::GetCurSched();
 	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	UINT64 Elapsed = pantheon::CPU::TimerTick();
+	CurSched->WakeSleepers();
+	CurSched->ReleaseThrottled();
+	CurSched->Balance();
 
 	if (CurThread)
 	{
 		CurThread->Lock();
-		CurThread->CountTick();
+		CurThread->CountTick(Elapsed);
 		UINT64 RemainingTicks = CurThread->TicksLeft();
 
-		if (RemainingTicks > 0 || CurThread->Preempted())
+		/* A deadline thread may need this core before the slice is up. */
+		BOOL Expired = (RemainingTicks == 0 || CurSched->ShouldPreempt());
+		if (Expired == FALSE || CurThread->Preempted())
 		{
+			/* Come back at the end of the slice, or next tick if
+			 * this thread can't be switched away from right now. */
+			CurSched->ProgramTimer(CurThread);
 			CurThread->Unlock();
 			return;
 		}
-		
-		CurThread->SetTicks(0);
 		CurThread->Unlock();
 
 
@@ -359,126 +1722,135 @@ void pantheon::AttemptReschedule()
 			StopError("Interrupts not allowed for reschedule");
 		}
 
+		/* If nothing else wants this core, check again next tick.
+		 * Switching threads reprograms the timer anyway. */
+		pantheon::CPU::ArmTick(1);
 		CurSched->Reschedule();
 	}
 }
 
-extern "C" VOID FinishThread()
+/**
+ * \~english @brief Ends the current thread, which never runs again.
+ * \~english @details The process becomes a zombie once its last thread
+ * has exited. Nothing is freed here, so this is fine to call from an
+ * interrupt handler: the thread is reaped later on, by the scheduler.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::ExitThread()
 {
-	pantheon::CPU::GetCurThread()->EnableScheduling();
-}
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	pantheon::Process *CurProc = CurThread->MyProc();
 
-BOOL pantheon::GlobalScheduler::MapPages(UINT32 PID, pantheon::vmm::VirtualAddress *VAddresses, pantheon::vmm::PhysicalAddress *PAddresses, const pantheon::vmm::PageTableEntry &PageAttributes, UINT64 NumPages)
-{
-	BOOL Success = FALSE;
-	pantheon::GlobalScheduler::Lock();
-	for (pantheon::Process &Proc : GlobalScheduler::ProcessList)
+	/* The locks can't be held across the reschedule: this thread never comes back. */
+	CurProc->Lock();
+	CurThread->Lock();
+	CurThread->SetState(pantheon::Thread::STATE_TERMINATED);
+	if (CurThread->IsDeadline())
 	{
-		if (Proc.ProcessID() == PID)
-		{
-			pantheon::ScopedLock L(&Proc);
-			for (UINT64 Index = 0; Index < NumPages; ++Index)
-			{
-				Proc.MapAddress(VAddresses[Index], PAddresses[Index], PageAttributes);
-			}
-			Success = TRUE;
-			break;
-		}
+		CurThread->DeadlineHome()->ReleaseDeadline(CurThread);
+	}
+	CurThread->Unlock();
+
+	if (CurProc->ThreadExited() == 0)
+	{
+		CurProc->SetState(pantheon::Process::STATE_ZOMBIE);
 	}
-	pantheon::GlobalScheduler::Unlock();
-	return Success;
+	CurProc->Unlock();
+	pantheon::CPU::GetCurSched()->Reschedule();
 }
 
-BOOL pantheon::GlobalScheduler::RunProcess(UINT32 PID)
+extern "C" VOID FinishThread()
 {
-	BOOL Success = FALSE;
-	pantheon::vmm::VirtualAddress Entry = 0x00;
-	pantheon::GlobalScheduler::Lock();
-	for (pantheon::Process &Proc : GlobalScheduler::ProcessList)
+	pantheon::CPU::GetCurSched()->FinishSwitch();
+	pantheon::CPU::GetCurThread()->EnableScheduling();
+}
+
+/**
+ * \~english @brief Maps pages into a process, which owns them from then on.
+ * \~english @details The pages are freed along with the process, so they
+ * must not be shared with anything else.
+ * \~english @return FALSE if there is no such process, or no memory left to
+ * keep track of the pages in.
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::GlobalScheduler::MapPages(UINT32 PID, pantheon::vmm::VirtualAddress *VAddresses, pantheon::vmm::PhysicalAddress *PAddresses, const pantheon::vmm::PageTableEntry &PageAttributes, UINT64 NumPages)
+{
+	/* Mapping can sleep on the address space lock, so this can't stay in
+	 * a read section. A process is only freed after its last thread exits,
+	 * so one which is still being loaded stays put after the lookup. */
+	pantheon::Process *Proc = nullptr;
 	{
-		if (Proc.ProcessID() == PID)
-		{
-			Proc.Lock();
-			Proc.SetState(pantheon::Process::STATE_RUNNING);
-			Entry = Proc.GetEntryPoint();
-			Success = TRUE;
-			Proc.Unlock();
-			break;
-		}
+		pantheon::rcu::ScopedReadSection _R;
+		Proc = GlobalScheduler::Processes.Lookup(PID);
 	}
-	pantheon::GlobalScheduler::Unlock();
 
-	if (Success)
+	if (Proc == nullptr)
 	{
-		pantheon::GlobalScheduler::CreateUserThread(PID, (void*)(Entry), nullptr);
+		return FALSE;
 	}
-	return Success;	
-}
 
-BOOL pantheon::GlobalScheduler::SetState(UINT32 PID, pantheon::Process::State State)
-{
-	BOOL Success = FALSE;
-	pantheon::GlobalScheduler::Lock();
-	for (pantheon::Process &Proc : GlobalScheduler::ProcessList)
+	/* Loading a program can map a lot of pages: don't keep interrupts
+	 * off for all of them at once. */
+	pantheon::ScopedMutex M(Proc->AddressSpaceLock());
+	for (UINT64 Index = 0; Index < NumPages; ++Index)
 	{
-		if (Proc.ProcessID() == PID)
+		pantheon::ScopedLock L(Proc);
+		if (Proc->KeepImagePage(PAddresses[Index]) == FALSE)
 		{
-			Proc.Lock();
-			Proc.SetState(State);
-			Success = TRUE;
-			Proc.Unlock();
-			break;
+			return FALSE;
 		}
+		Proc->MapAddress(VAddresses[Index], PAddresses[Index], PageAttributes);
 	}
-	pantheon::GlobalScheduler::Unlock();
-	return Success;	
+	return TRUE;
 }
 
-void pantheon::GlobalScheduler::AppendIntoReadyList(pantheon::Thread *Next)
+BOOL pantheon::GlobalScheduler::RunProcess(UINT32 PID)
 {
-	/* Make sure we're locked before doing this... */
-	if (GlobalScheduler::AccessSpinlock.IsLocked() == FALSE)
+	pantheon::rcu::ScopedReadSection _R;
+	pantheon::Process *Proc = GlobalScheduler::Processes.Lookup(PID);
+	if (Proc == nullptr)
 	{
-		StopError("Appending into readylist while not locked");
+		return FALSE;
 	}
 
-	/* If this thread is null for whatever reason, don't bother. */
-	if (Next == nullptr)
-	{
-		return;
-	}
+	pantheon::vmm::VirtualAddress Entry = 0x00;
+	Proc->Lock();
+	Proc->SetState(pantheon::Process::STATE_RUNNING);
+	Entry = Proc->GetEntryPoint();
+	Proc->Unlock();
 
-	if (GlobalScheduler::ReadyTail)
-	{
-		GlobalScheduler::ReadyTail->SetNext(Next);
-		GlobalScheduler::ReadyTail = Next;
-	}
-	else
-	{
-		/* Only possible if the queue really is empty. */
-		GlobalScheduler::ReadyTail = Next;
-		GlobalScheduler::ReadyHead = Next;
-	}
-	GlobalScheduler::ReadyTail->SetNext(nullptr);
+	pantheon::GlobalScheduler::CreateUserThread(Proc, (void*)(Entry), nullptr);
+	return TRUE;
 }
 
-pantheon::Thread *pantheon::GlobalScheduler::PopFromReadyList()
+BOOL pantheon::GlobalScheduler::SetState(UINT32 PID, pantheon::Process::State State)
 {
-	/* Make sure we're locked before doing this... */
-	if (GlobalScheduler::AccessSpinlock.IsLocked() == FALSE)
+	pantheon::rcu::ScopedReadSection _R;
+	pantheon::Process *Proc = GlobalScheduler::Processes.Lookup(PID);
+	if (Proc == nullptr)
 	{
-		StopError("Poping from readylist while not locked");
+		return FALSE;
 	}
 
-	pantheon::Thread *Head = GlobalScheduler::ReadyHead;
-	if (Head)
-	{
-		GlobalScheduler::ReadyHead = GlobalScheduler::ReadyHead->Next();
-	}
+	pantheon::ScopedLock L(Proc);
+	Proc->SetState(State);
+	return TRUE;
+}
 
-	if (GlobalScheduler::ReadyHead == nullptr)
+/**
+ * \~english @brief Hands a newly created thread to some core to run.
+ * \~english @details Threads are only placed onto a core here: from then on,
+ * they belong to that core's run queue until some other core steals them,
+ * or takes them to even out the load.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::GlobalScheduler::QueueThread(pantheon::Thread *T)
+{
+	pantheon::ScopedLock _L(T);
+	pantheon::Scheduler *Sched = pantheon::Scheduler::PickScheduler(T->AffinityMask());
+	if (Sched == nullptr)
 	{
-		GlobalScheduler::ReadyTail = nullptr;
+		StopError("No scheduler available for new thread");
 	}
-	return Head;
-}
\ No newline at end of file
+	Sched->Enqueue(T);
+}
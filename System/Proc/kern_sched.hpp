@@ -5,7 +5,10 @@
 #include <kern_container.hpp>
 
 #include <Sync/kern_atomic.hpp>
+#include <Sync/kern_lockable.hpp>
 #include <System/Proc/kern_proc.hpp>
+#include <System/Proc/kern_proctable.hpp>
+#include <System/Proc/kern_waitqueue.hpp>
 
 #include <Common/Structures/kern_slab.hpp>
 #include <Common/Structures/kern_linkedlist.hpp>
@@ -16,21 +19,120 @@
 namespace pantheon
 {
 
-class Scheduler
+class Scheduler : public pantheon::Lockable
 {
 
 public:
 	Scheduler();
-	~Scheduler();
+	explicit Scheduler(UINT8 CoreNo);
+	~Scheduler() override;
 
 	void Reschedule();
+	VOID HandOff(pantheon::Thread *Next, UINT64 Token, INT64 Reason);
 	Process *MyProc();
 	Thread *MyThread();
 
+	VOID Enqueue(pantheon::Thread *Next);
+	[[nodiscard]] UINT64 CountReady() const;
+
+	VOID AddSleeper(pantheon::WaitNode *Node);
+	VOID RemoveSleeper(pantheon::WaitNode *Node);
+	VOID WakeSleepers();
+	VOID ProgramTimer(pantheon::Thread *Next);
+
+	BOOL AdmitDeadline(pantheon::Thread *T, UINT64 Runtime, UINT64 Period, UINT64 Deadline);
+	VOID ReleaseDeadline(pantheon::Thread *T);
+	VOID ReleaseThrottled();
+	[[nodiscard]] BOOL ShouldPreempt();
+	[[nodiscard]] UINT64 DeadlineLoad() const;
+
+	VOID Balance();
+	VOID FinishSwitch();
+	BOOL Reap();
+	[[nodiscard]] UINT8 CoreNumber() const;
+	[[nodiscard]] UINT64 Load() const;
+	[[nodiscard]] UINT64 Utilization() const;
+
+	static pantheon::Scheduler *PickScheduler(UINT64 Mask = pantheon::Thread::AnyCore);
+	static VOID Promote(pantheon::Thread *T);
+
+	/* Reservations are in parts of LoadUnit, which is one entire core. */
+	static constexpr UINT64 LoadUnit = 1ULL << 16;
+	static constexpr UINT64 MaxDeadlineLoad = (LoadUnit * 95) / 100;
+
+	/* How often each core looks at how busy the others are. */
+	static constexpr UINT64 BalanceInterval = 16;
+
+	/* How long a thread's working set is assumed to stay in cache. */
+	static constexpr UINT64 CacheHotTicks = 4;
+
 private:
 	VOID PerformCpuSwitch(pantheon::CpuContext *Old, pantheon::CpuContext *New);
+	[[nodiscard]] UINT64 NextWakeup();
+	pantheon::Thread *Dequeue();
+	VOID WakeIdleCore();
+	pantheon::Thread *Steal(UINT8 CoreNo);
+	pantheon::Thread *Migrate(UINT8 CoreNo);
+	pantheon::Thread *Detach(UINT8 CoreNo, BOOL TakeHot);
+	static pantheon::Thread *StealFromOthers(UINT8 CoreNo);
+
+	VOID AccountSwitch(pantheon::Thread *Old, UINT64 Now);
+	VOID SampleLoad(UINT64 Now);
+
+	VOID EnqueueDeadline(pantheon::Thread *Next);
+	VOID PushDeadline(pantheon::Thread *Next);
+	VOID PushThrottled(pantheon::Thread *Next);
+	VOID ReleaseThrottledLocked(UINT64 Now);
+
+	VOID PushLevel(UINT8 Level, pantheon::Thread *Next);
+	pantheon::Thread *PopLevel(UINT8 Level);
+	VOID UnlinkLevel(UINT8 Level, pantheon::Thread *Prev, pantheon::Thread *Cur);
+	[[nodiscard]] UINT8 HighestLevel() const;
+
+	VOID PushZombie(pantheon::Process *Proc);
+
+	UINT8 CoreNo;
 	Thread *CurThread;
 	Thread *IdleThread;
+
+	/* The thread this core is in the middle of switching away from. */
+	Thread *SwitchedFrom;
+
+	Thread *ReadyHead[pantheon::Thread::PRIORITY_MAX];
+	Thread *ReadyTail[pantheon::Thread::PRIORITY_MAX];
+	UINT32 ReadyMask;
+	Thread *LastQueued;
+
+	UINT64 Picks;
+	pantheon::Atomic<UINT64> ReadyCount;
+
+	/* Deadline threads which can run, earliest deadline first. */
+	Thread *DeadlineHead;
+
+	/* Deadline threads out of budget, soonest next period first. */
+	Thread *ThrottledHead;
+
+	UINT64 ReservedLoad;
+
+	/* Threads with a timeout, soonest first. */
+	pantheon::Atomic<pantheon::WaitNode*> Sleepers;
+
+	/* Threads which exited here, and processes which couldn't be freed yet. */
+	pantheon::Atomic<pantheon::Thread*> DeadThreads;
+	pantheon::Atomic<pantheon::Process*> Zombies;
+	static constexpr UINT64 MaxWakeBatch = 16;
+
+	static constexpr UINT64 AgingInterval = 8;
+
+	/* Only ever touched by the core which owns this scheduler. */
+	UINT64 BusyTicks;
+	UINT64 BusySince;
+	UINT64 WindowStart;
+	UINT64 NextBalance;
+
+	/* Published for the other cores, in parts of LoadUnit. */
+	pantheon::Atomic<UINT64> LoadAvg;
+	pantheon::Atomic<UINT64> Utilized;
 };
 
 class GlobalScheduler
@@ -44,15 +146,16 @@ public:
 	static pantheon::Thread *CreateUserThread(UINT32 PID, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority = pantheon::Thread::PRIORITY_NORMAL);
 	static pantheon::Thread *CreateUserThread(pantheon::Process *Proc, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority = pantheon::Thread::PRIORITY_NORMAL);
 
-	static UINT64 CountThreads(UINT64 PID);
+	static UINT64 CountThreads(UINT32 PID);
+	static BOOL ProcessAlive(UINT32 PID);
 	static pantheon::Thread *CreateProcessorIdleThread();
 
 	static BOOL RunProcess(UINT32 PID);
 	static BOOL SetState(UINT32 PID, pantheon::Process::State State);
 	static BOOL MapPages(UINT32 PID, pantheon::vmm::VirtualAddress *VAddresses, pantheon::vmm::PhysicalAddress *PAddresses, const pantheon::vmm::PageTableEntry &PageAttributes, UINT64 NumPages);
 
-	static void AppendIntoReadyList(pantheon::Thread *Next);
-	static pantheon::Thread *PopFromReadyList();
+	static pantheon::Process *ReapThread(pantheon::Thread *T);
+	static BOOL ReapProcess(pantheon::Process *Proc);
 
 	/* TODO: Inherit from Lockable... */
 	static void Lock();
@@ -60,15 +163,12 @@ public:
 
 private:
 	static Atomic<BOOL> Okay;
-	static Spinlock AccessSpinlock;
-
-	static LinkedList<Process> ProcessList;
-	static LinkedList<Thread> ThreadList;
+	static QueuedSpinlock AccessSpinlock;
 
-	static Thread *ReadyHead;
-	static Thread *ReadyTail;	
+	static ProcessTable Processes;
 
 private:
+	static void QueueThread(pantheon::Thread *T);
 	static Thread *CreateUserThreadCommon(pantheon::Process *Proc, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority);
 };
 
@@ -88,8 +188,11 @@ public:
 
 UINT32 AcquireProcessID();
 UINT64 AcquireThreadID();
+VOID ReleaseProcessID(UINT32 PID);
+VOID ReleaseThreadID(UINT64 TID);
 
 void AttemptReschedule();
+VOID ExitThread();
 
 }
 
@@ -28,6 +28,26 @@ pantheon::Thread::Thread() : pantheon::Lockable("Thread")
 	this->KernelStackSpace = nullptr;
 	this->UserStackSpace = nullptr;
 	this->TID = 0;
+	this->LocalRegion = 0;
+	this->LocalArea = nullptr;
+	this->ProcNext = nullptr;
+	this->ProcPrev = nullptr;
+	this->CoreNo = 0;
+	this->LastRun = 0;
+	this->Affinity = pantheon::Thread::AnyCore;
+	this->Switching = FALSE;
+	this->FPUCoreNo = pantheon::Thread::NoCore;
+	this->WaitToken = 0;
+	this->WakeIndex = pantheon::Thread::WakeNone;
+	this->ExitPending = FALSE;
+	this->Inherited = pantheon::Thread::PRIORITY_VERYLOW;
+	this->WaitingOn = nullptr;
+	this->Held = nullptr;
+	this->DlRuntime = 0;
+	this->DlPeriod = 0;
+	this->DlDeadline = 0;
+	this->DlStart = 0;
+	this->DlHome = nullptr;
 	this->Unlock();
 }
 
@@ -57,6 +77,26 @@ pantheon::Thread::Thread(Process *OwningProcess, Priority Pri) : pantheon::Locka
 	this->CurPriority = Pri;
 	this->KernelStackSpace = nullptr;
 	this->UserStackSpace = nullptr;
+	this->LocalRegion = 0;
+	this->LocalArea = nullptr;
+	this->ProcNext = nullptr;
+	this->ProcPrev = nullptr;
+	this->CoreNo = 0;
+	this->LastRun = 0;
+	this->Affinity = pantheon::Thread::AnyCore;
+	this->Switching = FALSE;
+	this->FPUCoreNo = pantheon::Thread::NoCore;
+	this->WaitToken = 0;
+	this->WakeIndex = pantheon::Thread::WakeNone;
+	this->ExitPending = FALSE;
+	this->Inherited = pantheon::Thread::PRIORITY_VERYLOW;
+	this->WaitingOn = nullptr;
+	this->Held = nullptr;
+	this->DlRuntime = 0;
+	this->DlPeriod = 0;
+	this->DlDeadline = 0;
+	this->DlStart = 0;
+	this->DlHome = nullptr;
 
 	this->PreemptCount = 1;
 	this->RemainingTicks = 0;
@@ -77,6 +117,9 @@ pantheon::Thread::Thread(const pantheon::Thread &Other) : pantheon::Thread()
 	this->ParentProcess = Other.ParentProcess;
 	this->PreemptCount = Other.PreemptCount;
 	this->CurPriority = Other.CurPriority;
+	this->Inherited = Other.Inherited;
+	this->WaitingOn = Other.WaitingOn;
+	this->Held = Other.Held;
 	this->Registers = Other.Registers;
 	this->RemainingTicks = Other.RemainingTicks;
 	this->CurState = Other.CurState;
@@ -84,15 +127,43 @@ pantheon::Thread::Thread(const pantheon::Thread &Other) : pantheon::Thread()
 	this->KernelStackSpace = Other.KernelStackSpace;
 	this->UserStackSpace = Other.UserStackSpace;
 	this->LocalRegion = Other.LocalRegion;
+	this->LocalArea = Other.LocalArea;
+	this->DlRuntime = Other.DlRuntime;
+	this->DlPeriod = Other.DlPeriod;
+	this->DlDeadline = Other.DlDeadline;
+	this->DlStart = Other.DlStart;
+	this->DlHome = Other.DlHome;
+	this->Affinity = Other.Affinity;
 	this->Unlock();
 }
 
 pantheon::Thread::Thread(pantheon::Thread &&Other) noexcept : pantheon::Lockable("Thread")
 {
 	this->Lock();
+	this->ProcNext = nullptr;
+	this->ProcPrev = nullptr;
+	this->CoreNo = 0;
+	this->LastRun = 0;
+	this->Affinity = pantheon::Thread::AnyCore;
+	this->Switching = FALSE;
+	this->FPUCoreNo = pantheon::Thread::NoCore;
+	this->WaitToken = 0;
+	this->WakeIndex = pantheon::Thread::WakeNone;
+	this->ExitPending = FALSE;
+	this->Inherited = pantheon::Thread::PRIORITY_VERYLOW;
+	this->WaitingOn = nullptr;
+	this->Held = nullptr;
+	this->DlRuntime = 0;
+	this->DlPeriod = 0;
+	this->DlDeadline = 0;
+	this->DlStart = 0;
+	this->DlHome = nullptr;
 	this->ParentProcess = Other.ParentProcess;
 	this->PreemptCount = Other.PreemptCount;
 	this->CurPriority = Other.CurPriority;
+	this->Inherited = Other.Inherited;
+	this->WaitingOn = Other.WaitingOn;
+	this->Held = Other.Held;
 	this->Registers = Other.Registers;
 	this->RemainingTicks = Other.RemainingTicks;
 	this->CurState = Other.CurState;
@@ -100,6 +171,13 @@ pantheon::Thread::Thread(pantheon::Thread &&Other) noexcept : pantheon::Lockable
 	this->KernelStackSpace = Other.KernelStackSpace;
 	this->UserStackSpace = Other.UserStackSpace;
 	this->LocalRegion = Other.LocalRegion;
+	this->LocalArea = Other.LocalArea;
+	this->DlRuntime = Other.DlRuntime;
+	this->DlPeriod = Other.DlPeriod;
+	this->DlDeadline = Other.DlDeadline;
+	this->DlStart = Other.DlStart;
+	this->DlHome = Other.DlHome;
+	this->Affinity = Other.Affinity;
 	this->Unlock();
 }
 
@@ -158,6 +236,27 @@ pantheon::Thread::Priority pantheon::Thread::MyPriority() const
 	{
 		StopError("MyPriority without lock");
 	}
+
+	/* Running as whoever is being held up by this thread. */
+	if (this->Inherited > this->CurPriority)
+	{
+		return this->Inherited;
+	}
+	return this->CurPriority;
+}
+
+/**
+ * \~english @brief Gets the priority of this thread, without anything
+ * inherited through a mutex.
+ * \~english @author Brian Schnepp
+ */
+pantheon::Thread::Priority pantheon::Thread::BasePriority() const
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("BasePriority without lock");
+	}
 	return this->CurPriority;
 }
 
@@ -188,9 +287,12 @@ UINT64 pantheon::Thread::TicksLeft() const
 
 /**
  * \~english @brief Counts down the number of timer interrupts for this thread
+ * \~english @details Without a periodic tick, one interrupt may stand in
+ * for several ticks: all of them are charged at once.
+ * \~english @param TickCount The number of ticks which passed
  * \~english @author Brian Schnepp
  */
-VOID pantheon::Thread::CountTick()
+VOID pantheon::Thread::CountTick(UINT64 TickCount)
 {
 	OBJECT_SELF_ASSERT();
 	if (this->IsLocked() == FALSE)
@@ -198,11 +300,13 @@ VOID pantheon::Thread::CountTick()
 		StopError("CountTicks without lock");
 	}
 
-	if (this->RemainingTicks == 0)
+	UINT64 Remaining = this->RemainingTicks.Load();
+	if (TickCount >= Remaining)
 	{
+		this->RemainingTicks.Store(0);
 		return;
 	}
-	this->RemainingTicks.Store(this->RemainingTicks.Load() - 1);
+	this->RemainingTicks.Store(Remaining - TickCount);
 }
 
 [[nodiscard]]
@@ -212,6 +316,17 @@ UINT64 pantheon::Thread::ThreadID() const
 	return this->TID;
 }
 
+/**
+ * \~english @brief Frees a thread which nothing refers to anymore.
+ * \~english @details Its thread ID can be handed out again afterwards.
+ * \~english @author Brian Schnepp
+ */
+void pantheon::Thread::DestroyObject()
+{
+	pantheon::ReleaseThreadID(this->TID);
+	pantheon::Thread::Destroy(this);
+}
+
 /**
  * \~english @brief Forcefully adds execution time to the current process.
  * \~english @author Brian Schnepp
@@ -223,7 +338,7 @@ VOID pantheon::Thread::AddTicks(UINT64 TickCount)
 	{
 		StopError("AddTicks without lock");
 	}
-	this->RemainingTicks.Store(this->RemainingTicks.Load() + TickCount);
+	this->RemainingTicks.FetchAdd(TickCount);
 }
 
 VOID pantheon::Thread::RefreshTicks()
@@ -233,6 +348,12 @@ VOID pantheon::Thread::RefreshTicks()
 	{
 		StopError("RefreshTicks without lock");
 	}
+
+	/* Budgets are only refilled at the start of each period. */
+	if (this->IsDeadline())
+	{
+		return;
+	}
 	this->RemainingTicks = static_cast<UINT64>((this->CurPriority + 1)) * 3;
 }
 
@@ -281,6 +402,26 @@ VOID pantheon::Thread::SetPriority(Thread::Priority Pri)
 	}
 }
 
+/**
+ * \~english @brief Lends this thread the priority of some thread waiting
+ * on it, or takes it back.
+ * \~english @details Unlike SetPriority, this may raise the priority of
+ * the thread, but only ever up to the priority of a thread it's holding
+ * up. The thread runs at whichever of the two is higher. The thread
+ * must be locked.
+ * \~english @param Pri The priority to lend, or PRIORITY_VERYLOW to lend nothing
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Thread::InheritPriority(Thread::Priority Pri)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("InheritPriority without lock");
+	}
+	this->Inherited = Pri;
+}
+
 /**
  * \~english @brief Obtains a reference to the registers of the thread.
  * \~english @author Brian Schnepp
@@ -309,6 +450,9 @@ pantheon::Thread &pantheon::Thread::operator=(const pantheon::Thread &Other)
 	this->ParentProcess = Other.ParentProcess;
 	this->PreemptCount = Other.PreemptCount;
 	this->CurPriority = Other.CurPriority;
+	this->Inherited = Other.Inherited;
+	this->WaitingOn = Other.WaitingOn;
+	this->Held = Other.Held;
 	this->Registers = Other.Registers;
 	this->RemainingTicks = Other.RemainingTicks;
 	this->CurState = Other.CurState;
@@ -317,6 +461,14 @@ pantheon::Thread &pantheon::Thread::operator=(const pantheon::Thread &Other)
 	/* Is this right? */
 	this->KernelStackSpace = Other.KernelStackSpace;
 	this->UserStackSpace = Other.UserStackSpace;
+	this->LocalRegion = Other.LocalRegion;
+	this->LocalArea = Other.LocalArea;
+	this->DlRuntime = Other.DlRuntime;
+	this->DlPeriod = Other.DlPeriod;
+	this->DlDeadline = Other.DlDeadline;
+	this->DlStart = Other.DlStart;
+	this->DlHome = Other.DlHome;
+	this->Affinity = Other.Affinity;
 	return *this;
 }
 
@@ -331,12 +483,23 @@ pantheon::Thread &pantheon::Thread::operator=(pantheon::Thread &&Other) noexcept
 	this->ParentProcess = Other.ParentProcess;
 	this->PreemptCount = Other.PreemptCount;
 	this->CurPriority = Other.CurPriority;
+	this->Inherited = Other.Inherited;
+	this->WaitingOn = Other.WaitingOn;
+	this->Held = Other.Held;
 	this->Registers = Other.Registers;
 	this->RemainingTicks = Other.RemainingTicks;
 	this->CurState = Other.CurState;
 	this->TID = Other.TID;
 	this->KernelStackSpace = Other.KernelStackSpace;
 	this->UserStackSpace = Other.UserStackSpace;
+	this->LocalRegion = Other.LocalRegion;
+	this->LocalArea = Other.LocalArea;
+	this->DlRuntime = Other.DlRuntime;
+	this->DlPeriod = Other.DlPeriod;
+	this->DlDeadline = Other.DlDeadline;
+	this->DlStart = Other.DlStart;
+	this->DlHome = Other.DlHome;
+	this->Affinity = Other.Affinity;
 	return *this;
 }
 
@@ -377,18 +540,14 @@ void pantheon::Thread::SetProc(pantheon::Process *Proc)
 void pantheon::Thread::BlockScheduling()
 {
 	OBJECT_SELF_ASSERT();
-	pantheon::Sync::DSBISH();
-	this->PreemptCount.Store(this->PreemptCount.Load() + 1);
-	pantheon::Sync::DSBISH();
+	this->PreemptCount.FetchAdd(1, pantheon::MemoryOrder::AcqRel);
 }
 
 void pantheon::Thread::EnableScheduling()
 {
 	OBJECT_SELF_ASSERT();
 	this->Lock();
-	pantheon::Sync::DSBISH();
-	this->PreemptCount.Store(this->PreemptCount.Load() - 1);
-	pantheon::Sync::DSBISH();
+	this->PreemptCount.FetchSub(1, pantheon::MemoryOrder::AcqRel);
 	this->Unlock();
 }
 
@@ -414,6 +573,10 @@ void pantheon::Thread::Initialize(pantheon::Process *Proc, void *StartAddr, void
 		this->ParentProcess = Proc;
 		this->Lock();
 
+		/* The stack is freed along with the thread. */
+		this->KernelStackSpace = StackSpace();
+		this->TID = pantheon::AcquireThreadID();
+
 		UINT64 IStartAddr = (UINT64)true_drop_process;
 		UINT64 IThreadData = (UINT64)ThreadData;
 
@@ -424,7 +587,20 @@ void pantheon::Thread::Initialize(pantheon::Process *Proc, void *StartAddr, void
 			Regs->SetInitUserContext(pantheon::Process::StackAddr, (UINT64)StartAddr);
 		}
 		this->SetState(pantheon::Thread::STATE_WAITING);
-		this->SetPriority(Priority);
+
+		/* SetPriority only ever lowers it: this is the initial value. */
+		this->CurPriority = Priority;
+		this->Inherited = pantheon::Thread::PRIORITY_VERYLOW;
+		this->WaitingOn = nullptr;
+		this->Held = nullptr;
+		this->RefreshTicks();
+
+		/* Threads can start anywhere, and haven't run anywhere yet. */
+		this->Affinity = pantheon::Thread::AnyCore;
+		this->LastRun = 0;
+		this->Switching = FALSE;
+		this->FPUCoreNo = pantheon::Thread::NoCore;
+		this->ExitPending = FALSE;
 		this->Unlock();
 	}
 }
@@ -444,11 +620,412 @@ void pantheon::Thread::SetNext(pantheon::Thread *Item)
 	this->NextThread = Item;
 }
 
+[[nodiscard]] pantheon::Thread *pantheon::Thread::NextInProcess() const
+{
+	return this->ProcNext;
+}
+
+[[nodiscard]] pantheon::Thread *pantheon::Thread::PrevInProcess() const
+{
+	return this->ProcPrev;
+}
+
+void pantheon::Thread::SetNextInProcess(pantheon::Thread *Item)
+{
+	this->ProcNext = Item;
+}
+
+void pantheon::Thread::SetPrevInProcess(pantheon::Thread *Item)
+{
+	this->ProcPrev = Item;
+}
+
+/**
+ * \~english @brief Gets the message buffer of this thread, as the kernel sees it.
+ * \~english @details This doesn't need the owning process to be locked,
+ * so messages can be copied between threads of different processes.
+ * \~english @return The thread local region, or nullptr if there is none.
+ * \~english @author Brian Schnepp
+ */
 pantheon::Thread::ThreadLocalRegion *pantheon::Thread::GetThreadLocalArea() 
 {
-	/* Assume Proc is locked */
-	pantheon::Process *Proc = this->ParentProcess;
-	pantheon::vmm::PhysicalAddress PhyAddr = pantheon::vmm::VirtualToPhysicalAddress(Proc->GetPageTable(), this->LocalRegion);
-	pantheon::vmm::VirtualAddress VirtAddr = pantheon::vmm::PhysicalToVirtualAddress(PhyAddr);
-	return reinterpret_cast<ThreadLocalRegion*>(VirtAddr);
-}
\ No newline at end of file
+	OBJECT_SELF_ASSERT();
+	return this->LocalArea;
+}
+
+/**
+ * \~english @brief Gives this thread a message buffer.
+ * \~english @param Addr Where the buffer is in the owning process
+ * \~english @param Area Where the same buffer is in kernel memory
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Thread::SetLocalRegion(pantheon::vmm::VirtualAddress Addr, ThreadLocalRegion *Area)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("SetLocalRegion without lock");
+	}
+	this->LocalRegion = Addr;
+	this->LocalArea = Area;
+}
+
+/**
+ * \~english @brief Gets the core this thread last ran on.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT8 pantheon::Thread::LastCore() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->CoreNo;
+}
+
+VOID pantheon::Thread::SetLastCore(UINT8 CoreNo)
+{
+	OBJECT_SELF_ASSERT();
+	this->CoreNo = CoreNo;
+}
+
+/**
+ * \~english @brief Gets the tick this thread was last switched away at.
+ * \~english @details This is how the scheduler guesses if the cache of
+ * the core it last ran on still holds much of its working set.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT64 pantheon::Thread::LastRan() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->LastRun;
+}
+
+VOID pantheon::Thread::SetLastRan(UINT64 Tick)
+{
+	OBJECT_SELF_ASSERT();
+	this->LastRun = Tick;
+}
+
+/**
+ * \~english @brief Checks if some core is still running this thread.
+ * \~english @details A core may have already picked some other thread to
+ * run, but still be saving this one's registers. Until that's done, no
+ * other core can be allowed to switch to this thread.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] BOOL pantheon::Thread::OnCore() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Switching.Load();
+}
+
+VOID pantheon::Thread::SetOnCore(BOOL Running)
+{
+	OBJECT_SELF_ASSERT();
+	this->Switching.Store(Running);
+}
+
+/**
+ * \~english @brief Gets the core this thread's FP/SIMD registers were
+ * last loaded on, or NoCore if they never were.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT8 pantheon::Thread::LastFPUCore() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->FPUCoreNo;
+}
+
+VOID pantheon::Thread::SetFPUCore(UINT8 CoreNo)
+{
+	OBJECT_SELF_ASSERT();
+	this->FPUCoreNo = CoreNo;
+}
+
+/**
+ * \~english @brief Gets the set of cores this thread is allowed to run on.
+ * \~english @return A mask with bit N set if core N is allowed
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT64 pantheon::Thread::AffinityMask() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Affinity;
+}
+
+[[nodiscard]] BOOL pantheon::Thread::CanRunOn(UINT8 CoreNo) const
+{
+	OBJECT_SELF_ASSERT();
+	return (this->Affinity & (1ULL << CoreNo)) != 0;
+}
+
+/**
+ * \~english @brief Restricts which cores this thread can run on.
+ * \~english @details This takes effect the next time the thread is
+ * queued: a thread running on some core it's no longer allowed on keeps
+ * running there until it's switched away from. The thread must be locked.
+ * \~english @param Mask A mask with bit N set if core N is allowed
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Thread::SetAffinity(UINT64 Mask)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("SetAffinity without lock");
+	}
+	this->Affinity = Mask;
+}
+
+/**
+ * \~english @brief Checks if this thread is scheduled by deadline,
+ * rather than by priority.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] BOOL pantheon::Thread::IsDeadline() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlRuntime != 0;
+}
+
+/**
+ * \~english @brief Gets the scheduler holding this thread's reservation.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] pantheon::Scheduler *pantheon::Thread::DeadlineHome() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlHome;
+}
+
+[[nodiscard]] UINT64 pantheon::Thread::DeadlineRuntime() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlRuntime;
+}
+
+[[nodiscard]] UINT64 pantheon::Thread::DeadlinePeriod() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlPeriod;
+}
+
+[[nodiscard]] UINT64 pantheon::Thread::RelativeDeadline() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlDeadline;
+}
+
+/**
+ * \~english @brief Gets the tick the current period's work is due by.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT64 pantheon::Thread::AbsoluteDeadline() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlStart + this->DlDeadline;
+}
+
+/**
+ * \~english @brief Gets the tick the next period starts at.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] UINT64 pantheon::Thread::NextRelease() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->DlStart + this->DlPeriod;
+}
+
+/**
+ * \~english @brief Moves this thread into, or out of, the deadline class.
+ * \~english @details This doesn't check whether the reservation fits:
+ * that's up to the scheduler. The thread must be locked, and must not be
+ * queued anywhere.
+ * \~english @param Runtime The ticks of work needed every period, or 0
+ * to go back to being scheduled by priority
+ * \~english @param Period How often the work comes in
+ * \~english @param Deadline How long after the start of a period the
+ * work has to be done
+ * \~english @param Home The scheduler the reservation was made on
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Thread::SetDeadlineParams(UINT64 Runtime, UINT64 Period, UINT64 Deadline, pantheon::Scheduler *Home)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("SetDeadlineParams without lock");
+	}
+
+	this->DlRuntime = Runtime;
+	this->DlPeriod = Period;
+	this->DlDeadline = Deadline;
+	this->DlStart = 0;
+	this->DlHome = Home;
+	if (Runtime == 0)
+	{
+		this->RefreshTicks();
+	}
+}
+
+/**
+ * \~english @brief Starts a new period, with a full budget.
+ * \~english @details The thread must be locked, or be throttled on a
+ * scheduler which is.
+ * \~english @param Now The tick the period starts at
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::Thread::StartPeriod(UINT64 Now)
+{
+	OBJECT_SELF_ASSERT();
+	this->DlStart = Now;
+	this->RemainingTicks = this->DlRuntime;
+}
+
+/**
+ * \~english @brief Starts a new wait, forgetting about any older ones.
+ * \~english @details Wakeups meant for some earlier wait are ignored from
+ * now on. The thread must be locked.
+ * \~english @return A token identifying this wait, to be passed to Wake.
+ * \~english @author Brian Schnepp
+ */
+UINT64 pantheon::Thread::BeginWait()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("BeginWait without lock");
+	}
+
+	this->WakeIndex = pantheon::Thread::WakeNone;
+	return ++this->WaitToken;
+}
+
+/**
+ * \~english @brief Marks this thread as blocked on its current wait.
+ * \~english @details The thread is only blocked if nothing has woken it up
+ * since BeginWait. The caller should reschedule afterwards. The thread
+ * must be locked.
+ * \~english @param Interruptible If the wait ends early when the thread
+ * is asked to exit. Waits which always end soon, like for a mutex, don't
+ * need to be.
+ * \~english @return TRUE if the thread is now blocked, FALSE if it was
+ * already woken up.
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::Thread::Block(BOOL Interruptible)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Block without lock");
+	}
+
+	/* Asked to exit before this wait started: it would never end otherwise. */
+	if (Interruptible && this->ExitPending.Load() && this->WakeIndex == pantheon::Thread::WakeNone)
+	{
+		this->WakeIndex = pantheon::Thread::WakeTimeout;
+	}
+
+	if (this->WakeIndex != pantheon::Thread::WakeNone)
+	{
+		return FALSE;
+	}
+	this->SetState(pantheon::Thread::STATE_BLOCKED);
+	return TRUE;
+}
+
+/**
+ * \~english @brief Records why this thread stopped waiting.
+ * \~english @details Only the first wakeup for the current wait counts.
+ * This doesn't make the thread runnable by itself. The thread must be
+ * locked.
+ * \~english @param Token The token returned by BeginWait for the wait
+ * \~english @param Reason Which object woke the thread, or WakeTimeout
+ * \~english @return TRUE if this was the wakeup which counted
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::Thread::Wake(UINT64 Token, INT64 Reason)
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("Wake without lock");
+	}
+
+	if (Token != this->WaitToken || this->WakeIndex != pantheon::Thread::WakeNone)
+	{
+		return FALSE;
+	}
+	this->WakeIndex = Reason;
+	return TRUE;
+}
+
+[[nodiscard]] INT64 pantheon::Thread::WakeReason() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->WakeIndex;
+}
+
+/**
+ * \~english @brief Asks this thread to end itself.
+ * \~english @details Whatever it's waiting on is given up on as if it timed
+ * out, and the thread exits next time it would go back to userspace. It's
+ * only there that it holds no locks, and that nothing on its kernel stack
+ * is linked in anywhere. The thread must be locked.
+ * \~english @return TRUE if this ended a wait, and the caller should make
+ * the thread runnable again.
+ * \~english @author Brian Schnepp
+ */
+BOOL pantheon::Thread::RequestExit()
+{
+	OBJECT_SELF_ASSERT();
+	if (this->IsLocked() == FALSE)
+	{
+		StopError("RequestExit without lock");
+	}
+
+	this->ExitPending.Store(TRUE);
+	return this->Wake(this->WaitToken, pantheon::Thread::WakeTimeout);
+}
+
+[[nodiscard]] BOOL pantheon::Thread::ExitRequested() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->ExitPending.Load();
+}
+
+/**
+ * \~english @brief Gets the mutex this thread is waiting to acquire, if any.
+ * \~english @details Priority lent to this thread is passed on to
+ * whoever holds that mutex. This is covered by the mutex chain lock,
+ * not by the lock of the thread.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] pantheon::Mutex *pantheon::Thread::BlockedOn() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->WaitingOn;
+}
+
+VOID pantheon::Thread::SetBlockedOn(pantheon::Mutex *Lock)
+{
+	OBJECT_SELF_ASSERT();
+	this->WaitingOn = Lock;
+}
+
+/**
+ * \~english @brief Gets the most recently acquired mutex this thread holds.
+ * \~english @details The rest follow from there. Only ever changed by the
+ * thread itself, or for it by whoever hands it a mutex while it sleeps.
+ * \~english @author Brian Schnepp
+ */
+[[nodiscard]] pantheon::Mutex *pantheon::Thread::HeldMutexes() const
+{
+	OBJECT_SELF_ASSERT();
+	return this->Held;
+}
+
+VOID pantheon::Thread::SetHeldMutexes(pantheon::Mutex *Lock)
+{
+	OBJECT_SELF_ASSERT();
+	this->Held = Lock;
+}
@@ -16,7 +16,9 @@
 namespace pantheon
 {
 
+class Mutex;
 class Process;
+class Scheduler;
 
 class Thread  : public pantheon::Object<Thread, 512>, public pantheon::Lockable
 {
@@ -65,6 +67,7 @@ public:
 		STATE_RUNNING,
 		STATE_WAITING,
 		STATE_TERMINATED,
+		STATE_BLOCKED,
 		STATE_MAX,
 	}State;
 
@@ -87,22 +90,25 @@ public:
 	~Thread() override;
 
 	void Initialize(pantheon::Process *Proc, void *StartAddr, void *ThreadData, pantheon::Thread::Priority Priority, BOOL UserMode);
+	void DestroyObject();
 
 	[[nodiscard]] Process *MyProc() const;
 
 	[[nodiscard]] Thread::State MyState() const;
 	[[nodiscard]] Thread::Priority MyPriority() const;
+	[[nodiscard]] Thread::Priority BasePriority() const;
 
 	[[nodiscard]] UINT64 TicksLeft() const;
 	[[nodiscard]] UINT64 ThreadID() const;
 
 	VOID AddTicks(UINT64 TickCount);
-	VOID CountTick();
+	VOID CountTick(UINT64 TickCount = 1);
 	VOID RefreshTicks();
 	VOID SetTicks(UINT64 TickCount);
 
 	VOID SetState(Thread::State State);
 	VOID SetPriority(Thread::Priority Priority);
+	VOID InheritPriority(Thread::Priority Priority);
 
 	VOID SetEntryLocation(UINT64 IP, UINT64 SP, VOID* ThreadData);
 
@@ -124,7 +130,67 @@ public:
 	Thread *Next();
 	void SetNext(pantheon::Thread *Item);
 
+	[[nodiscard]] Thread *NextInProcess() const;
+	[[nodiscard]] Thread *PrevInProcess() const;
+	void SetNextInProcess(pantheon::Thread *Item);
+	void SetPrevInProcess(pantheon::Thread *Item);
+
 	ThreadLocalRegion *GetThreadLocalArea();
+	VOID SetLocalRegion(pantheon::vmm::VirtualAddress Addr, ThreadLocalRegion *Area);
+
+	[[nodiscard]] UINT8 LastCore() const;
+	VOID SetLastCore(UINT8 CoreNo);
+
+	[[nodiscard]] UINT64 LastRan() const;
+	VOID SetLastRan(UINT64 Tick);
+
+	[[nodiscard]] BOOL OnCore() const;
+	VOID SetOnCore(BOOL Running);
+
+	[[nodiscard]] UINT8 LastFPUCore() const;
+	VOID SetFPUCore(UINT8 CoreNo);
+
+	[[nodiscard]] UINT64 AffinityMask() const;
+	[[nodiscard]] BOOL CanRunOn(UINT8 CoreNo) const;
+	VOID SetAffinity(UINT64 Mask);
+
+	[[nodiscard]] BOOL IsDeadline() const;
+	[[nodiscard]] pantheon::Scheduler *DeadlineHome() const;
+	[[nodiscard]] UINT64 DeadlineRuntime() const;
+	[[nodiscard]] UINT64 DeadlinePeriod() const;
+	[[nodiscard]] UINT64 RelativeDeadline() const;
+	[[nodiscard]] UINT64 AbsoluteDeadline() const;
+	[[nodiscard]] UINT64 NextRelease() const;
+	VOID SetDeadlineParams(UINT64 Runtime, UINT64 Period, UINT64 Deadline, pantheon::Scheduler *Home);
+	VOID StartPeriod(UINT64 Now);
+
+	UINT64 BeginWait();
+	BOOL Block(BOOL Interruptible = TRUE);
+	BOOL Wake(UINT64 Token, INT64 Reason);
+	[[nodiscard]] INT64 WakeReason() const;
+
+	BOOL RequestExit();
+	[[nodiscard]] BOOL ExitRequested() const;
+
+	[[nodiscard]] pantheon::Mutex *BlockedOn() const;
+	VOID SetBlockedOn(pantheon::Mutex *Lock);
+	[[nodiscard]] pantheon::Mutex *HeldMutexes() const;
+	VOID SetHeldMutexes(pantheon::Mutex *Lock);
+
+	/* Not woken up yet. */
+	static constexpr INT64 WakeNone = -1;
+
+	/* Woken up because the wait took too long. */
+	static constexpr INT64 WakeTimeout = -2;
+
+	/* Woken up because the object waited on went away. */
+	static constexpr INT64 WakeClosed = -3;
+
+	/* Allowed to run on every core. */
+	static constexpr UINT64 AnyCore = ~0ULL;
+
+	/* Not any particular core. */
+	static constexpr UINT8 NoCore = 0xFF;
 	
 
 private:
@@ -136,6 +202,13 @@ private:
 	Thread::State CurState;
 	Thread::Priority CurPriority;
 
+	/* Lent by the highest priority thread waiting on a mutex this one holds. */
+	Thread::Priority Inherited;
+
+	/* The mutex this thread is waiting for, and every one it holds. */
+	pantheon::Mutex *WaitingOn;
+	pantheon::Mutex *Held;
+
 	pantheon::Atomic<UINT64> PreemptCount;
 	pantheon::Atomic<UINT64> RemainingTicks;
 
@@ -143,10 +216,39 @@ private:
 	void *UserStackSpace;
 
 	pantheon::vmm::VirtualAddress LocalRegion;
+	ThreadLocalRegion *LocalArea;
 
 	static constexpr UINT64 InitialNumStackPages = 4;
 
 	pantheon::Atomic<pantheon::Thread*> NextThread;
+
+	/* Siblings in the owning process: only touched with that process locked. */
+	pantheon::Thread *ProcNext;
+	pantheon::Thread *ProcPrev;
+
+	UINT8 CoreNo;
+	UINT64 LastRun;
+	UINT64 Affinity;
+
+	/* Set from being switched to until the core is done switching away. */
+	pantheon::Atomic<BOOL> Switching;
+
+	/* The core the FP/SIMD registers were last loaded on. */
+	UINT8 FPUCoreNo;
+
+	UINT64 WaitToken;
+	INT64 WakeIndex;
+
+	/* Set once the process is exiting: the thread ends itself on its way
+	 * back to userspace. */
+	pantheon::Atomic<BOOL> ExitPending;
+
+	/* Deadline scheduling parameters, in system ticks. Zero runtime if unused. */
+	UINT64 DlRuntime;
+	UINT64 DlPeriod;
+	UINT64 DlDeadline;
+	UINT64 DlStart;
+	pantheon::Scheduler *DlHome;
 };
 
 }
@@ -0,0 +1,193 @@
+#include <kern_datatypes.hpp>
+
+#include "kern_cpu.hpp"
+#include "kern_sched.hpp"
+#include "kern_thread.hpp"
+#include "kern_waitqueue.hpp"
+
+pantheon::WaitQueue::WaitQueue() : pantheon::Lockable("Wait Queue")
+{
+	this->Head = nullptr;
+	this->Tail = nullptr;
+}
+
+pantheon::WaitQueue::~WaitQueue() = default;
+
+/**
+ * @brief Prepares a node for a thread to wait on some object with
+ * @param Node The node to set up
+ * @param Waiter The thread which is going to wait
+ * @param Token The token returned by BeginWait for this wait
+ * @param Index What to report to the thread if this object wakes it up
+ */
+VOID pantheon::InitWaitNode(WaitNode *Node, pantheon::Thread *Waiter, UINT64 Token, INT64 Index)
+{
+	Node->Waiter = Waiter;
+	Node->Token = Token;
+	Node->Index = Index;
+	Node->WakeAt = 0;
+	Node->Queued = FALSE;
+	Node->Next = nullptr;
+	Node->Prev = nullptr;
+}
+
+/**
+ * @brief Ends some wait of a thread, and makes it runnable again
+ * @param Waiter The thread to wake up
+ * @param Token The token of the wait being ended
+ * @param Reason Why the thread is being woken up
+ * @return TRUE if this ended the wait, FALSE if the wait was already over
+ */
+BOOL pantheon::WakeThread(pantheon::Thread *Waiter, UINT64 Token, INT64 Reason)
+{
+	pantheon::ScopedLock _L(Waiter);
+	if (Waiter->Wake(Token, Reason) == FALSE)
+	{
+		return FALSE;
+	}
+	pantheon::ResumeThread(Waiter);
+	return TRUE;
+}
+
+/**
+ * @brief Makes a thread whose wait just ended runnable again
+ * @details If the thread hasn't actually blocked yet, it notices the
+ * wakeup by itself when it tries to. If it blocked, but its core is
+ * still switching away from it, it just keeps running there. Otherwise,
+ * it's queued back onto the core it last ran on, since its cache is most
+ * likely still warm there. The thread must be locked.
+ * @param Waiter The thread to make runnable
+ */
+VOID pantheon::ResumeThread(pantheon::Thread *Waiter)
+{
+	if (Waiter->MyState() != pantheon::Thread::STATE_BLOCKED)
+	{
+		return;
+	}
+
+	pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Waiter->LastCore());
+	if (Sched != nullptr && Sched->MyThread() == Waiter)
+	{
+		Waiter->SetState(pantheon::Thread::STATE_RUNNING);
+		return;
+	}
+
+	if (Sched == nullptr)
+	{
+		Sched = pantheon::Scheduler::PickScheduler();
+	}
+	Waiter->SetState(pantheon::Thread::STATE_WAITING);
+	Sched->Enqueue(Waiter);
+}
+
+/**
+ * @brief Adds a waiting thread to the end of this queue
+ */
+VOID pantheon::WaitQueue::Insert(WaitNode *Node)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	Node->Next = nullptr;
+	Node->Prev = this->Tail;
+	if (this->Tail)
+	{
+		this->Tail->Next = Node;
+	}
+	else
+	{
+		this->Head = Node;
+	}
+	this->Tail = Node;
+	Node->Queued = TRUE;
+}
+
+/**
+ * @brief Removes a waiting thread from this queue
+ * @details This must be done before the node goes out of scope, whether
+ * or not the thread was woken up by this queue.
+ */
+VOID pantheon::WaitQueue::Remove(WaitNode *Node)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	if (Node->Queued == FALSE)
+	{
+		return;
+	}
+
+	if (Node->Prev)
+	{
+		Node->Prev->Next = Node->Next;
+	}
+	else
+	{
+		this->Head = Node->Next;
+	}
+
+	if (Node->Next)
+	{
+		Node->Next->Prev = Node->Prev;
+	}
+	else
+	{
+		this->Tail = Node->Prev;
+	}
+	Node->Next = nullptr;
+	Node->Prev = nullptr;
+	Node->Queued = FALSE;
+}
+
+/**
+ * @brief Takes the oldest waiting thread out of this queue
+ * @return The node of that thread, or nullptr if nobody is waiting
+ */
+pantheon::WaitNode *pantheon::WaitQueue::PopFront()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	WaitNode *Node = this->Head;
+	if (Node == nullptr)
+	{
+		return nullptr;
+	}
+
+	this->Head = Node->Next;
+	if (this->Head)
+	{
+		this->Head->Prev = nullptr;
+	}
+	else
+	{
+		this->Tail = nullptr;
+	}
+	Node->Next = nullptr;
+	Node->Prev = nullptr;
+	Node->Queued = FALSE;
+	return Node;
+}
+
+/**
+ * @brief Wakes up every thread waiting in this queue
+ * @details The object this queue belongs to must already be signaled, so
+ * that a thread about to wait sees it's signaled instead of blocking.
+ * Woken threads stay in the queue until they remove themselves.
+ * @return The number of threads which were woken up
+ */
+UINT64 pantheon::WaitQueue::WakeAll()
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::ScopedLock _L(this);
+
+	UINT64 Count = 0;
+	for (WaitNode *Node = this->Head; Node != nullptr; Node = Node->Next)
+	{
+		if (pantheon::WakeThread(Node->Waiter, Node->Token, Node->Index))
+		{
+			Count++;
+		}
+	}
+	return Count;
+}
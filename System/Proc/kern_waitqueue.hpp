@@ -0,0 +1,62 @@
+#include <kern_datatypes.hpp>
+
+#include <Common/Sync/kern_lockable.hpp>
+
+/**
+ * @file System/Proc/kern_waitqueue.hpp
+ * @brief Definitions for queues of threads blocked on some kernel object
+ */
+
+#ifndef _KERN_WAITQUEUE_HPP_
+#define _KERN_WAITQUEUE_HPP_
+
+namespace pantheon
+{
+
+class Thread;
+
+/**
+ * @brief One thread waiting on one object.
+ * @details A thread waiting on several objects at once has one of these for
+ * each of them. These live on the stack of the waiting thread, which is
+ * always the one to remove them from their queue.
+ */
+typedef struct WaitNode
+{
+	pantheon::Thread *Waiter;
+	UINT64 Token;
+	INT64 Index;
+	UINT64 WakeAt;
+	BOOL Queued;
+	struct WaitNode *Next;
+	struct WaitNode *Prev;
+}WaitNode;
+
+VOID InitWaitNode(WaitNode *Node, pantheon::Thread *Waiter, UINT64 Token, INT64 Index);
+BOOL WakeThread(pantheon::Thread *Waiter, UINT64 Token, INT64 Reason);
+VOID ResumeThread(pantheon::Thread *Waiter);
+
+/**
+ * @brief The threads waiting for some object to become signaled.
+ */
+class WaitQueue : public pantheon::Lockable
+{
+public:
+	WaitQueue();
+	~WaitQueue() override;
+
+	VOID Insert(WaitNode *Node);
+	VOID Remove(WaitNode *Node);
+	WaitNode *PopFront();
+	UINT64 WakeAll();
+
+	[[nodiscard]] BOOL IsEmpty() const { return this->Head == nullptr; }
+
+private:
+	WaitNode *Head;
+	WaitNode *Tail;
+};
+
+}
+
+#endif
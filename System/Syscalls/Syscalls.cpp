@@ -6,8 +6,12 @@
 
 #include <Proc/kern_proc.hpp>
 #include <Proc/kern_sched.hpp>
+#include <Proc/kern_futex.hpp>
 #include <Proc/kern_thread.hpp>
 
+#include <Sync/kern_rcu.hpp>
+#include <Sync/kern_lockstats.hpp>
+
 #include <IPC/kern_port.hpp>
 #include <IPC/kern_event.hpp>
 
@@ -33,8 +37,10 @@ static const CHAR *ReadArgumentAsCharPointer(UINT64 Val)
 		return nullptr;
 	}
 
+	/* Mappings are only torn down once no thread is left to be in a
+	 * syscall, so holding either lock is enough. */
 	pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
-	if (CurProc->IsLocked() == FALSE)
+	if (CurProc->IsLocked() == FALSE && CurProc->AddressSpaceLock()->IsHolding() == FALSE)
 	{
 		pantheon::StopErrorFmt("Attempt to read userspace memory without CurProc lock (PID %hhu)\n", CurProc->ProcessID());
 	}
@@ -61,8 +67,10 @@ static T *ReadArgumentAsPointer(UINT64 Val)
 		return nullptr;
 	}
 
+	/* Mappings are only torn down once no thread is left to be in a
+	 * syscall, so holding either lock is enough. */
 	pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
-	if (CurProc->IsLocked() == FALSE)
+	if (CurProc->IsLocked() == FALSE && CurProc->AddressSpaceLock()->IsHolding() == FALSE)
 	{
 		pantheon::StopErrorFmt("Attempt to read userspace memory without CurProc lock (PID %hhu)\n", CurProc->ProcessID());
 	}
@@ -90,20 +98,20 @@ static UINT64 ReadArgumentAsInteger(UINT64 Val)
 
 VOID pantheon::SVCExitProcess(pantheon::TrapFrame *CurFrame)
 {
-	pantheon::Process *Proc = pantheon::CPU::GetCurThread()->MyProc();
-	pantheon::ScopedLock ScopeLockProc(Proc);
-
 	PANTHEON_UNUSED(CurFrame);
 
-	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
-	CurThread->MyProc()->SetState(pantheon::Process::STATE_ZOMBIE);
+	/* Whatever exited here before is freed by whoever exits next. */
+	pantheon::CPU::GetCurSched()->Reap();
 
-	CurThread->Lock();
-	CurThread->SetState(pantheon::Thread::STATE_TERMINATED);
-	CurThread->SetState(pantheon::Thread::STATE_DEAD);
-	CurThread->Unlock();
-	
-	pantheon::CPU::GetCoreInfo()->CurSched->Reschedule();
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	pantheon::Process *Proc = CurThread->MyProc();
+	{
+		/* The other threads end themselves: the process is freed after the last one. */
+		pantheon::ScopedLock _L(Proc);
+		Proc->SetState(pantheon::Process::STATE_ZOMBIE);
+		Proc->KillThreads(CurThread);
+	}
+	pantheon::ExitThread();
 }
 
 pantheon::Result pantheon::SVCForkProcess(pantheon::TrapFrame *CurFrame)
@@ -118,8 +126,9 @@ pantheon::Result pantheon::SVCForkProcess(pantheon::TrapFrame *CurFrame)
 
 pantheon::Result pantheon::SVCLogText(pantheon::TrapFrame *CurFrame)
 {
+	/* Printing is slow: keep interrupts on for it. */
 	pantheon::Process *Proc = pantheon::CPU::GetCurThread()->MyProc();
-	pantheon::ScopedLock _P(Proc);
+	pantheon::ScopedMutex _P(Proc->AddressSpaceLock());
 
 	const CHAR *Data = nullptr;
 	
@@ -174,8 +183,8 @@ pantheon::Result pantheon::SVCCreateThread(pantheon::TrapFrame *CurFrame)
  */
 pantheon::Result pantheon::SVCCreateNamedEvent(pantheon::TrapFrame *CurFrame)
 {
-	pantheon::ScopedGlobalSchedulerLock _SL;
-
+	/* The event list has a lock of its own, so lookups from many
+	 * processes don't need to wait on each other. */
 	pantheon::Process *Proc = pantheon::CPU::GetCurThread()->MyProc();
 	pantheon::ScopedLock ScopeLockProc(Proc);
 
@@ -199,6 +208,7 @@ pantheon::Result pantheon::SVCCreateNamedEvent(pantheon::TrapFrame *CurFrame)
 
 	pantheon::String EvtName(Name);
 
+	pantheon::rcu::ScopedReadSection _R;
 	pantheon::ipc::NamedEvent *Evt = pantheon::ipc::LookupEvent(EvtName);
 	if (Evt != nullptr)
 	{
@@ -251,9 +261,8 @@ pantheon::Result pantheon::SVCSignalEvent(pantheon::TrapFrame *CurFrame)
 	{
 		Evt->Signaler = Proc;
 		Evt->Parent->Status = pantheon::ipc::EVENT_TYPE_SIGNALED;
+		Evt->Parent->Waiters.WakeAll();
 	}
-
-	/* TODO: wakeup every process waiting on it */
 	return pantheon::Result::SYS_OK;
 }
 
@@ -367,20 +376,8 @@ pantheon::Result pantheon::SVCYield(pantheon::TrapFrame *CurFrame)
 pantheon::Result pantheon::SVCExitThread(pantheon::TrapFrame *CurFrame)
 {
 	PANTHEON_UNUSED(CurFrame);
-	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
-	pantheon::Process *CurProc = CurThread->MyProc();
-	pantheon::Scheduler *CurSched = pantheon::CPU::GetCurSched();
-	CurProc->Lock();
-	CurThread->Lock();
-	CurThread->SetState(pantheon::Thread::STATE_TERMINATED);
-	CurThread->Unlock();
-
-	if (pantheon::GlobalScheduler::CountThreads(CurThread->MyProc()->ProcessID()) == 0)
-	{
-		CurProc->SetState(pantheon::Process::STATE_ZOMBIE);
-	}
-	CurProc->Unlock();
-	CurSched->Reschedule();
+	pantheon::CPU::GetCurSched()->Reap();
+	pantheon::ExitThread();
 	return pantheon::Result::SYS_OK;
 }
 
@@ -496,6 +493,8 @@ pantheon::Result pantheon::SVCConnectToNamedPort(pantheon::TrapFrame *CurFrame)
 	pantheon::ipc::PortName PName;
 	CopyString(PName.AsChars, Name, pantheon::ipc::PortNameLength);
 
+	/* Keeps the port from going away while a connection is made to it. */
+	pantheon::rcu::ScopedReadSection _R;
 	pantheon::ipc::Port *NamedPort = pantheon::ipc::Port::GetRegistered(PName);
 	if (NamedPort == nullptr)
 	{
@@ -563,7 +562,9 @@ pantheon::Result pantheon::SVCAcceptConnection(pantheon::TrapFrame *CurFrame)
 		return pantheon::Result::SYS_FAIL;
 	}
 
+	/* The handle takes over from the server port in keeping it alive. */
 	INT32 Res = CurProc->EncodeHandle(pantheon::Handle(Conn));
+	Conn->GetOwner()->Close();
 	if (Res >= 0)
 	{
 		*OutHandle = Res;
@@ -572,11 +573,68 @@ pantheon::Result pantheon::SVCAcceptConnection(pantheon::TrapFrame *CurFrame)
 	return pantheon::Result::SYS_FAIL;
 }
 
+/**
+ * \~english @brief Replies to the last request on a connection, and waits
+ * for the next one.
+ * \~english @details The reply is taken from the thread local region of
+ * the calling thread, and the next request is put there. If the client
+ * is the only thing left to run, it's switched to right away.
+ * \~english @param ContentSize The number of words in the reply
+ * \~english @param ReplyData If not null, the reply is copied from here
+ * first instead
+ * \~english @param Connection The server connection to reply on
+ * \~english @return SYS_OK once a new request was received, or
+ * KERN_CONN_CLOSED if the connection was closed.
+ */
 pantheon::Result pantheon::SVCReplyAndRecieve(pantheon::TrapFrame *CurFrame)
 {
-	/* NYI */
-	PANTHEON_UNUSED(CurFrame);
-	return pantheon::Result::SYS_FAIL;
+	/* svc_ReplyAndRecieve(UINT32 ContentSize, UINT32 *ReplyData, INT32 *Connection) */
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	pantheon::Process *CurProc = CurThread->MyProc();
+
+	pantheon::ipc::ServerConnection *Conn = nullptr;
+	{
+		/* The reply can be a whole page: only look up the handle with
+		 * interrupts off. */
+		pantheon::ScopedMutex _M(CurProc->AddressSpaceLock());
+		UINT64 ContentSize = CurFrame->GetIntArgument(0);
+		UINT32 *ReplyData = nullptr;
+		if (CurFrame->GetIntArgument(1) != 0)
+		{
+			ReplyData = ReadArgumentAsPointer<UINT32>(CurFrame->GetIntArgument(1));
+		}
+		INT32 *ConnHandle = ReadArgumentAsPointer<INT32>(CurFrame->GetIntArgument(2));
+		if (ConnHandle == nullptr)
+		{
+			return pantheon::Result::SYS_FAIL;
+		}
+
+		{
+			pantheon::ScopedLock _L(CurProc);
+			pantheon::Handle *Hand = CurProc->GetHandle(*ConnHandle);
+			if (Hand == nullptr || Hand->GetType() != pantheon::HANDLE_TYPE_SERVER_CONNECTION)
+			{
+				return pantheon::Result::SYS_FAIL;
+			}
+			Conn = Hand->GetContent().Connection;
+
+			/* The handle can be closed while this waits for a request. */
+			Conn->GetOwner()->Open();
+		}
+
+		pantheon::Thread::ThreadLocalRegion *Area = CurThread->GetThreadLocalArea();
+		if (ReplyData != nullptr && Area != nullptr)
+		{
+			static constexpr UINT64 MaxWords = sizeof(Area->Payload) / sizeof(UINT32);
+			ContentSize = (ContentSize > MaxWords) ? MaxWords : ContentSize;
+			CopyMemory(Area->Payload.Data, ReplyData, ContentSize * sizeof(UINT32));
+			Area->Header.Meta = static_cast<UINT16>((Area->Header.Meta & 0x3F) | (ContentSize << 6));
+		}
+	}
+
+	pantheon::Result Res = Conn->ReplyAndRecv(CurThread);
+	Conn->GetOwner()->Close();
+	return Res;
 }
 
 pantheon::Result pantheon::SVCCloseHandle(pantheon::TrapFrame *CurFrame)
@@ -601,13 +659,478 @@ pantheon::Result pantheon::SVCCloseHandle(pantheon::TrapFrame *CurFrame)
 	return pantheon::Result::SYS_OK;
 }
 
+/**
+ * \~english @brief Sends a request over a connection, and waits for the reply.
+ * \~english @details The request is taken from the thread local region of
+ * the calling thread, and the reply is put there. If a server thread is
+ * already waiting, it's switched to right away.
+ * \~english @param Handle The client connection to send the request over
+ * \~english @return SYS_OK once the reply came back, or KERN_CONN_CLOSED
+ * if the server closed the connection.
+ */
 pantheon::Result pantheon::SVCSendRequest(pantheon::TrapFrame *CurFrame)
 {
-	/* NYI */
-	PANTHEON_UNUSED(CurFrame);
+	/* svc_SendRequest(INT32 Handle) */
+	pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
+
+	pantheon::ipc::ClientConnection *Conn = nullptr;
+	{
+		pantheon::ScopedLock _L(CurProc);
+		pantheon::Handle *Hand = CurProc->GetHandle(CurFrame->GetRawArgument<INT32>(0));
+		if (Hand == nullptr || Hand->GetType() != pantheon::HANDLE_TYPE_CLIENT_CONNECTION)
+		{
+			return pantheon::Result::SYS_FAIL;
+		}
+		Conn = Hand->GetContent().ClientConnection;
+
+		/* The handle can be closed while this waits for the reply. */
+		Conn->GetOwner()->Open();
+	}
+
+	pantheon::Result Res = Conn->Send();
+	Conn->GetOwner()->Close();
+	return Res;
+}
+
+/* The most handles a single thread can wait on at once. */
+static constexpr UINT64 MaxWaitHandles = 16;
+
+static pantheon::WaitQueue *GetWaitQueue(pantheon::Handle *Hand)
+{
+	switch (Hand->GetType())
+	{
+	case pantheon::HANDLE_TYPE_READ_SIGNAL:
+		return &Hand->GetContent().ReadEvent->Parent->Waiters;
+	case pantheon::HANDLE_TYPE_SERVER_PORT:
+		return Hand->GetContent().ServerPort->GetWaiters();
+	case pantheon::HANDLE_TYPE_SERVER_CONNECTION:
+		return Hand->GetContent().Connection->GetWaiters();
+	default:
+		return nullptr;
+	}
+}
+
+/* Keeps whatever a handle refers to alive while it's waited on, even if the handle is closed. */
+static VOID OpenWaitable(pantheon::Handle *Hand)
+{
+	switch (Hand->GetType())
+	{
+	case pantheon::HANDLE_TYPE_READ_SIGNAL:
+		Hand->GetContent().ReadEvent->Open();
+		break;
+	case pantheon::HANDLE_TYPE_SERVER_PORT:
+		Hand->GetContent().ServerPort->Open();
+		break;
+	case pantheon::HANDLE_TYPE_SERVER_CONNECTION:
+		Hand->GetContent().Connection->GetOwner()->Open();
+		break;
+	default:
+		break;
+	}
+}
+
+static VOID CloseWaitable(pantheon::Handle *Hand)
+{
+	switch (Hand->GetType())
+	{
+	case pantheon::HANDLE_TYPE_READ_SIGNAL:
+		Hand->GetContent().ReadEvent->Close();
+		break;
+	case pantheon::HANDLE_TYPE_SERVER_PORT:
+		Hand->GetContent().ServerPort->Close();
+		break;
+	case pantheon::HANDLE_TYPE_SERVER_CONNECTION:
+		Hand->GetContent().Connection->GetOwner()->Close();
+		break;
+	default:
+		break;
+	}
+}
+
+static BOOL IsSignaled(pantheon::Handle *Hand)
+{
+	switch (Hand->GetType())
+	{
+	case pantheon::HANDLE_TYPE_READ_SIGNAL:
+		return Hand->GetContent().ReadEvent->Parent->Status == pantheon::ipc::EVENT_TYPE_SIGNALED;
+	case pantheon::HANDLE_TYPE_SERVER_PORT:
+		return Hand->GetContent().ServerPort->HasPending();
+	case pantheon::HANDLE_TYPE_SERVER_CONNECTION:
+		return Hand->GetContent().Connection->HasPending();
+	default:
+		return FALSE;
+	}
+}
+
+static INT64 FindSignaled(pantheon::Handle *Handles, UINT64 Count)
+{
+	for (UINT64 Index = 0; Index < Count; ++Index)
+	{
+		if (IsSignaled(&Handles[Index]))
+		{
+			return static_cast<INT64>(Index);
+		}
+	}
+	return -1;
+}
+
+/**
+ * \~english @brief Blocks until any of some handles becomes signaled.
+ * \~english @details A readable event is signaled once some writer
+ * signals it. A server port is signaled while a connection is waiting
+ * to be accepted, and a server connection is signaled while a request
+ * is waiting to be handled. The calling thread doesn't run at all while
+ * it's waiting.
+ * \~english @param Handles The handles to wait on
+ * \~english @param Count The number of handles, up to 16
+ * \~english @param Timeout The most ticks to wait for, 0 to only poll,
+ * or a negative number to wait forever
+ * \~english @param[out] Index Which handle was signaled, or -1
+ * \~english @return SYS_OK if a handle was signaled, KERN_TIMED_OUT if
+ * the timeout ran out first.
+ */
+pantheon::Result pantheon::SVCWaitSynchronization(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_WaitSynchronization(const INT32 *Handles, UINT64 Count, INT64 Timeout, INT32 *OutIndex) */
+	UINT64 Count = CurFrame->GetIntArgument(1);
+	INT64 Timeout = CurFrame->GetRawArgument<INT64>(2);
+	if (Count == 0 || Count > MaxWaitHandles)
+	{
+		return pantheon::Result::SYS_FAIL;
+	}
+
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	pantheon::Process *CurProc = CurThread->MyProc();
+
+	pantheon::Handle Handles[MaxWaitHandles];
+	{
+		pantheon::ScopedLock _L(CurProc);
+		const INT32 *Indices = ReadArgumentAsPointer<const INT32>(CurFrame->GetIntArgument(0));
+		INT32 *OutIndex = ReadArgumentAsPointer<INT32>(CurFrame->GetIntArgument(3));
+		if (Indices == nullptr || OutIndex == nullptr)
+		{
+			return pantheon::Result::SYS_FAIL;
+		}
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			pantheon::Handle *Hand = CurProc->GetHandle(Indices[Index]);
+			if (Hand == nullptr || GetWaitQueue(Hand) == nullptr)
+			{
+				*OutIndex = -1;
+				return pantheon::Result::SYS_FAIL;
+			}
+			Handles[Index] = *Hand;
+		}
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			OpenWaitable(&Handles[Index]);
+		}
+	}
+
+	UINT64 Deadline = 0;
+	if (Timeout > 0)
+	{
+		Deadline = pantheon::GetSystemTicks() + static_cast<UINT64>(Timeout);
+	}
+
+	INT64 Signaled = -1;
+	pantheon::Result Res = pantheon::Result::SYS_OK;
+	pantheon::WaitNode Nodes[MaxWaitHandles];
+	pantheon::WaitNode Timer;
+	for (;;)
+	{
+		Signaled = FindSignaled(Handles, Count);
+		if (Signaled >= 0)
+		{
+			break;
+		}
+
+		/* A thread told to exit gives up, as if it timed out. */
+		BOOL Expired = (Deadline != 0 && pantheon::GetSystemTicks() >= Deadline);
+		if (Timeout == 0 || Expired || CurThread->ExitRequested())
+		{
+			Res = pantheon::Result::KERN_TIMED_OUT;
+			break;
+		}
+
+		UINT64 Token = 0;
+		{
+			pantheon::ScopedLock _T(CurThread);
+			Token = CurThread->BeginWait();
+		}
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			pantheon::InitWaitNode(&Nodes[Index], CurThread, Token, static_cast<INT64>(Index));
+			GetWaitQueue(&Handles[Index])->Insert(&Nodes[Index]);
+		}
+
+		pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
+		if (Deadline != 0)
+		{
+			pantheon::InitWaitNode(&Timer, CurThread, Token, pantheon::Thread::WakeTimeout);
+			Timer.WakeAt = Deadline;
+			Sched->AddSleeper(&Timer);
+		}
+
+		/* Something may have been signaled before we were queued to hear about it. */
+		BOOL Blocked = FALSE;
+		if (FindSignaled(Handles, Count) < 0)
+		{
+			pantheon::ScopedLock _T(CurThread);
+			Blocked = CurThread->Block();
+		}
+
+		if (Blocked)
+		{
+			pantheon::CPU::GetCurSched()->Reschedule();
+		}
+
+		if (Deadline != 0)
+		{
+			Sched->RemoveSleeper(&Timer);
+		}
+
+		for (UINT64 Index = 0; Index < Count; ++Index)
+		{
+			GetWaitQueue(&Handles[Index])->Remove(&Nodes[Index]);
+		}
+	}
+
+	/* Nothing is queued on any of them anymore. */
+	for (UINT64 Index = 0; Index < Count; ++Index)
+	{
+		CloseWaitable(&Handles[Index]);
+	}
+
+	pantheon::ScopedLock _L(CurProc);
+	INT32 *OutIndex = ReadArgumentAsPointer<INT32>(CurFrame->GetIntArgument(3));
+	if (OutIndex != nullptr)
+	{
+		*OutIndex = static_cast<INT32>(Signaled);
+	}
+	return Res;
+}
+
+/**
+ * \~english @brief Makes the calling thread be scheduled by deadline.
+ * \~english @details Every period, the thread gets to run for its runtime
+ * before its deadline, ahead of any thread scheduled by priority. It's
+ * stopped until the next period once it uses up its runtime, or yields.
+ * Time is reserved on the first core with enough room the thread is
+ * allowed to run on, starting with the current one. Any older reservation is given back first, even if the new
+ * one can't be made.
+ * \~english @param Runtime The ticks of work needed every period, or 0
+ * to go back to being scheduled by priority
+ * \~english @param Period How often the work comes in, in ticks
+ * \~english @param Deadline How many ticks after the start of a period
+ * the work has to be done by, at most the period
+ * \~english @return SYS_OK if the reservation was made, SYS_FAIL if no
+ * core had enough room for it.
+ */
+pantheon::Result pantheon::SVCSetDeadline(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_SetDeadline(UINT64 Runtime, UINT64 Period, UINT64 Deadline) */
+	UINT64 Runtime = CurFrame->GetIntArgument(0);
+	UINT64 Period = CurFrame->GetIntArgument(1);
+	UINT64 Deadline = CurFrame->GetIntArgument(2);
+
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	pantheon::ScopedLock _T(CurThread);
+	if (CurThread->IsDeadline())
+	{
+		CurThread->DeadlineHome()->ReleaseDeadline(CurThread);
+	}
+
+	if (Runtime == 0)
+	{
+		return pantheon::Result::SYS_OK;
+	}
+
+	UINT8 Here = pantheon::CPU::GetProcessorNumber();
+	for (UINT8 Offset = 0; Offset < MAX_NUM_CPUS; ++Offset)
+	{
+		UINT8 CoreNo = (Here + Offset) % MAX_NUM_CPUS;
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(CoreNo);
+		if (Sched == nullptr || CurThread->CanRunOn(CoreNo) == FALSE)
+		{
+			continue;
+		}
+
+		if (Sched->AdmitDeadline(CurThread, Runtime, Period, Deadline))
+		{
+			/* The current slice doesn't count anymore: the budget does. */
+			pantheon::CPU::GetCurSched()->ProgramTimer(CurThread);
+			return pantheon::Result::SYS_OK;
+		}
+	}
 	return pantheon::Result::SYS_FAIL;
 }
 
+/**
+ * \~english @brief Restricts which cores the calling thread can run on.
+ * \~english @details If the current core isn't allowed anymore, the
+ * thread moves to one that is right away. A deadline thread has to keep
+ * the core its time is reserved on.
+ * \~english @param Mask A mask with bit N set if core N is allowed
+ * \~english @return SYS_OK if the mask was applied, SYS_FAIL if it
+ * doesn't allow any core which is up, or leaves out the reserved one.
+ */
+pantheon::Result pantheon::SVCSetAffinity(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_SetAffinity(UINT64 Mask) */
+	UINT64 Mask = CurFrame->GetIntArgument(0);
+
+	UINT64 Online = 0;
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		if (pantheon::CPU::GetSched(Index) != nullptr)
+		{
+			Online |= (1ULL << Index);
+		}
+	}
+
+	if ((Mask & Online) == 0)
+	{
+		return pantheon::Result::SYS_FAIL;
+	}
+
+	BOOL Move = FALSE;
+	pantheon::Thread *CurThread = pantheon::CPU::GetCurThread();
+	{
+		pantheon::ScopedLock _T(CurThread);
+		pantheon::Scheduler *Home = CurThread->DeadlineHome();
+		if (CurThread->IsDeadline() && (Mask & (1ULL << Home->CoreNumber())) == 0)
+		{
+			return pantheon::Result::SYS_FAIL;
+		}
+		CurThread->SetAffinity(Mask);
+		Move = (CurThread->CanRunOn(pantheon::CPU::GetProcessorNumber()) == FALSE);
+	}
+
+	/* Getting queued again puts this thread onto an allowed core. */
+	if (Move)
+	{
+		pantheon::CPU::GetCurSched()->Reschedule();
+	}
+	return pantheon::Result::SYS_OK;
+}
+
+/**
+ * \~english @brief Gets what was measured about one class of spinlock.
+ * \~english @details Every spinlock with the same name counts towards
+ * the same class. Nothing is measured unless the kernel was built with
+ * LOCK_STATS.
+ * \~english @param Index Which class, starting from 0
+ * \~english @param Out Where to write what was measured
+ * \~english @return SYS_OK if there is such a class, SYS_FAIL otherwise.
+ */
+pantheon::Result pantheon::SVCGetLockStats(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_GetLockStats(UINT64 Index, LockStats *Out) */
+	UINT64 Index = CurFrame->GetIntArgument(0);
+
+	pantheon::LockStats Stats;
+	if (pantheon::lockstats::Get(Index, &Stats) == FALSE)
+	{
+		return pantheon::Result::SYS_FAIL;
+	}
+
+	pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
+	pantheon::ScopedLock _L(CurProc);
+	pantheon::LockStats *Out = ReadArgumentAsPointer<pantheon::LockStats>(CurFrame->GetIntArgument(1));
+	if (Out == nullptr)
+	{
+		return pantheon::Result::SYS_FAIL;
+	}
+	*Out = Stats;
+	return pantheon::Result::SYS_OK;
+}
+
+/**
+ * \~english @brief Finds the futex behind some word of userspace memory.
+ * \~english @details The process must be locked.
+ * \~english @param Address Where the word is, which has to be aligned
+ * \~english @param[out] Key The physical address of the word
+ * \~english @return Where the kernel can read the word, or nullptr if
+ * it can't be used as a futex.
+ */
+static const UINT32 *ReadFutexWord(UINT64 Address, UINT64 *Key)
+{
+	if (Address == 0 || Address % sizeof(UINT32) != 0)
+	{
+		return nullptr;
+	}
+
+	pantheon::Process *CurProc = pantheon::CPU::GetCurProcess();
+	const UINT32 *Word = ReadArgumentAsPointer<const UINT32>(Address);
+	if (Word != nullptr)
+	{
+		*Key = pantheon::vmm::VirtualToPhysicalAddress(CurProc->GetPageTable(), Address);
+	}
+	return Word;
+}
+
+/**
+ * \~english @brief Sleeps on a word of memory, if it still has some value.
+ * \~english @details This is the slow path of a userspace lock: a thread
+ * which finds the lock taken marks it as contended, then sleeps here
+ * until whoever releases it calls svc_FutexWake. Threads in different
+ * processes sharing the same memory sleep on the same futex.
+ * \~english @param Address The word to sleep on
+ * \~english @param Expected The value the word must still have
+ * \~english @param Timeout The most ticks to wait for, or a negative
+ * number to wait forever
+ * \~english @return SYS_OK once woken up, KERN_TRY_AGAIN if the word
+ * didn't have the expected value, or KERN_TIMED_OUT.
+ */
+pantheon::Result pantheon::SVCFutexWait(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_FutexWait(UINT32 *Address, UINT32 Expected, INT64 Timeout) */
+	UINT64 Address = CurFrame->GetIntArgument(0);
+	UINT32 Expected = CurFrame->GetRawArgument<UINT32>(1);
+	INT64 Timeout = CurFrame->GetRawArgument<INT64>(2);
+
+	UINT64 Key = 0;
+	const UINT32 *Word = nullptr;
+	{
+		pantheon::ScopedLock _L(pantheon::CPU::GetCurProcess());
+		Word = ReadFutexWord(Address, &Key);
+	}
+
+	if (Word == nullptr)
+	{
+		return pantheon::Result::SYS_FAIL;
+	}
+	return pantheon::FutexWait(Word, Key, Expected, Timeout);
+}
+
+/**
+ * \~english @brief Wakes up threads sleeping on a word of memory.
+ * \~english @param Address The word they're sleeping on
+ * \~english @param Count The most threads to wake up
+ * \~english @return SYS_OK, even if nobody was sleeping there.
+ */
+pantheon::Result pantheon::SVCFutexWake(pantheon::TrapFrame *CurFrame)
+{
+	/* svc_FutexWake(UINT32 *Address, UINT64 Count) */
+	UINT64 Address = CurFrame->GetIntArgument(0);
+	UINT64 Count = CurFrame->GetIntArgument(1);
+
+	UINT64 Key = 0;
+	{
+		pantheon::ScopedLock _L(pantheon::CPU::GetCurProcess());
+		if (ReadFutexWord(Address, &Key) == nullptr)
+		{
+			return pantheon::Result::SYS_FAIL;
+		}
+	}
+	pantheon::FutexWake(Key, Count);
+	return pantheon::Result::SYS_OK;
+}
+
 typedef pantheon::Result (*SyscallFn)(pantheon::TrapFrame *);
 
 SyscallFn syscall_table[] = 
@@ -632,6 +1155,12 @@ SyscallFn syscall_table[] =
 	(SyscallFn)pantheon::SVCReplyAndRecieve,
 	(SyscallFn)pantheon::SVCCloseHandle,
 	(SyscallFn)pantheon::SVCSendRequest,
+	(SyscallFn)pantheon::SVCWaitSynchronization,
+	(SyscallFn)pantheon::SVCSetDeadline,
+	(SyscallFn)pantheon::SVCSetAffinity,
+	(SyscallFn)pantheon::SVCGetLockStats,
+	(SyscallFn)pantheon::SVCFutexWait,
+	(SyscallFn)pantheon::SVCFutexWake,
 };
 
 UINT64 pantheon::SyscallCount()
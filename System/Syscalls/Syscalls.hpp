@@ -32,6 +32,12 @@ Result SVCAcceptConnection(pantheon::TrapFrame *CurFrame);
 Result SVCReplyAndRecieve(pantheon::TrapFrame *CurFrame);
 Result SVCCloseHandle(pantheon::TrapFrame *CurFrame);
 Result SVCSendRequest(pantheon::TrapFrame *CurFrame);
+Result SVCWaitSynchronization(pantheon::TrapFrame *CurFrame);
+Result SVCSetDeadline(pantheon::TrapFrame *CurFrame);
+Result SVCSetAffinity(pantheon::TrapFrame *CurFrame);
+Result SVCGetLockStats(pantheon::TrapFrame *CurFrame);
+Result SVCFutexWait(pantheon::TrapFrame *CurFrame);
+Result SVCFutexWake(pantheon::TrapFrame *CurFrame);
 
 UINT64 SyscallCount();
 BOOL CallSyscall(UINT32 Index, pantheon::TrapFrame *Frame);
@@ -3,6 +3,7 @@
 
 #include <kern_result.hpp>
 #include <kern_datatypes.hpp>
+#include <Sync/kern_lockstats.hpp>
 
 extern "C" pantheon::Result svc_ExitProcess();
 extern "C" pantheon::Result svc_LogText(const CHAR *Content);
@@ -23,5 +24,11 @@ extern "C" pantheon::Result svc_AcceptConnection(INT32 InServerPortHandle, INT32
 extern "C" pantheon::Result svc_ReplyAndRecieve(UINT32 ContentSize, UINT32 *ReplyData, INT32 *NewConnection);
 extern "C" pantheon::Result svc_CloseHandle(INT32 Handle);
 extern "C" pantheon::Result svc_SendRequest(INT32 Handle);
+extern "C" pantheon::Result svc_WaitSynchronization(const INT32 *Handles, UINT64 Count, INT64 Timeout, INT32 *OutIndex);
+extern "C" pantheon::Result svc_SetDeadline(UINT64 Runtime, UINT64 Period, UINT64 Deadline);
+extern "C" pantheon::Result svc_SetAffinity(UINT64 Mask);
+extern "C" pantheon::Result svc_GetLockStats(UINT64 Index, pantheon::LockStats *Out);
+extern "C" pantheon::Result svc_FutexWait(UINT32 *Address, UINT32 Expected, INT64 Timeout);
+extern "C" pantheon::Result svc_FutexWake(UINT32 *Address, UINT64 Count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "sync.hpp"
+#include "pantheon.h"
+
+pantheon::sdk::Mutex::Mutex()
+{
+	this->State = Unlocked;
+}
+
+[[nodiscard]] BOOL pantheon::sdk::Mutex::TryLock()
+{
+	UINT32 Expected = Unlocked;
+	return __atomic_compare_exchange_n(&this->State, &Expected, Locked, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Takes this mutex, sleeping for as long as it takes
+ * @details Whoever has to sleep marks the mutex as contended first, so
+ * that the holder knows to wake someone up.
+ */
+VOID pantheon::sdk::Mutex::Lock()
+{
+	for (UINT32 Spin = 0; Spin < SpinLimit; ++Spin)
+	{
+		if (this->TryLock())
+		{
+			return;
+		}
+	}
+
+	UINT32 Cur = __atomic_exchange_n(&this->State, Contended, __ATOMIC_ACQUIRE);
+	while (Cur != Unlocked)
+	{
+		svc_FutexWait(&this->State, Contended, -1);
+		Cur = __atomic_exchange_n(&this->State, Contended, __ATOMIC_ACQUIRE);
+	}
+}
+
+VOID pantheon::sdk::Mutex::Unlock()
+{
+	if (__atomic_exchange_n(&this->State, Unlocked, __ATOMIC_RELEASE) == Contended)
+	{
+		svc_FutexWake(&this->State, 1);
+	}
+}
+
+pantheon::sdk::CondVar::CondVar()
+{
+	this->Sequence = 0;
+	this->Waiters = 0;
+}
+
+/**
+ * @brief Unlocks a mutex, and sleeps until signaled
+ * @details The mutex is locked again before this returns. Like with any
+ * condition variable, this can return without being signaled, so the
+ * condition has to be checked again.
+ */
+pantheon::Result pantheon::sdk::CondVar::Wait(Mutex *Mtx, INT64 Timeout)
+{
+	__atomic_fetch_add(&this->Waiters, 1, __ATOMIC_SEQ_CST);
+	UINT32 Seen = __atomic_load_n(&this->Sequence, __ATOMIC_SEQ_CST);
+	Mtx->Unlock();
+
+	pantheon::Result Status = svc_FutexWait(&this->Sequence, Seen, Timeout);
+	__atomic_fetch_sub(&this->Waiters, 1, __ATOMIC_SEQ_CST);
+	Mtx->Lock();
+
+	/* Signaled before we got to sleep. */
+	if (Status == pantheon::Result::KERN_TRY_AGAIN)
+	{
+		return pantheon::Result::SYS_OK;
+	}
+	return Status;
+}
+
+VOID pantheon::sdk::CondVar::Signal()
+{
+	__atomic_fetch_add(&this->Sequence, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&this->Waiters, __ATOMIC_SEQ_CST) != 0)
+	{
+		svc_FutexWake(&this->Sequence, 1);
+	}
+}
+
+VOID pantheon::sdk::CondVar::Broadcast()
+{
+	__atomic_fetch_add(&this->Sequence, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&this->Waiters, __ATOMIC_SEQ_CST) != 0)
+	{
+		svc_FutexWake(&this->Sequence, ~0ULL);
+	}
+}
+
+pantheon::sdk::Semaphore::Semaphore(UINT32 Initial)
+{
+	this->Count = Initial;
+	this->Waiters = 0;
+}
+
+[[nodiscard]] BOOL pantheon::sdk::Semaphore::TryWait()
+{
+	UINT32 Cur = __atomic_load_n(&this->Count, __ATOMIC_RELAXED);
+	while (Cur != 0)
+	{
+		if (__atomic_compare_exchange_n(&this->Count, &Cur, Cur - 1, TRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * @brief Takes one from the count, sleeping until it's above zero
+ */
+VOID pantheon::sdk::Semaphore::Wait()
+{
+	while (this->TryWait() == FALSE)
+	{
+		__atomic_fetch_add(&this->Waiters, 1, __ATOMIC_SEQ_CST);
+		svc_FutexWait(&this->Count, 0, -1);
+		__atomic_fetch_sub(&this->Waiters, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+VOID pantheon::sdk::Semaphore::Post()
+{
+	__atomic_fetch_add(&this->Count, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&this->Waiters, __ATOMIC_SEQ_CST) != 0)
+	{
+		svc_FutexWake(&this->Count, 1);
+	}
+}
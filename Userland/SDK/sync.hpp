@@ -0,0 +1,64 @@
+#ifndef PANTHEON_SYNC_H_
+#define PANTHEON_SYNC_H_
+
+#include <kern_result.hpp>
+#include <kern_datatypes.hpp>
+
+/* Locks for userspace threads. None of these make a system call unless
+ * some thread actually has to wait, or has to wake up one that is. */
+namespace pantheon::sdk
+{
+
+class Mutex
+{
+public:
+	Mutex();
+
+	VOID Lock();
+	VOID Unlock();
+	[[nodiscard]] BOOL TryLock();
+
+	/* How many times to retry before sleeping. */
+	static constexpr UINT32 SpinLimit = 100;
+
+private:
+	/* Unlocked, locked, or locked with someone maybe asleep on it. */
+	static constexpr UINT32 Unlocked = 0;
+	static constexpr UINT32 Locked = 1;
+	static constexpr UINT32 Contended = 2;
+
+	UINT32 State;
+};
+
+class CondVar
+{
+public:
+	CondVar();
+
+	pantheon::Result Wait(Mutex *Mtx, INT64 Timeout = -1);
+	VOID Signal();
+	VOID Broadcast();
+
+private:
+	/* Bumped by every signal, so a waiter can tell if it missed one. */
+	UINT32 Sequence;
+	UINT32 Waiters;
+};
+
+class Semaphore
+{
+public:
+	Semaphore(UINT32 Initial = 0);
+
+	VOID Wait();
+	[[nodiscard]] BOOL TryWait();
+	VOID Post();
+
+private:
+	UINT32 Count;
+	UINT32 Waiters;
+};
+
+}
+
+#endif
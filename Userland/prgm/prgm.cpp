@@ -10,14 +10,6 @@ void prgm_Main()
 	svc_CreateNamedEvent("signal", &Read, &Write);
 	for (;;)
 	{
-		volatile BOOL Recieve = svc_PollEvent(Read);
-		if (Recieve)
-		{
-			svc_ResetEvent(Read);
-			svc_LogText("GOT SIGNAL");
-			svc_Yield();
-		}
-
 		INT32 ClientConn;
 		pantheon::Result Status = svc_ConnectToNamedPort("sysm:reg", &ClientConn);
 		if (Status != pantheon::Result::SYS_OK)
@@ -26,11 +18,20 @@ void prgm_Main()
 		}
 		else 
 		{
-			svc_SignalEvent(Write);
+			svc_SendRequest(ClientConn);
 			svc_CloseHandle(ClientConn);
 		}
 
-		svc_LogText("IN USERSPACE [prgm]");		
+		svc_LogText("IN USERSPACE [prgm]");
+
+		/* Sleep until sysm gets around to us. */
+		INT32 Index;
+		Status = svc_WaitSynchronization(&Read, 1, 1000, &Index);
+		if (Status == pantheon::Result::SYS_OK)
+		{
+			svc_ResetEvent(Read);
+			svc_LogText("GOT SIGNAL");
+		}
 	}
 }
 
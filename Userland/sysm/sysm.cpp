@@ -27,18 +27,31 @@ void sysm_Main()
 	/* TODO: Accept data from it... */
 	for (;;)
 	{
+		/* Don't run at all until someone wants to connect. */
+		INT32 Index;
+		Status = svc_WaitSynchronization(&ServerPortRegistration, 1, -1, &Index);
+		if (Status != pantheon::Result::SYS_OK)
+		{
+			svc_LogText("Unable to wait for a session");
+			svc_Yield();
+			continue;
+		}
+
 		INT32 ServerConnection;
 		Status = svc_AcceptConnection(ServerPortRegistration, &ServerConnection);
 		if (Status == pantheon::Result::SYS_OK)
 		{
-			/* Reply with nothing, forever. */
-			svc_ReplyAndRecieve(0, nullptr, &ServerConnection);
-			svc_LogText("[sysm] Replying to session");
+			/* Reply with nothing, until the client hangs up. */
+			while (svc_ReplyAndRecieve(0, nullptr, &ServerConnection) == pantheon::Result::SYS_OK)
+			{
+				svc_LogText("[sysm] Replying to session");
+				svc_SignalEvent(Write);
+			}
+			svc_CloseHandle(ServerConnection);
 		}
 		else
 		{
 			svc_LogText("Unable to accept a session");
-			svc_Yield();
 		}
 	}
 }
@@ -1,7 +1,11 @@
 #include <arch.hpp>
+#include <arch/aarch64/gic.hpp>
 #include <arch/aarch64/ints.hpp>
 #include <arch/aarch64/thread.hpp>
 
+#include <vmm/pte.hpp>
+#include <kern_runtime.hpp>
+
 #include <Proc/kern_cpu.hpp>
 #include <Common/Sync/kern_atomic.hpp>
 
@@ -27,6 +31,82 @@ VOID pantheon::CPU::PAUSE()
 	asm volatile("yield\n");
 }
 
+/**
+ * \~english @brief Sleeps until some core signals an event, or until any
+ * memory this core has an exclusive monitor on is written to.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::WFE()
+{
+	asm volatile("wfe\n" ::: "memory");
+}
+
+/**
+ * \~english @brief Wakes up every core waiting in WFE.
+ * \~english @details Whatever was written before this is visible to those
+ * cores once they wake up.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::SEV()
+{
+	asm volatile("dsb ishst\n"
+		"sev\n" ::: "memory");
+}
+
+/**
+ * \~english @brief Sleeps until the value at some address might no longer
+ * be what it was.
+ * \~english @details The load-exclusive arms this core's exclusive
+ * monitor, so any other core writing there wakes this one up, even if it
+ * does so right before the WFE. Nobody has to signal an event for it. This
+ * can return early, so the caller should always check again.
+ * \~english @param Addr The address to watch
+ * \~english @param Value What the caller last saw there
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::WaitForChange(const UINT16 *Addr, UINT16 Value)
+{
+	UINT32 Cur = 0;
+	asm volatile("ldaxrh %w0, [%1]\n" : "=&r"(Cur) : "r"(Addr) : "memory");
+	if (Cur == Value)
+	{
+		asm volatile("wfe\n" ::: "memory");
+	}
+}
+
+VOID pantheon::CPU::WaitForChange(const UINT32 *Addr, UINT32 Value)
+{
+	UINT32 Cur = 0;
+	asm volatile("ldaxr %w0, [%1]\n" : "=&r"(Cur) : "r"(Addr) : "memory");
+	if (Cur == Value)
+	{
+		asm volatile("wfe\n" ::: "memory");
+	}
+}
+
+VOID pantheon::CPU::WaitForChange(const UINT64 *Addr, UINT64 Value)
+{
+	UINT64 Cur = 0;
+	asm volatile("ldaxr %0, [%1]\n" : "=&r"(Cur) : "r"(Addr) : "memory");
+	if (Cur == Value)
+	{
+		asm volatile("wfe\n" ::: "memory");
+	}
+}
+
+/**
+ * \~english @brief Interrupts some other core, so it runs its interrupt
+ * handler as soon as it can.
+ * \~english @details Whatever was written before this is visible to that
+ * core once it takes the interrupt.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::IPI(UINT8 CoreNo)
+{
+	asm volatile("dsb ishst\n" ::: "memory");
+	pantheon::arm::GICSendSGI(pantheon::arm::WakeSGI, CoreNo);
+}
+
 VOID pantheon::CPU::HLT()
 {
 	asm volatile("wfi\n");
@@ -43,9 +123,75 @@ VOID pantheon::CPU::LIDT(void *Table)
 	pantheon::arm::LoadInterruptTable(Table);
 }
 
+/* DCZID_EL0: DZP says DC ZVA can't be used, BS is log2 of its block size in words. */
+static constexpr UINT64 DCZIDProhibited = 1ULL << 4;
+static constexpr UINT64 DCZIDBlockMask = 0xF;
+
+/**
+ * \~english @brief Zeroes one page of normal memory.
+ * \~english @details DC ZVA zeroes a whole block of cache lines at a time,
+ * without reading them in first, so this is much cheaper than storing
+ * zeroes one register at a time. The block is at most 2 KiB, so it always
+ * divides the page evenly.
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::CPU::ZeroPage(VOID *Page)
+{
+	UINT64 DCZID = pantheon::CPUReg::R_DCZID_EL0();
+	if (DCZID & DCZIDProhibited)
+	{
+		ClearBuffer(reinterpret_cast<CHAR*>(Page), pantheon::vmm::SmallestPageSize);
+		return;
+	}
+
+	UINT64 BlockSize = 4ULL << (DCZID & DCZIDBlockMask);
+	UINT64 Addr = reinterpret_cast<UINT64>(Page);
+	for (UINT64 Offset = 0; Offset < pantheon::vmm::SmallestPageSize; Offset += BlockSize)
+	{
+		asm volatile("dc zva, %0\n" :: "r"(Addr + Offset) : "memory");
+	}
+}
+
+/* CPACR_EL1.FPEN: 0b11 lets both EL0 and EL1 use FP/SIMD, 0b00 traps both. */
+static constexpr UINT64 CPACRFPENShift = 20;
+static constexpr UINT64 CPACRFPENMask = 0b11ULL << CPACRFPENShift;
+
+VOID pantheon::CPU::FPUEnable()
+{
+	UINT64 CPACR = pantheon::CPUReg::R_CPACR_EL1();
+	pantheon::CPUReg::W_CPACR_EL1(CPACR | CPACRFPENMask);
+}
+
+VOID pantheon::CPU::FPUDisable()
+{
+	UINT64 CPACR = pantheon::CPUReg::R_CPACR_EL1();
+	pantheon::CPUReg::W_CPACR_EL1(CPACR & ~CPACRFPENMask);
+}
+
+BOOL pantheon::CPU::FPUEnabled()
+{
+	return (pantheon::CPUReg::R_CPACR_EL1() & CPACRFPENMask) == CPACRFPENMask;
+}
+
+extern "C" void fpu_save(pantheon::CpuContext *Context, UINT64 RegOffset);
+extern "C" void fpu_restore(pantheon::CpuContext *Context, UINT64 RegOffset);
+
+VOID pantheon::CPU::FPUSave(pantheon::CpuContext *Context)
+{
+	fpu_save(Context, CpuFRegOffset);
+}
+
+VOID pantheon::CPU::FPURestore(pantheon::CpuContext *Context)
+{
+	fpu_restore(Context, CpuFRegOffset);
+}
+
 extern "C" void *prepare_kernel_stack()
 {
+	/* This is the first thing every core runs: nothing can use its
+	 * per-core area before this. */
 	UINT8 CpuNo = pantheon::CPU::GetProcessorNumber();
+	pantheon::CPU::InitCoreArea(CpuNo);
 	void *Stack = pantheon::CPU::GetStackArea(CpuNo);
 	return Stack;
 
@@ -39,6 +39,16 @@ FORCE_INLINE VOID DisableSystemTimer()
 	pantheon::arm::DisableSystemTimer();
 }
 
+FORCE_INLINE VOID ArmSystemTimer(UINT64 Ticks)
+{
+	pantheon::arm::ArmSystemTimer(Ticks);
+}
+
+FORCE_INLINE UINT64 GetSystemTicks()
+{
+	return pantheon::arm::GetSystemTicks();
+}
+
 FORCE_INLINE VOID RearmSystemTimer()
 {
 	pantheon::arm::RearmSystemTimer();
@@ -59,8 +69,50 @@ VOID HLT();
 BOOL IF();
 
 VOID PAUSE();
+VOID WFE();
+VOID SEV();
+VOID IPI(UINT8 CoreNo);
+
+VOID WaitForChange(const UINT16 *Addr, UINT16 Value);
+VOID WaitForChange(const UINT32 *Addr, UINT32 Value);
+VOID WaitForChange(const UINT64 *Addr, UINT64 Value);
 VOID LIDT(void *IDT);
 
+/**
+ * \~english @brief Gets the per-core area of the current core
+ * \~english @details TPIDR_EL1 is never touched by userspace, so it
+ * always holds whatever SetPerCoreArea put there.
+ * \~english @author Brian Schnepp
+ */
+FORCE_INLINE VOID *GetPerCoreArea()
+{
+	return reinterpret_cast<VOID*>(pantheon::CPUReg::R_TPIDR_EL1());
+}
+
+FORCE_INLINE VOID SetPerCoreArea(VOID *Area)
+{
+	pantheon::CPUReg::W_TPIDR_EL1(reinterpret_cast<UINT64>(Area));
+}
+
+/**
+ * \~english @brief Reads the raw virtual counter, for timing short things
+ * \~english @details Unlike GetSystemTicks, this isn't scaled down, so
+ * it's only good for comparing against other reads of it.
+ * \~english @author Brian Schnepp
+ */
+FORCE_INLINE UINT64 ReadCycleCounter()
+{
+	return pantheon::CPUReg::R_CNTVCT_EL0();
+}
+
+VOID ZeroPage(VOID *Page);
+
+VOID FPUEnable();
+VOID FPUDisable();
+BOOL FPUEnabled();
+VOID FPUSave(pantheon::CpuContext *Context);
+VOID FPURestore(pantheon::CpuContext *Context);
+
 }
 
 
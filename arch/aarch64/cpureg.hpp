@@ -31,6 +31,13 @@ FORCE_INLINE VOID W_TTBR0_EL1(UINT64 Val)
 		"isb\n" :: "r"(Val) :);
 }
 
+FORCE_INLINE VOID W_TTBR0_EL1_NOFLUSH(UINT64 Val)
+{
+	/* Entries are tagged with the ASID in the upper bits: nothing to smash. */
+	asm volatile ("msr ttbr0_el1, %0\n"
+		"isb\n" :: "r"(Val) :);
+}
+
 FORCE_INLINE VOID W_TTBR1_EL1(UINT64 Val)
 {
 	/* The TLB has to also be smashed here... */
@@ -64,6 +71,19 @@ FORCE_INLINE UINT64 R_TCR_EL1()
 	return RetVal;
 }
 
+FORCE_INLINE VOID W_CPACR_EL1(UINT64 Value)
+{
+	asm volatile ("msr cpacr_el1, %0\n"
+		"isb\n" :: "r"(Value) :);
+}
+
+FORCE_INLINE UINT64 R_CPACR_EL1()
+{
+	UINT64 RetVal = 0;
+	asm volatile ("mrs %0, cpacr_el1\n" : "=r"(RetVal) ::);
+	return RetVal;
+}
+
 FORCE_INLINE VOID W_TPIDRRO_EL0(UINT64 Value)
 {
 	asm volatile ("msr tpidrro_el0, %0\n" :: "r"(Value) :);
@@ -76,6 +96,33 @@ FORCE_INLINE UINT64 R_TPIDRRO_EL0()
 	return RetVal;
 }
 
+FORCE_INLINE VOID W_TPIDR_EL1(UINT64 Value)
+{
+	asm volatile ("msr tpidr_el1, %0\n" :: "r"(Value) : "memory");
+}
+
+FORCE_INLINE UINT64 R_TPIDR_EL1()
+{
+	UINT64 RetVal = 0;
+	asm volatile ("mrs %0, tpidr_el1\n" : "=r"(RetVal) ::);
+	return RetVal;
+}
+
+FORCE_INLINE UINT64 R_CNTVCT_EL0()
+{
+	UINT64 RetVal = 0;
+	asm volatile ("isb\n"
+		"mrs %0, cntvct_el0\n" : "=r"(RetVal) :: "memory");
+	return RetVal;
+}
+
+FORCE_INLINE UINT64 R_DCZID_EL0()
+{
+	UINT64 RetVal = 0;
+	asm volatile ("mrs %0, dczid_el0\n" : "=r"(RetVal) ::);
+	return RetVal;
+}
+
 
 }
 
@@ -79,6 +79,9 @@ VOID pantheon::arm::GICInitCore()
 	GICWrite(GIC_CLASS_CPU_INTERFACE, GICC_PMR, 0, 0xFF);
 	GICWrite(GIC_CLASS_CPU_INTERFACE, GICC_BPR, 0, 0x07);
 
+	/* SGIs are enabled per core. */
+	GICEnableInterrupt(WakeSGI);
+
 	GICEnable();
 }
 
@@ -134,6 +137,20 @@ VOID pantheon::arm::GICIgnoreInterrupt(UINT32 Interrupt)
 		GICD_ICPENDR, Interface, (1 << IRQNumber));	
 }
 
+/**
+ * \~english @brief Raises a software interrupt on another core.
+ * \~english @details This assumes each core's CPU interface number is the
+ * same as its core number, which is the case on every board supported.
+ * \~english @param SGI Which SGI to raise, from 0 to 15
+ * \~english @param CoreNo The core to interrupt
+ * \~english @author Brian Schnepp
+ */
+VOID pantheon::arm::GICSendSGI(UINT32 SGI, UINT8 CoreNo)
+{
+	UINT32 Targets = (1U << CoreNo) << 16;
+	GICWrite(GIC_CLASS_DISTRIBUTOR, GICD_SGIR, 0, Targets | (SGI & 0x0F));
+}
+
 VOID pantheon::arm::GICAckInterrupt(UINT32 Value)
 {
 	GICWrite(GIC_CLASS_CPU_INTERFACE, GICC_EOIR, 0, Value);
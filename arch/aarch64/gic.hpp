@@ -88,6 +88,9 @@ typedef enum GICRegisterOffsets
 	GICV_DIR = 0x1000,
 }GICRegisterOffsets;
 
+/* Sent to a core only to make it take an interrupt. */
+static constexpr UINT32 WakeSGI = 0;
+
 VOID GICSetMMIOAddr(GICClassType Type, UINT64 Addr);
 
 VOID GICInit();
@@ -118,6 +121,8 @@ VOID GICAckInterrupt(UINT32 IAR);
 BOOL GICPollInterrupt(UINT32 Interrupt);
 VOID GICIgnoreInterrupt(UINT32 Interrupt);
 
+VOID GICSendSGI(UINT32 SGI, UINT8 CoreNo);
+
 }
 
 
@@ -76,7 +76,7 @@ extern "C" void irq_handler_el1(pantheon::TrapFrame *Frame)
 	pantheon::arm::GICAckInterrupt(IAR);
 	if ((IAR & 0x3FF) == 30)
 	{
-		pantheon::arm::RearmSystemTimer();
+		/* The timer is one-shot: AttemptReschedule decides when it next fires. */
 		pantheon::AttemptReschedule();
 	}
 	pantheon::CPU::GetCoreInfo()->CurFrame = nullptr;
@@ -102,8 +102,17 @@ extern "C" void sync_handler_el0(pantheon::TrapFrame *Frame)
 		pantheon::CPU::STI();
 		UINT32 SyscallNo = Frame->Regs[8];
 		pantheon::CallSyscall(SyscallNo, Frame);
+		if (pantheon::CPU::GetCurThread()->ExitRequested())
+		{
+			pantheon::ExitThread();
+		}
 		pantheon::CPU::CLI();
 	} 
+	else if ((ESRType & 0xFF) == 0x07)
+	{
+		/* First FP/SIMD use since this thread was switched to. */
+		pantheon::CPU::FPUTrap();
+	}
 	else if (ESR == 0x2000000)
 	{
 		SERIAL_LOG_UNSAFE("Bad sync handler el0: esr: 0x%lx far: 0x%lx elr: 0x%lx spsr: 0x%lx\n", ESR, FAR, ELR, SPSR);
@@ -129,6 +138,12 @@ extern "C" void fiq_handler_el0(pantheon::TrapFrame *Frame)
 extern "C" void irq_handler_el0(pantheon::TrapFrame *Frame)
 {
 	irq_handler_el1(Frame);
+
+	/* The process is exiting: this is as good a place to stop as any. */
+	if (pantheon::CPU::GetCurThread()->ExitRequested())
+	{
+		pantheon::ExitThread();
+	}
 }
 
 
@@ -188,13 +203,44 @@ VOID pantheon::arm::RearmSystemTimer(UINT64 Frequency)
 	pantheon::arm::RearmSystemTimer();
 }
 
-VOID pantheon::arm::DisableSystemTimer()
+/* The timer compare value is a signed 32-bit number. */
+static constexpr UINT64 MaxTimerValue = 0x7FFFFFFF;
+
+VOID pantheon::arm::ArmSystemTimer(UINT64 Ticks)
 {
-	UINT64 ClockSpeed = 0xFFFFFFFFFFFFFFFF;
+	UINT64 ClockSpeed;
+	asm volatile ("mrs %0, cntfrq_el0\n" : "=r"(ClockSpeed));
+	ClockSpeed /= TimerClock;
+
+	UINT64 Value = MaxTimerValue;
+	if (Ticks < MaxTimerValue / ClockSpeed)
+	{
+		Value = ClockSpeed * Ticks;
+	}
+
 	volatile UINT64 TimerCtl = 1;
 	asm volatile ("msr cntp_tval_el0, %0\n" 
 			"msr cntp_ctl_el0, %1"
-			:: "r"(ClockSpeed), "r"(TimerCtl) : "memory");	
+			:: "r"(Value), "r"(TimerCtl) : "memory");
+}
+
+UINT64 pantheon::arm::GetSystemTicks()
+{
+	UINT64 ClockSpeed;
+	UINT64 Count;
+	asm volatile ("mrs %0, cntfrq_el0\n" : "=r"(ClockSpeed));
+	asm volatile ("isb\n"
+			"mrs %0, cntpct_el0\n" : "=r"(Count) :: "memory");
+	return Count / (ClockSpeed / TimerClock);
+}
+
+VOID pantheon::arm::DisableSystemTimer()
+{
+	/* Writing a huge compare value isn't enough: it's only 32 bits
+	 * and signed, so it'd just fire again immediately. Turn it off. */
+	volatile UINT64 TimerCtl = 0;
+	asm volatile ("msr cntp_ctl_el0, %0"
+			:: "r"(TimerCtl) : "memory");
 }
 
 UINT64 pantheon::arm::DAIFR()
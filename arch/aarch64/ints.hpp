@@ -13,7 +13,9 @@ UINT64 GetSystemTimerClock();
 
 VOID RearmSystemTimer();
 VOID RearmSystemTimer(UINT64 Frequency);
+VOID ArmSystemTimer(UINT64 Ticks);
 VOID DisableSystemTimer();
+UINT64 GetSystemTicks();
 
 UINT64 DAIFR();
 
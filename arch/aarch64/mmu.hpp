@@ -42,13 +42,19 @@ typedef enum TCRAttribute : UINT64
 	TCR_ATTRIBUTE_TG1_4K = (0b10ULL) << 30,
 	TCR_ATTRIBUTE_TG1_16K = (0b01ULL) << 30,
 	TCR_ATTRIBUTE_TG1_64K = (0b11ULL) << 30,
+
+	/* ASIDs come from TTBR0, and are only 8 bits wide. */
+	TCR_ATTRIBUTE_A1_TTBR0 = (0b0ULL) << 22,
+	TCR_ATTRIBUTE_A1_TTBR1 = (0b1ULL) << 22,
+	TCR_ATTRIBUTE_AS_8BIT = (0b0ULL) << 36,
+	TCR_ATTRIBUTE_AS_16BIT = (0b1ULL) << 36,
 }TCRAttribute;
 
 typedef UINT64 TCRAttributes;
 
 constexpr inline TCRAttributes DefaultTCRAttributes()
 {
-	return TCR_ATTRIBUTE_T0SZ_4LVL | TCR_ATTRIBUTE_TG0_4K | TCR_ATTRIBUTE_T1SZ_4LVL | TCR_ATTRIBUTE_TG1_4K;
+	return TCR_ATTRIBUTE_T0SZ_4LVL | TCR_ATTRIBUTE_TG0_4K | TCR_ATTRIBUTE_T1SZ_4LVL | TCR_ATTRIBUTE_TG1_4K | TCR_ATTRIBUTE_A1_TTBR0 | TCR_ATTRIBUTE_AS_8BIT;
 }
 }
 
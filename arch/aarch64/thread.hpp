@@ -25,6 +25,13 @@ typedef struct CpuContext
 	UINT64 SP;
 	UINT64 PC;
 
+	/* The 128-bit Q registers, as pairs of 64-bit numbers. These are
+	 * only saved and restored if the thread actually uses them. */
+	static constexpr UINT64 NumFRegs = 32;
+	UINT64 FRegs[2 * NumFRegs];
+	UINT64 FPCR;
+	UINT64 FPSR;
+
 	VOID Wipe()
 	{
 		x19 = 0;
@@ -39,7 +46,13 @@ typedef struct CpuContext
 		x28 = 0;
 		FP = 0;
 		SP = 0;
-		PC = 0;		
+		PC = 0;
+		for (UINT64 &Item : this->FRegs)
+		{
+			Item = 0;
+		}
+		FPCR = 0;
+		FPSR = 0;
 	}
 
 	UINT64 &operator[](UINT64 Index)
@@ -62,7 +75,7 @@ typedef struct CpuContext
 	[[nodiscard]] 
 	UINT64 FRegCount() const
 	{
-		return 32;
+		return NumFRegs;
 	}
 
 	VOID SetPC(UINT64 Val)
@@ -115,6 +128,12 @@ typedef struct CpuContext
 		this->FP = Other.FP;
 		this->SP = Other.SP;
 		this->PC = Other.PC;
+		for (UINT64 Index = 0; Index < 2 * NumFRegs; ++Index)
+		{
+			this->FRegs[Index] = Other.FRegs[Index];
+		}
+		this->FPCR = Other.FPCR;
+		this->FPSR = Other.FPSR;
 		return *this;
 	}
 
@@ -124,5 +143,6 @@ typedef struct CpuContext
 }
 
 #define CpuIRegOffset offsetof(pantheon::CpuContext, x19)
+#define CpuFRegOffset offsetof(pantheon::CpuContext, FRegs)
 
 #endif
\ No newline at end of file
@@ -16,6 +16,26 @@ VOID pantheon::vmm::InvalidateTLB()
 		"isb\n" ::: "memory");
 }
 
+VOID pantheon::vmm::InvalidateLocalTLB()
+{
+	/* Only this core's TLB: other cores flush their own when they need to. */
+	asm volatile(
+		"tlbi vmalle1\n"
+		"dsb nsh\n"
+		"isb\n" ::: "memory");
+}
+
+VOID pantheon::vmm::InvalidateASID(UINT64 ASID)
+{
+	/* Every core: the address space could have run on any of them. */
+	UINT64 Operand = ASID << 48;
+	asm volatile(
+		"dsb ishst\n"
+		"tlbi aside1is, %0\n"
+		"dsb ish\n"
+		"isb\n" :: "r"(Operand) : "memory");
+}
+
 VOID pantheon::vmm::PrintPageTables(pantheon::vmm::PageTable *Table)
 {
 	for (const pantheon::vmm::PageTableEntry &L0Entry : Table->Entries)
@@ -463,4 +483,49 @@ BOOL pantheon::vmm::PageAllocator::Reprotect(pantheon::vmm::PageTable *TTBR, pan
 fail:
 	VMMSync();
 	return FALSE;	
-}
\ No newline at end of file
+}
+/**
+ * \~english @brief Frees every table below a root table, leaving the root empty.
+ * \~english @details Only the tables themselves go back to this allocator:
+ * whatever they mapped is left alone. Nothing may be running with these
+ * tables anymore, and the TLB must not hold anything from them.
+ * \~english @param TTBR The root table, which isn't freed
+ * \~english @param VirtTranslate If the tables have to be found through the physical memory map
+ */
+VOID pantheon::vmm::PageAllocator::Release(pantheon::vmm::PageTable *TTBR, BOOL VirtTranslate)
+{
+	OBJECT_SELF_ASSERT();
+	PanicOnNullPageTable(TTBR);
+	for (pantheon::vmm::PageTableEntry &L0Entry : TTBR->Entries)
+	{
+		if (L0Entry.IsMapped())
+		{
+			this->ReleaseTable(L0Entry.GetPhysicalAddressArea(), 1, VirtTranslate);
+		}
+		L0Entry.SetRawAttributes(0x00);
+	}
+	VMMSync();
+}
+
+VOID pantheon::vmm::PageAllocator::ReleaseTable(pantheon::vmm::PhysicalAddress Table, UINT8 Level, BOOL VirtTranslate)
+{
+	OBJECT_SELF_ASSERT();
+	pantheon::vmm::PageTable *Cur = (pantheon::vmm::PageTable*)Table;
+	if (VirtTranslate)
+	{
+		Cur = (pantheon::vmm::PageTable*)PhysicalToVirtualAddress(Table);
+	}
+
+	/* The last level only has pages in it. */
+	if (Level < 3)
+	{
+		for (const pantheon::vmm::PageTableEntry &Entry : Cur->Entries)
+		{
+			if (Entry.IsMapped() && Entry.IsTable())
+			{
+				this->ReleaseTable(Entry.GetPhysicalAddressArea(), Level + 1, VirtTranslate);
+			}
+		}
+	}
+	this->Allocator.Deallocate(reinterpret_cast<pantheon::vmm::PageTable*>(Table + this->TableOffset));
+}
@@ -35,6 +35,18 @@ constexpr FORCE_INLINE UINT16 VirtAddrToPageTableIndex(pantheon::vmm::VirtualAdd
 PhysicalAddress VirtualToPhysicalAddress(PageTable *RootTable, VirtualAddress VirtAddr);
 
 VOID InvalidateTLB();
+VOID InvalidateLocalTLB();
+VOID InvalidateASID(UINT64 ASID);
+
+/**
+ * \~english @brief Builds the value for TTBR0 for some address space
+ * \~english @param Table The physical address of the root page table
+ * \~english @param ASID The ASID to tag TLB entries of this address space with
+ */
+constexpr FORCE_INLINE UINT64 MakeTTBR(PhysicalAddress Table, UINT64 ASID)
+{
+	return (ASID << 48) | (Table & 0xFFFFFFFFFFFE);
+}
 
 static_assert(sizeof(PageTableEntry) == sizeof(PageTableEntryRaw));
 
@@ -52,6 +64,7 @@ public:
 	{
 		OBJECT_SELF_ASSERT();
 		this->Allocator = pantheon::mm::SlabCache<pantheon::vmm::PageTable>(Area, Pages);
+		this->TableOffset = 0;
 	}
 	
 	~PageAllocator() = default;
@@ -76,7 +89,10 @@ public:
 
 	BOOL Map(pantheon::vmm::PageTable *TTBR, pantheon::vmm::VirtualAddress VirtAddr, pantheon::vmm::PhysicalAddress PhysAddr, UINT64 Size, const pantheon::vmm::PageTableEntry &Permissions, BOOL VirtTranslate = TRUE);
 	BOOL Reprotect(pantheon::vmm::PageTable *TTBR, pantheon::vmm::VirtualAddress VirtAddr, UINT64 Size, const pantheon::vmm::PageTableEntry &Permissions, BOOL VirtTranslate = FALSE);
+	VOID Release(pantheon::vmm::PageTable *TTBR, BOOL VirtTranslate = TRUE);
 private:
+	VOID ReleaseTable(pantheon::vmm::PhysicalAddress Table, UINT8 Level, BOOL VirtTranslate);
+
 	static void PanicOnNullPageTable(pantheon::vmm::PageTable *Table)
 	{
 		if (Table == nullptr)
@@ -118,6 +134,9 @@ private:
 		{
 			PTable = VirtualToPhysicalAddress((pantheon::vmm::PageTable*)pantheon::CPUReg::R_TTBR1_EL1(), (UINT64)Table);
 		}
+
+		/* The tables are contiguous, so this is the same for all of them. */
+		this->TableOffset = (UINT64)Table - PTable;
 		Entry->SetPhysicalAddressArea(PTable);
 		Entry->SetTable(TRUE);
 		Entry->SetMapped(TRUE);
@@ -145,6 +164,9 @@ private:
 	}
 
 	pantheon::mm::SlabCache<pantheon::vmm::PageTable> Allocator;
+
+	/* How far the tables are from their physical addresses, as the allocator sees them. */
+	UINT64 TableOffset;
 };
 
 }
@@ -0,0 +1,8 @@
+#!/bin/sh
+
+rm -rf build
+mkdir build
+cd build
+cmake .. -DONLY_TESTS=ON -DCMAKE_C_FLAGS="-O2 -g3 -pthread -latomic" -DCMAKE_CXX_FLAGS="-O2 -g3 -pthread -latomic" -DCMAKE_CXX_LINK_FLAGS="${CMAKE_CXX_FLAGS} -latomic -lpthread" -DCMAKE_C_LINK_FLAGS="${CMAKE_C_FLAGS} -latomic -lpthread"
+make -j`nproc` schedsim
+./schedsim "$@"
\ No newline at end of file
@@ -7,5 +7,5 @@ scan-build -plist --force-analyze-debug-code -analyze-headers -o analyzer_report
 scan-build -plist --force-analyze-debug-code -analyze-headers -o analyzer_reports make -j`nproc`
 valgrind --xml=yes --xml-file=valgrind.xml ./pantheon --gtest_output=xml:./gtests.xml
 cd ..
-gcovr --exclude-directories externals/  --exclude-directories arch/ --exclude-directories board/ -e tests/struct_tests.hpp -e tests/sched_tests.hpp -e tests/common_tests.hpp -e tests/main.cpp -e tests/arch_tests.hpp -r . --xml-pretty > build/coverage.xml
+gcovr --exclude-directories externals/  --exclude-directories arch/ --exclude-directories board/ -e tests/struct_tests.hpp -e tests/sched_tests.hpp -e tests/common_tests.hpp -e tests/main.cpp -e tests/arch_tests.hpp -e tests/sched_sim.hpp -e tests/schedsim.cpp -r . --xml-pretty > build/coverage.xml
 sonar-scanner
\ No newline at end of file
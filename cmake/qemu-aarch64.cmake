@@ -13,9 +13,16 @@ SET(CMAKE_OBJCOPY "aarch64-none-elf-objcopy")
 SET(BOOT_LINKER_SCRIPT ${CMAKE_SOURCE_DIR}/BoardSupport/qemu-aarch64/linkin.ld)
 SET(KLINKER_SCRIPT ${CMAKE_SOURCE_DIR}/BoardSupport/klinkin.ld)
 
+# The core to build for. Anything with the ARMv8.1 atomics (LSE), like
+# cortex-a76 or neoverse-n1, gets single-instruction atomics instead of
+# exclusive load/store loops. Run QEMU with a matching -cpu.
+IF(NOT DEFINED TARGET_CPU)
+	SET(TARGET_CPU "cortex-a72")
+ENDIF()
+
 SET(CMAKE_ASM_FLAGS "${CMAKE_ASM_FLAGS}")
-SET(CMAKE_C_FLAGS "-target aarch64-none-elf -fPIE -mgeneral-regs-only -ffreestanding -nostdlib -c -Wall -Wextra -Wvla -mcpu=cortex-a72 -mtune=cortex-a72 -fno-builtin -fstack-protector ${CMAKE_C_FLAGS}")
-SET(CMAKE_CXX_FLAGS "-target aarch64-none-elf -fPIE -mgeneral-regs-only -ffreestanding -nostdlib -c -Wall -Wextra -Wvla -fno-rtti -fno-exceptions -mcpu=cortex-a72 -mtune=cortex-a72 -fno-builtin -fstack-protector ${CMAKE_CXX_FLAGS}")
+SET(CMAKE_C_FLAGS "-target aarch64-none-elf -fPIE -mgeneral-regs-only -ffreestanding -nostdlib -c -Wall -Wextra -Wvla -mcpu=${TARGET_CPU} -mtune=${TARGET_CPU} -fno-builtin -fstack-protector ${CMAKE_C_FLAGS}")
+SET(CMAKE_CXX_FLAGS "-target aarch64-none-elf -fPIE -mgeneral-regs-only -ffreestanding -nostdlib -c -Wall -Wextra -Wvla -fno-rtti -fno-exceptions -mcpu=${TARGET_CPU} -mtune=${TARGET_CPU} -fno-builtin -fstack-protector ${CMAKE_CXX_FLAGS}")
 SET(FSANITIZE_FLAGS "-fsanitize=undefined")
 
 SET(TARGET_SYSTEM "qemu-aarch64-virt")
@@ -53,7 +53,11 @@ extern "C" void kern_init_core()
 		/* Loop until core 0 finished essential kernel setup */
 	}
 
-	pantheon::CPU::InitCoreInfo(CpuNo);
+	/* Core 0 needed a scheduler early, to queue the initial programs onto. */
+	if (CpuNo != 0)
+	{
+		pantheon::CPU::InitCoreInfo(CpuNo);
+	}
 	PerCoreInit();
 
 	while (pantheon::GetKernelStatus() < pantheon::KERNEL_STATUS_OK)
@@ -67,10 +71,22 @@ extern "C" void kern_init_core()
 
 	for (;;)
 	{
-		if (CpuNo == 0)
+		/* An idle core has the time to free whatever exited on it, and
+		 * to clear pages before anyone asks for them. */
+		pantheon::Scheduler *Sched = pantheon::CPU::GetCurSched();
+		BOOL Reaped = Sched->Reap();
+		Sched->Balance();
+		BOOL Scrubbed = pantheon::PageAllocator::Scrub();
+		Sched->Reschedule();
+
+		/* There was nothing to run. Queueing a thread for this core
+		 * interrupts it, and the timer is only armed for the next
+		 * sleeper: either wakes this up. An interrupt taken since the
+		 * last WFE isn't lost, returning from it makes this one return
+		 * right away. */
+		if (Reaped == FALSE && Scrubbed == FALSE)
 		{
-			/* There's a few more races to deal with before enabling all-core scheduling */
-			pantheon::CPU::GetCurSched()->Reschedule();
+			pantheon::CPU::WFE();
 		}
 	}
 }
@@ -83,6 +99,7 @@ extern "C" void kern_init(InitialBootInfo *InitBootInfo)
 		pantheon::SetKernelStatus(pantheon::KERNEL_STATUS_INIT);
 		BoardRuntimeInit();
 		kern_basic_init(InitBootInfo);
+		pantheon::CPU::InitCoreInfo(0);
 		pantheon::SetKernelStatus(pantheon::KERNEL_STATUS_SECOND_STAGE);
 		kern_stage2_init();
 		pantheon::SetKernelStatus(pantheon::KERNEL_STATUS_OK);
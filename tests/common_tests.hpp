@@ -1,13 +1,28 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <kern.h>
 #include <kern_runtime.hpp>
 #include <kern_container.hpp>
+#include <byte_swap.hpp>
 #include <kern_integers.hpp>
 #include <kern_string.hpp>
 
 #include <Common/Sync/kern_atomic.hpp>
 
+#include <Sync/kern_rcu.hpp>
+#include <Sync/kern_mutex.hpp>
+#include <Sync/kern_seqlock.hpp>
+#include <Sync/kern_spinlock.hpp>
+#include <Sync/kern_lockstats.hpp>
+#include <Sync/kern_rwspinlock.hpp>
+
+#include "lock_bench.hpp"
+#include "mock_cores.hpp"
+
 #ifndef COMMON_TESTS_HPP_
 #define COMMON_TESTS_HPP_
 
@@ -950,6 +965,45 @@ TEST(KernAtomic, AtomicInteger)
 	ASSERT_EQ(Number.Load(), 37892388);
 }
 
+TEST(KernAtomic, ReadModifyWrite)
+{
+	pantheon::Atomic<UINT64> Number(5);
+	ASSERT_EQ(Number.FetchAdd(3), 5);
+	ASSERT_EQ(Number.FetchSub(2, pantheon::MemoryOrder::Relaxed), 8);
+	ASSERT_EQ(Number.Exchange(40, pantheon::MemoryOrder::AcqRel), 6);
+
+	UINT64 Expected = 41;
+	ASSERT_FALSE(Number.CompareExchange(Expected, 0, pantheon::MemoryOrder::Release));
+	ASSERT_EQ(Expected, 40);
+	ASSERT_TRUE(Number.CompareExchange(Expected, 0, pantheon::MemoryOrder::Acquire));
+	ASSERT_EQ(Number.Load(pantheon::MemoryOrder::Acquire), 0);
+}
+
+TEST(KernAtomic, ConcurrentFetchAdd)
+{
+	static constexpr UINT64 Threads = 4;
+	static constexpr UINT64 Rounds = 100000;
+
+	pantheon::Atomic<UINT64> Number(0);
+	std::vector<std::thread> Workers;
+	for (UINT64 Index = 0; Index < Threads; ++Index)
+	{
+		Workers.emplace_back([&]()
+		{
+			for (UINT64 Round = 0; Round < Rounds; ++Round)
+			{
+				Number.FetchAdd(1, pantheon::MemoryOrder::Relaxed);
+			}
+		});
+	}
+
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+	ASSERT_EQ(Number.Load(), Threads * Rounds);
+}
+
 TEST(KernAtomic, AtomicStruct)
 {
 	struct SomeData
@@ -977,4 +1031,353 @@ TEST(KernAtomic, AtomicStruct)
 	ASSERT_EQ(Number.Load().DataD[1], B.DataD[1]);
 }
 
+TEST(Spinlock, Contended)
+{
+	LockBenchReport Ticket = RunLockBench<pantheon::Spinlock>(4, 50);
+	ASSERT_FALSE(Ticket.Broken);
+	ASSERT_GT(Ticket.Fewest, 0);
+	pantheon::CPU::MockSetProcessorNumber(0);
+}
+
+TEST(QueuedSpinlock, Contended)
+{
+	LockBenchReport Queued = RunLockBench<pantheon::QueuedSpinlock>(4, 50);
+	ASSERT_FALSE(Queued.Broken);
+	ASSERT_GT(Queued.Fewest, 0);
+	pantheon::CPU::MockSetProcessorNumber(0);
+}
+
+TEST(QueuedSpinlock, Nested)
+{
+	pantheon::QueuedSpinlock Outer("outer");
+	pantheon::QueuedSpinlock Inner("inner");
+
+	Outer.Acquire();
+	Inner.Acquire();
+	ASSERT_TRUE(Outer.IsLocked());
+	ASSERT_TRUE(Inner.IsLocked());
+
+	/* Released out of order, which frees up the outer lock's node first. */
+	Outer.Release();
+	ASSERT_FALSE(Outer.IsLocked());
+	Outer.Acquire();
+	Inner.Release();
+	Outer.Release();
+	ASSERT_FALSE(Inner.IsLocked());
+	ASSERT_EQ(pantheon::CPU::ICOUNT(), 0);
+}
+
+static BOOL FindLockStats(const char *Name, pantheon::LockStats *Out)
+{
+	for (UINT64 Index = 0; pantheon::lockstats::Get(Index, Out); ++Index)
+	{
+		if (StringCompare(Out->Name, Name, pantheon::LockStatsNameLength))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+TEST(LockStats, CountsAcquires)
+{
+	pantheon::LockStats Stats;
+#if LOCK_STATS
+	pantheon::Spinlock Lock("lockstats test");
+	pantheon::CPU::MockSetProcessorNumber(0);
+	Lock.Acquire();
+
+	pantheon::Atomic<BOOL> Started(FALSE);
+	std::thread Waiter([&]()
+	{
+		pantheon::CPU::MockSetProcessorNumber(1);
+		Started.Store(TRUE);
+		Lock.Acquire();
+		Lock.Release();
+	});
+	while (Started.Load() == FALSE)
+	{
+		std::this_thread::yield();
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	Lock.Release();
+	Waiter.join();
+
+	ASSERT_TRUE(FindLockStats("lockstats test", &Stats));
+	ASSERT_EQ(Stats.Acquires, 2);
+	ASSERT_EQ(Stats.Contended, 1);
+	ASSERT_GT(Stats.SpinMax, 0);
+	ASSERT_GE(Stats.SpinTotal, Stats.SpinMax);
+	ASSERT_GE(Stats.HoldTotal, Stats.HoldMax);
+
+	/* Every lock with the same name is counted together. */
+	pantheon::Spinlock Other("lockstats test");
+	Other.Acquire();
+	Other.Release();
+	ASSERT_TRUE(FindLockStats("lockstats test", &Stats));
+	ASSERT_EQ(Stats.Acquires, 3);
+#else
+	/* Taking a lock records nothing at all. */
+	pantheon::Spinlock Lock("lockstats test");
+	Lock.Acquire();
+	Lock.Release();
+	ASSERT_FALSE(pantheon::lockstats::Get(0, &Stats));
+	ASSERT_FALSE(FindLockStats("lockstats test", &Stats));
+#endif
+}
+
+TEST(RWSpinlock, Readers)
+{
+	pantheon::RWSpinlock Lock("test");
+	pantheon::CPU::MockSetProcessorNumber(0);
+	Lock.AcquireRead();
+
+	/* Readers on other cores get in right away. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	Lock.AcquireRead();
+	ASSERT_EQ(Lock.Readers(), 2);
+	Lock.ReleaseRead();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	/* A writer has to wait for the last reader. */
+	BOOL Wrote = FALSE;
+	std::thread Writer([&Lock, &Wrote]()
+	{
+		pantheon::CPU::MockSetProcessorNumber(1);
+		Lock.AcquireWrite();
+		__atomic_store_n(&Wrote, TRUE, __ATOMIC_SEQ_CST);
+		Lock.ReleaseWrite();
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_FALSE(__atomic_load_n(&Wrote, __ATOMIC_SEQ_CST));
+	Lock.ReleaseRead();
+	Writer.join();
+
+	ASSERT_TRUE(Wrote);
+	ASSERT_FALSE(Lock.IsLocked());
+	ASSERT_EQ(pantheon::CPU::ICOUNT(), 0);
+}
+
+TEST(SeqLock, Consistent)
+{
+	static constexpr UINT64 NumWrites = 20000;
+	pantheon::SeqLock Lock("test");
+	pantheon::Atomic<UINT64> First(0);
+	pantheon::Atomic<UINT64> Second(0);
+
+	std::thread Writer([&]()
+	{
+		pantheon::CPU::MockSetProcessorNumber(1);
+		for (UINT64 Index = 1; Index <= NumWrites; ++Index)
+		{
+			Lock.AcquireWrite();
+			First.Store(Index);
+			Second.Store(Index);
+			Lock.ReleaseWrite();
+		}
+	});
+
+	/* Whatever a reader sees, it never sees half of a write. */
+	UINT64 Last = 0;
+	while (Last != NumWrites)
+	{
+		UINT64 Start = 0;
+		UINT64 A = 0;
+		UINT64 B = 0;
+		do
+		{
+			Start = Lock.ReadBegin();
+			A = First.Load();
+			B = Second.Load();
+		} while (Lock.ReadRetry(Start));
+		ASSERT_EQ(A, B);
+		ASSERT_GE(A, Last);
+		Last = A;
+	}
+	Writer.join();
+}
+
+static VOID MockReclaim(VOID *Arg)
+{
+	(*static_cast<UINT64*>(Arg))++;
+}
+
+TEST(RCU, GracePeriod)
+{
+	SetupMockCores();
+	UINT64 Freed = 0;
+	pantheon::rcu::Head Node;
+
+	/* Core 1 is looking at something while core 0 unpublishes it. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::rcu::ReadLock();
+	ASSERT_TRUE(pantheon::rcu::InReadSection());
+
+	pantheon::CPU::MockSetProcessorNumber(0);
+	pantheon::rcu::Defer(&Node, MockReclaim, &Freed);
+	ASSERT_EQ(pantheon::rcu::Pending(), 1);
+
+	/* No matter how often the other cores go by, core 1 holds it up. */
+	for (UINT64 Round = 0; Round < 4; ++Round)
+	{
+		for (UINT8 Core = 0; Core < MAX_NUM_CPUS; ++Core)
+		{
+			if (Core == 1)
+			{
+				continue;
+			}
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			pantheon::rcu::Quiescent();
+		}
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(Freed, 0);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::rcu::ReadUnlock();
+	ASSERT_FALSE(pantheon::rcu::InReadSection());
+	pantheon::rcu::Quiescent();
+
+	/* Freed by the core which deferred it, at its next quiescent point. */
+	pantheon::CPU::MockSetProcessorNumber(0);
+	pantheon::rcu::Quiescent();
+	ASSERT_EQ(Freed, 1);
+	ASSERT_EQ(pantheon::rcu::Pending(), 0);
+	ASSERT_EQ(pantheon::CPU::ICOUNT(), 0);
+}
+
+TEST(RCU, Reschedule)
+{
+	SetupMockCores();
+	UINT64 Freed = 0;
+	pantheon::rcu::Head Node;
+
+	pantheon::rcu::Defer(&Node, MockReclaim, &Freed);
+	UINT64 Epoch = pantheon::rcu::CurrentEpoch();
+
+	/* Rescheduling is a quiescent point, even with nothing to switch to. */
+	for (UINT64 Round = 0; Round < 2 && Freed == 0; ++Round)
+	{
+		for (UINT8 Core = 0; Core < MAX_NUM_CPUS; ++Core)
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			pantheon::CPU::GetSched(Core)->Reschedule();
+		}
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+	pantheon::CPU::GetSched(0)->Reschedule();
+	ASSERT_GT(pantheon::rcu::CurrentEpoch(), Epoch);
+	ASSERT_EQ(Freed, 1);
+}
+
+TEST(Mutex, Uncontended)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Thread *Zero = RunMockThread(pantheon::CPU::GetSched(0), &Proc);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *One = RunMockThread(pantheon::CPU::GetSched(1), &Proc);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	pantheon::Mutex Mtx("test");
+	ASSERT_TRUE(Mtx.TryAcquire());
+	ASSERT_TRUE(Mtx.IsHolding());
+	ASSERT_EQ(Mtx.Owner(), Zero);
+	ASSERT_EQ(Zero->HeldMutexes(), &Mtx);
+
+	/* Some other thread can't take it, and doesn't think it has it. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	ASSERT_FALSE(Mtx.TryAcquire());
+	ASSERT_FALSE(Mtx.IsHolding());
+	ASSERT_EQ(One->HeldMutexes(), nullptr);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	Mtx.Release();
+	ASSERT_FALSE(Mtx.IsLocked());
+	ASSERT_EQ(Zero->HeldMutexes(), nullptr);
+
+	/* Interrupts stay on while it's held. */
+	Mtx.Acquire();
+	ASSERT_EQ(pantheon::CPU::ICOUNT(), 0);
+	Mtx.Release();
+}
+
+TEST(Mutex, PromoteQueued)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::Thread *Low = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_LOW);
+	EnqueueMockThread(Zero, Low);
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+
+	/* Lent a priority while queued, it doesn't wait behind the others. */
+	Low->Lock();
+	Low->InheritPriority(pantheon::Thread::PRIORITY_HIGH);
+	pantheon::Scheduler::Promote(Low);
+	ASSERT_EQ(Low->MyPriority(), pantheon::Thread::PRIORITY_HIGH);
+	ASSERT_EQ(Low->BasePriority(), pantheon::Thread::PRIORITY_LOW);
+	Low->Unlock();
+
+	ASSERT_EQ(Zero->CountReady(), 3);
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Low);
+}
+
+TEST(Mutex, PriorityInheritance)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	pantheon::Thread *Low = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_LOW);
+	EnqueueMockThread(Zero, Low);
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Low);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *High = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_VERYHIGH);
+	EnqueueMockThread(One, High);
+	One->Reschedule();
+	ASSERT_EQ(One->MyThread(), High);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	pantheon::Mutex Mtx("test");
+	Mtx.Acquire();
+
+	std::thread Waiter([&Mtx]()
+	{
+		pantheon::CPU::MockSetProcessorNumber(1);
+		Mtx.Acquire();
+	});
+
+	/* Until it gives up the mutex, the holder runs as the waiter would. */
+	for (;;)
+	{
+		pantheon::ScopedLock _L(Low);
+		if (Low->MyPriority() == pantheon::Thread::PRIORITY_VERYHIGH)
+		{
+			break;
+		}
+	}
+
+	Mtx.Release();
+	Waiter.join();
+
+	ASSERT_EQ(Mtx.Owner(), High);
+	ASSERT_EQ(High->HeldMutexes(), &Mtx);
+	ASSERT_EQ(Low->HeldMutexes(), nullptr);
+	Low->Lock();
+	ASSERT_EQ(Low->MyPriority(), pantheon::Thread::PRIORITY_LOW);
+	Low->Unlock();
+	High->Lock();
+	ASSERT_EQ(High->BlockedOn(), nullptr);
+	High->Unlock();
+}
+
 #endif
\ No newline at end of file
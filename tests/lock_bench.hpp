@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+
+#include <kern_datatypes.hpp>
+#include <Sync/kern_spinlock.hpp>
+
+#include <Proc/kern_cpu.hpp>
+
+#ifndef LOCK_BENCH_HPP_
+#define LOCK_BENCH_HPP_
+
+/* A contention benchmark for the spinlocks, on the mock board.
+ *
+ * Some number of host threads each pretend to be a core, and fight over
+ * one lock for some number of milliseconds, doing a little bit of work
+ * each time they get it.
+ * Besides how many times the lock was taken overall, this reports how
+ * evenly that was shared out among the cores: an unfair lock lets
+ * whichever core last held it win again and again.
+ */
+
+/* What Spinlock used to be, to compare the others against. */
+class TestAndSetLock
+{
+public:
+	void Acquire()
+	{
+		pantheon::CPU::PUSHI();
+		while (__sync_lock_test_and_set(&this->Locked, TRUE))
+		{
+			while (__atomic_load_n(&this->Locked, __ATOMIC_RELAXED))
+			{
+				pantheon::CPU::PAUSE();
+			}
+		}
+	}
+
+	void Release()
+	{
+		__sync_lock_release(&this->Locked);
+		pantheon::CPU::POPI();
+	}
+
+private:
+	BOOL Locked = FALSE;
+};
+
+struct LockBenchReport
+{
+	UINT64 Nanos;
+	UINT64 Total;
+	UINT64 Fewest;
+	UINT64 Most;
+
+	/* Set if two cores were ever in the critical section together. */
+	BOOL Broken;
+};
+
+template<typename LockType>
+static LockBenchReport RunLockBench(UINT8 NumCores, UINT64 Millis)
+{
+	LockType Lock;
+	UINT64 Shared = 0;
+	BOOL Inside = FALSE;
+	BOOL Broken = FALSE;
+	BOOL Stop = FALSE;
+	std::vector<UINT64> Taken(NumCores, 0);
+
+	auto Start = std::chrono::steady_clock::now();
+	std::vector<std::thread> Cores;
+	for (UINT8 Core = 0; Core < NumCores; ++Core)
+	{
+		Cores.emplace_back([&, Core]()
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			while (__atomic_load_n(&Stop, __ATOMIC_RELAXED) == FALSE)
+			{
+				Lock.Acquire();
+				if (Inside)
+				{
+					Broken = TRUE;
+				}
+				Inside = TRUE;
+				Shared++;
+				Taken[Core]++;
+				Inside = FALSE;
+				Lock.Release();
+			}
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(Millis));
+	__atomic_store_n(&Stop, TRUE, __ATOMIC_RELAXED);
+	for (std::thread &Core : Cores)
+	{
+		Core.join();
+	}
+	auto End = std::chrono::steady_clock::now();
+
+	LockBenchReport Report = {};
+	Report.Nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count();
+	Report.Total = Shared;
+	Report.Fewest = *std::min_element(Taken.begin(), Taken.end());
+	Report.Most = *std::max_element(Taken.begin(), Taken.end());
+
+	UINT64 Sum = 0;
+	for (UINT64 Count : Taken)
+	{
+		Sum += Count;
+	}
+	Report.Broken = Broken || (Shared != Sum);
+	return Report;
+}
+
+#endif
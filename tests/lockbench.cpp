@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "lock_bench.hpp"
+
+static VOID PrintLockBench(const char *Name, UINT8 NumCores, const LockBenchReport &Report)
+{
+	UINT64 Nanos = std::max<UINT64>(Report.Nanos, 1);
+	printf("%-14s %hhu cores: %lu acquires, %lu ns each, fewest %lu, most %lu%s\n",
+		Name, NumCores, Report.Total, Nanos / std::max<UINT64>(Report.Total, 1),
+		Report.Fewest, Report.Most, Report.Broken ? " (BROKEN)" : "");
+}
+
+/* Compares the spinlocks against each other, with more and more cores
+ * fighting over them. Takes an optional number of milliseconds to run
+ * each one for. */
+int main(int argc, char **argv)
+{
+	UINT64 Millis = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 1000;
+
+	for (UINT8 Cores : {2, 4, 8})
+	{
+		PrintLockBench("test-and-set", Cores, RunLockBench<TestAndSetLock>(Cores, Millis));
+		PrintLockBench("ticket", Cores, RunLockBench<pantheon::Spinlock>(Cores, Millis));
+		PrintLockBench("queued", Cores, RunLockBench<pantheon::QueuedSpinlock>(Cores, Millis));
+	}
+
+	/* The kernel object pools are never torn down, so don't do it here either. */
+	fflush(stdout);
+	_Exit(0);
+}
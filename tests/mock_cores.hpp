@@ -0,0 +1,65 @@
+#include <kern_datatypes.hpp>
+#include <Sync/kern_rcu.hpp>
+
+#include <Proc/kern_cpu.hpp>
+#include <Proc/kern_proc.hpp>
+#include <Proc/kern_sched.hpp>
+#include <Proc/kern_thread.hpp>
+
+#ifndef MOCK_CORES_HPP_
+#define MOCK_CORES_HPP_
+
+/* Setting up the cores of the mock board, and putting threads on them,
+ * for any test which needs the scheduler around. */
+
+static void SetupMockCores()
+{
+	pantheon::InitProcessTables();
+	pantheon::GlobalScheduler::Init();
+
+	/* Set up every core, so nothing is left queued from some other test. */
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::CPU::MockSetProcessorNumber(Index);
+		pantheon::CPU::InitCoreInfo(Index);
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+}
+
+/* Lets every core go by enough times for whatever was deferred to be freed. */
+static void PassMockGracePeriods()
+{
+	for (UINT64 Round = 0; Round < 4; ++Round)
+	{
+		for (UINT8 Core = 0; Core < MAX_NUM_CPUS; ++Core)
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			pantheon::rcu::Quiescent();
+		}
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+}
+
+static pantheon::Thread *CreateMockThread(pantheon::Process *Proc, pantheon::Thread::Priority Priority = pantheon::Thread::PRIORITY_NORMAL)
+{
+	pantheon::Thread *T = pantheon::Thread::Create();
+	T->Initialize(Proc, nullptr, nullptr, Priority, FALSE);
+	return T;
+}
+
+static void EnqueueMockThread(pantheon::Scheduler *Sched, pantheon::Thread *T)
+{
+	T->Lock();
+	Sched->Enqueue(T);
+	T->Unlock();
+}
+
+static pantheon::Thread *RunMockThread(pantheon::Scheduler *Sched, pantheon::Process *Proc)
+{
+	pantheon::Thread *T = CreateMockThread(Proc);
+	EnqueueMockThread(Sched, T);
+	Sched->Reschedule();
+	return T;
+}
+
+#endif
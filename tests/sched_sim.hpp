@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <stdio.h>
+
+#include <kern_datatypes.hpp>
+
+#include <Proc/kern_cpu.hpp>
+#include <Proc/kern_proc.hpp>
+#include <Proc/kern_sched.hpp>
+#include <Proc/kern_thread.hpp>
+#include <Proc/kern_proctable.hpp>
+#include <Proc/kern_waitqueue.hpp>
+
+#ifndef SCHED_SIM_HPP_
+#define SCHED_SIM_HPP_
+
+/* A discrete-event simulation of the scheduler on the mock board.
+ *
+ * Some number of cores run a synthetic workload on the real Scheduler:
+ * threads of mixed priorities which either compute for a while and then
+ * block on some I/O, or never block at all. Virtual time jumps straight
+ * from one event (a burst ending, an I/O completing, or a core's timer
+ * going off) to the next. Everything is driven from one host thread, so a
+ * given seed always produces exactly the same schedule.
+ *
+ * The only numbers which aren't deterministic are the lock hold times,
+ * which are measured in host nanoseconds.
+ */
+
+struct SimConfig
+{
+	UINT64 Seed;
+	UINT8 NumCores;
+	UINT64 NumThreads;
+
+	/* How long to run for, in ticks. */
+	UINT64 Length;
+
+	/* The average number of ticks a thread computes for, before blocking. */
+	UINT64 MeanBurst;
+
+	/* The average number of ticks it then stays blocked for. */
+	UINT64 MeanIO;
+
+	/* How many threads out of 100 ever block. The rest only compute. */
+	UINT64 IOPercent;
+};
+
+struct SimReport
+{
+	UINT64 Ticks;
+	UINT64 BusyTicks;
+	UINT64 Bursts;
+	UINT64 Switches;
+
+	/* Ticks spent ready, but not running. */
+	UINT64 Waits;
+	UINT64 WaitP50;
+	UINT64 WaitP90;
+	UINT64 WaitP99;
+	UINT64 WaitMax;
+
+	/* Host nanoseconds some core held any spinlock. */
+	UINT64 Holds;
+	UINT64 HoldP50;
+	UINT64 HoldP99;
+	UINT64 HoldMax;
+};
+
+/* The timer is programmed for 1000Hz by kern_init_core. */
+static constexpr UINT64 SimTicksPerSecond = 1000;
+
+struct SimThread
+{
+	pantheon::Thread *T;
+	BOOL Interactive;
+	BOOL Blocked;
+	UINT64 Token;
+	UINT64 WakeAt;
+	UINT64 ReadySince;
+
+	/* Ticks left until this thread blocks, or finishes some work. */
+	UINT64 Remaining;
+};
+
+struct SimRandom
+{
+	UINT64 State;
+
+	UINT64 Next()
+	{
+		/* xorshift64* */
+		this->State ^= this->State >> 12;
+		this->State ^= this->State << 25;
+		this->State ^= this->State >> 27;
+		return this->State * 2685821657736338717ULL;
+	}
+
+	UINT64 Range(UINT64 Lo, UINT64 Hi)
+	{
+		return Lo + (this->Next() % (Hi - Lo + 1));
+	}
+};
+
+static std::vector<UINT64> SimHoldTimes;
+
+static VOID SimRecordHold(UINT64 Nanos)
+{
+	SimHoldTimes.push_back(Nanos);
+}
+
+static UINT64 SimPercentile(const std::vector<UINT64> &Sorted, UINT64 Percent)
+{
+	if (Sorted.empty())
+	{
+		return 0;
+	}
+	return Sorted[((Sorted.size() - 1) * Percent) / 100];
+}
+
+static VOID SimSetupCores()
+{
+	pantheon::InitProcessTables();
+	pantheon::GlobalScheduler::Init();
+
+	/* Whatever ran before may have left some timer armed. */
+	for (UINT8 Index = 0; Index < MAX_NUM_CPUS; ++Index)
+	{
+		pantheon::CPU::MockSetProcessorNumber(Index);
+		pantheon::CPU::InitCoreInfo(Index);
+		pantheon::DisableSystemTimer();
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+}
+
+static pantheon::Thread::Priority SimPriority(SimRandom &Rand, BOOL Interactive)
+{
+	/* Interactive threads tend to be the more important ones. */
+	UINT64 Base = Interactive ? pantheon::Thread::PRIORITY_NORMAL : pantheon::Thread::PRIORITY_VERYLOW;
+	return static_cast<pantheon::Thread::Priority>(Rand.Range(Base, Base + 2));
+}
+
+static SimReport RunSchedSim(const SimConfig &Config)
+{
+	SimSetupCores();
+	SimRandom Rand = {Config.Seed ? Config.Seed : 1};
+
+	/* Keep everything on the simulated cores. */
+	UINT64 CoreMask = (1ULL << Config.NumCores) - 1;
+
+	pantheon::Process Proc;
+	std::vector<SimThread> Threads(Config.NumThreads);
+	std::unordered_map<pantheon::Thread*, SimThread*> Lookup;
+
+	UINT64 Start = pantheon::GetSystemTicks();
+	UINT64 End = Start + Config.Length;
+	for (UINT64 Index = 0; Index < Config.NumThreads; ++Index)
+	{
+		SimThread &S = Threads[Index];
+		S.Interactive = Rand.Range(1, 100) <= Config.IOPercent;
+		S.Blocked = FALSE;
+		S.ReadySince = Start;
+		S.Remaining = Rand.Range(1, 2 * Config.MeanBurst);
+
+		S.T = pantheon::Thread::Create();
+		S.T->Initialize(&Proc, nullptr, nullptr, SimPriority(Rand, S.Interactive), FALSE);
+		Lookup[S.T] = &S;
+
+		pantheon::ScopedLock _T(S.T);
+		S.T->SetAffinity(CoreMask);
+		pantheon::CPU::GetSched(Index % Config.NumCores)->Enqueue(S.T);
+	}
+
+	SimReport Report = {};
+	std::vector<UINT64> Waits;
+	pantheon::Thread *Running[MAX_NUM_CPUS] = {};
+	for (UINT8 Core = 0; Core < Config.NumCores; ++Core)
+	{
+		Running[Core] = pantheon::CPU::GetSched(Core)->MyThread();
+	}
+
+	SimHoldTimes.clear();
+	pantheon::CPU::MockSetHoldHook(SimRecordHold);
+
+	UINT64 Now = Start;
+	for (;;)
+	{
+		/* I/O completions come in on core 0, like any other interrupt. */
+		pantheon::CPU::MockSetProcessorNumber(0);
+		for (SimThread &S : Threads)
+		{
+			if (S.Blocked && S.WakeAt <= Now)
+			{
+				S.Blocked = FALSE;
+				S.ReadySince = Now;
+				pantheon::WakeThread(S.T, S.Token, 0);
+			}
+		}
+
+		for (UINT8 Core = 0; Core < Config.NumCores; ++Core)
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Core);
+
+			auto Cur = Lookup.find(Sched->MyThread());
+			SimThread *S = (Cur == Lookup.end()) ? nullptr : Cur->second;
+			if (S != nullptr && S->Remaining == 0)
+			{
+				Report.Bursts++;
+				S->Remaining = Rand.Range(1, 2 * Config.MeanBurst);
+				if (S->Interactive)
+				{
+					S->Blocked = TRUE;
+					S->WakeAt = Now + Rand.Range(1, 2 * Config.MeanIO);
+
+					pantheon::ScopedLock _T(S->T);
+					S->Token = S->T->BeginWait();
+					S->T->Block();
+				}
+			}
+
+			if (S != nullptr && S->Blocked)
+			{
+				Sched->Reschedule();
+			}
+			else if (pantheon::MockTimerDeadline() <= Now)
+			{
+				pantheon::AttemptReschedule();
+			}
+			else if (S == nullptr)
+			{
+				/* Just like the idle loop in kern_init_core. */
+				Sched->Reap();
+				Sched->Balance();
+				Sched->Reschedule();
+			}
+
+			pantheon::Thread *Next = Sched->MyThread();
+			if (Next == Running[Core])
+			{
+				continue;
+			}
+
+			Report.Switches++;
+			if (S != nullptr && !S->Blocked)
+			{
+				S->ReadySince = Now;
+			}
+
+			auto Woken = Lookup.find(Next);
+			if (Woken != Lookup.end())
+			{
+				Waits.push_back(Now - Woken->second->ReadySince);
+			}
+			Running[Core] = Next;
+		}
+
+		/* Jump ahead to whatever happens next. */
+		UINT64 NextEvent = End;
+		for (const SimThread &S : Threads)
+		{
+			if (S.Blocked)
+			{
+				NextEvent = std::min(NextEvent, S.WakeAt);
+			}
+		}
+
+		for (UINT8 Core = 0; Core < Config.NumCores; ++Core)
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			NextEvent = std::min(NextEvent, pantheon::MockTimerDeadline());
+
+			auto Cur = Lookup.find(Running[Core]);
+			if (Cur != Lookup.end())
+			{
+				NextEvent = std::min(NextEvent, Now + Cur->second->Remaining);
+			}
+		}
+		NextEvent = std::max(NextEvent, Now + 1);
+		NextEvent = std::min(NextEvent, End);
+
+		UINT64 Delta = NextEvent - Now;
+		for (UINT8 Core = 0; Core < Config.NumCores; ++Core)
+		{
+			auto Cur = Lookup.find(Running[Core]);
+			if (Cur != Lookup.end())
+			{
+				Cur->second->Remaining -= std::min(Cur->second->Remaining, Delta);
+				Report.BusyTicks += Delta;
+			}
+		}
+
+		pantheon::MockAdvanceTicks(Delta);
+		Now = NextEvent;
+		if (Now >= End)
+		{
+			break;
+		}
+	}
+
+	pantheon::CPU::MockSetHoldHook(nullptr);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	std::sort(Waits.begin(), Waits.end());
+	std::sort(SimHoldTimes.begin(), SimHoldTimes.end());
+
+	Report.Ticks = Config.Length;
+	Report.Waits = Waits.size();
+	Report.WaitP50 = SimPercentile(Waits, 50);
+	Report.WaitP90 = SimPercentile(Waits, 90);
+	Report.WaitP99 = SimPercentile(Waits, 99);
+	Report.WaitMax = Waits.empty() ? 0 : Waits.back();
+
+	Report.Holds = SimHoldTimes.size();
+	Report.HoldP50 = SimPercentile(SimHoldTimes, 50);
+	Report.HoldP99 = SimPercentile(SimHoldTimes, 99);
+	Report.HoldMax = SimHoldTimes.empty() ? 0 : SimHoldTimes.back();
+
+	/* The threads reference Proc: don't leave them anywhere they can run. */
+	SimSetupCores();
+	return Report;
+}
+
+#endif
@@ -1,12 +1,24 @@
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <kern_runtime.hpp>
 #include <kern_container.hpp>
 
 #include <Proc/kern_cpu.hpp>
+#include <Proc/kern_futex.hpp>
+#include <Proc/kern_asid.hpp>
 #include <Proc/kern_proc.hpp>
 #include <Proc/kern_sched.hpp>
 #include <Proc/kern_thread.hpp>
+#include <Proc/kern_proctable.hpp>
+#include <Proc/kern_waitqueue.hpp>
+
+#include <vmm/vmm.hpp>
+
+#include "sched_sim.hpp"
+#include "mock_cores.hpp"
 
 #ifndef SCHED_TESTS_HPP_
 #define SCHED_TESTS_HPP_
@@ -27,7 +39,7 @@ TEST(Scheduler, CreateThreadWithProc)
 TEST(Scheduler, CreateThreadWithProcName)
 {
 	pantheon::Process Proc;
-	pantheon::ProcessCreateInfo Info = {nullptr};
+	pantheon::ProcessCreateInfo Info = {};
 	Info.Name = "./someprocess";
 	Proc.Lock();
 	Proc.Initialize(Info);
@@ -41,7 +53,7 @@ TEST(Scheduler, CreateThreadWithProcNameKernelString)
 {
 	pantheon::String MyStr("./someprocess");
 	pantheon::Process Proc;
-	pantheon::ProcessCreateInfo Info = {nullptr};
+	pantheon::ProcessCreateInfo Info = {};
 	Info.Name = MyStr;
 	Proc.Lock();
 	Proc.Initialize(Info);
@@ -222,7 +234,7 @@ TEST(Scheduler, DefaultProcessName)
 
 TEST(Scheduler, ManyProcessIDs)
 {
-	pantheon::ProcessCreateInfo Info = {nullptr};
+	pantheon::ProcessCreateInfo Info = {};
 	Info.Name = "one";
 
 	pantheon::Process OneProc;
@@ -263,7 +275,7 @@ TEST(Scheduler, ManyThreadIDs)
 TEST(Scheduler, ProcessFromRawString)
 {
 	const char *SomeRawString = "some raw string";
-	pantheon::ProcessCreateInfo Info = {nullptr};
+	pantheon::ProcessCreateInfo Info = {};
 	Info.Name = SomeRawString;
 
 	pantheon::Process Proc;
@@ -282,4 +294,1102 @@ TEST(Scheduler, ProcessFromRawString)
 	ASSERT_NE(Proc.ProcessID(), Proc2.ProcessID());
 }
 
+TEST(Scheduler, ProcessTableLookup)
+{
+	pantheon::ProcessCreateInfo Info = {};
+	Info.Name = "table";
+
+	pantheon::Process Procs[4];
+	pantheon::ProcessTable Table;
+	for (pantheon::Process &Proc : Procs)
+	{
+		Proc.Lock();
+		Proc.Initialize(Info);
+		Proc.Unlock();
+		ASSERT_TRUE(Table.Insert(&Proc));
+	}
+
+	ASSERT_EQ(Table.Count(), 4);
+	pantheon::rcu::ScopedReadSection _R;
+	for (pantheon::Process &Proc : Procs)
+	{
+		ASSERT_EQ(Table.Lookup(Proc.ProcessID()), &Proc);
+	}
+	ASSERT_FALSE(Table.Insert(&Procs[0]));
+	ASSERT_EQ(Table.Lookup(Procs[3].ProcessID() + 1), nullptr);
+
+	/* Same slot, but some other generation of it. */
+	ASSERT_EQ(Table.Lookup(Procs[3].ProcessID() + pantheon::ProcessTable::NumSlots), nullptr);
+}
+
+TEST(Scheduler, ProcessTableRemove)
+{
+	pantheon::ProcessCreateInfo Info = {};
+	Info.Name = "table";
+
+	pantheon::Process Procs[3];
+	pantheon::ProcessTable Table;
+	for (pantheon::Process &Proc : Procs)
+	{
+		Proc.Lock();
+		Proc.Initialize(Info);
+		Proc.Unlock();
+		ASSERT_TRUE(Table.Insert(&Proc));
+	}
+
+	pantheon::rcu::ScopedReadSection _R;
+	ASSERT_TRUE(Table.Remove(Procs[1].ProcessID()));
+	ASSERT_FALSE(Table.Remove(Procs[1].ProcessID()));
+	ASSERT_EQ(Table.Lookup(Procs[1].ProcessID()), nullptr);
+	ASSERT_EQ(Table.Lookup(Procs[2].ProcessID()), &Procs[2]);
+	ASSERT_EQ(Table.Count(), 2);
+
+	ASSERT_TRUE(Table.Insert(&Procs[1]));
+	ASSERT_EQ(Table.Lookup(Procs[1].ProcessID()), &Procs[1]);
+
+	/* Churn never leaves anything behind to fill the table up. */
+	for (UINT64 Index = 0; Index < 4 * pantheon::ProcessTable::NumSlots; ++Index)
+	{
+		ASSERT_TRUE(Table.Remove(Procs[0].ProcessID()));
+		ASSERT_TRUE(Table.Insert(&Procs[0]));
+	}
+	ASSERT_EQ(Table.Count(), 3);
+	ASSERT_EQ(Table.Lookup(Procs[0].ProcessID()), &Procs[0]);
+}
+
+TEST(Scheduler, ASIDUnique)
+{
+	pantheon::ASIDAllocator ASIDs;
+	pantheon::Atomic<UINT64> Contexts[pantheon::ASIDAllocator::Count - 1];
+	BOOL Seen[pantheon::ASIDAllocator::Count] = {FALSE};
+
+	BOOL Flush = FALSE;
+	for (pantheon::Atomic<UINT64> &Context : Contexts)
+	{
+		UINT64 ASID = ASIDs.Activate(Context, 0, Flush);
+		ASSERT_NE(ASID, 0);
+		ASSERT_FALSE(Seen[ASID]);
+		Seen[ASID] = TRUE;
+		ASSERT_EQ(Flush, &Context == &Contexts[0]);
+	}
+	ASSERT_EQ(ASIDs.Generation(), 1);
+
+	/* Switching back to an address space changes nothing. */
+	UINT64 Before = Contexts[3].Load();
+	ASSERT_EQ(ASIDs.Activate(Contexts[3], 0, Flush), Before & pantheon::ASIDAllocator::Mask);
+	ASSERT_EQ(Contexts[3].Load(), Before);
+	ASSERT_FALSE(Flush);
+}
+
+TEST(Scheduler, ASIDRollover)
+{
+	pantheon::ASIDAllocator ASIDs;
+	pantheon::Atomic<UINT64> Running;
+	pantheon::Atomic<UINT64> Others[pantheon::ASIDAllocator::Count - 1];
+
+	BOOL Flush = FALSE;
+	UINT64 Kept = ASIDs.Activate(Running, 1, Flush);
+	for (UINT64 Index = 0; Index < pantheon::ASIDAllocator::Count - 2; ++Index)
+	{
+		ASIDs.Activate(Others[Index], 0, Flush);
+	}
+	ASSERT_EQ(ASIDs.Generation(), 1);
+
+	/* Nothing's left: everyone but what's loaded right now loses their ASID. */
+	UINT64 Last = Others[pantheon::ASIDAllocator::Count - 3].Load() & pantheon::ASIDAllocator::Mask;
+	UINT64 Fresh = ASIDs.Activate(Others[pantheon::ASIDAllocator::Count - 2], 0, Flush);
+	ASSERT_EQ(ASIDs.Generation(), 2);
+	ASSERT_TRUE(Flush);
+	ASSERT_NE(Fresh, Kept);
+	ASSERT_NE(Fresh, Last);
+
+	/* Core 1 was still running with its ASID, so that's kept. */
+	ASSERT_EQ(ASIDs.Activate(Running, 1, Flush), Kept);
+	ASSERT_TRUE(Flush);
+	ASSERT_EQ(Running.Load() >> pantheon::ASIDAllocator::Bits, 2);
+
+	ASSERT_EQ(ASIDs.Activate(Running, 1, Flush), Kept);
+	ASSERT_FALSE(Flush);
+}
+
+TEST(Scheduler, ProcessThreadAccounting)
+{
+	pantheon::ProcessCreateInfo Info = {};
+	Info.Name = "counted";
+
+	pantheon::Process Proc;
+	Proc.Lock();
+	Proc.Initialize(Info);
+	ASSERT_TRUE(Proc.IsAlive());
+	Proc.SetState(pantheon::Process::STATE_RUNNING);
+
+	pantheon::Thread Threads[3];
+	for (pantheon::Thread &T : Threads)
+	{
+		Proc.AttachThread(&T);
+	}
+	ASSERT_EQ(Proc.CountThreads(), 3);
+	ASSERT_EQ(Proc.FirstThread(), &Threads[2]);
+
+	Threads[1].Lock();
+	Threads[1].SetState(pantheon::Thread::STATE_TERMINATED);
+	Threads[1].Unlock();
+	ASSERT_EQ(Proc.ThreadExited(), 2);
+	Proc.DetachThread(&Threads[1]);
+	ASSERT_EQ(Proc.CountAttachedThreads(), 2);
+	ASSERT_EQ(Proc.CountThreads(), 2);
+	ASSERT_EQ(Threads[2].NextInProcess(), &Threads[0]);
+	ASSERT_EQ(Threads[0].PrevInProcess(), &Threads[2]);
+
+	ASSERT_EQ(Proc.ThreadExited(), 1);
+	ASSERT_EQ(Proc.ThreadExited(), 0);
+	ASSERT_FALSE(Proc.IsAlive());
+	Proc.Unlock();
+}
+
+TEST(Scheduler, RunQueuePerCore)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	ASSERT_EQ(Zero->CountReady(), 2);
+	ASSERT_EQ(One->CountReady(), 0);
+
+	pantheon::Thread *First = CreateMockThread(&Proc);
+	EnqueueMockThread(One, First);
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	ASSERT_EQ(One->MyThread(), First);
+	ASSERT_EQ(Zero->CountReady(), 2);
+}
+
+TEST(Scheduler, RunQueueSteal)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	pantheon::Thread *First = CreateMockThread(&Proc);
+	EnqueueMockThread(Zero, First);
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	ASSERT_EQ(One->MyThread(), First);
+	ASSERT_EQ(Zero->CountReady(), 2);
+}
+
+TEST(Scheduler, RunQueueNoStealLast)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	pantheon::Thread *Idle = One->MyThread();
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	ASSERT_EQ(One->MyThread(), Idle);
+	ASSERT_EQ(Zero->CountReady(), 1);
+}
+
+TEST(Scheduler, PriorityRunQueue)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::Thread *High = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_VERYHIGH);
+	EnqueueMockThread(Zero, CreateMockThread(&Proc, pantheon::Thread::PRIORITY_LOW));
+	EnqueueMockThread(Zero, CreateMockThread(&Proc, pantheon::Thread::PRIORITY_NORMAL));
+	EnqueueMockThread(Zero, High);
+
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), High);
+}
+
+TEST(Scheduler, PriorityAging)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::Thread *Low = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_VERYLOW);
+	EnqueueMockThread(Zero, Low);
+	for (UINT64 Index = 0; Index < 4; ++Index)
+	{
+		EnqueueMockThread(Zero, CreateMockThread(&Proc, pantheon::Thread::PRIORITY_HIGH));
+	}
+
+	/* It only moves up a level every 8 picks: it needs three of those first. */
+	UINT64 Rounds = 0;
+	BOOL Ran = FALSE;
+	for (; Rounds < 64 && !Ran; ++Rounds)
+	{
+		Zero->Reschedule();
+		Ran = (Zero->MyThread() == Low);
+	}
+	ASSERT_TRUE(Ran);
+	ASSERT_GT(Rounds, 16);
+}
+
+TEST(Scheduler, ConcurrentReschedule)
+{
+	constexpr UINT8 NumCores = 4;
+	constexpr UINT64 ThreadsPerCore = 8;
+	constexpr UINT64 NumRounds = 10000;
+
+	SetupMockCores();
+	pantheon::Process Proc;
+	for (UINT8 Core = 0; Core < NumCores; ++Core)
+	{
+		for (UINT64 Index = 0; Index < ThreadsPerCore; ++Index)
+		{
+			EnqueueMockThread(pantheon::CPU::GetSched(Core), CreateMockThread(&Proc));
+		}
+	}
+
+	/* Reschedule must never need the global lock to make progress. */
+	pantheon::CPU::MockSetProcessorNumber(NumCores);
+	pantheon::GlobalScheduler::Lock();
+
+	std::vector<std::thread> Cores;
+	for (UINT8 Core = 0; Core < NumCores; ++Core)
+	{
+		Cores.emplace_back([Core]()
+		{
+			pantheon::CPU::MockSetProcessorNumber(Core);
+			pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Core);
+			for (UINT64 Round = 0; Round < NumRounds; ++Round)
+			{
+				Sched->Reschedule();
+			}
+		});
+	}
+
+	for (std::thread &Core : Cores)
+	{
+		Core.join();
+	}
+
+	pantheon::GlobalScheduler::Unlock();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	/* Every thread is either queued somewhere or running on some core. */
+	UINT64 Total = 0;
+	for (UINT8 Core = 0; Core < NumCores; ++Core)
+	{
+		pantheon::Scheduler *Sched = pantheon::CPU::GetSched(Core);
+		Total += Sched->CountReady();
+		if (Sched->MyThread()->MyProc() == &Proc)
+		{
+			Total++;
+		}
+	}
+	ASSERT_EQ(Total, NumCores * ThreadsPerCore);
+}
+
+TEST(Scheduler, TickAccounting)
+{
+	SetupMockCores();
+
+	/* One interrupt at the end of a 5 tick slice stands in for all 5. */
+	pantheon::CPU::ArmTick(5);
+	pantheon::MockAdvanceTicks(5);
+	ASSERT_EQ(pantheon::CPU::TimerTick(), 5);
+	ASSERT_EQ(pantheon::CPU::TicksTaken(0), 1);
+	ASSERT_EQ(pantheon::CPU::TicksSkipped(0), 4);
+
+	/* Nothing at all is taken while the tick is stopped. */
+	pantheon::CPU::StopTick();
+	pantheon::MockAdvanceTicks(10);
+	pantheon::CPU::ArmTick(1);
+	ASSERT_EQ(pantheon::CPU::TicksTaken(0), 1);
+	ASSERT_EQ(pantheon::CPU::TicksSkipped(0), 14);
+
+	pantheon::MockAdvanceTicks(1);
+	ASSERT_EQ(pantheon::CPU::TimerTick(), 1);
+	ASSERT_EQ(pantheon::CPU::TicksTaken(0), 2);
+	ASSERT_EQ(pantheon::CPU::TicksSkipped(0), 14);
+}
+
+TEST(Scheduler, TicklessIdle)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	Zero->Reschedule();
+	ASSERT_TRUE(pantheon::CPU::GetCoreInfo()->TickStopped);
+
+	pantheon::Thread *T = CreateMockThread(&Proc);
+	EnqueueMockThread(Zero, T);
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), T);
+	ASSERT_FALSE(pantheon::CPU::GetCoreInfo()->TickStopped);
+
+	/* Running out the slice takes exactly one interrupt. */
+	UINT64 Slice = T->TicksLeft();
+	pantheon::MockAdvanceTicks(Slice);
+	pantheon::AttemptReschedule();
+	ASSERT_EQ(pantheon::CPU::TicksTaken(0), 1);
+	ASSERT_EQ(pantheon::CPU::TicksSkipped(0), Slice - 1);
+}
+
+TEST(Scheduler, EnqueueWakesIdleCore)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	Zero->Reschedule();
+	UINT64 Before[MAX_NUM_CPUS];
+	for (UINT8 Core = 0; Core < MAX_NUM_CPUS; ++Core)
+	{
+		Before[Core] = pantheon::CPU::MockIPIs(Core);
+	}
+
+	/* An idle core is interrupted to run what was queued for it. */
+	EnqueueMockThread(One, CreateMockThread(&Proc));
+	ASSERT_EQ(pantheon::CPU::MockIPIs(1), Before[1] + 1);
+
+	/* A busy one gets to it by itself, unless there's enough to steal. */
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	for (UINT8 Core = 0; Core < MAX_NUM_CPUS; ++Core)
+	{
+		ASSERT_EQ(pantheon::CPU::MockIPIs(Core), Before[Core] + (Core == 1));
+	}
+
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	ASSERT_EQ(pantheon::CPU::MockIPIs(1), Before[1] + 2);
+	ASSERT_EQ(pantheon::CPU::MockIPIs(0), Before[0]);
+}
+
+static UINT64 BlockMockThread(pantheon::Thread *T, pantheon::WaitQueue *Queue, pantheon::WaitNode *Node)
+{
+	T->Lock();
+	UINT64 Token = T->BeginWait();
+	T->Unlock();
+
+	pantheon::InitWaitNode(Node, T, Token, 3);
+	Queue->Insert(Node);
+
+	T->Lock();
+	BOOL Blocked = T->Block();
+	T->Unlock();
+	EXPECT_TRUE(Blocked);
+	return Token;
+}
+
+TEST(Scheduler, WaitQueueWake)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *T = RunMockThread(One, &Proc);
+	ASSERT_EQ(One->MyThread(), T);
+
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode Node;
+	BlockMockThread(T, &Queue, &Node);
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	/* Blocked threads aren't queued anywhere. */
+	ASSERT_NE(One->MyThread(), T);
+	ASSERT_EQ(One->CountReady(), 0);
+	ASSERT_EQ(T->MyState(), pantheon::Thread::STATE_BLOCKED);
+
+	/* Waking goes back to the core it last ran on. */
+	ASSERT_EQ(Queue.WakeAll(), 1);
+	ASSERT_EQ(T->MyState(), pantheon::Thread::STATE_WAITING);
+	ASSERT_EQ(T->WakeReason(), 3);
+	ASSERT_EQ(One->CountReady(), 1);
+
+	/* Only the first wakeup counts. */
+	ASSERT_EQ(Queue.WakeAll(), 0);
+	ASSERT_EQ(One->CountReady(), 1);
+	Queue.Remove(&Node);
+}
+
+TEST(Scheduler, WaitQueueWakeBeforeBlock)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Thread *T = RunMockThread(Zero, &Proc);
+
+	T->Lock();
+	UINT64 Token = T->BeginWait();
+	T->Unlock();
+
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode Node;
+	pantheon::InitWaitNode(&Node, T, Token, 0);
+	Queue.Insert(&Node);
+	ASSERT_EQ(Queue.WakeAll(), 1);
+
+	T->Lock();
+	ASSERT_FALSE(T->Block());
+	T->Unlock();
+	ASSERT_EQ(T->MyState(), pantheon::Thread::STATE_RUNNING);
+	ASSERT_EQ(Zero->CountReady(), 0);
+	Queue.Remove(&Node);
+}
+
+TEST(Scheduler, WaitQueueWakeWhileSwitching)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Thread *T = RunMockThread(Zero, &Proc);
+
+	/* Blocked, but its core hasn't switched away yet: it has to keep running. */
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode Node;
+	BlockMockThread(T, &Queue, &Node);
+	ASSERT_EQ(Queue.WakeAll(), 1);
+	ASSERT_EQ(T->MyState(), pantheon::Thread::STATE_RUNNING);
+	ASSERT_EQ(Zero->CountReady(), 0);
+	Queue.Remove(&Node);
+}
+
+TEST(Scheduler, WaitTimeout)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Thread *T = RunMockThread(Zero, &Proc);
+
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode Node;
+	UINT64 Token = BlockMockThread(T, &Queue, &Node);
+
+	pantheon::WaitNode Timer;
+	pantheon::InitWaitNode(&Timer, T, Token, pantheon::Thread::WakeTimeout);
+	Timer.WakeAt = pantheon::GetSystemTicks() + 5;
+	Zero->AddSleeper(&Timer);
+
+	Zero->Reschedule();
+	ASSERT_NE(Zero->MyThread(), T);
+	ASSERT_FALSE(pantheon::CPU::GetCoreInfo()->TickStopped);
+
+	pantheon::MockAdvanceTicks(4);
+	Zero->Reschedule();
+	ASSERT_NE(Zero->MyThread(), T);
+
+	pantheon::MockAdvanceTicks(1);
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), T);
+	ASSERT_EQ(T->WakeReason(), pantheon::Thread::WakeTimeout);
+
+	Zero->RemoveSleeper(&Timer);
+	Queue.Remove(&Node);
+	ASSERT_EQ(Queue.WakeAll(), 0);
+}
+
+
+TEST(Scheduler, FutexWake)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	RunMockThread(pantheon::CPU::GetSched(0), &Proc);
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *T = RunMockThread(pantheon::CPU::GetSched(1), &Proc);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	UINT32 Word = 0;
+	UINT64 Key = reinterpret_cast<UINT64>(&Word);
+
+	/* Nobody sleeps on a value which already changed. */
+	ASSERT_EQ(pantheon::FutexWait(&Word, Key, 1, -1), pantheon::Result::KERN_TRY_AGAIN);
+	ASSERT_EQ(pantheon::FutexWait(&Word, Key, 0, 0), pantheon::Result::KERN_TIMED_OUT);
+	ASSERT_EQ(pantheon::FutexWake(Key, 1), 0);
+
+	pantheon::Result Status = pantheon::Result::SYS_FAIL;
+	std::thread Waiter([&]()
+	{
+		pantheon::CPU::MockSetProcessorNumber(1);
+		Status = pantheon::FutexWait(&Word, Key, 0, -1);
+	});
+
+	/* Some other futex doesn't wake it. */
+	ASSERT_EQ(pantheon::FutexWake(Key + sizeof(UINT32), 1), 0);
+	while (pantheon::FutexWake(Key, 1) == 0)
+	{
+		std::this_thread::yield();
+	}
+	Waiter.join();
+
+	ASSERT_EQ(Status, pantheon::Result::SYS_OK);
+	ASSERT_NE(T->MyState(), pantheon::Thread::STATE_BLOCKED);
+	ASSERT_EQ(pantheon::FutexWake(Key, 1), 0);
+}
+
+TEST(Scheduler, HandOff)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	/* A server waiting for a request, which isn't running anywhere. */
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode SrvNode;
+	pantheon::Thread *Srv = RunMockThread(Zero, &Proc);
+	UINT64 SrvToken = BlockMockThread(Srv, &Queue, &SrvNode);
+	Zero->Reschedule();
+	ASSERT_NE(Zero->MyThread(), Srv);
+
+	pantheon::WaitNode CliNode;
+	pantheon::Thread *Cli = RunMockThread(Zero, &Proc);
+	ASSERT_EQ(Zero->MyThread(), Cli);
+	Cli->Lock();
+	Cli->SetTicks(7);
+	Cli->Unlock();
+	UINT64 CliToken = BlockMockThread(Cli, &Queue, &CliNode);
+
+	/* The server runs on the rest of the client's time slice, and nothing gets queued. */
+	Zero->HandOff(Srv, SrvToken, 0);
+	ASSERT_EQ(Zero->MyThread(), Srv);
+	ASSERT_EQ(Srv->MyState(), pantheon::Thread::STATE_RUNNING);
+	ASSERT_EQ(Srv->TicksLeft(), 7);
+	ASSERT_EQ(Srv->WakeReason(), 0);
+	ASSERT_EQ(Cli->MyState(), pantheon::Thread::STATE_BLOCKED);
+	ASSERT_EQ(Zero->CountReady(), 0);
+
+	/* And the reply goes straight back. */
+	Queue.Remove(&SrvNode);
+	BlockMockThread(Srv, &Queue, &SrvNode);
+	Zero->HandOff(Cli, CliToken, 0);
+	ASSERT_EQ(Zero->MyThread(), Cli);
+	ASSERT_EQ(Cli->MyState(), pantheon::Thread::STATE_RUNNING);
+	ASSERT_EQ(Srv->MyState(), pantheon::Thread::STATE_BLOCKED);
+	ASSERT_EQ(Zero->CountReady(), 0);
+
+	Queue.Remove(&SrvNode);
+	Queue.Remove(&CliNode);
+}
+
+TEST(Scheduler, HandOffBeforeBlock)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	/* The server is still running on another core: it can't be taken from there. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *Srv = RunMockThread(One, &Proc);
+	Srv->Lock();
+	UINT64 SrvToken = Srv->BeginWait();
+	Srv->Unlock();
+
+	pantheon::CPU::MockSetProcessorNumber(0);
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode CliNode;
+	pantheon::Thread *Cli = RunMockThread(Zero, &Proc);
+	BlockMockThread(Cli, &Queue, &CliNode);
+
+	Zero->HandOff(Srv, SrvToken, 0);
+	ASSERT_NE(Zero->MyThread(), Srv);
+	ASSERT_NE(Zero->MyThread(), Cli);
+	ASSERT_EQ(One->MyThread(), Srv);
+	ASSERT_EQ(Srv->WakeReason(), 0);
+
+	Srv->Lock();
+	ASSERT_FALSE(Srv->Block());
+	Srv->Unlock();
+	Queue.Remove(&CliNode);
+}
+
+
+TEST(Scheduler, DeadlineAdmission)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::Thread *A = CreateMockThread(&Proc);
+	pantheon::Thread *B = CreateMockThread(&Proc);
+	pantheon::ScopedLock _A(A);
+	pantheon::ScopedLock _B(B);
+
+	/* Nonsense reservations are never made. */
+	ASSERT_FALSE(Zero->AdmitDeadline(A, 0, 10, 10));
+	ASSERT_FALSE(Zero->AdmitDeadline(A, 5, 10, 4));
+	ASSERT_FALSE(Zero->AdmitDeadline(A, 5, 10, 20));
+
+	/* Half the core fits, but not half again. */
+	ASSERT_TRUE(Zero->AdmitDeadline(A, 5, 10, 10));
+	ASSERT_TRUE(A->IsDeadline());
+	ASSERT_EQ(A->TicksLeft(), 5);
+	ASSERT_FALSE(Zero->AdmitDeadline(B, 5, 10, 10));
+	ASSERT_FALSE(B->IsDeadline());
+
+	/* A tighter deadline needs more of the core. */
+	ASSERT_FALSE(Zero->AdmitDeadline(B, 2, 20, 4));
+	ASSERT_TRUE(Zero->AdmitDeadline(B, 2, 20, 5));
+
+	Zero->ReleaseDeadline(A);
+	Zero->ReleaseDeadline(B);
+	ASSERT_FALSE(A->IsDeadline());
+	ASSERT_EQ(Zero->DeadlineLoad(), 0);
+}
+
+TEST(Scheduler, DeadlineSimulation)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	/* Runtime, period, deadline: 20% + 25% + 30% of the core. */
+	static constexpr UINT64 NumTasks = 3;
+	static constexpr UINT64 Params[NumTasks][3] = { {2, 10, 10}, {3, 15, 12}, {6, 30, 20} };
+	static constexpr UINT64 Length = 300;
+
+	/* Something which never stops running, that they all have to beat. */
+	pantheon::Thread *Hog = CreateMockThread(&Proc, pantheon::Thread::PRIORITY_VERYHIGH);
+	EnqueueMockThread(Zero, Hog);
+
+	UINT64 Start = pantheon::GetSystemTicks();
+	pantheon::Thread *Tasks[NumTasks];
+	for (UINT64 Index = 0; Index < NumTasks; ++Index)
+	{
+		Tasks[Index] = CreateMockThread(&Proc);
+		pantheon::ScopedLock _T(Tasks[Index]);
+		ASSERT_TRUE(Zero->AdmitDeadline(Tasks[Index], Params[Index][0], Params[Index][1], Params[Index][2]));
+		Zero->Enqueue(Tasks[Index]);
+	}
+	Zero->Reschedule();
+
+	/* Each task has to get exactly its runtime before every deadline. */
+	UINT64 Received[NumTasks] = {};
+	UINT64 HogTicks = 0;
+	for (UINT64 Tick = 0; Tick < Length; ++Tick)
+	{
+		pantheon::Thread *Cur = Zero->MyThread();
+		for (UINT64 Index = 0; Index < NumTasks; ++Index)
+		{
+			if (Cur == Tasks[Index])
+			{
+				Received[Index]++;
+			}
+		}
+		HogTicks += (Cur == Hog);
+
+		pantheon::MockAdvanceTicks(1);
+		pantheon::AttemptReschedule();
+
+		UINT64 Now = pantheon::GetSystemTicks() - Start;
+		for (UINT64 Index = 0; Index < NumTasks; ++Index)
+		{
+			UINT64 Period = Params[Index][1];
+			UINT64 Offset = Now % Period;
+			if (Offset == Params[Index][2])
+			{
+				ASSERT_EQ(Received[Index], Params[Index][0]) << "task " << Index << " at " << Now;
+			}
+			if (Offset == 0)
+			{
+				Received[Index] = 0;
+			}
+		}
+	}
+
+	/* Whatever wasn't reserved is still left over for everything else. */
+	ASSERT_GE(HogTicks, Length / 4);
+
+	for (UINT64 Index = 0; Index < NumTasks; ++Index)
+	{
+		pantheon::ScopedLock _T(Tasks[Index]);
+		Zero->ReleaseDeadline(Tasks[Index]);
+	}
+}
+
+
+TEST(Scheduler, AffinityEnqueue)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	/* Queued onto core 0, but only allowed on core 1. */
+	pantheon::Thread *Pinned = CreateMockThread(&Proc);
+	pantheon::Thread *Others[3];
+	{
+		pantheon::ScopedLock _T(Pinned);
+		Pinned->SetAffinity(1ULL << 1);
+		ASSERT_FALSE(Pinned->CanRunOn(0));
+	}
+	EnqueueMockThread(Zero, Pinned);
+	ASSERT_EQ(Zero->CountReady(), 0);
+	ASSERT_EQ(One->CountReady(), 1);
+
+	/* Threads only allowed on core 0 are never stolen by core 1. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Reschedule();
+	ASSERT_EQ(One->MyThread(), Pinned);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	for (pantheon::Thread *&Other : Others)
+	{
+		Other = CreateMockThread(&Proc);
+		pantheon::ScopedLock _T(Other);
+		Other->SetAffinity(1ULL << 0);
+		Zero->Enqueue(Other);
+	}
+
+	/* Core 1 would rather go idle than take any of them. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_NE(One->MyThread()->MyProc(), &Proc);
+	ASSERT_EQ(One->CountReady(), 1);
+	ASSERT_EQ(Zero->CountReady(), 3);
+}
+
+TEST(Scheduler, BalanceColdThread)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+	pantheon::Scheduler *One = pantheon::CPU::GetSched(1);
+
+	pantheon::Thread *Hot = CreateMockThread(&Proc);
+	EnqueueMockThread(Zero, Hot);
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Hot);
+
+	/* Core 0 is busy the whole time, and Hot only just stopped running there. */
+	pantheon::MockAdvanceTicks(pantheon::Scheduler::BalanceInterval);
+	Zero->Reschedule();
+	pantheon::Thread *Cold = CreateMockThread(&Proc);
+	EnqueueMockThread(Zero, Cold);
+	EnqueueMockThread(Zero, CreateMockThread(&Proc));
+	ASSERT_EQ(Zero->CountReady(), 3);
+
+	Zero->Balance();
+	ASSERT_EQ(Zero->Utilization(), pantheon::Scheduler::LoadUnit);
+	ASSERT_GT(Zero->Load(), pantheon::Scheduler::LoadUnit);
+	ASSERT_EQ(Zero->CountReady(), 3);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Balance();
+	ASSERT_EQ(One->Utilization(), 0);
+	ASSERT_EQ(One->CountReady(), 1);
+	ASSERT_EQ(Zero->CountReady(), 2);
+
+	One->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(One->MyThread(), Cold);
+
+	/* Nothing more happens until the next interval. */
+	pantheon::CPU::MockSetProcessorNumber(1);
+	One->Balance();
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(Zero->CountReady(), 2);
+}
+
+
+TEST(Scheduler, LazyFPU)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::Thread *Vector = CreateMockThread(&Proc);
+	pantheon::Thread *Integer = CreateMockThread(&Proc);
+	EnqueueMockThread(Zero, Vector);
+	EnqueueMockThread(Zero, Integer);
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Vector);
+	ASSERT_FALSE(pantheon::CPU::FPUEnabled());
+
+	/* Vector's first use traps, and gets it a clean register file. */
+	pantheon::CPU::MockFPURegs()[0] = 0xDEAD;
+	pantheon::CPU::FPUTrap();
+	ASSERT_TRUE(pantheon::CPU::FPUEnabled());
+	ASSERT_EQ(pantheon::CPU::MockFPURegs()[0], 0);
+	pantheon::CPU::MockFPURegs()[0] = 0xAAAA;
+
+	/* Switching away from a thread which used the registers saves them... */
+	UINT64 Saves = pantheon::CPU::MockFPUSaves();
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Integer);
+	ASSERT_EQ(pantheon::CPU::MockFPUSaves(), Saves + 1);
+	ASSERT_FALSE(pantheon::CPU::FPUEnabled());
+
+	/* ...but a thread which never touches them costs nothing. */
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Vector);
+	ASSERT_EQ(pantheon::CPU::MockFPUSaves(), Saves + 1);
+
+	/* Nobody else used them in between, so they're still Vector's. */
+	ASSERT_TRUE(pantheon::CPU::FPUEnabled());
+	ASSERT_EQ(pantheon::CPU::MockFPURegs()[0], 0xAAAA);
+
+	/* Once Integer uses them too, each gets its own state back. */
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Integer);
+	pantheon::CPU::FPUTrap();
+	ASSERT_EQ(pantheon::CPU::MockFPURegs()[0], 0);
+	pantheon::CPU::MockFPURegs()[0] = 0xBBBB;
+
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Vector);
+	ASSERT_FALSE(pantheon::CPU::FPUEnabled());
+	pantheon::CPU::FPUTrap();
+	ASSERT_EQ(pantheon::CPU::MockFPURegs()[0], 0xAAAA);
+
+	Zero->Reschedule();
+	ASSERT_EQ(Zero->MyThread(), Integer);
+	pantheon::CPU::FPUTrap();
+	ASSERT_EQ(pantheon::CPU::MockFPURegs()[0], 0xBBBB);
+}
+
+TEST(Scheduler, ReapExitedThreads)
+{
+	SetupMockCores();
+	pantheon::Scheduler *Zero = pantheon::CPU::GetSched(0);
+
+	pantheon::ProcessCreateInfo Info = {};
+	Info.Name = "churn";
+	pantheon::Process *Proc = pantheon::Process::Create();
+	Proc->Lock();
+	Proc->Initialize(Info);
+	Proc->SetState(pantheon::Process::STATE_RUNNING);
+	Proc->Unlock();
+	UINT32 PID = Proc->ProcessID();
+
+	/* Far more threads than there's room for at once, or IDs for. */
+	static constexpr UINT64 Rounds = 2048;
+	for (UINT64 Round = 0; Round < Rounds; ++Round)
+	{
+		pantheon::Thread *T = pantheon::Thread::Create();
+		ASSERT_NE(T, nullptr);
+		T->Initialize(Proc, nullptr, nullptr, pantheon::Thread::PRIORITY_NORMAL, TRUE);
+
+		Proc->Lock();
+		Proc->AttachThread(T);
+		pantheon::vmm::PhysicalAddress Page = 0;
+		pantheon::vmm::VirtualAddress Region = Proc->AcquireThreadLocalRegion(Page);
+		Proc->Unlock();
+
+		/* The region of the last thread gets handed out again. */
+		ASSERT_EQ(Region, pantheon::Process::ThreadLocalAddr);
+		T->Lock();
+		T->SetLocalRegion(Region, reinterpret_cast<pantheon::Thread::ThreadLocalRegion*>(pantheon::vmm::PhysicalToVirtualAddress(Page)));
+		T->Unlock();
+
+		EnqueueMockThread(Zero, T);
+		Zero->Reschedule();
+		ASSERT_EQ(Zero->MyThread(), T);
+
+		Proc->Lock();
+		T->Lock();
+		T->SetState(pantheon::Thread::STATE_TERMINATED);
+		T->Unlock();
+		ASSERT_EQ(Proc->ThreadExited(), 0);
+		if (Round == Rounds - 1)
+		{
+			Proc->SetState(pantheon::Process::STATE_ZOMBIE);
+		}
+		Proc->Unlock();
+
+		/* Nothing is freed until the core is done switching away. */
+		Zero->Reschedule();
+		ASSERT_NE(Zero->MyThread(), T);
+		Zero->Reap();
+		ASSERT_EQ(Proc->CountAttachedThreads(), 0);
+	}
+
+	/* This core still has the address space loaded, so the process stays. */
+	ASSERT_TRUE(Proc->AddressSpaceLoaded());
+	ASSERT_EQ(Proc->MyState(), pantheon::Process::STATE_ZOMBIE);
+
+	pantheon::Process Other;
+	Other.Lock();
+	Other.Initialize(Info);
+	Other.Unlock();
+	RunMockThread(Zero, &Other);
+	Zero->Reap();
+
+	/* Some lookup could still have it, so it's only freed after everyone goes by. */
+	ASSERT_EQ(pantheon::rcu::Pending(), 1);
+	PassMockGracePeriods();
+	ASSERT_EQ(pantheon::rcu::Pending(), 0);
+
+	/* Its ID is free again, and the next process gets it with a new generation. */
+	pantheon::Process Next;
+	Next.Lock();
+	Next.Initialize(Info);
+	Next.Unlock();
+	ASSERT_NE(Next.ProcessID(), PID);
+	ASSERT_EQ(Next.ProcessID() % pantheon::ProcessTable::NumSlots, PID % pantheon::ProcessTable::NumSlots);
+}
+
+TEST(Scheduler, ExitProcessKillsThreads)
+{
+	SetupMockCores();
+	pantheon::Scheduler *Scheds[4];
+	for (UINT8 Core = 0; Core < 4; ++Core)
+	{
+		Scheds[Core] = pantheon::CPU::GetSched(Core);
+	}
+
+	pantheon::ProcessCreateInfo Info = {};
+	Info.Name = "exiting";
+	pantheon::Process *Proc = pantheon::Process::Create();
+	Proc->Lock();
+	Proc->Initialize(Info);
+	Proc->SetState(pantheon::Process::STATE_RUNNING);
+	Proc->Unlock();
+
+	/* One thread exits the process, one is running elsewhere, and one is asleep. */
+	pantheon::Thread *Threads[4] = {};
+	for (UINT8 Core = 0; Core < 3; ++Core)
+	{
+		pantheon::CPU::MockSetProcessorNumber(Core);
+		Threads[Core] = RunMockThread(Scheds[Core], Proc);
+		ASSERT_EQ(Scheds[Core]->MyThread(), Threads[Core]);
+		Proc->Lock();
+		Proc->AttachThread(Threads[Core]);
+		Proc->Unlock();
+	}
+
+	pantheon::WaitQueue Queue;
+	pantheon::WaitNode Node;
+	BlockMockThread(Threads[2], &Queue, &Node);
+	Scheds[2]->Reschedule();
+	ASSERT_NE(Scheds[2]->MyThread(), Threads[2]);
+	pantheon::CPU::MockSetProcessorNumber(0);
+
+	UINT64 Running = pantheon::CPU::MockIPIs(1);
+	UINT64 Asleep = pantheon::CPU::MockIPIs(2);
+	Proc->Lock();
+	Proc->SetState(pantheon::Process::STATE_ZOMBIE);
+	Proc->KillThreads(Threads[0]);
+	Proc->Unlock();
+
+	ASSERT_FALSE(Threads[0]->ExitRequested());
+	ASSERT_TRUE(Threads[1]->ExitRequested());
+	ASSERT_TRUE(Threads[2]->ExitRequested());
+
+	/* The running one is interrupted, and the sleeping one gives up:
+	 * its core was idle, so that's interrupted to run it again. */
+	ASSERT_EQ(pantheon::CPU::MockIPIs(1), Running + 1);
+	ASSERT_EQ(pantheon::CPU::MockIPIs(2), Asleep + 1);
+	ASSERT_EQ(Threads[2]->MyState(), pantheon::Thread::STATE_WAITING);
+	ASSERT_EQ(Threads[2]->WakeReason(), pantheon::Thread::WakeTimeout);
+	Queue.Remove(&Node);
+
+	/* Nor can it start a new wait. */
+	Threads[1]->Lock();
+	Threads[1]->BeginWait();
+	ASSERT_FALSE(Threads[1]->Block());
+	Threads[1]->Unlock();
+	ASSERT_EQ(Threads[1]->WakeReason(), pantheon::Thread::WakeTimeout);
+
+	/* A thread made after that is told straight away. */
+	pantheon::CPU::MockSetProcessorNumber(3);
+	Threads[3] = CreateMockThread(Proc);
+	Proc->Lock();
+	Proc->AttachThread(Threads[3]);
+	Proc->Unlock();
+	ASSERT_TRUE(Threads[3]->ExitRequested());
+	EnqueueMockThread(Scheds[3], Threads[3]);
+	Scheds[3]->Reschedule();
+	pantheon::CPU::MockSetProcessorNumber(2);
+	Scheds[2]->Reschedule();
+
+	/* Each ends itself once it gets back to its core, and is reaped from there. */
+	for (UINT8 Core = 0; Core < 4; ++Core)
+	{
+		pantheon::CPU::MockSetProcessorNumber(Core);
+		ASSERT_EQ(Scheds[Core]->MyThread(), Threads[Core]);
+		pantheon::ExitThread();
+		ASSERT_NE(Scheds[Core]->MyThread(), Threads[Core]);
+		Scheds[Core]->Reap();
+	}
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(Proc->CountThreads(), 0);
+	ASSERT_EQ(Proc->CountAttachedThreads(), 0);
+}
+
+TEST(Scheduler, PerCoreArea)
+{
+	SetupMockCores();
+	pantheon::Process Proc;
+	pantheon::Thread *Zero = RunMockThread(pantheon::CPU::GetSched(0), &Proc);
+
+	pantheon::CPU::MockSetProcessorNumber(1);
+	pantheon::Thread *One = RunMockThread(pantheon::CPU::GetSched(1), &Proc);
+	ASSERT_EQ(pantheon::CPU::GetCurThread(), One);
+	ASSERT_EQ(pantheon::CPU::GetCoreInfo()->CoreNo, 1);
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(pantheon::CPU::GetCurThread(), Zero);
+	ASSERT_EQ(pantheon::CPU::GetCurSched(), pantheon::CPU::GetSched(0));
+
+	/* Neighbouring cores never share a cache line. */
+	UINT64 First = reinterpret_cast<UINT64>(pantheon::CPU::GetCoreArea(0));
+	UINT64 Second = reinterpret_cast<UINT64>(pantheon::CPU::GetCoreArea(1));
+	ASSERT_EQ(First % CACHE_LINE_SIZE, 0);
+	ASSERT_GE(Second - First, CACHE_LINE_SIZE);
+
+	pantheon::CPU::PerCore<UINT64> Counter;
+	Counter.On(0) = 0;
+	Counter.On(1) = 0;
+	Counter.Local()++;
+	pantheon::CPU::MockSetProcessorNumber(1);
+	Counter.Local() += 2;
+	pantheon::CPU::MockSetProcessorNumber(0);
+	ASSERT_EQ(Counter.On(0), 1);
+	ASSERT_EQ(Counter.On(1), 2);
+	ASSERT_GE(reinterpret_cast<UINT64>(&Counter.On(1)) - reinterpret_cast<UINT64>(&Counter.On(0)), CACHE_LINE_SIZE);
+}
+
+TEST(Scheduler, Simulation)
+{
+	SimConfig Config = {42, 4, 48, 4000, 6, 12, 50};
+	SimReport First = RunSchedSim(Config);
+	SimReport Second = RunSchedSim(Config);
+
+	/* Everything but the host's timing comes out exactly the same. */
+	ASSERT_EQ(First.BusyTicks, Second.BusyTicks);
+	ASSERT_EQ(First.Bursts, Second.Bursts);
+	ASSERT_EQ(First.Switches, Second.Switches);
+	ASSERT_EQ(First.Waits, Second.Waits);
+	ASSERT_EQ(First.WaitP50, Second.WaitP50);
+	ASSERT_EQ(First.WaitP99, Second.WaitP99);
+	ASSERT_EQ(First.WaitMax, Second.WaitMax);
+
+	/* There's always more work than cores, so none of them sit idle,
+	 * and nothing waits forever. */
+	ASSERT_GT(First.Bursts, 0);
+	ASSERT_GT(First.Holds, 0);
+	ASSERT_GE(First.BusyTicks, (First.Ticks * Config.NumCores * 9) / 10);
+	ASSERT_LE(First.WaitP50, First.WaitP99);
+	ASSERT_LT(First.WaitMax, First.Ticks / 4);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sched_sim.hpp"
+
+static VOID PrintSchedSim(const char *Name, const SimConfig &Config, const SimReport &Report)
+{
+	UINT64 Seconds = std::max<UINT64>(Report.Ticks / SimTicksPerSecond, 1);
+	printf("%s: %hhu cores, %lu threads, %lu ticks (seed %lu)\n",
+		Name, Config.NumCores, Config.NumThreads, Report.Ticks, Config.Seed);
+	printf("  throughput       %lu bursts/s\n", Report.Bursts / Seconds);
+	printf("  utilization      %lu%%\n", (Report.BusyTicks * 100) / (Report.Ticks * Config.NumCores));
+	printf("  switches         %lu/s\n", Report.Switches / Seconds);
+	printf("  wait (ticks)     p50 %lu, p90 %lu, p99 %lu, max %lu (%lu samples)\n",
+		Report.WaitP50, Report.WaitP90, Report.WaitP99, Report.WaitMax, Report.Waits);
+	printf("  lock hold (ns)   p50 %lu, p99 %lu, max %lu (%lu samples)\n",
+		Report.HoldP50, Report.HoldP99, Report.HoldMax, Report.Holds);
+}
+
+/* Runs a few synthetic workloads through the scheduler on the mock board,
+ * and reports how it did. Takes an optional seed. */
+int main(int argc, char **argv)
+{
+	UINT64 Seed = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 1;
+
+	struct
+	{
+		const char *Name;
+		SimConfig Config;
+	} Workloads[] =
+	{
+		{"cpu-bound", {Seed, 4, 32, 60000, 40, 10, 0}},
+		{"interactive", {Seed, 4, 64, 60000, 2, 20, 100}},
+		{"mixed", {Seed, 4, 64, 60000, 8, 16, 50}},
+		{"mixed-1core", {Seed, 1, 16, 60000, 8, 16, 50}},
+		{"mixed-8core", {Seed, 8, 128, 60000, 8, 16, 50}},
+	};
+
+	for (const auto &Workload : Workloads)
+	{
+		SimReport Report = RunSchedSim(Workload.Config);
+		PrintSchedSim(Workload.Name, Workload.Config, Report);
+	}
+
+	/* The kernel object pools are never torn down, so don't do it here either. */
+	fflush(stdout);
+	_Exit(0);
+}
@@ -1,9 +1,16 @@
+#include <algorithm>
 #include <list>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <Common/Structures/kern_bitmap.hpp>
 #include <Common/Structures/kern_slab.hpp>
+#include <Common/Structures/kern_idalloc.hpp>
+
+#include <System/Memory/kern_buddy.hpp>
+#include <System/Memory/kern_magazine.hpp>
 
 #ifndef STRUCT_TESTS_HPP_
 #define STRUCT_TESTS_HPP_
@@ -76,4 +83,231 @@ TEST(SlabAlloc, SlabDeallocInvalid)
 	free(Area);
 }
 
+TEST(IDAlloc, DenseAndRecycled)
+{
+	pantheon::IDAllocator<128> IDs(1);
+	for (UINT32 Index = 1; Index < 128; Index++)
+	{
+		ASSERT_EQ(IDs.Acquire(), Index);
+	}
+	ASSERT_EQ(IDs.Acquire(), IDs.Invalid);
+
+	/* The lowest free slot comes back first, with a new generation. */
+	ASSERT_TRUE(IDs.Release(40));
+	ASSERT_TRUE(IDs.Release(7));
+	UINT32 Again = IDs.Acquire();
+	ASSERT_EQ(IDs.SlotOf(Again), 7);
+	ASSERT_EQ(IDs.GenerationOf(Again), 1);
+	ASSERT_EQ(IDs.SlotOf(IDs.Acquire()), 40);
+}
+
+TEST(IDAlloc, StaleRejected)
+{
+	pantheon::IDAllocator<64> IDs;
+	UINT32 Old = IDs.Acquire();
+	ASSERT_TRUE(IDs.Valid(Old));
+	ASSERT_TRUE(IDs.Release(Old));
+	ASSERT_FALSE(IDs.Valid(Old));
+	ASSERT_FALSE(IDs.Release(Old));
+
+	UINT32 New = IDs.Acquire();
+	ASSERT_EQ(IDs.SlotOf(New), IDs.SlotOf(Old));
+	ASSERT_NE(New, Old);
+	ASSERT_TRUE(IDs.Valid(New));
+	ASSERT_FALSE(IDs.Valid(Old));
+	ASSERT_FALSE(IDs.Release(Old));
+	ASSERT_TRUE(IDs.Valid(New));
+}
+
+TEST(IDAlloc, ConcurrentAcquire)
+{
+	static constexpr UINT32 NumThreads = 4;
+	static constexpr UINT32 PerThread = 256;
+	pantheon::IDAllocator<NumThreads * PerThread> IDs;
+
+	std::vector<std::thread> Workers;
+	std::vector<UINT32> Taken[NumThreads];
+	for (UINT32 Index = 0; Index < NumThreads; Index++)
+	{
+		Workers.emplace_back([&IDs, &Taken, Index]()
+		{
+			/* Churn a little, so releases race with acquires. */
+			for (UINT32 Round = 0; Round < PerThread; Round++)
+			{
+				IDs.Release(IDs.Acquire());
+				Taken[Index].push_back(IDs.Acquire());
+			}
+		});
+	}
+
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+
+	std::vector<BOOL> Seen(NumThreads * PerThread, FALSE);
+	for (const std::vector<UINT32> &List : Taken)
+	{
+		for (UINT32 ID : List)
+		{
+			ASSERT_NE(ID, IDs.Invalid);
+			ASSERT_TRUE(IDs.Valid(ID));
+			ASSERT_FALSE(Seen[IDs.SlotOf(ID)]);
+			Seen[IDs.SlotOf(ID)] = TRUE;
+		}
+	}
+	ASSERT_EQ(IDs.Acquire(), IDs.Invalid);
+}
+
+/* Pretends some host memory is an area of physical memory, which starts
+ * a page past a 2 MiB boundary and ends partway through another block. */
+class BuddyArea
+{
+public:
+	static constexpr UINT64 PageSize = pantheon::vmm::SmallestPageSize;
+	static constexpr UINT64 NumPages = 1200;
+
+	BuddyArea()
+	{
+		this->Memory = static_cast<UINT8*>(aligned_alloc(pantheon::mm::BuddyAllocator::MaxBlockSize, 4 * pantheon::mm::BuddyAllocator::MaxBlockSize));
+		this->Bitmap.resize(pantheon::mm::BuddyAllocator::BitmapBytes(NumPages + 1));
+		this->Start = reinterpret_cast<UINT64>(this->Memory) + PageSize;
+		this->Buddy.Init(this->Start, NumPages, this->Bitmap.data(), this->Bitmap.size());
+	}
+
+	~BuddyArea()
+	{
+		free(this->Memory);
+	}
+
+	UINT8 *Memory;
+	UINT64 Start;
+	std::vector<UINT8> Bitmap;
+	pantheon::mm::BuddyAllocator Buddy;
+};
+
+TEST(BuddyAlloc, NaturalAlignment)
+{
+	BuddyArea Area;
+	ASSERT_EQ(Area.Buddy.FreePages(), BuddyArea::NumPages);
+
+	/* Only one whole 2 MiB block fits, and it's aligned. */
+	UINT64 Big = Area.Buddy.Alloc(pantheon::mm::BuddyAllocator::MaxOrder);
+	ASSERT_EQ(Big, reinterpret_cast<UINT64>(Area.Memory) + pantheon::mm::BuddyAllocator::MaxBlockSize);
+	ASSERT_EQ(Area.Buddy.Alloc(pantheon::mm::BuddyAllocator::MaxOrder), 0);
+	ASSERT_FALSE(Area.Buddy.IsFree(Big));
+
+	UINT64 Mid = Area.Buddy.Alloc(4);
+	ASSERT_NE(Mid, 0);
+	ASSERT_EQ((Mid - reinterpret_cast<UINT64>(Area.Memory)) % (BuddyArea::PageSize << 4), 0);
+	ASSERT_TRUE(Area.Buddy.Contains(Mid));
+
+	Area.Buddy.Free(Mid, 4);
+	Area.Buddy.Free(Big, pantheon::mm::BuddyAllocator::MaxOrder);
+	ASSERT_EQ(Area.Buddy.FreePages(), BuddyArea::NumPages);
+	ASSERT_TRUE(Area.Buddy.IsFree(Big));
+	ASSERT_FALSE(Area.Buddy.Contains(Area.Start - BuddyArea::PageSize));
+	ASSERT_FALSE(Area.Buddy.Contains(Area.Start + (BuddyArea::NumPages * BuddyArea::PageSize)));
+}
+
+TEST(BuddyAlloc, SplitAndMerge)
+{
+	BuddyArea Area;
+
+	/* Every single page comes out exactly once. */
+	std::vector<UINT64> Pages;
+	for (UINT64 Index = 0; Index < BuddyArea::NumPages; ++Index)
+	{
+		UINT64 Page = Area.Buddy.Alloc(0);
+		ASSERT_TRUE(Area.Buddy.Contains(Page));
+		Pages.push_back(Page);
+	}
+	ASSERT_EQ(Area.Buddy.Alloc(0), 0);
+	ASSERT_EQ(Area.Buddy.FreePages(), 0);
+
+	std::sort(Pages.begin(), Pages.end());
+	for (UINT64 Index = 1; Index < Pages.size(); ++Index)
+	{
+		ASSERT_EQ(Pages[Index], Pages[Index - 1] + BuddyArea::PageSize);
+	}
+
+	/* Given back in some other order, they merge back together. */
+	for (UINT64 Index = 0; Index < Pages.size(); Index += 2)
+	{
+		Area.Buddy.Free(Pages[Index], 0);
+	}
+	ASSERT_EQ(Area.Buddy.Alloc(1), 0);
+	for (UINT64 Index = 1; Index < Pages.size(); Index += 2)
+	{
+		Area.Buddy.Free(Pages[Index], 0);
+	}
+	ASSERT_EQ(Area.Buddy.FreePages(), BuddyArea::NumPages);
+	ASSERT_NE(Area.Buddy.Alloc(pantheon::mm::BuddyAllocator::MaxOrder), 0);
+}
+
+TEST(PageMagazine, Batches)
+{
+	pantheon::mm::PageMagazine Mag;
+	BOOL Clean = TRUE;
+	ASSERT_EQ(Mag.Pop(Clean), 0);
+
+	constexpr UINT64 PageSize = pantheon::vmm::SmallestPageSize;
+	for (UINT64 Index = 1; Index <= pantheon::mm::PageMagazine::Capacity; ++Index)
+	{
+		ASSERT_TRUE(Mag.Push(Index * PageSize, FALSE));
+	}
+	ASSERT_TRUE(Mag.Full());
+	ASSERT_FALSE(Mag.Push(0xDEAD000, TRUE));
+
+	/* The most recently freed page comes back first... */
+	ASSERT_EQ(Mag.Pop(Clean), pantheon::mm::PageMagazine::Capacity * PageSize);
+	ASSERT_FALSE(Clean);
+	ASSERT_TRUE(Mag.Push(0xDEAD000, FALSE));
+	ASSERT_EQ(Mag.Pop(Clean), 0xDEAD000);
+
+	/* ...and the oldest ones are drained. */
+	UINT64 Pages[pantheon::mm::PageMagazine::Batch];
+	ASSERT_EQ(Mag.Take(Pages, pantheon::mm::PageMagazine::Batch), pantheon::mm::PageMagazine::Batch);
+	for (UINT64 Index = 0; Index < pantheon::mm::PageMagazine::Batch; ++Index)
+	{
+		ASSERT_EQ(Pages[Index], (Index + 1) * PageSize);
+	}
+
+	UINT64 Left = pantheon::mm::PageMagazine::Capacity - 1 - pantheon::mm::PageMagazine::Batch;
+	ASSERT_EQ(Mag.Count(), Left);
+	ASSERT_EQ(Mag.Pop(Clean), (pantheon::mm::PageMagazine::Capacity - 1) * PageSize);
+	ASSERT_EQ(Mag.Take(Pages, pantheon::mm::PageMagazine::Batch), Left - 1);
+	ASSERT_EQ(Pages[0], (pantheon::mm::PageMagazine::Batch + 1) * PageSize);
+	ASSERT_EQ(Mag.Count(), 0);
+}
+
+TEST(PageMagazine, CleanPages)
+{
+	pantheon::mm::PageMagazine Mag;
+	constexpr UINT64 PageSize = pantheon::vmm::SmallestPageSize;
+	ASSERT_TRUE(Mag.Push(1 * PageSize, FALSE));
+	ASSERT_TRUE(Mag.Push(2 * PageSize, TRUE));
+	ASSERT_TRUE(Mag.Push(3 * PageSize, FALSE));
+	ASSERT_EQ(Mag.CleanCount(), 1);
+	ASSERT_EQ(Mag.Count(), 3);
+
+	/* Cleared pages are handed out before newer dirty ones. */
+	BOOL Clean = FALSE;
+	ASSERT_EQ(Mag.Pop(Clean), 2 * PageSize);
+	ASSERT_TRUE(Clean);
+	ASSERT_EQ(Mag.Pop(Clean), 3 * PageSize);
+	ASSERT_FALSE(Clean);
+
+	/* Dirty pages are the first to go back, whatever their age. */
+	ASSERT_TRUE(Mag.Push(4 * PageSize, TRUE));
+	ASSERT_TRUE(Mag.Push(5 * PageSize, FALSE));
+	UINT64 Pages[2];
+	ASSERT_EQ(Mag.Take(Pages, 2), 2);
+	ASSERT_EQ(Pages[0], 1 * PageSize);
+	ASSERT_EQ(Pages[1], 5 * PageSize);
+	ASSERT_EQ(Mag.PopDirty(), 0);
+	ASSERT_EQ(Mag.Pop(Clean), 4 * PageSize);
+	ASSERT_TRUE(Clean);
+}
+
 #endif
\ No newline at end of file